@@ -0,0 +1,90 @@
+/**
+ * @file BurstCapture.ino
+ * @brief Burst capture into PSRAM for M5Stack Unit CamS3-5MP
+ *
+ * This example grabs a burst of JPEG frames into a ring of PSRAM buffers
+ * with copyFrame(), which moves each frame on the GDMA while the CPU is
+ * free for other work, then writes the burst to the SD card at its own
+ * pace. Before the burst it compares how long the CPU is busy for one frame
+ * copy with memcpy() and with the copy engine.
+ */
+
+#include <CamS3Library.h>
+
+#define BURST_FRAMES 8
+#define SLOT_SIZE    (192 * 1024)
+
+uint8_t* slots[BURST_FRAMES];
+size_t lengths[BURST_FRAMES];
+uint32_t burstCount = 0;
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println("\n\n[CamS3] Burst Capture Example");
+    Serial.println("=============================");
+
+    if (!CamS3.begin(true)) {
+        Serial.println("[CamS3] Init failed!");
+        while (1) {
+            delay(1000);
+        }
+    }
+
+    // Aligned PSRAM buffers let the GDMA move the whole frame
+    for (int i = 0; i < BURST_FRAMES; i++) {
+        slots[i] = (uint8_t*)heap_caps_aligned_alloc(CAMS3_COPY_PSRAM_ALIGN, SLOT_SIZE, MALLOC_CAP_SPIRAM);
+        if (!slots[i]) {
+            Serial.println("[Burst] PSRAM allocation failed!");
+            while (1) {
+                delay(1000);
+            }
+        }
+    }
+
+    // CPU time for one frame copy, both ways
+    if (CamS3.Camera.get()) {
+        int64_t start = esp_timer_get_time();
+        memcpy(slots[0], CamS3.Camera.fb->buf, CamS3.Camera.fb->len);
+        uint32_t cpuUs = (uint32_t)(esp_timer_get_time() - start);
+
+        size_t len = CamS3.Camera.fb->len;
+        CamS3.Camera.copyFrame(slots[0], SLOT_SIZE);
+        CamS3.Camera.free();  // Waits for the copy
+
+        const cams3_copy_stats_t& stats = CamS3Copy.getStats();
+        Serial.printf("[Burst] %u byte frame: memcpy %lu us, copy engine %lu us of CPU (%lu us total, %s)\n", len,
+                      (unsigned long)cpuUs, (unsigned long)stats.lastCpuUs, (unsigned long)stats.lastUs,
+                      CamS3Copy.isDma() ? "GDMA" : "CPU fallback");
+    }
+
+    Serial.println("[CamS3] Ready!\n");
+}
+
+void loop() {
+    // Capture; anything done between copyFrame() and free() overlaps the copy
+    uint32_t start = millis();
+    int frames     = 0;
+    for (int i = 0; i < BURST_FRAMES; i++) {
+        if (!CamS3.Camera.get()) continue;
+        lengths[frames] = CamS3.Camera.fb->len;
+        if (CamS3.Camera.copyFrame(slots[frames], SLOT_SIZE)) {
+            frames++;
+        }
+        CamS3.Camera.free();
+    }
+    uint32_t captureMs = millis() - start;
+
+    // Save
+    burstCount++;
+    start = millis();
+    for (int i = 0; i < frames; i++) {
+        char path[48];
+        snprintf(path, sizeof(path), "/burst_%04lu_%d.jpg", (unsigned long)burstCount, i);
+        CamS3.Sd.writeFile(path, slots[i], lengths[i]);
+    }
+
+    Serial.printf("[Burst] %d frames captured in %lu ms, saved in %lu ms\n", frames, (unsigned long)captureMs,
+                  (unsigned long)(millis() - start));
+    delay(10000);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file CompressedLog.ino
+ * @brief Compressed diagnostic and CSV logging for M5Stack Unit CamS3-5MP
+ *
+ * This example writes a CSV row of telemetry every second and a diagnostic
+ * line for every saved frame into two compressed logs, and prints how many
+ * card bytes the compression saves. Logs are continued across reboots.
+ * Decompress them on a PC with
+ * tools/cams3_zlog.py telemetry.cs3z -o telemetry.csv
+ */
+
+#include <CamS3Library.h>
+#include <CamS3_ZLog.h>
+
+CamS3_ZLog telemetry;
+CamS3_ZLog diag;
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println("\n\n[CamS3] Compressed Log Example");
+    Serial.println("==============================");
+
+    if (!CamS3.begin(true, true)) {
+        Serial.println("[CamS3] Init failed!");
+        while (1) {
+            delay(1000);
+        }
+    }
+
+    bool isNew = !CamS3.Sd.exists("/telemetry.cs3z");
+    if (!telemetry.begin(CamS3.Sd, "/telemetry.cs3z") || !diag.begin(CamS3.Sd, "/diag.cs3z")) {
+        Serial.println("[CamS3] Failed to open the logs!");
+        while (1) {
+            delay(1000);
+        }
+    }
+    if (isNew) {
+        telemetry.println("millis,rms,peak,heap,psram,temp");
+    }
+    diag.printf("[%lu] boot, card %s, %llu MB free\n", millis(), CamS3.Sd.getCardTypeName(),
+                CamS3.Sd.getFreeBytes() >> 20);
+
+    Serial.println("[CamS3] Logging...\n");
+}
+
+void loop() {
+    telemetry.printf("%lu,%u,%u,%u,%u,%.1f\n", millis(), CamS3.Mic.getRMSLevel(), CamS3.Mic.getPeakAmplitude(),
+                     ESP.getFreeHeap(), ESP.getFreePsram(), temperatureRead());
+
+    String path = CamS3.Sd.generateFilename();
+    int64_t t   = esp_timer_get_time();
+    bool saved  = CamS3.captureToSD(path.c_str());
+    diag.printf("[%lu] %s %s in %lu ms\n", millis(), path.c_str(), saved ? "saved" : "FAILED",
+                (unsigned long)((esp_timer_get_time() - t) / 1000));
+
+    static uint32_t lastReport = 0;
+    if (millis() - lastReport >= 30000) {
+        lastReport                      = millis();
+        const cams3_zlog_stats_t& stats = telemetry.getStats();
+        Serial.printf("[Log] telemetry: %llu bytes -> %llu on card (%.1f:1), diag %.1f:1\n", stats.rawBytes,
+                      stats.packedBytes, telemetry.getRatio(), diag.getRatio());
+    }
+
+    delay(1000);
+}
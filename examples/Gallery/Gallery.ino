@@ -0,0 +1,73 @@
+/**
+ * @file Gallery.ino
+ * @brief Capture gallery server example for M5Stack Unit CamS3-5MP
+ *
+ * This example captures an image every 10 seconds, indexes it in the
+ * capture catalog with a thumbnail, and serves a paged JSON gallery:
+ *   http://<ip>/api/gallery?limit=20      newest captures
+ *   http://<ip>/api/gallery?cursor=<next> older page
+ *   http://<ip>/api/thumb?id=<id>         thumbnail (cached in PSRAM)
+ *   http://<ip>/api/image?id=<id>         full image
+ */
+
+#include <WiFi.h>
+#include <CamS3Library.h>
+#include <CamS3_Gallery.h>
+
+// WiFi credentials
+const char* ssid     = "YOUR_SSID";
+const char* password = "YOUR_PASSWORD";
+
+#define CAPTURE_INTERVAL 10000
+
+CamS3_Gallery gallery;
+httpd_handle_t server = nullptr;
+unsigned long lastCaptureTime = 0;
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println("\n\n[CamS3] Gallery Example");
+    Serial.println("=======================");
+
+    if (!CamS3.begin(true)) {
+        Serial.println("[CamS3] Initialization failed!");
+        while (1) {
+            delay(1000);
+        }
+    }
+
+    CamS3.Camera.setFrameSize(FRAMESIZE_UXGA);
+    CamS3.Sd.setThumbnails(true);
+    CamS3.Sd.openCatalog();
+    Serial.printf("[CamS3] Catalog: %lu captures\n", CamS3.Sd.getCatalog().getCount());
+
+    WiFi.begin(ssid, password);
+    WiFi.setSleep(false);
+    Serial.print("[WiFi] Connecting");
+    while (WiFi.status() != WL_CONNECTED) {
+        delay(500);
+        Serial.print(".");
+    }
+    Serial.printf("\n[WiFi] Gallery URL: http://%s/api/gallery\n", WiFi.localIP().toString().c_str());
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.stack_size     = 16384;  // Room for on-demand thumbnail generation
+    if (httpd_start(&server, &config) != ESP_OK || !gallery.begin(CamS3.Sd, 2 * 1024 * 1024) ||
+        !gallery.registerHandlers(server)) {
+        Serial.println("[Gallery] Failed to start server");
+    }
+}
+
+void loop() {
+    if (millis() - lastCaptureTime >= CAPTURE_INTERVAL) {
+        lastCaptureTime = millis();
+        CamS3.captureToSD();
+        Serial.printf("[Gallery] Captures: %lu, cache: %u KB, hits/misses: %lu/%lu\n",
+                      CamS3.Sd.getCatalog().getCount(),
+                      (unsigned)(gallery.getCacheBytes() / 1024),
+                      gallery.getCacheHits(),
+                      gallery.getCacheMisses());
+    }
+    delay(10);
+}
@@ -0,0 +1,63 @@
+/**
+ * @file HighFpsBenchmark.ino
+ * @brief High frame rate sensor presets for M5Stack Unit CamS3-5MP
+ *
+ * This example switches through the binned high frame rate presets and
+ * measures each one: delivered frame rate against the rate the preset's
+ * timing should produce, frames that arrived incomplete or with the wrong
+ * size, get() timeouts and the longest gap between frames (dropped frames
+ * show up there). JPEG output is used because every preset supports it;
+ * grayscale works too, RGB565 only for the QVGA and QQVGA presets.
+ */
+
+#include <CamS3Library.h>
+
+#define BENCH_FRAMES 240
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println("\n\n[CamS3] High FPS Benchmark Example");
+    Serial.println("==================================");
+
+    // Start at the largest preset size so every preset fits the frame buffers
+    if (!CamS3.Camera.begin(FRAMESIZE_VGA, PIXFORMAT_JPEG, 12, 2)) {
+        Serial.println("[CamS3] Camera init failed!");
+        while (1) {
+            delay(1000);
+        }
+    }
+
+    Serial.printf("[CamS3] Sensor: %s\n", CamS3.Camera.getSensorName());
+    Serial.println("[CamS3] Camera ready!\n");
+}
+
+void loop() {
+    Serial.println("[Bench] Preset      Expected  Measured  Valid    Timeouts  Max gap");
+    for (int i = 0; i < CAMS3_FPS_PRESETS; i++) {
+        cams3_fps_preset_t preset = (cams3_fps_preset_t)i;
+        if (!CamS3.Camera.setFpsPreset(preset)) {
+            Serial.printf("[Bench] %-10s  not supported\n", CamS3.Camera.getFpsPresetName(preset));
+            continue;
+        }
+
+        cams3_fps_benchmark_t result;
+        if (!CamS3.Camera.benchmarkFps(BENCH_FRAMES, &result)) {
+            Serial.printf("[Bench] %-10s  no frames (%lu timeouts)\n", CamS3.Camera.getFpsPresetName(preset),
+                          (unsigned long)result.timeouts);
+            continue;
+        }
+        Serial.printf("[Bench] %-10s  %6.1f    %6.1f    %3lu/%-3lu  %8lu  %5lu ms\n",
+                      CamS3.Camera.getFpsPresetName(preset),
+                      result.expectedFps,
+                      result.fps,
+                      (unsigned long)result.valid,
+                      (unsigned long)result.frames,
+                      (unsigned long)result.timeouts,
+                      (unsigned long)(result.maxGapUs / 1000));
+    }
+
+    CamS3.Camera.setFpsPreset(CAMS3_FPS_DEFAULT);
+    Serial.println();
+    delay(10000);
+}
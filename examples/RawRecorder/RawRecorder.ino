@@ -0,0 +1,132 @@
+/**
+ * @file RawRecorder.ino
+ * @brief Raw-sector recording and FAT throughput comparison for M5Stack Unit CamS3-5MP
+ *
+ * This example first writes the same frame repeatedly through three paths
+ * and prints the sustained rate and the worst single write of each:
+ *   - one file per frame (what saveFrame() does)
+ *   - all frames appended to one open file
+ *   - CamS3_RawLog records in a preallocated region
+ * It then records camera frames and microphone audio into the region until
+ * it is full. Copy record.cs3r to a PC and read it with
+ * tools/cams3_rawlog.py record.cs3r --extract out/
+ */
+
+#include <CamS3Library.h>
+#include <CamS3_RawLog.h>
+
+#define BENCH_FRAMES 100
+#define REGION_SIZE  (256ull * 1024 * 1024)
+#define AUDIO_BYTES  3200  // 100 ms at 16 kHz, 16-bit
+
+CamS3_RawLog rawLog;
+int16_t audio[AUDIO_BYTES / 2];
+
+static void report(const char* name, uint64_t bytes, uint32_t totalUs, uint32_t maxUs) {
+    Serial.printf("[Bench] %-16s %6lu KB/s, worst write %5lu ms\n", name,
+                  (unsigned long)(totalUs ? bytes * 1000000 / 1024 / totalUs : 0), (unsigned long)(maxUs / 1000));
+}
+
+static void benchmark(const uint8_t* frame, size_t len) {
+    uint64_t bytes = (uint64_t)len * BENCH_FRAMES;
+    CamS3.Sd.mkdir("/bench");
+
+    // One file per frame
+    uint32_t maxUs = 0;
+    int64_t start  = esp_timer_get_time();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "/bench/f%03d.jpg", i);
+        int64_t t = esp_timer_get_time();
+        CamS3.Sd.writeFile(path, frame, len);
+        uint32_t us = esp_timer_get_time() - t;
+        if (us > maxUs) maxUs = us;
+    }
+    report("file per frame", bytes, esp_timer_get_time() - start, maxUs);
+
+    // One growing file
+    File file = CamS3.Sd.getFS().open("/bench/stream.bin", FILE_WRITE);
+    maxUs     = 0;
+    start     = esp_timer_get_time();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        int64_t t = esp_timer_get_time();
+        file.write(frame, len);
+        uint32_t us = esp_timer_get_time() - t;
+        if (us > maxUs) maxUs = us;
+    }
+    file.close();
+    report("one FAT file", bytes, esp_timer_get_time() - start, maxUs);
+
+    // Raw region
+    maxUs = 0;
+    start = esp_timer_get_time();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        int64_t t = esp_timer_get_time();
+        rawLog.append(CAMS3_RAWLOG_USER, frame, len, t);
+        uint32_t us = esp_timer_get_time() - t;
+        if (us > maxUs) maxUs = us;
+    }
+    rawLog.checkpoint();
+    report("raw region", bytes, esp_timer_get_time() - start, maxUs);
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println("\n\n[CamS3] Raw Recorder Example");
+    Serial.println("============================");
+
+    if (!CamS3.begin(true, true)) {
+        Serial.println("[CamS3] Init failed!");
+        while (1) {
+            delay(1000);
+        }
+    }
+
+    // A fresh region each boot; the first run on a card takes a moment to allocate it
+    if (!rawLog.begin(CamS3.Sd, "/record.cs3r", REGION_SIZE)) {
+        Serial.println("[CamS3] Raw region unavailable!");
+        while (1) {
+            delay(1000);
+        }
+    }
+
+    if (CamS3.Camera.get()) {
+        Serial.printf("[Bench] %d x %u byte frames\n", BENCH_FRAMES, CamS3.Camera.fb->len);
+        benchmark(CamS3.Camera.fb->buf, CamS3.Camera.fb->len);
+        CamS3.Camera.free();
+    }
+
+    // Start the recording proper after the benchmark records
+    rawLog.begin(CamS3.Sd, "/record.cs3r", REGION_SIZE);
+    Serial.println("[CamS3] Recording...\n");
+}
+
+void loop() {
+    if (!rawLog.isOpen()) {
+        delay(1000);
+        return;
+    }
+
+    if (CamS3.Camera.get()) {
+        rawLog.appendFrame(CamS3.Camera.fb);
+        CamS3.Camera.free();
+    }
+    int32_t got = CamS3.Mic.read(audio, AUDIO_BYTES / 2, 0);
+    if (got > 0) {
+        rawLog.appendAudio(audio, got * 2, CamS3.Mic.getSampleRate(), 16);
+    }
+
+    static uint32_t lastReport = 0;
+    if (millis() - lastReport >= 5000) {
+        lastReport                        = millis();
+        const cams3_rawlog_stats_t& stats = rawLog.getStats();
+        Serial.printf("[Rec] %lu records, %llu/%llu MB, %lu KB/s, worst write %lu ms\n",
+                      (unsigned long)stats.records, rawLog.getUsedBytes() >> 20, rawLog.getCapacity() >> 20,
+                      (unsigned long)rawLog.getThroughputKBps(), (unsigned long)(stats.maxWriteUs / 1000));
+        if (stats.rejected) {
+            Serial.println("[Rec] Region full, recording stopped");
+            rawLog.end();
+        }
+    }
+}
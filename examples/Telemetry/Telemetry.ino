@@ -0,0 +1,86 @@
+/**
+ * @file Telemetry.ino
+ * @brief On-card telemetry time series for M5Stack Unit CamS3-5MP
+ *
+ * This example appends a row of telemetry (temperature, microphone level,
+ * free heap and PSRAM) to a time-series store every second, and once a
+ * minute queries the last ten minutes back from the card to print their
+ * averages. The store is continued across reboots: without an RTC, times
+ * are milliseconds of logging, carried on from the last stored row.
+ * Export it on a PC with
+ * tools/cams3_series.py telemetry.cs3t -o telemetry.csv
+ */
+
+#include <CamS3Library.h>
+#include <CamS3_Series.h>
+
+CamS3_Series series;
+int64_t timeBase = 0;
+
+struct Average {
+    double sum[4];
+    uint32_t rows;
+};
+
+bool addRow(int64_t timeMs, const double* values, void* arg) {
+    Average* avg = (Average*)arg;
+    for (int i = 0; i < 4; i++) {
+        avg->sum[i] += values[i];
+    }
+    avg->rows++;
+    return true;
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println("\n\n[CamS3] Telemetry Example");
+    Serial.println("=========================");
+
+    if (!CamS3.begin(true, true)) {
+        Serial.println("[CamS3] Init failed!");
+        while (1) {
+            delay(1000);
+        }
+    }
+
+    const cams3_series_column_t columns[] = {
+        {"temp", CAMS3_SERIES_FLOAT},
+        {"rms", CAMS3_SERIES_INT},
+        {"heap", CAMS3_SERIES_INT},
+        {"psram", CAMS3_SERIES_INT},
+    };
+    if (!series.begin(CamS3.Sd, "/telemetry.cs3t", columns, 4)) {
+        Serial.println("[CamS3] Failed to open the store!");
+        while (1) {
+            delay(1000);
+        }
+    }
+
+    // Times must not go backwards: continue after the newest stored row
+    timeBase = series.getLastTime() + 1000 - (int64_t)millis();
+    Serial.printf("[CamS3] %lu chunks stored, logging...\n\n", series.getChunkCount());
+}
+
+void loop() {
+    int64_t now     = timeBase + millis();
+    double values[] = {temperatureRead(), (double)CamS3.Mic.getRMSLevel(), (double)ESP.getFreeHeap(),
+                       (double)ESP.getFreePsram()};
+    series.append(now, values);
+
+    static uint32_t lastReport = 0;
+    if (millis() - lastReport >= 60000) {
+        lastReport  = millis();
+        Average avg = {};
+        uint32_t t  = millis();
+        series.query(now - 600000, now, addRow, &avg);
+        if (avg.rows) {
+            Serial.printf("[Telemetry] last 10 min: %.1f C, rms %.0f, heap %.0f, psram %.0f\n", avg.sum[0] / avg.rows,
+                          avg.sum[1] / avg.rows, avg.sum[2] / avg.rows, avg.sum[3] / avg.rows);
+            Serial.printf("[Telemetry] %lu rows from %lu chunks in %lu ms\n", avg.rows, series.getStats().queryChunks,
+                          millis() - t);
+        }
+    }
+
+    delay(1000);
+}
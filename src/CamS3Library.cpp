@@ -9,6 +9,18 @@
 
 #include "CamS3Library.h"
 #include <math.h>
+#include <time.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <driver/ledc.h>
+#include <hal/gpio_ll.h>
+#include <ff.h>
+#include <diskio_sdmmc.h>
+#include <driver/sdspi_host.h>
+#include <esp_memory_utils.h>
+#include <esp_vfs_fat.h>
+#include <img_converters.h>
 
 // Global instance
 CamS3Library CamS3;
@@ -145,28 +157,104 @@ bool CamS3_Camera::deinit() {
         return true;
     }
 
+    if (_standby) {
+        wake();
+    }
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+    // The driver deletes its SCCB bus, which fails while a device is still on it
+    if (_sccbDev) {
+        i2c_master_bus_rm_device(_sccbDev);
+        _sccbDev = nullptr;
+    }
+#endif
+
     esp_err_t err = esp_camera_deinit();
     if (err != ESP_OK) {
         return false;
     }
 
     _initialized = false;
+    _aeEnabled   = false;
+    _fpsPreset   = CAMS3_FPS_DEFAULT;
+    _fpsAecValid = false;
+    _standby     = false;
+    _wakeStartUs = 0;
+    _frameSeq    = 0;
+    _lumaSeq     = 0;
+    _stats.valid = false;
     sensor       = nullptr;
     fb           = nullptr;
+
+    ::free(_lumaBuf);
+    _lumaBuf     = nullptr;
+    _lumaBufSize = 0;
     return true;
 }
 
 bool CamS3_Camera::get() {
-    if (!_initialized) return false;
+    // No frames will come while the sensor is in standby
+    if (_standby) return false;
+
+    // A failed re-initialization is retried by the next get()
+    if (!_initialized && !(_wdtEnabled && _wdtStallStartUs)) return false;
+    if (_wdtEnabled) {
+        if (!_initialized || _vsyncStalled()) {
+            _recoverStall();
+            return false;
+        }
+        // Until VSYNC shows the sensor running again after a step, waiting for a frame can only time out
+        if (_wdtStallStartUs && _vsyncCount && _vsyncCount == _wdtStepVsync) return false;
+    }
 
-    fb = esp_camera_fb_get();
+    // A frame still held from the last get() stays held on failure, so the
+    // watchdog's flush step can return it
+    _inFbGet           = true;
+    camera_fb_t* frame = esp_camera_fb_get();
+    _inFbGet           = false;
+    if (_wdtLock) {
+        // Let a step the watchdog task started during the wait finish
+        xSemaphoreTake(_wdtLock, portMAX_DELAY);
+        xSemaphoreGive(_wdtLock);
+    }
+    if (!frame) {
+        if (_wdtEnabled) _recoverStall();
+        return false;
+    }
+    free();
+    fb = frame;
+    if (_wakeStartUs) {
+        _skipStaleFrames();
+    }
     if (!fb) {
+        if (_wdtEnabled) _recoverStall();
         return false;
     }
+
+    if (_wdtStallStartUs) {
+        _frameRecovered();
+    }
+    _frameSeq++;
+    if (_statsEnabled) {
+        _readFrameStats();
+    }
+    if (_aeEnabled) {
+        _runSoftAE();
+    }
+    if (_healthEnabled) {
+        _runHealth();
+    }
+    if (_colorEnabled && fb->format == PIXFORMAT_RGB565 && fb->len >= (size_t)fb->width * fb->height * 2) {
+        _color.apply(fb->buf, fb->width, fb->height);
+    }
     return true;
 }
 
 bool CamS3_Camera::free() {
+    if (_copyPending) {
+        CamS3Copy.wait();
+        _copyPending = false;
+    }
     if (fb) {
         esp_camera_fb_return(fb);
         fb = nullptr;
@@ -175,6 +263,14 @@ bool CamS3_Camera::free() {
     return false;
 }
 
+bool CamS3_Camera::copyFrame(uint8_t* dst, size_t cap, cams3_copy_cb_t cb, void* arg) {
+    if (!fb || !dst || fb->len > cap) return false;
+    if (!CamS3Copy.isDma()) CamS3Copy.begin();
+
+    _copyPending = CamS3Copy.copy(dst, fb->buf, fb->len, cb, arg);
+    return _copyPending;
+}
+
 cams3_sensor_type_t CamS3_Camera::getSensorType() {
     return _sensorType;
 }
@@ -192,6 +288,15 @@ const char* CamS3_Camera::getSensorName() {
     }
 }
 
+void CamS3_Camera::_beginWire() {
+    // Initialize I2C if not already done
+    static bool i2cInitialized = false;
+    if (!i2cInitialized) {
+        Wire.begin(CAMS3_SIOD_GPIO_NUM, CAMS3_SIOC_GPIO_NUM);
+        i2cInitialized = true;
+    }
+}
+
 uint8_t CamS3_Camera::_readRegister(uint8_t slaveAddr, uint16_t regAddr) {
     Wire.beginTransmission(slaveAddr);
     Wire.write((uint8_t)(regAddr >> 8));
@@ -204,14 +309,118 @@ uint8_t CamS3_Camera::_readRegister(uint8_t slaveAddr, uint16_t regAddr) {
     return 0x00;
 }
 
-cams3_hw_version_t CamS3_Camera::getHardwareVersion() {
-    // Initialize I2C if not already done
-    static bool i2cInitialized = false;
-    if (!i2cInitialized) {
-        Wire.begin(CAMS3_SIOD_GPIO_NUM, CAMS3_SIOC_GPIO_NUM);
-        i2cInitialized = true;
+// The camera driver installs the SCCB bus on this port when it gets the pins
+#if CONFIG_SCCB_HARDWARE_I2C_PORT1
+#define CAMS3_SCCB_PORT 1
+#else
+#define CAMS3_SCCB_PORT 0
+#endif
+
+bool CamS3_Camera::_readRegisters(uint16_t regAddr, uint8_t* buf, uint8_t len) {
+    if (!sensor) return false;
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+    // One auto-increment sequential read, as a device on the driver's own bus
+    if (!_sccbDev) {
+        i2c_master_bus_handle_t bus;
+        if (i2c_master_get_bus_handle((i2c_port_num_t)CAMS3_SCCB_PORT, &bus) == ESP_OK) {
+            i2c_device_config_t dev = {};
+            dev.dev_addr_length     = I2C_ADDR_BIT_LEN_7;
+            dev.device_address      = sensor->slv_addr;
+            dev.scl_speed_hz        = 100000;
+            if (i2c_master_bus_add_device(bus, &dev, &_sccbDev) != ESP_OK) _sccbDev = nullptr;
+        }
+    }
+    if (_sccbDev) {
+        uint8_t reg[2] = {(uint8_t)(regAddr >> 8), (uint8_t)regAddr};
+        return i2c_master_transmit_receive(_sccbDev, reg, sizeof(reg), buf, len, 20) == ESP_OK;
+    }
+#endif
+
+    // Bus not reachable: one driver read per register
+    for (uint8_t i = 0; i < len; i++) {
+        int value = getRegister(regAddr + i, 0xFF);
+        if (value < 0) return false;
+        buf[i] = value;
+    }
+    return true;
+}
+
+#define OV2640_REG_GAIN  0x100  // Sensor bank (bit 8): AGC gain
+#define OV2640_REG_REG04 0x104  // AEC[1:0]
+#define OV2640_REG_AEC   0x110  // AEC[9:2]
+#define OV2640_REG_REG45 0x145  // AEC[15:10]
+
+void CamS3_Camera::_readFrameStats() {
+    _stats.sequence    = _frameSeq;
+    _stats.timestampUs = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+
+    // The die sensor is slow to read and temperature drifts slowly
+    uint32_t now = millis();
+    if (!_stats.valid || now - _tempSampledMs >= 1000) {
+        _stats.chipTemperature = (int8_t)temperatureRead();
+        _tempSampledMs         = now;
+    }
+
+    uint8_t fields = 0;
+    switch (_sensorType) {
+        case CAMS3_SENSOR_OV5640:
+        case CAMS3_SENSOR_OV3660: {
+            // 0x3500-0x3502: exposure in 1/16 lines, 0x350A-0x350B: real gain, both as applied by the AEC
+            uint8_t aec[12];
+            if (_readRegisters(0x3500, aec, sizeof(aec))) {
+                _stats.exposure = (((uint32_t)(aec[0] & 0x0F) << 16) | (aec[1] << 8) | aec[2]) >> 4;
+                _stats.gainX16  = ((aec[10] & 0x03) << 8) | aec[11];
+                fields |= CAMS3_STATS_EXPOSURE | CAMS3_STATS_GAIN;
+            }
+
+            // 0x519F-0x51A4: current AWB gains (not the 0x3400 manual ones); the OV3660 has no documented copy
+            uint8_t awb[6];
+            if (_sensorType == CAMS3_SENSOR_OV5640 && _readRegisters(0x519F, awb, sizeof(awb))) {
+                _stats.awbRed   = ((awb[0] & 0x0F) << 8) | awb[1];
+                _stats.awbGreen = ((awb[2] & 0x0F) << 8) | awb[3];
+                _stats.awbBlue  = ((awb[4] & 0x0F) << 8) | awb[5];
+                fields |= CAMS3_STATS_AWB;
+            }
+            break;
+        }
+
+        case CAMS3_SENSOR_OV2640: {
+            // Scattered over the sensor bank, so one read each; the AWB gains are not readable
+            int gain = getRegister(OV2640_REG_GAIN, 0xFF);
+            int aecL = getRegister(OV2640_REG_REG04, 0x03);
+            int aecM = getRegister(OV2640_REG_AEC, 0xFF);
+            int aecH = getRegister(OV2640_REG_REG45, 0x3F);
+            if (aecL >= 0 && aecM >= 0 && aecH >= 0) {
+                _stats.exposure = (aecH << 10) | (aecM << 2) | aecL;
+                fields |= CAMS3_STATS_EXPOSURE;
+            }
+            if (gain >= 0) {
+                // Bits 7-4 each double the gain, bits 3-0 add sixteenths
+                uint32_t x16 = 16 + (gain & 0x0F);
+                for (uint8_t bit = 4; bit < 8; bit++) {
+                    if (gain & (1 << bit)) x16 *= 2;
+                }
+                _stats.gainX16 = x16;
+                fields |= CAMS3_STATS_GAIN;
+            }
+            break;
+        }
+
+        default:
+            break;
     }
 
+    if (!(fields & CAMS3_STATS_EXPOSURE)) _stats.exposure = 0;
+    if (!(fields & CAMS3_STATS_GAIN)) _stats.gainX16 = 0;
+    if (!(fields & CAMS3_STATS_AWB)) _stats.awbRed = _stats.awbGreen = _stats.awbBlue = 0;
+    _stats.fields = fields;
+    _stats.valid  = true;
+}
+
+cams3_hw_version_t CamS3_Camera::getHardwareVersion() {
+    _beginWire();
+
     // Read hardware version register (0x0200) from device 0x1f
     uint8_t version = _readRegister(0x1f, 0x0200);
     
@@ -262,6 +471,7 @@ void CamS3_Camera::ledSet(bool state) {
 
 bool CamS3_Camera::setFrameSize(framesize_t size) {
     if (!sensor) return false;
+    if (_fpsPreset != CAMS3_FPS_DEFAULT && !setFpsPreset(CAMS3_FPS_DEFAULT)) return false;
     return sensor->set_framesize(sensor, size) == 0;
 }
 
@@ -383,169 +593,1320 @@ bool CamS3_Camera::setAGCGain(int gain) {
 }
 
 // ============================================
-// Image Processing
+// Software Auto Exposure
 // ============================================
 
-bool CamS3_Camera::setSpecialEffect(int effect) {
-    if (!sensor) return false;
-    return sensor->set_special_effect(sensor, effect) == 0;
-}
+// OV5640/OV3660 registers used by the software AE loop
+#define OV_REG_GROUP_ACCESS 0x3212
+#define OV_REG_EXPOSURE_HI  0x3500
+#define OV_REG_VTS_HI       0x380E
+#define OV_REG_B50_STEP_HI  0x3A08
+#define OV_REG_B60_STEP_HI  0x3A0A
+#define OV_REG_BAND_SELECT  0x3C00
+#define OV_REG_BAND_MANUAL  0x3C01
+#define OV_REG_BAND_DETECT  0x3C0C
 
-bool CamS3_Camera::setDCW(bool enable) {
-    if (!sensor || !sensor->set_dcw) return false;
-    return sensor->set_dcw(sensor, enable ? 1 : 0) == 0;
+// AGC gain index to linear gain (x16). Approximate: the residual is
+// corrected by the next controller iteration.
+static inline uint32_t aeGainX16(uint8_t gain) {
+    return 16 + gain * 8;
 }
 
-bool CamS3_Camera::setBPC(bool enable) {
-    if (!sensor || !sensor->set_bpc) return false;
-    return sensor->set_bpc(sensor, enable ? 1 : 0) == 0;
+static inline uint8_t aeGainIndex(uint32_t gainX16) {
+    if (gainX16 <= 16) return 0;
+    return (gainX16 - 16 + 4) / 8;
 }
 
-bool CamS3_Camera::setWPC(bool enable) {
-    if (!sensor || !sensor->set_wpc) return false;
-    return sensor->set_wpc(sensor, enable ? 1 : 0) == 0;
-}
+bool CamS3_Camera::setSoftAE(bool enable, const cams3_ae_config_t* aeConfig) {
+    if (!sensor) return false;
 
-bool CamS3_Camera::setRawGMA(bool enable) {
-    if (!sensor || !sensor->set_raw_gma) return false;
-    return sensor->set_raw_gma(sensor, enable ? 1 : 0) == 0;
-}
+    if (!enable) {
+        if (!_aeEnabled) return true;
+        _aeEnabled = false;
+
+        // Back to what the application had: sensor AEC/AGC, or its manual exposure and gain
+        if (_aePrior.bandManual >= 0) setRegister(OV_REG_BAND_MANUAL, 0xFF, _aePrior.bandManual);
+        if (_aePrior.bandSelect >= 0) setRegister(OV_REG_BAND_SELECT, 0xFF, _aePrior.bandSelect);
+        bool ok = setExposureCtrl(_aePrior.aec) && setGainCtrl(_aePrior.agc);
+        if (!_aePrior.aec) ok = setAECValue(_aePrior.exposure) && ok;
+        if (!_aePrior.agc) ok = setAGCGain(_aePrior.gain) && ok;
+        return ok;
+    }
 
-bool CamS3_Camera::setLensCorrection(bool enable) {
-    if (!sensor || !sensor->set_lenc) return false;
-    return sensor->set_lenc(sensor, enable ? 1 : 0) == 0;
-}
+    if (aeConfig) {
+        _aeConfig = *aeConfig;
+    }
+    if (_aeConfig.maxGain > 30) _aeConfig.maxGain = 30;
+
+    bool omni = (_sensorType == CAMS3_SENSOR_OV5640 || _sensorType == CAMS3_SENSOR_OV3660);
+
+    // Reconfiguring a running controller keeps the state saved when it was first enabled
+    if (!_aeEnabled) {
+        _aePrior.aec        = sensor->status.aec;
+        _aePrior.agc        = sensor->status.agc;
+        _aePrior.exposure   = sensor->status.aec_value;
+        _aePrior.gain       = sensor->status.agc_gain;
+        _aePrior.bandManual = omni ? getRegister(OV_REG_BAND_MANUAL, 0xFF) : -1;
+        _aePrior.bandSelect = omni ? getRegister(OV_REG_BAND_SELECT, 0xFF) : -1;
+    }
 
-// ============================================
-// Advanced Register & Low-Level Control
-// ============================================
+    // Start from the exposure the sensor AEC settled on, so enabling is seamless
+    _aeMaxExposure = 1200;
+    _aeExposure    = sensor->status.aec_value ? sensor->status.aec_value : 300;
+    if (omni) {
+        int vtsHi = getRegister(OV_REG_VTS_HI, 0xFF);
+        int vtsLo = getRegister(OV_REG_VTS_HI + 1, 0xFF);
+        if (vtsHi >= 0 && vtsLo >= 0 && ((vtsHi << 8) | vtsLo) > 8) {
+            _aeMaxExposure = ((vtsHi << 8) | vtsLo) - 4;
+        }
+        int e0 = getRegister(OV_REG_EXPOSURE_HI, 0x0F);
+        int e1 = getRegister(OV_REG_EXPOSURE_HI + 1, 0xFF);
+        int e2 = getRegister(OV_REG_EXPOSURE_HI + 2, 0xF0);
+        if (e0 >= 0 && e1 >= 0 && e2 >= 0) {
+            uint32_t lines = ((e0 << 16) | (e1 << 8) | e2) >> 4;
+            if (lines > 0) _aeExposure = lines;
+        }
 
-int CamS3_Camera::getRegister(int reg, int mask) {
-    if (!sensor || !sensor->get_reg) return -1;
-    return sensor->get_reg(sensor, reg, mask);
-}
+        // Light-frequency detector: auto, or forced to the requested band
+        if (_aeConfig.flicker == CAMS3_FLICKER_AUTO) {
+            setRegister(OV_REG_BAND_MANUAL, 0x80, 0x00);
+        } else if (_aeConfig.flicker != CAMS3_FLICKER_OFF) {
+            setRegister(OV_REG_BAND_MANUAL, 0x80, 0x80);
+            setRegister(OV_REG_BAND_SELECT, 0x04, _aeConfig.flicker == CAMS3_FLICKER_50HZ ? 0x04 : 0x00);
+        }
+    }
+    if (_aeExposure > _aeMaxExposure) _aeExposure = _aeMaxExposure;
+    _aeGain = 0;
 
-bool CamS3_Camera::setRegister(int reg, int mask, int value) {
-    if (!sensor || !sensor->set_reg) return false;
-    return sensor->set_reg(sensor, reg, mask, value) == 0;
-}
+    if (!setExposureCtrl(false) || !setGainCtrl(false)) {
+        return false;
+    }
+    _writeExposure(_aeExposure, _aeGain);
 
-bool CamS3_Camera::setResolutionRaw(int startX, int startY, int endX, int endY,
-                                    int offsetX, int offsetY, int totalX, int totalY,
-                                    int outputX, int outputY, bool scale, bool binning) {
-    if (!sensor || !sensor->set_res_raw) return false;
-    return sensor->set_res_raw(sensor, startX, startY, endX, endY,
-                              offsetX, offsetY, totalX, totalY,
-                              outputX, outputY, scale, binning) == 0;
+    _aeSettle    = _aeConfig.settleFrames;
+    _aeConverged = false;
+    _aeEnabled   = true;
+    return true;
 }
 
-bool CamS3_Camera::setPLL(int bypass, int mul, int sys, int root, int pre, int seld5, int pclken, int pclk) {
-    if (!sensor || !sensor->set_pll) return false;
-    return sensor->set_pll(sensor, bypass, mul, sys, root, pre, seld5, pclken, pclk) == 0;
-}
+uint16_t CamS3_Camera::_bandLines() {
+    _aeFlickerHz = 0;
+    if (_aeConfig.flicker == CAMS3_FLICKER_OFF) return 0;
+    if (_sensorType != CAMS3_SENSOR_OV5640 && _sensorType != CAMS3_SENSOR_OV3660) return 0;
 
-bool CamS3_Camera::setXCLK(int timer, int xclk) {
-    if (!sensor || !sensor->set_xclk) return false;
-    return sensor->set_xclk(sensor, timer, xclk) == 0;
+    bool is50Hz = (_aeConfig.flicker == CAMS3_FLICKER_50HZ);
+    if (_aeConfig.flicker == CAMS3_FLICKER_AUTO) {
+        is50Hz = getRegister(OV_REG_BAND_DETECT, 0x01) == 1;
+    }
+
+    // Band step registers hold the number of lines in one flicker period
+    uint16_t reg = is50Hz ? OV_REG_B50_STEP_HI : OV_REG_B60_STEP_HI;
+    int hi       = getRegister(reg, 0x03);
+    int lo       = getRegister(reg + 1, 0xFF);
+    if (hi < 0 || lo < 0) return 0;
+
+    _aeFlickerHz = is50Hz ? 50 : 60;
+    return (hi << 8) | lo;
+}
+
+void CamS3_Camera::_writeExposure(uint16_t exposure, uint8_t gain) {
+    // Group hold latches exposure and gain on the same frame boundary
+    bool grouped = (_sensorType == CAMS3_SENSOR_OV5640 || _sensorType == CAMS3_SENSOR_OV3660);
+    if (grouped) setRegister(OV_REG_GROUP_ACCESS, 0xFF, 0x00);
+    setAECValue(exposure);
+    setAGCGain(gain);
+    if (grouped) {
+        setRegister(OV_REG_GROUP_ACCESS, 0xFF, 0x10);
+        setRegister(OV_REG_GROUP_ACCESS, 0xFF, 0xA0);
+    }
 }
 
-// ============================================
-// CamS3Library Implementation
-// ============================================
+void CamS3_Camera::_runSoftAE() {
+    // New settings need a few frames to reach the output, measuring earlier
+    // would double-correct
+    if (_aeSettle > 0) {
+        _aeSettle--;
+        return;
+    }
 
-bool CamS3Library::begin() {
-    return Camera.begin();
+    uint32_t hist[256];
+    if (!computeLumaHistogram(fb, hist)) return;
+
+    uint32_t count = 0;
+    uint64_t sum   = 0;
+    for (int i = 0; i < 256; i++) {
+        count += hist[i];
+        sum += (uint64_t)i * hist[i];
+    }
+    if (count == 0) return;
+
+    uint32_t mean = sum / count;
+    _aeLuma       = mean;
+
+    int32_t error = (int32_t)_aeConfig.targetLuma - (int32_t)mean;
+    if (abs(error) <= _aeConfig.tolerance) {
+        _aeConverged = true;
+        return;
+    }
+    _aeConverged = false;
+
+    // Predictive step: the sensor is linear in exposure * gain, so scaling the
+    // product by target/mean lands near the target in one update. Near the
+    // clip points the mean no longer tracks exposure, so step by fixed ratios.
+    uint32_t ratioQ8;
+    if (mean >= 240) {
+        ratioQ8 = 96;
+    } else if (mean < 8) {
+        ratioQ8 = 1024;
+    } else {
+        ratioQ8 = (_aeConfig.targetLuma * 256) / mean;
+        if (ratioQ8 < 64) ratioQ8 = 64;
+        if (ratioQ8 > 1024) ratioQ8 = 1024;
+    }
+
+    uint64_t desired = ((uint64_t)_aeExposure * aeGainX16(_aeGain) * ratioQ8) >> 8;  // lines * gain x16
+
+    // Exposure first (less noise than gain), in whole flicker periods when
+    // long enough, with gain making up the remainder
+    uint32_t exposure = desired / 16;
+    if (exposure > _aeMaxExposure) exposure = _aeMaxExposure;
+    uint16_t band = _bandLines();
+    if (band > 0 && exposure >= band) {
+        exposure = (exposure / band) * band;
+    }
+    if (exposure < 1) exposure = 1;
+
+    uint32_t gainX16 = desired / exposure;
+    uint8_t gain     = aeGainIndex(gainX16);
+    if (gain > _aeConfig.maxGain) gain = _aeConfig.maxGain;
+
+    if (exposure == _aeExposure && gain == _aeGain) {
+        return;  // At a limit, nothing left to adjust
+    }
+
+    _aeExposure = exposure;
+    _aeGain     = gain;
+    _writeExposure(_aeExposure, _aeGain);
+    _aeSettle = _aeConfig.settleFrames;
+}
+
+bool CamS3_Camera::computeLumaHistogram(camera_fb_t* frame, uint32_t* hist) {
+    if (!frame || !hist) return false;
+    memset(hist, 0, 256 * sizeof(uint32_t));
+
+    const uint8_t* buf = frame->buf;
+    size_t width       = frame->width;
+    size_t height      = frame->height;
+
+    switch (frame->format) {
+        case PIXFORMAT_JPEG: {
+            if (!_jpeg.parse(frame->buf, frame->len)) return false;
+            size_t needed = (size_t)_jpeg.getDCWidth() * _jpeg.getDCHeight();
+            if (needed > _lumaBufSize) {
+                uint8_t* grown = (uint8_t*)realloc(_lumaBuf, needed);
+                if (!grown) return false;
+                _lumaBuf     = grown;
+                _lumaBufSize = needed;
+            }
+            if (!_jpeg.decodeDC(_lumaBuf, needed)) return false;
+            _lumaSeq    = (frame == fb) ? _frameSeq : 0;
+            _lumaWidth  = _jpeg.getDCWidth();
+            _lumaHeight = _jpeg.getDCHeight();
+            for (size_t i = 0; i < needed; i++) {
+                hist[_lumaBuf[i]]++;
+            }
+            return true;
+        }
+
+        case PIXFORMAT_GRAYSCALE:
+            if (frame->len < width * height) return false;
+            for (size_t y = 0; y < height; y += 4) {
+                const uint8_t* row = buf + y * width;
+                for (size_t x = 0; x < width; x += 4) {
+                    hist[row[x]]++;
+                }
+            }
+            return true;
+
+        case PIXFORMAT_YUV422:
+            // YUYV: luma on even bytes
+            if (frame->len < width * height * 2) return false;
+            for (size_t y = 0; y < height; y += 4) {
+                const uint8_t* row = buf + y * width * 2;
+                for (size_t x = 0; x < width; x += 4) {
+                    hist[row[x * 2]]++;
+                }
+            }
+            return true;
+
+        case PIXFORMAT_RGB565:
+            // Big-endian RGB565 as delivered by the camera DMA
+            if (frame->len < width * height * 2) return false;
+            for (size_t y = 0; y < height; y += 4) {
+                const uint8_t* row = buf + y * width * 2;
+                for (size_t x = 0; x < width; x += 4) {
+                    uint16_t px = (row[x * 2] << 8) | row[x * 2 + 1];
+                    uint32_t r  = (px >> 8) & 0xF8;
+                    uint32_t g  = (px >> 3) & 0xFC;
+                    uint32_t b  = (px << 3) & 0xF8;
+                    hist[(r * 77 + g * 150 + b * 29) >> 8]++;
+                }
+            }
+            return true;
+
+        default:
+            return false;
+    }
 }
 
-bool CamS3Library::begin(bool initSD) {
-    bool camOk = Camera.begin();
-    if (!camOk) return false;
+// ============================================
+// Health Monitor
+// ============================================
 
-    if (initSD) {
-        return Sd.begin();
+bool CamS3_Camera::setHealthMonitor(bool enable, const cams3_health_config_t* healthConfig) {
+    if (healthConfig) {
+        if (healthConfig->interval == 0 || healthConfig->frozenFrames < 2) return false;
+        _healthConfig = *healthConfig;
+    }
+    if (enable && !_healthEnabled) {
+        memset(&_health, 0, sizeof(_health));
+        memset(_healthRun, 0, sizeof(_healthRun));
+        _healthHash = 0;
+        resetHealthBaseline();
     }
+    _healthEnabled = enable;
     return true;
 }
 
-bool CamS3Library::begin(bool initSD, bool initMic) {
-    bool camOk = Camera.begin();
-    if (!camOk) return false;
+void CamS3_Camera::resetHealthBaseline() {
+    _baselineQ4      = 0;
+    _baselineSamples = 0;
+    _health.baseline = 0;
+}
 
-    bool sdOk = true;
-    bool micOk = true;
+bool CamS3_Camera::_lumaPreview() {
+    if (!fb) return false;
 
-    if (initSD) {
-        sdOk = Sd.begin();
+    // Software AE may already have decoded this frame's DC image
+    if (fb->format == PIXFORMAT_JPEG) {
+        if (_lumaSeq == _frameSeq) return true;
+        uint32_t hist[256];
+        return computeLumaHistogram(fb, hist);
     }
 
-    if (initMic) {
-        micOk = Mic.begin();
+    // Raw formats: one sample per 8x8 block, same geometry as the DC image
+    size_t width  = fb->width;
+    size_t height = fb->height;
+    size_t bpp    = (fb->format == PIXFORMAT_GRAYSCALE) ? 1 : 2;
+    if (fb->format != PIXFORMAT_GRAYSCALE && fb->format != PIXFORMAT_YUV422 && fb->format != PIXFORMAT_RGB565) {
+        return false;
+    }
+    if (fb->len < width * height * bpp) return false;
+
+    uint16_t pw   = (width + 7) / 8;
+    uint16_t ph   = (height + 7) / 8;
+    size_t needed = (size_t)pw * ph;
+    if (needed > _lumaBufSize) {
+        uint8_t* grown = (uint8_t*)realloc(_lumaBuf, needed);
+        if (!grown) return false;
+        _lumaBuf     = grown;
+        _lumaBufSize = needed;
     }
 
-    return sdOk && micOk;
+    uint8_t* out = _lumaBuf;
+    for (uint16_t by = 0; by < ph; by++) {
+        size_t y           = (by * 8 + 4 < height) ? by * 8 + 4 : height - 1;
+        const uint8_t* row = fb->buf + y * width * bpp;
+        for (uint16_t bx = 0; bx < pw; bx++) {
+            size_t x = (bx * 8 + 4 < width) ? bx * 8 + 4 : width - 1;
+            if (fb->format == PIXFORMAT_RGB565) {
+                uint16_t px = (row[x * 2] << 8) | row[x * 2 + 1];
+                uint32_t r  = (px >> 8) & 0xF8;
+                uint32_t g  = (px >> 3) & 0xFC;
+                uint32_t b  = (px << 3) & 0xF8;
+                *out++      = (r * 77 + g * 150 + b * 29) >> 8;
+            } else {
+                *out++ = row[x * bpp];
+            }
+        }
+    }
+    _lumaSeq    = _frameSeq;
+    _lumaWidth  = pw;
+    _lumaHeight = ph;
+    return true;
 }
 
-bool CamS3Library::captureToSD(const char* path) {
-    if (!Camera.isInitialized()) {
-        Serial.println("[CamS3] Camera not initialized");
-        return false;
+void CamS3_Camera::_runHealth() {
+    if (_frameSeq % _healthConfig.interval != 0) return;
+    int64_t start = esp_timer_get_time();
+    if (!_lumaPreview()) return;
+
+    const uint16_t w = _lumaWidth;
+    const uint16_t h = _lumaHeight;
+    const size_t n   = (size_t)w * h;
+    if (w < 2 || h < 2) return;
+
+    // Mean, contrast and gradient energy of the preview
+    uint64_t sum   = 0;
+    uint64_t sumSq = 0;
+    uint64_t grad  = 0;
+    for (uint16_t y = 0; y < h; y++) {
+        const uint8_t* row = _lumaBuf + (size_t)y * w;
+        for (uint16_t x = 0; x < w; x++) {
+            uint32_t v = row[x];
+            sum += v;
+            sumSq += v * v;
+            if (x + 1 < w) grad += abs((int)row[x + 1] - (int)v);
+            if (y + 1 < h) grad += abs((int)row[x + w] - (int)v);
+        }
     }
-    if (!Sd.isInitialized()) {
-        Serial.println("[CamS3] SD card not initialized");
-        return false;
+    uint32_t mean     = sum / n;
+    uint32_t variance = sumSq / n - mean * mean;
+    uint32_t contrast = (uint32_t)sqrtf((float)variance);
+    uint32_t gradQ10  = (grad * 1024) / (2 * n);
+
+    // Contrast-relative, so exposure changes do not read as focus changes
+    uint32_t sharpness = gradQ10 / (contrast + 1);
+    if (sharpness > 0xFFFF) sharpness = 0xFFFF;
+
+    // A stalled pipeline hands back the same bytes; sample the buffer rather than hash all of it
+    uint32_t hash = esp_rom_crc32_le(fb->len, _lumaBuf, n);
+    size_t stride = fb->len / CAMS3_HEALTH_HASH_CHUNKS;
+    size_t chunk  = (stride < 256) ? stride : 256;
+    for (int i = 0; chunk && i < CAMS3_HEALTH_HASH_CHUNKS; i++) {
+        hash = esp_rom_crc32_le(hash, fb->buf + i * stride, chunk);
+    }
+    if (hash == _healthHash) {
+        if (_health.identicalFrames < 0xFFFF) _health.identicalFrames++;
+    } else {
+        _health.identicalFrames = 0;
+    }
+    _healthHash = hash;
+
+    bool black = mean <= _healthConfig.darkLuma;
+    bool raw[5];
+    raw[0] = black;
+    raw[1] = mean >= _healthConfig.brightLuma;
+    raw[2] = _health.identicalFrames + 1 >= _healthConfig.frozenFrames;
+    raw[3] = !black && !raw[1] && contrast < _healthConfig.minContrast;
+    raw[4] = !raw[3] && _baselineSamples >= 16 && sharpness * 100 < _health.baseline * _healthConfig.sharpnessDropPct;
+
+    // Each condition must hold (or stay clear) for holdFrames analyses before the flag changes
+    uint8_t flags = _health.flags;
+    for (int i = 0; i < 5; i++) {
+        bool raised = flags & (1 << i);
+        if (raw[i] == raised) {
+            _healthRun[i] = 0;
+        } else if (++_healthRun[i] >= _healthConfig.holdFrames) {
+            flags ^= (1 << i);
+            _healthRun[i] = 0;
+        }
     }
 
-    if (!Camera.get()) {
-        Serial.println("[CamS3] Failed to capture frame");
-        return false;
+    // Learn the scene's sharpness from healthy frames only
+    if (flags == CAMS3_HEALTH_OK && !raw[3] && !raw[4]) {
+        if (_baselineSamples == 0) {
+            _baselineQ4 = sharpness << 4;
+        } else {
+            _baselineQ4 += (int32_t)((sharpness << 4) - _baselineQ4) / 32;
+        }
+        if (_baselineSamples < 0xFFFF) _baselineSamples++;
+        _health.baseline = (_baselineSamples >= 16) ? _baselineQ4 >> 4 : 0;
     }
 
-    bool result = Sd.saveFrame(Camera.fb, path);
-    Camera.free();
+    uint8_t changed   = flags ^ _health.flags;
+    _health.flags     = flags;
+    _health.meanLuma  = mean;
+    _health.contrast  = contrast > 255 ? 255 : contrast;
+    _health.sharpness = sharpness;
+    _health.analyzeUs = esp_timer_get_time() - start;
+    if (changed) {
+        _health.events++;
+        if (_healthCb) _healthCb(&_health, changed, _healthCtx);
+    }
+}
 
-    return result;
+// ============================================
+// Capture-stall Watchdog
+// ============================================
+
+void IRAM_ATTR CamS3_Camera::_vsyncISR(void* arg) {
+    CamS3_Camera* camera = (CamS3_Camera*)arg;
+    camera->_vsyncLastUs = esp_timer_get_time();
+    camera->_vsyncCount++;
 }
 
-bool CamS3Library::recordToSD(const char* path, uint32_t durationMs) {
-    if (!Mic.isInitialized()) {
-        Serial.println("[CamS3] Microphone not initialized");
-        return false;
+void CamS3_Camera::_attachVsync() {
+    if (_vsyncAttached) return;
+    // The S3 driver takes VSYNC through the LCD_CAM peripheral, so the GPIO interrupt is free to tap it
+    _vsyncCount = 0;
+    attachInterruptArg(CAMS3_VSYNC_GPIO_NUM, _vsyncISR, this, FALLING);
+    _vsyncAttached = true;
+}
+
+void CamS3_Camera::_detachVsync() {
+    // The watchdog and flash sync share the tap
+    if (!_vsyncAttached || _wdtEnabled || _flashEnabled) return;
+    detachInterrupt(CAMS3_VSYNC_GPIO_NUM);
+    _vsyncAttached = false;
+}
+
+bool CamS3_Camera::setWatchdog(bool enable, uint32_t stallMs) {
+    if (!enable) {
+        if (_wdtTask) {
+            // Holding the lock, the task is between checks and never inside a step
+            xSemaphoreTake(_wdtLock, portMAX_DELAY);
+            vTaskDelete(_wdtTask);
+            _wdtTask = nullptr;
+            xSemaphoreGive(_wdtLock);
+        }
+        _wdtEnabled      = false;
+        _wdtStallStartUs = 0;
+        _wdtLevel        = 0;
+        _detachVsync();
+        return true;
     }
-    if (!Sd.isInitialized()) {
-        Serial.println("[CamS3] SD card not initialized");
-        return false;
+    if (stallMs == 0) return false;
+
+    if (!_wdtLock) {
+        _wdtLock = xSemaphoreCreateMutex();
+        if (!_wdtLock) return false;
     }
 
-    // Record audio
-    size_t numSamples = 0;
-    int16_t* samples = Mic.record(durationMs, &numSamples);
-    if (!samples || numSamples == 0) {
-        Serial.println("[CamS3] Recording failed");
+    _wdtStallMs = stallMs;
+    if (!_wdtEnabled) {
+        _attachVsync();
+        _vsyncSeen   = _vsyncCount;
+        _vsyncSeenUs = esp_timer_get_time();
+    }
+    _wdtEnabled = true;
+
+    if (!_wdtTask && xTaskCreate(_wdtTaskMain, "cams3_wdt", 4096, this, tskIDLE_PRIORITY + 1, &_wdtTask) != pdPASS) {
+        Serial.println("[CamS3] Failed to start watchdog task");
+        _wdtTask = nullptr;
+        setWatchdog(false);
         return false;
     }
+    return true;
+}
 
-    // Generate filename if not provided
-    String filename;
-    if (path == nullptr) {
-        filename = "/REC_" + String(millis()) + ".wav";
-    } else {
-        filename = String(path);
+void CamS3_Camera::_wdtTaskMain(void* arg) {
+    CamS3_Camera* camera = (CamS3_Camera*)arg;
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(camera->_wdtStallMs / 4) + 1);
+
+        // Only while get() waits for a frame: then nothing else uses fb or the sensor. Re-initializing
+        // would delete the frame queue under that wait, so the last step is left to get()
+        xSemaphoreTake(camera->_wdtLock, portMAX_DELAY);
+        if (camera->_inFbGet && camera->_wdtLevel < CAMS3_RECOVER_REINIT && camera->_vsyncStalled()) {
+            camera->_recoverStall();
+        }
+        xSemaphoreGive(camera->_wdtLock);
     }
+}
 
-    // Create WAV file
-    File file = SD.open(filename.c_str(), FILE_WRITE);
-    if (!file) {
-        Serial.println("[CamS3] Failed to create WAV file");
-        Mic.freeSamples(samples);
+bool CamS3_Camera::_vsyncStalled() {
+    int64_t now    = esp_timer_get_time();
+    uint32_t count = _vsyncCount;
+    if (count != _vsyncSeen) {
+        _vsyncSeen   = count;
+        _vsyncSeenUs = now;
         return false;
     }
 
-    // WAV header
-    uint32_t sampleRate = Mic.getSampleRate();
-    uint16_t bitsPerSample = Mic.getSampleBits();
-    uint16_t numChannels = 1;
-    uint32_t dataSize = numSamples * (bitsPerSample / 8);
-    uint32_t byteRate = sampleRate * numChannels * (bitsPerSample / 8);
+    // No edge ever seen means the tap is not working; rely on frame timeouts
+    if (count == 0) return false;
+    return now - _vsyncSeenUs > (int64_t)_wdtStallMs * 1000;
+}
+
+bool CamS3_Camera::_restoreSensor(const camera_status_t& st) {
+    if (!sensor) return false;
+
+    bool ok = sensor->set_pixformat(sensor, camera_config.pixel_format) == 0;
+    ok      = ok && sensor->set_framesize(sensor, st.framesize) == 0;
+    if (camera_config.pixel_format == PIXFORMAT_JPEG) {
+        sensor->set_quality(sensor, st.quality);
+    }
+    sensor->set_brightness(sensor, st.brightness);
+    sensor->set_contrast(sensor, st.contrast);
+    sensor->set_saturation(sensor, st.saturation);
+    sensor->set_sharpness(sensor, st.sharpness);
+    sensor->set_denoise(sensor, st.denoise);
+    sensor->set_gainceiling(sensor, (gainceiling_t)st.gainceiling);
+    sensor->set_special_effect(sensor, st.special_effect);
+    sensor->set_whitebal(sensor, st.awb);
+    sensor->set_awb_gain(sensor, st.awb_gain);
+    sensor->set_wb_mode(sensor, st.wb_mode);
+    sensor->set_exposure_ctrl(sensor, st.aec);
+    sensor->set_aec2(sensor, st.aec2);
+    sensor->set_ae_level(sensor, st.ae_level);
+    sensor->set_aec_value(sensor, st.aec_value);
+    sensor->set_gain_ctrl(sensor, st.agc);
+    sensor->set_agc_gain(sensor, st.agc_gain);
+    sensor->set_bpc(sensor, st.bpc);
+    sensor->set_wpc(sensor, st.wpc);
+    sensor->set_raw_gma(sensor, st.raw_gma);
+    sensor->set_lenc(sensor, st.lenc);
+    sensor->set_hmirror(sensor, st.hmirror);
+    sensor->set_vflip(sensor, st.vflip);
+    sensor->set_dcw(sensor, st.dcw);
+    sensor->set_colorbar(sensor, st.colorbar);
+    if (_fpsPreset != CAMS3_FPS_DEFAULT) {
+        ok = _applyFpsPreset(_fpsPreset) && ok;
+    }
+    return ok;
+}
+
+void CamS3_Camera::_recoverStall() {
+    int64_t now = esp_timer_get_time();
+    if (!_wdtStallStartUs) {
+        _wdtStallStartUs = now;
+        _wdtLevel        = 0;
+    }
+
+    cams3_recovery_step_t step = (cams3_recovery_step_t)_wdtLevel;
+    if (_wdtLevel < CAMS3_RECOVER_REINIT) _wdtLevel++;
+    _wdtStats.stalls++;
+    _wdtStats.steps[step]++;
+    _wdtStats.lastStep = step;
+
+    static const char* names[] = {"flush", "registers", "reset pin", "reinit"};
+    Serial.printf("[CamS3] Capture stalled, recovery step: %s\n", names[step]);
+
+    // Settings survive every step; the driver's copy is lost on reset
+    camera_status_t st = {};
+    bool haveStatus    = sensor != nullptr;
+    if (haveStatus) st = sensor->status;
+
+    switch (step) {
+        case CAMS3_RECOVER_FLUSH:
+            // A frame the application never returned starves the driver
+            free();
+            break;
+
+        case CAMS3_RECOVER_REGISTERS:
+            if (sensor && sensor->reset(sensor) == 0) {
+                _applySensorDefaults();
+                _restoreSensor(st);
+            }
+            break;
+
+        case CAMS3_RECOVER_RESET_PIN:
+            if (sensor) {
+                pinMode(CAMS3_RESET_GPIO_NUM, OUTPUT);
+                digitalWrite(CAMS3_RESET_GPIO_NUM, LOW);
+                delay(10);
+                digitalWrite(CAMS3_RESET_GPIO_NUM, HIGH);
+                delay(20);
+                if (sensor->reset(sensor) == 0) {
+                    _applySensorDefaults();
+                    _restoreSensor(st);
+                }
+            }
+            break;
+
+        default: {
+            bool ae                = _aeEnabled;
+            AePrior aePrior        = _aePrior;
+            cams3_fps_preset_t fps = _fpsPreset;
+            fb                     = nullptr;  // Owned by the driver being torn down
+            if (_initialized && !deinit()) break;
+            if (!begin(camera_config.frame_size, camera_config.pixel_format, camera_config.jpeg_quality,
+                       camera_config.fb_count)) {
+                break;
+            }
+            if (fps != CAMS3_FPS_DEFAULT) st.framesize = _fpsBaseSize;  // The preset below records it again
+            if (haveStatus) _restoreSensor(st);
+            if (fps != CAMS3_FPS_DEFAULT) setFpsPreset(fps);
+            if (ae) {
+                setSoftAE(true, &_aeConfig);
+                _aePrior = aePrior;  // Not the state restored above, which had software AE in control
+            }
+            break;
+        }
+    }
+
+    // Give the sensor one stall period to restart before the VSYNC check fires again
+    _vsyncSeen    = _vsyncCount;
+    _vsyncSeenUs  = esp_timer_get_time();
+    _wdtStepVsync = _vsyncSeen;
+}
+
+void CamS3_Camera::_frameRecovered() {
+    uint32_t ms = (esp_timer_get_time() - _wdtStallStartUs) / 1000;
+    _wdtStallStartUs = 0;
+    _wdtLevel        = 0;
+
+    _wdtStats.recoveries++;
+    _wdtTotalMs += ms;
+    _wdtStats.lastRecoveryMs = ms;
+    _wdtStats.meanRecoveryMs = _wdtTotalMs / _wdtStats.recoveries;
+    if (ms > _wdtStats.maxRecoveryMs) _wdtStats.maxRecoveryMs = ms;
+    Serial.printf("[CamS3] Capture recovered in %lu ms\n", (unsigned long)ms);
+}
+
+bool CamS3_Camera::encodeJpeg(camera_fb_t* frame, uint8_t quality, uint8_t** out, size_t* outLen, uint8_t bands) {
+    if (!frame || frame->format != PIXFORMAT_RGB565) return false;
+    if (frame->len < (size_t)frame->width * frame->height * 2) return false;
+    return _encoder.encode(frame->buf, frame->width, frame->height, quality, out, outLen, bands);
+}
+
+// ============================================
+// Sensor Standby
+// ============================================
+
+#define OV_REG_SYSTEM_CTRL 0x3008  // Bit 6: software power down
+#define OV2640_REG_COM2    0x109   // Sensor bank; bit 4: standby
+
+static inline int64_t frameStartUs(const camera_fb_t* frame) {
+    // The driver stamps frames with esp_timer at VSYNC
+    return (int64_t)frame->timestamp.tv_sec * 1000000 + frame->timestamp.tv_usec;
+}
+
+static bool sensorStandby(CamS3_Camera* camera, bool enable) {
+    switch (camera->getSensorType()) {
+        case CAMS3_SENSOR_OV5640:
+        case CAMS3_SENSOR_OV3660:
+            return camera->setRegister(OV_REG_SYSTEM_CTRL, 0x40, enable ? 0x40 : 0x00);
+        case CAMS3_SENSOR_OV2640:
+            return camera->setRegister(OV2640_REG_COM2, 0x10, enable ? 0x10 : 0x00);
+        default:
+            return false;
+    }
+}
+
+bool CamS3_Camera::standby() {
+    if (!_initialized || !sensor) return false;
+    if (_standby) return true;
+
+    if (!sensorStandby(this, true)) {
+        Serial.printf("[CamS3] Standby not supported on %s\n", getSensorName());
+        return false;
+    }
+    // SCCB is done; without XCLK the sensor drives no PCLK, so the capture DMA idles
+    ledc_timer_pause(LEDC_LOW_SPEED_MODE, camera_config.ledc_timer);
+    _standby     = true;
+    _wakeStartUs = 0;
+    _standbyStats.standbys++;
+    return true;
+}
+
+bool CamS3_Camera::wake() {
+    if (!_standby) return true;
+
+    int64_t start = esp_timer_get_time();
+    ledc_timer_resume(LEDC_LOW_SPEED_MODE, camera_config.ledc_timer);
+    delayMicroseconds(100);  // A few hundred XCLK cycles before the sensor takes SCCB writes
+    if (!sensorStandby(this, false)) {
+        ledc_timer_pause(LEDC_LOW_SPEED_MODE, camera_config.ledc_timer);
+        return false;
+    }
+    _standby     = false;
+    _wakeStartUs = start;
+
+    // Give the sensor one stall period to restart before the VSYNC check fires again
+    _vsyncSeen   = _vsyncCount;
+    _vsyncSeenUs = esp_timer_get_time();
+    return true;
+}
+
+void CamS3_Camera::_skipStaleFrames() {
+    // Frames queued before standby, or cut short by it, started before wake()
+    uint8_t tries = camera_config.fb_count + 1;
+    while (fb && frameStartUs(fb) < _wakeStartUs && tries-- > 0) {
+        esp_camera_fb_return(fb);
+        _standbyStats.staleFrames++;
+        fb = esp_camera_fb_get();
+    }
+    if (!fb || frameStartUs(fb) < _wakeStartUs) return;  // Measured on the next frame
+
+    // From the frame's VSYNC stamp, so time before the caller asked for it does not count
+    uint32_t us  = (uint32_t)(frameStartUs(fb) - _wakeStartUs);
+    _wakeStartUs = 0;
+    _wakeTotalUs += us;
+    _standbyStats.wakes++;
+    _standbyStats.lastWakeUs = us;
+    _standbyStats.meanWakeUs = _wakeTotalUs / _standbyStats.wakes;
+    if (us > _standbyStats.maxWakeUs) _standbyStats.maxWakeUs = us;
+}
+
+// ============================================
+// Exposure-synchronized Flash
+// ============================================
+
+#define FLASH_LEAD_US 2000  // Least time between scheduling and switching the LED on
+
+// Run from the esp_timer ISR where the configuration allows it, so the edges do not wait behind other
+// esp_timer task callbacks; the LED is driven through the inline GPIO HAL, which is safe from IRAM
+void IRAM_ATTR CamS3_Camera::_flashOnCb(void* arg) {
+    CamS3_Camera* camera = (CamS3_Camera*)arg;
+    gpio_ll_set_level(&GPIO, CAMS3_LED_GPIO, 0);  // Active-low LED
+    camera->_flashOnUs = esp_timer_get_time();
+}
+
+void IRAM_ATTR CamS3_Camera::_flashOffCb(void* arg) {
+    CamS3_Camera* camera = (CamS3_Camera*)arg;
+    gpio_ll_set_level(&GPIO, CAMS3_LED_GPIO, 1);
+    camera->_flashOffUs = esp_timer_get_time();
+}
+
+bool CamS3_Camera::setFlashSync(bool enable) {
+    if (!enable) {
+        if (_flashOn) {
+            esp_timer_stop(_flashOn);
+            esp_timer_delete(_flashOn);
+        }
+        if (_flashOff) {
+            esp_timer_stop(_flashOff);
+            esp_timer_delete(_flashOff);
+        }
+        _flashOn      = nullptr;
+        _flashOff     = nullptr;
+        _flashEnabled = false;
+        ledOff();
+        _detachVsync();
+        return true;
+    }
+    if (_flashEnabled) return true;
+
+    esp_timer_create_args_t args = {};
+    args.arg                     = this;
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+    args.dispatch_method = ESP_TIMER_ISR;
+#else
+    args.dispatch_method = ESP_TIMER_TASK;
+#endif
+    args.callback                = _flashOnCb;
+    args.name                    = "cams3_flash_on";
+    if (esp_timer_create(&args, &_flashOn) != ESP_OK) return false;
+    args.callback = _flashOffCb;
+    args.name     = "cams3_flash_off";
+    if (esp_timer_create(&args, &_flashOff) != ESP_OK) {
+        esp_timer_delete(_flashOn);
+        _flashOn = nullptr;
+        return false;
+    }
+
+    _attachVsync();
+    _flashEnabled = true;
+    return true;
+}
+
+bool CamS3_Camera::_waitVsync(int64_t& us, uint32_t timeoutMs) {
+    // The edge time comes from the ISR, so polling at tick rate costs no accuracy
+    uint32_t count = _vsyncCount;
+    uint32_t start = millis();
+    while (_vsyncCount == count) {
+        if (millis() - start > timeoutMs) return false;
+        vTaskDelay(1);
+    }
+    us = _vsyncLastUs;
+    return true;
+}
+
+void CamS3_Camera::_flashTiming(uint32_t frameUs, uint32_t& exposureUs, uint32_t& readoutUs) {
+    // Without timing registers, light two whole frame periods around the target VSYNC
+    exposureUs = frameUs;
+    readoutUs  = frameUs;
+    if (_sensorType != CAMS3_SENSOR_OV5640 && _sensorType != CAMS3_SENSOR_OV3660) return;
+
+    // 0x3500-0x3502: exposure in 1/16 lines; 0x3802/0x3806: window start/end Y, 0x380E: VTS,
+    // 0x3815: Y subsampling
+    uint8_t aec[3];
+    uint8_t startReg[2];
+    uint8_t endReg[2];
+    uint8_t vtsReg[2];
+    uint8_t inc;
+    if (!_readRegisters(0x3500, aec, sizeof(aec)) || !_readRegisters(0x3802, startReg, sizeof(startReg)) ||
+        !_readRegisters(0x3806, endReg, sizeof(endReg)) || !_readRegisters(0x380E, vtsReg, sizeof(vtsReg)) ||
+        !_readRegisters(0x3815, &inc, 1)) {
+        return;
+    }
+    uint32_t lines  = (((uint32_t)(aec[0] & 0x0F) << 16) | (aec[1] << 8) | aec[2]) >> 4;
+    uint32_t startY = ((startReg[0] & 0x07) << 8) | startReg[1];
+    uint32_t endY   = ((endReg[0] & 0x07) << 8) | endReg[1];
+    uint32_t vts    = (vtsReg[0] << 8) | vtsReg[1];
+    uint32_t step   = ((inc >> 4) + (inc & 0x0F)) / 2;
+    if (vts == 0 || endY <= startY) return;
+    if (step == 0) step = 1;
+
+    // A long exposure stretches the frame past VTS, and the measured period with it
+    float lineUs = (float)frameUs / (lines + 4 > vts ? lines + 4 : vts);
+    exposureUs   = (uint32_t)(lines * lineUs);
+    readoutUs    = (uint32_t)((endY - startY + 1) / step * lineUs);
+    if (readoutUs > frameUs) readoutUs = frameUs;
+}
+
+bool CamS3_Camera::captureFlash(cams3_flash_result_t* result) {
+    cams3_flash_result_t r = {};
+    if (result) *result = r;
+    if (!_flashEnabled || !_initialized || _standby) return false;
+
+    // Frame period from two consecutive edges
+    int64_t v0, v1;
+    if (!_waitVsync(v0, 1000) || !_waitVsync(v1, 1000)) {
+        Serial.println("[CamS3] Flash: no VSYNC");
+        return false;
+    }
+    r.frameUs = (uint32_t)(v1 - v0);
+    _flashTiming(r.frameUs, r.exposureUs, r.readoutUs);
+
+    // Row 0 of the frame read from `target` integrates from target - exposure; the last row is
+    // read at target + readout. Pick the first VSYNC whose window is still ahead.
+    int64_t now    = esp_timer_get_time();
+    int64_t target = v1 + r.frameUs;
+    while (target - (int64_t)r.exposureUs - CAMS3_FLASH_GUARD_US < now + FLASH_LEAD_US) {
+        target += r.frameUs;
+    }
+    int64_t onAt  = target - r.exposureUs - CAMS3_FLASH_GUARD_US;
+    int64_t offAt = target + r.readoutUs + CAMS3_FLASH_GUARD_US;
+
+    _flashOnUs  = 0;
+    _flashOffUs = 0;
+    now         = esp_timer_get_time();
+    esp_timer_start_once(_flashOn, onAt - now);
+    esp_timer_start_once(_flashOff, offAt - now);
+
+    // Frames that started before the target were exposed without (or with part of) the flash
+    bool found       = false;
+    uint32_t waitMs  = (uint32_t)((offAt - now) / 1000) + 2 * r.frameUs / 1000 + 1000;
+    uint32_t started = millis();
+    while (millis() - started < waitMs) {
+        if (!get()) continue;
+        int64_t ts = frameStartUs(fb);
+        if (ts < target - (int64_t)r.frameUs / 2) {
+            free();
+            r.staleFrames++;
+            continue;
+        }
+        r.frameErrorUs = (int32_t)(ts - target);
+        found          = ts < target + (int64_t)r.frameUs / 2;
+        break;
+    }
+
+    // The target frame ends with the readout, so the off switch is due by now
+    started = millis();
+    while (!_flashOffUs && millis() - started < 100) {
+        vTaskDelay(1);
+    }
+    if (!_flashOffUs) {
+        esp_timer_stop(_flashOn);
+        esp_timer_stop(_flashOff);
+        ledOff();
+    }
+
+    int64_t onUs  = _flashOnUs;
+    int64_t offUs = _flashOffUs;
+    if (onUs && offUs) {
+        r.onTimeUs   = (uint32_t)(offUs - onUs);
+        r.onErrorUs  = (int32_t)(onUs - onAt);
+        r.offErrorUs = (int32_t)(offUs - offAt);
+        r.covered    = found && onUs <= target - (int64_t)r.exposureUs && offUs >= target + (int64_t)r.readoutUs;
+    }
+    if (result) *result = r;
+
+    if (!found && fb) {
+        free();  // A later frame: the target was dropped
+    }
+    return found;
+}
+
+// ============================================
+// High Frame Rate Presets
+// ============================================
+
+// OV5640 clock tree and AEC limit registers
+#define OV_REG_PLL_BIT_MODE 0x3034
+#define OV_REG_PLL_SYS_DIV  0x3035
+#define OV_REG_PLL_MULT     0x3036
+#define OV_REG_PLL_PRE_DIV  0x3037  // Pre-divider, bit 4 root divider
+#define OV_REG_CLOCK_DIV    0x3108  // SCLK and PCLK root dividers
+#define OV_REG_PCLK_DIV     0x3824
+#define OV_REG_PCLK_MANUAL  0x460C
+#define OV_REG_AEC_CTRL     0x3A00
+#define OV_REG_MAX_EXPO_60  0x3A02
+#define OV_REG_B60_MAX      0x3A0D
+#define OV_REG_B50_MAX      0x3A0E
+#define OV_REG_MAX_EXPO_50  0x3A14
+
+// Saved on the first preset switch and written back by CAMS3_FPS_DEFAULT
+static const uint16_t kFpsAecRegs[] = {0x3A00, 0x3A02, 0x3A03, 0x3A08, 0x3A09, 0x3A0A,
+                                       0x3A0B, 0x3A0D, 0x3A0E, 0x3A14, 0x3A15};
+
+typedef struct {
+    framesize_t frameSize;
+    uint16_t startX, startY, endX, endY;  // Array window
+    uint8_t offsetX, offsetY;             // Crop inside the binned window
+    uint16_t hts, vts;                    // Line length in SCLK cycles, frame length in lines
+    uint8_t preDiv, mult;                 // VCO = XCLK / preDiv * mult
+    uint8_t pclkDiv;                      // DVP PCLK = VCO / 5 / pclkDiv
+    uint8_t maxBytesPerPixel;             // DVP bandwidth: 1 = JPEG or grayscale only
+} ov_fps_timing_t;
+
+// SCLK = VCO / 2.5 (10-bit PLL mode) / 2 (0x3108), FPS = SCLK / (HTS * VTS).
+// The full-view modes bin the whole 2624x1944 array to 1312x972, the crop
+// modes bin the central 1312x976 to 656x488; the ISP scales to the output.
+static const ov_fps_timing_t kOv5640Fps[CAMS3_FPS_PRESETS] = {
+    {FRAMESIZE_INVALID, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {FRAMESIZE_QVGA, 0, 4, 2623, 1947, 16, 6, 1896, 984, 2, 56, 5, 2},      // 60.0 fps at 20 MHz
+    {FRAMESIZE_VGA, 0, 4, 2623, 1947, 16, 6, 1896, 984, 2, 56, 5, 1},       // 60.0 fps
+    {FRAMESIZE_QVGA, 656, 488, 1967, 1463, 8, 4, 1896, 500, 2, 57, 5, 2},   // 120.3 fps
+    {FRAMESIZE_QQVGA, 656, 488, 1967, 1463, 8, 4, 1896, 500, 2, 57, 8, 2},  // 120.3 fps
+};
+
+static const char* const kFpsPresetNames[CAMS3_FPS_PRESETS] = {"Default", "QVGA 60", "VGA 60", "QVGA 120",
+                                                               "QQVGA 120"};
+
+static uint32_t fpsSclk(const ov_fps_timing_t& t, uint32_t xclk) {
+    return (uint32_t)((uint64_t)xclk * t.mult / ((uint32_t)t.preDiv * 5));
+}
+
+const char* CamS3_Camera::getFpsPresetName(cams3_fps_preset_t preset) {
+    if (preset >= CAMS3_FPS_PRESETS) return "Unknown";
+    return kFpsPresetNames[preset];
+}
+
+float CamS3_Camera::getExpectedFps(cams3_fps_preset_t preset) {
+    if (preset == CAMS3_FPS_DEFAULT || preset >= CAMS3_FPS_PRESETS) return 0.0f;
+    if (_sensorType != CAMS3_SENSOR_OV5640) return 0.0f;
+
+    const ov_fps_timing_t& t = kOv5640Fps[preset];
+    uint32_t xclk            = (sensor && sensor->xclk_freq_hz) ? sensor->xclk_freq_hz : camera_config.xclk_freq_hz;
+    return (float)fpsSclk(t, xclk) / ((float)t.hts * t.vts);
+}
+
+bool CamS3_Camera::setFpsPreset(cams3_fps_preset_t preset) {
+    if (!sensor || preset >= CAMS3_FPS_PRESETS) return false;
+
+    if (preset == CAMS3_FPS_DEFAULT) {
+        if (_fpsPreset == CAMS3_FPS_DEFAULT) return true;
+        // The driver reprograms window, binning and PLL for the size in effect before the preset
+        bool ok = sensor->set_framesize(sensor, _fpsBaseSize) == 0;
+        if (_fpsAecValid) {
+            for (size_t i = 0; i < sizeof(kFpsAecRegs) / sizeof(kFpsAecRegs[0]); i++) {
+                ok = setRegister(kFpsAecRegs[i], 0xFF, _fpsAecSaved[i]) && ok;
+            }
+        }
+        _fpsPreset = CAMS3_FPS_DEFAULT;
+        return ok;
+    }
+
+    if (_sensorType != CAMS3_SENSOR_OV5640) {
+        Serial.printf("[CamS3] No high frame rate presets for %s\n", getSensorName());
+        return false;
+    }
+
+    // Raw frame buffers were sized by begin(), and the DVP bus limits bytes per line
+    const ov_fps_timing_t& t      = kOv5640Fps[preset];
+    const resolution_info_t& want = resolution[t.frameSize];
+    const resolution_info_t& have = resolution[camera_config.frame_size];
+    if ((uint32_t)want.width * want.height > (uint32_t)have.width * have.height) {
+        Serial.printf("[CamS3] %s needs begin() with at least %ux%u\n", kFpsPresetNames[preset], want.width,
+                      want.height);
+        return false;
+    }
+    uint8_t bpp = 0;
+    if (sensor->pixformat == PIXFORMAT_GRAYSCALE) {
+        bpp = 1;
+    } else if (sensor->pixformat != PIXFORMAT_JPEG) {
+        bpp = 2;
+    }
+    if (bpp > t.maxBytesPerPixel) {
+        Serial.printf("[CamS3] %s needs JPEG or grayscale output\n", kFpsPresetNames[preset]);
+        return false;
+    }
+
+    if (!_fpsAecValid) {
+        for (size_t i = 0; i < sizeof(kFpsAecRegs) / sizeof(kFpsAecRegs[0]); i++) {
+            int value = getRegister(kFpsAecRegs[i], 0xFF);
+            if (value < 0) return false;
+            _fpsAecSaved[i] = value;
+        }
+        _fpsAecValid = true;
+    }
+
+    // Switching between presets keeps the size from before the first one
+    if (_fpsPreset == CAMS3_FPS_DEFAULT) _fpsBaseSize = sensor->status.framesize;
+
+    if (!_applyFpsPreset(preset)) {
+        Serial.printf("[CamS3] Failed to apply %s\n", kFpsPresetNames[preset]);
+        return false;
+    }
+    _fpsPreset = preset;
+    return true;
+}
+
+bool CamS3_Camera::_applyFpsPreset(cams3_fps_preset_t preset) {
+    const ov_fps_timing_t& t      = kOv5640Fps[preset];
+    const resolution_info_t& size = resolution[t.frameSize];
+
+    // The driver sets up the output path for the frame size, then the preset replaces its timing
+    bool ok = sensor->set_framesize(sensor, t.frameSize) == 0;
+    ok      = ok && setResolutionRaw(t.startX, t.startY, t.endX, t.endY, t.offsetX, t.offsetY, t.hts, t.vts,
+                                     size.width, size.height, true, true);
+    ok      = ok && setRegister(OV_REG_PLL_BIT_MODE, 0xFF, 0x1A);
+    ok      = ok && setRegister(OV_REG_PLL_SYS_DIV, 0xFF, 0x11);
+    ok      = ok && setRegister(OV_REG_PLL_MULT, 0xFF, t.mult);
+    ok      = ok && setRegister(OV_REG_PLL_PRE_DIV, 0xFF, t.preDiv & 0x0F);
+    ok      = ok && setRegister(OV_REG_CLOCK_DIV, 0xFF, 0x01);
+    ok      = ok && setRegister(OV_REG_PCLK_DIV, 0xFF, t.pclkDiv);
+    ok      = ok && setRegister(OV_REG_PCLK_MANUAL, 0xFF, 0x22);
+    if (!ok) return false;
+
+    // AEC may otherwise stretch the frame past VTS; band steps follow the new line time
+    uint32_t xclk     = sensor->xclk_freq_hz ? sensor->xclk_freq_hz : camera_config.xclk_freq_hz;
+    uint32_t lineRate = fpsSclk(t, xclk) / t.hts;
+    uint16_t b50      = lineRate / 100;
+    uint16_t b60      = lineRate / 120;
+    uint8_t bands50   = b50 ? t.vts / b50 : 0;
+    uint8_t bands60   = b60 ? t.vts / b60 : 0;
+    ok                = setRegister(OV_REG_MAX_EXPO_60, 0xFF, t.vts >> 8);
+    ok                = ok && setRegister(OV_REG_MAX_EXPO_60 + 1, 0xFF, t.vts & 0xFF);
+    ok                = ok && setRegister(OV_REG_MAX_EXPO_50, 0xFF, t.vts >> 8);
+    ok                = ok && setRegister(OV_REG_MAX_EXPO_50 + 1, 0xFF, t.vts & 0xFF);
+    ok                = ok && setRegister(OV_REG_B50_STEP_HI, 0x03, b50 >> 8);
+    ok                = ok && setRegister(OV_REG_B50_STEP_HI + 1, 0xFF, b50 & 0xFF);
+    ok                = ok && setRegister(OV_REG_B60_STEP_HI, 0x03, b60 >> 8);
+    ok                = ok && setRegister(OV_REG_B60_STEP_HI + 1, 0xFF, b60 & 0xFF);
+    ok                = ok && setRegister(OV_REG_B50_MAX, 0x3F, bands50);
+    ok                = ok && setRegister(OV_REG_B60_MAX, 0x3F, bands60);
+
+    // A frame shorter than one mains half-cycle cannot be banded
+    ok = ok && setRegister(OV_REG_AEC_CTRL, 0x20, (bands50 && bands60) ? 0x20 : 0x00);
+    return ok;
+}
+
+bool CamS3_Camera::benchmarkFps(uint16_t frames, cams3_fps_benchmark_t* result) {
+    if (!result) return false;
+    *result             = {};
+    result->expectedFps = getExpectedFps(_fpsPreset);
+    if (!_initialized || frames < 2) return false;
+
+    // Let a preset switch settle and drop frames queued under the old timing
+    for (uint8_t i = 0; i < 3; i++) {
+        if (get()) free();
+    }
+
+    int64_t firstUs = 0;
+    int64_t lastUs  = 0;
+    while (result->frames < frames && result->timeouts < frames) {
+        if (!get()) {
+            result->timeouts++;
+            continue;
+        }
+        int64_t ts = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+        if (result->frames == 0) {
+            firstUs = ts;
+        } else if (ts - lastUs > result->maxGapUs) {
+            result->maxGapUs = ts - lastUs;
+        }
+        lastUs = ts;
+        result->frames++;
+
+        // Complete payload for the size the driver reports
+        const resolution_info_t& size = resolution[sensor->status.framesize];
+        bool valid                    = fb->width == size.width && fb->height == size.height;
+        if (fb->format == PIXFORMAT_JPEG) {
+            valid = valid && fb->len > 4 && fb->buf[0] == 0xFF && fb->buf[1] == 0xD8;
+            bool eoi = false;
+            for (size_t i = fb->len > 32 ? fb->len - 32 : 0; valid && i + 1 < fb->len; i++) {
+                if (fb->buf[i] == 0xFF && fb->buf[i + 1] == 0xD9) eoi = true;
+            }
+            valid = valid && eoi;
+        } else {
+            size_t bpp = (fb->format == PIXFORMAT_GRAYSCALE) ? 1 : 2;
+            valid      = valid && fb->len == (size_t)fb->width * fb->height * bpp;
+        }
+        if (valid) result->valid++;
+        free();
+    }
+
+    if (result->frames < 2 || lastUs <= firstUs) return false;
+    result->fps = (result->frames - 1) * 1000000.0f / (float)(lastUs - firstUs);
+    return true;
+}
+
+// ============================================
+// Image Processing
+// ============================================
+
+bool CamS3_Camera::setSpecialEffect(int effect) {
+    if (!sensor) return false;
+    return sensor->set_special_effect(sensor, effect) == 0;
+}
+
+bool CamS3_Camera::setDCW(bool enable) {
+    if (!sensor || !sensor->set_dcw) return false;
+    return sensor->set_dcw(sensor, enable ? 1 : 0) == 0;
+}
+
+bool CamS3_Camera::setBPC(bool enable) {
+    if (!sensor || !sensor->set_bpc) return false;
+    return sensor->set_bpc(sensor, enable ? 1 : 0) == 0;
+}
+
+bool CamS3_Camera::setWPC(bool enable) {
+    if (!sensor || !sensor->set_wpc) return false;
+    return sensor->set_wpc(sensor, enable ? 1 : 0) == 0;
+}
+
+bool CamS3_Camera::setRawGMA(bool enable) {
+    if (!sensor || !sensor->set_raw_gma) return false;
+    return sensor->set_raw_gma(sensor, enable ? 1 : 0) == 0;
+}
+
+bool CamS3_Camera::setLensCorrection(bool enable) {
+    if (!sensor || !sensor->set_lenc) return false;
+    return sensor->set_lenc(sensor, enable ? 1 : 0) == 0;
+}
+
+bool CamS3_Camera::setColorCorrection(bool enable, const cams3_color_config_t* config) {
+    if (!enable) {
+        _colorEnabled = false;
+        _color.end();
+        return true;
+    }
+    if (!_color.isReady()) {
+        if (!_color.begin(config)) return false;
+    } else if (config && !_color.setConfig(*config)) {
+        return false;
+    }
+    _colorEnabled = true;
+    return true;
+}
+
+// ============================================
+// Advanced Register & Low-Level Control
+// ============================================
+
+int CamS3_Camera::getRegister(int reg, int mask) {
+    if (!sensor || !sensor->get_reg) return -1;
+    return sensor->get_reg(sensor, reg, mask);
+}
+
+bool CamS3_Camera::setRegister(int reg, int mask, int value) {
+    if (!sensor || !sensor->set_reg) return false;
+    return sensor->set_reg(sensor, reg, mask, value) == 0;
+}
+
+bool CamS3_Camera::setResolutionRaw(int startX, int startY, int endX, int endY,
+                                    int offsetX, int offsetY, int totalX, int totalY,
+                                    int outputX, int outputY, bool scale, bool binning) {
+    if (!sensor || !sensor->set_res_raw) return false;
+    return sensor->set_res_raw(sensor, startX, startY, endX, endY,
+                              offsetX, offsetY, totalX, totalY,
+                              outputX, outputY, scale, binning) == 0;
+}
+
+bool CamS3_Camera::setPLL(int bypass, int mul, int sys, int root, int pre, int seld5, int pclken, int pclk) {
+    if (!sensor || !sensor->set_pll) return false;
+    return sensor->set_pll(sensor, bypass, mul, sys, root, pre, seld5, pclken, pclk) == 0;
+}
+
+bool CamS3_Camera::setXCLK(int timer, int xclk) {
+    if (!sensor || !sensor->set_xclk) return false;
+    return sensor->set_xclk(sensor, timer, xclk) == 0;
+}
+
+// ============================================
+// CamS3Library Implementation
+// ============================================
+
+bool CamS3Library::begin() {
+    return Camera.begin();
+}
+
+bool CamS3Library::begin(bool initSD) {
+    bool camOk = Camera.begin();
+    if (!camOk) return false;
+
+    if (initSD) {
+        return Sd.begin();
+    }
+    return true;
+}
+
+bool CamS3Library::begin(bool initSD, bool initMic) {
+    bool camOk = Camera.begin();
+    if (!camOk) return false;
+
+    bool sdOk = true;
+    bool micOk = true;
+
+    if (initSD) {
+        sdOk = Sd.begin();
+    }
+
+    if (initMic) {
+        micOk = Mic.begin();
+    }
+
+    return sdOk && micOk;
+}
+
+bool CamS3Library::captureToSD(const char* path) {
+    if (!Camera.isInitialized()) {
+        Serial.println("[CamS3] Camera not initialized");
+        return false;
+    }
+    if (!Sd.isInitialized()) {
+        Serial.println("[CamS3] SD card not initialized");
+        return false;
+    }
+
+    if (!Camera.get()) {
+        Serial.println("[CamS3] Failed to capture frame");
+        return false;
+    }
+
+    const cams3_frame_stats_t& stats = Camera.getFrameStats();
+    bool result = Sd.saveFrame(Camera.fb, path, stats.valid ? &stats : nullptr);
+    Camera.free();
+
+    return result;
+}
+
+bool CamS3Library::recordToSD(const char* path, uint32_t durationMs) {
+    if (!Mic.isInitialized()) {
+        Serial.println("[CamS3] Microphone not initialized");
+        return false;
+    }
+    if (!Sd.isInitialized()) {
+        Serial.println("[CamS3] SD card not initialized");
+        return false;
+    }
+
+    // Record audio
+    size_t numSamples = 0;
+    int16_t* samples = Mic.record(durationMs, &numSamples);
+    if (!samples || numSamples == 0) {
+        Serial.println("[CamS3] Recording failed");
+        return false;
+    }
+
+    // Generate filename if not provided
+    String filename;
+    if (path == nullptr) {
+        filename = "/REC_" + String(millis()) + ".wav";
+    } else {
+        filename = String(path);
+    }
+
+    // Create WAV file
+    File file = Sd.getFS().open(filename.c_str(), FILE_WRITE);
+    if (!file) {
+        Serial.println("[CamS3] Failed to create WAV file");
+        Mic.freeSamples(samples);
+        return false;
+    }
+
+    // WAV header
+    uint32_t sampleRate = Mic.getSampleRate();
+    uint16_t bitsPerSample = Mic.getSampleBits();
+    uint16_t numChannels = 1;
+    uint32_t dataSize = numSamples * (bitsPerSample / 8);
+    uint32_t byteRate = sampleRate * numChannels * (bitsPerSample / 8);
     uint16_t blockAlign = numChannels * (bitsPerSample / 8);
 
     // RIFF header
@@ -779,6 +2140,14 @@ bool CamS3_Mic::isSoundDetected(uint16_t threshold, size_t samples) {
 // CamS3_SD Implementation
 // ============================================
 
+#define SD_MOUNT_POINT "/sd"
+
+// SD commands for the pre-erase hint, not exported by the sdmmc driver
+static const uint32_t kSdAppCmd          = 55;  // CMD55, next command is application specific
+static const uint32_t kSdSetWrEraseCount = 23;  // ACMD23, SET_WR_BLK_ERASE_COUNT
+
+CamS3_SD* CamS3_SD::_active = nullptr;
+
 bool CamS3_SD::begin(uint32_t spiFreq) {
     if (_initialized) {
         return true;
@@ -786,25 +2155,62 @@ bool CamS3_SD::begin(uint32_t spiFreq) {
 
     _spiFreq = spiFreq;
 
-    // Initialize SPI with CamS3 SD card pins
-    _spi = new SPIClass(HSPI);
-    _spi->begin(CAMS3_SD_SCK_PIN, CAMS3_SD_MISO_PIN, CAMS3_SD_MOSI_PIN, CAMS3_SD_CS_PIN);
+    // SPI bus on the CamS3 SD card pins, with DMA
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num      = CAMS3_SD_MOSI_PIN;
+    bus.miso_io_num      = CAMS3_SD_MISO_PIN;
+    bus.sclk_io_num      = CAMS3_SD_SCK_PIN;
+    bus.quadwp_io_num    = -1;
+    bus.quadhd_io_num    = -1;
+    bus.max_transfer_sz  = CAMS3_SD_STAGE_SECTORS * 512;
+    esp_err_t err        = spi_bus_initialize(CAMS3_SD_SPI_HOST, &bus, SPI_DMA_CH_AUTO);
+    if (err != ESP_OK) {
+        Serial.printf("[CamS3 SD] SPI bus init failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
 
-    if (!SD.begin(CAMS3_SD_CS_PIN, *_spi, _spiFreq)) {
-        Serial.println("[CamS3 SD] Mount failed");
-        delete _spi;
-        _spi = nullptr;
+    sdmmc_host_t host          = SDSPI_HOST_DEFAULT();
+    host.slot                  = CAMS3_SD_SPI_HOST;
+    host.max_freq_khz          = _spiFreq / 1000;
+    sdspi_device_config_t slot = SDSPI_DEVICE_CONFIG_DEFAULT();
+    slot.gpio_cs               = (gpio_num_t)CAMS3_SD_CS_PIN;
+    slot.host_id               = CAMS3_SD_SPI_HOST;
+
+    esp_vfs_fat_sdmmc_mount_config_t mount = {};
+    mount.format_if_mount_failed           = false;
+    mount.max_files                        = 5;
+
+    err = esp_vfs_fat_sdspi_mount(SD_MOUNT_POINT, &host, &slot, &mount, &_card);
+    if (err != ESP_OK) {
+        Serial.printf("[CamS3 SD] Mount failed: %s\n", esp_err_to_name(err));
+        _card = nullptr;
+        spi_bus_free(CAMS3_SD_SPI_HOST);
         return false;
     }
+    _drive = ff_diskio_get_pdrv_card(_card);
 
-    sdcard_type_t cardType = SD.cardType();
-    if (cardType == CARD_NONE) {
-        Serial.println("[CamS3 SD] No card attached");
-        SD.end();
-        delete _spi;
-        _spi = nullptr;
+    // Ping-pong buffers for writes from memory the SPI DMA cannot read
+    _stage[0] = (uint8_t*)heap_caps_malloc(CAMS3_SD_STAGE_SECTORS * 512, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    _stage[1] = (uint8_t*)heap_caps_malloc(CAMS3_SD_STAGE_SECTORS * 512, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (!_ioLock) {
+        _ioLock = xSemaphoreCreateMutex();
+    }
+    if (!_stage[0] || !_stage[1] || !_ioLock) {
+        Serial.println("[CamS3 SD] Buffer allocation failed");
+        _initialized = true;
+        end();
         return false;
     }
+    _copy.begin();  // Without a free channel the staging copies run on the CPU
+    _ioStats = {};
+
+    // Route the card's sector I/O through the driver below
+    static const ff_diskio_impl_t diskImpl = {&_diskInit, &_diskStatus, &_diskRead, &_diskWrite, &_diskIoctl};
+    _active                                = this;
+    ff_diskio_register(_drive, &diskImpl);
+
+    // getFS() serves files from the same mount
+    _vfs->mountpoint(SD_MOUNT_POINT);
 
     _initialized = true;
     Serial.printf("[CamS3 SD] Card mounted: %s, Size: %lluMB\n", getCardTypeName(), getTotalBytes() / (1024 * 1024));
@@ -814,19 +2220,364 @@ bool CamS3_SD::begin(uint32_t spiFreq) {
 
 void CamS3_SD::end() {
     if (_initialized) {
-        SD.end();
-        if (_spi) {
-            _spi->end();
-            delete _spi;
-            _spi = nullptr;
+        _metaLog.close();
+        _catalog.close();
+        setWriteCache(false);
+        if (_card) {
+            _vfs->mountpoint(NULL);
+            esp_vfs_fat_sdcard_unmount(SD_MOUNT_POINT, _card);
+            _card = nullptr;
+            spi_bus_free(CAMS3_SD_SPI_HOST);
+        }
+        if (_active == this) {
+            _active = nullptr;
+        }
+        _copy.end();
+        for (int i = 0; i < 2; i++) {
+            heap_caps_free(_stage[i]);
+            _stage[i] = nullptr;
+        }
+        _drive       = -1;
+        _initialized = false;
+    }
+}
+
+// ============================================
+// CamS3_SD Sector I/O
+// ============================================
+
+DSTATUS CamS3_SD::_diskInit(BYTE pdrv) {
+    return _diskStatus(pdrv);
+}
+
+DSTATUS CamS3_SD::_diskStatus(BYTE pdrv) {
+    return (_active && _active->_card && pdrv == _active->_drive) ? 0 : STA_NOINIT;
+}
+
+DRESULT CamS3_SD::_diskRead(BYTE pdrv, BYTE* buff, uint32_t sector, UINT count) {
+    if (_diskStatus(pdrv)) return RES_NOTRDY;
+
+    CamS3_SD* sd = _active;
+    xSemaphoreTake(sd->_ioLock, portMAX_DELAY);
+
+    // FatFs window reads go through the cache
+    if (sd->_cache && count == 1) {
+        int i = sd->_cacheFind(sector);
+        if (i >= 0) {
+            sd->_ioStats.cacheHits++;
+        } else if ((i = sd->_cacheSlot()) >= 0) {
+            if (sdmmc_read_sectors(sd->_card, sd->_cache + i * 512, sector, 1) != ESP_OK) {
+                xSemaphoreGive(sd->_ioLock);
+                return RES_ERROR;
+            }
+            sd->_cacheEntries[i] = {sector, 0, true, false};
+            sd->_ioStats.cacheReads++;
+        }
+        if (i >= 0) {
+            sd->_cacheEntries[i].lastUse = ++sd->_cacheClock;
+            memcpy(buff, sd->_cache + i * 512, 512);
+            xSemaphoreGive(sd->_ioLock);
+            return RES_OK;
+        }
+    }
+
+    esp_err_t err = sdmmc_read_sectors(sd->_card, buff, sector, count);
+
+    // Cached sectors not yet written back are newer than the card
+    for (int i = 0; sd->_cache && err == ESP_OK && i < CAMS3_SD_CACHE_SECTORS; i++) {
+        const CacheEntry& e = sd->_cacheEntries[i];
+        if (e.valid && e.dirty && e.sector >= sector && e.sector - sector < count) {
+            memcpy(buff + (e.sector - sector) * 512, sd->_cache + i * 512, 512);
+        }
+    }
+    xSemaphoreGive(sd->_ioLock);
+    return err == ESP_OK ? RES_OK : RES_ERROR;
+}
+
+DRESULT CamS3_SD::_diskWrite(BYTE pdrv, const BYTE* buff, uint32_t sector, UINT count) {
+    if (_diskStatus(pdrv)) return RES_NOTRDY;
+
+    CamS3_SD* sd = _active;
+    xSemaphoreTake(sd->_ioLock, portMAX_DELAY);
+
+    // FatFs window writes (FAT, directory, FSInfo) stay in the cache until the next flush
+    if (sd->_cache && count == 1) {
+        int i = sd->_cacheFind(sector);
+        if (i < 0) i = sd->_cacheSlot();
+        if (i >= 0) {
+            memcpy(sd->_cache + i * 512, buff, 512);
+            sd->_cacheEntries[i] = {sector, ++sd->_cacheClock, true, true};
+            sd->_ioStats.cacheWrites++;
+            xSemaphoreGive(sd->_ioLock);
+            return RES_OK;
+        }
+    }
+
+    // Larger writes go straight to the card and supersede cached copies
+    for (int i = 0; sd->_cache && i < CAMS3_SD_CACHE_SECTORS; i++) {
+        CacheEntry& e = sd->_cacheEntries[i];
+        if (e.valid && e.sector >= sector && e.sector - sector < count) {
+            e.valid = false;
+        }
+    }
+    bool ok = sd->_writeSectors(buff, sector, count);
+    xSemaphoreGive(sd->_ioLock);
+    return ok ? RES_OK : RES_ERROR;
+}
+
+DRESULT CamS3_SD::_diskIoctl(BYTE pdrv, BYTE cmd, void* buff) {
+    if (_diskStatus(pdrv)) return RES_NOTRDY;
+
+    switch (cmd) {
+        case CTRL_SYNC:
+            return RES_OK;  // Writes complete before _diskWrite() returns; cached ones are flushed by sync()
+        case GET_SECTOR_COUNT:
+            *(DWORD*)buff = _active->_card->csd.capacity;
+            return RES_OK;
+        case GET_SECTOR_SIZE:
+            *(WORD*)buff = _active->_card->csd.sector_size;
+            return RES_OK;
+        default:
+            return RES_ERROR;
+    }
+}
+
+bool CamS3_SD::_writeSectors(const uint8_t* data, uint32_t sector, uint32_t count) {
+    // The SPI DMA reads internal, word-aligned memory directly
+    if (esp_ptr_dma_capable(data) && ((uintptr_t)data & 3) == 0) {
+        return _writeCard(data, sector, count);
+    }
+
+    // Anything else (PSRAM frame buffers, unaligned pointers) would go to the card one sector at a
+    // time through the driver's bounce buffer. Stage it instead: the copy engine fills one buffer
+    // while the other is on the bus, and every chunk is still a multi-block write.
+    uint32_t chunk = min(count, (uint32_t)CAMS3_SD_STAGE_SECTORS);
+    if (!_copy.copySync(_stage[0], data, chunk * 512)) return false;
+
+    int cur = 0;
+    while (count) {
+        uint32_t next = min(count - chunk, (uint32_t)CAMS3_SD_STAGE_SECTORS);
+        if (next && !_copy.copy(_stage[cur ^ 1], data + chunk * 512, next * 512)) return false;
+
+        bool ok = _writeCard(_stage[cur], sector, chunk);
+        if (next && !_copy.wait()) return false;
+        if (!ok) return false;
+
+        _ioStats.staged += chunk;
+        data += chunk * 512;
+        sector += chunk;
+        count -= chunk;
+        chunk = next;
+        cur ^= 1;
+    }
+    return true;
+}
+
+bool CamS3_SD::_writeCard(const uint8_t* data, uint32_t sector, uint32_t count) {
+    // A known-size multi-block write lets the card erase the blocks up front
+    if (count >= CAMS3_SD_PREERASE_MIN && _preErase && !_card->is_mmc) {
+        _sendPreErase(count);  // Only a hint; the write proceeds without it
+    }
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = sdmmc_write_sectors(_card, data, sector, count);
+    uint32_t us   = (uint32_t)(esp_timer_get_time() - start);
+
+    _ioStats.writes++;
+    if (count > 1) _ioStats.multiBlock++;
+    _ioStats.sectors += count;
+    _ioStats.writeUs += us;
+    if (us > _ioStats.maxWriteUs) _ioStats.maxWriteUs = us;
+
+    if (err != ESP_OK) {
+        Serial.printf("[CamS3 SD] Write of %lu sectors at %lu failed: %s\n", (unsigned long)count,
+                      (unsigned long)sector, esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+bool CamS3_SD::_sendPreErase(uint32_t count) {
+    sdmmc_command_t cmd = {};
+    cmd.opcode          = kSdAppCmd;
+    cmd.arg             = 0;  // RCA, always 0 in SPI mode
+    cmd.flags           = SCF_CMD_AC | SCF_RSP_R1;
+    if (_card->host.do_transaction(_card->host.slot, &cmd) != ESP_OK) return false;
+
+    cmd        = {};
+    cmd.opcode = kSdSetWrEraseCount;
+    cmd.arg    = count & 0x7FFFFF;
+    cmd.flags  = SCF_CMD_AC | SCF_RSP_R1;
+    if (_card->host.do_transaction(_card->host.slot, &cmd) != ESP_OK) return false;
+
+    _ioStats.preErases++;
+    return true;
+}
+
+// ============================================
+// CamS3_SD Write-back Cache
+// ============================================
+
+bool CamS3_SD::setWriteCache(bool enable, uint32_t flushMs) {
+    if (!_initialized || !_ioLock) return false;
+
+    if (!enable) {
+        // The ISR notifies the task, so it goes first
+        if (_lowVoltagePin >= 0) {
+            detachInterrupt(_lowVoltagePin);
+            _lowVoltagePin = -1;
+        }
+        if (!_cache) return true;
+        xSemaphoreTake(_ioLock, portMAX_DELAY);
+        if (_syncTask) {
+            // Holding the lock, the task is waiting and never inside a flush
+            vTaskDelete(_syncTask);
+            _syncTask = nullptr;
+        }
+        bool ok = _cacheFlush();
+        heap_caps_free(_cache);
+        _cache = nullptr;
+        xSemaphoreGive(_ioLock);
+        return ok;
+    }
+
+    _cacheFlushMs = flushMs ? flushMs : CAMS3_SD_CACHE_FLUSH_MS;
+    if (!_cache) {
+        uint8_t* cache = (uint8_t*)heap_caps_malloc(CAMS3_SD_CACHE_SECTORS * 512, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (!cache) {
+            Serial.println("[CamS3 SD] Cache allocation failed");
+            return false;
+        }
+        xSemaphoreTake(_ioLock, portMAX_DELAY);
+        memset(_cacheEntries, 0, sizeof(_cacheEntries));
+        _cache = cache;
+        xSemaphoreGive(_ioLock);
+    }
+    if (!_syncTask) {
+        // High priority: a flush is short, and after a low-voltage warning it has to beat the brownout
+        if (xTaskCreate(_syncTaskMain, "cams3_sync", 4096, this, configMAX_PRIORITIES - 2, &_syncTask) != pdPASS) {
+            Serial.println("[CamS3 SD] Failed to start sync task");
+            _syncTask = nullptr;
+            setWriteCache(false);
+            return false;
+        }
+    }
+    xTaskNotifyGive(_syncTask);  // Restart the interval
+    return true;
+}
+
+bool CamS3_SD::sync() {
+    if (!_initialized || !_ioLock) return false;
+
+    xSemaphoreTake(_ioLock, portMAX_DELAY);
+    bool ok = _cacheFlush();
+    xSemaphoreGive(_ioLock);
+    return ok;
+}
+
+bool CamS3_SD::attachLowVoltagePin(uint8_t pin, int mode) {
+    if (!_cache || !_syncTask) return false;
+
+    if (_lowVoltagePin >= 0) detachInterrupt(_lowVoltagePin);
+    pinMode(pin, INPUT);
+    attachInterruptArg(pin, _lowVoltageISR, this, mode);
+    _lowVoltagePin = pin;
+    return true;
+}
+
+void IRAM_ATTR CamS3_SD::_lowVoltageISR(void* arg) {
+    CamS3_SD* self   = (CamS3_SD*)arg;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->_syncTask, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void CamS3_SD::_syncTaskMain(void* arg) {
+    CamS3_SD* self = (CamS3_SD*)arg;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, self->_cache ? pdMS_TO_TICKS(self->_cacheFlushMs) : portMAX_DELAY);
+        if (self->_initialized) {
+            self->sync();
+        }
+    }
+}
+
+int CamS3_SD::_cacheFind(uint32_t sector) {
+    for (int i = 0; i < CAMS3_SD_CACHE_SECTORS; i++) {
+        if (_cacheEntries[i].valid && _cacheEntries[i].sector == sector) return i;
+    }
+    return -1;
+}
+
+int CamS3_SD::_cacheSlot() {
+    int lru = -1;
+    for (int i = 0; i < CAMS3_SD_CACHE_SECTORS; i++) {
+        if (!_cacheEntries[i].valid) return i;
+        if (lru < 0 || _cacheEntries[i].lastUse < _cacheEntries[lru].lastUse) lru = i;
+    }
+
+    // Evicting a dirty sector writes all of them: one coalesced flush instead of many single ones
+    if (_cacheEntries[lru].dirty && !_cacheFlush()) return -1;
+    _cacheEntries[lru].valid = false;
+    return lru;
+}
+
+bool CamS3_SD::_cacheFlush() {
+    if (!_cache) return true;
+
+    // Dirty sectors in card order
+    uint8_t order[CAMS3_SD_CACHE_SECTORS];
+    int n = 0;
+    for (int i = 0; i < CAMS3_SD_CACHE_SECTORS; i++) {
+        if (!_cacheEntries[i].valid || !_cacheEntries[i].dirty) continue;
+        int j = n++;
+        while (j > 0 && _cacheEntries[order[j - 1]].sector > _cacheEntries[i].sector) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    if (n == 0) return true;
+
+    // Runs of consecutive sectors become one multi-block write
+    bool ok = true;
+    for (int start = 0; start < n;) {
+        uint32_t first = _cacheEntries[order[start]].sector;
+        int len        = 1;
+        while (start + len < n && len < CAMS3_SD_STAGE_SECTORS &&
+               _cacheEntries[order[start + len]].sector == first + len) {
+            len++;
+        }
+
+        bool written;
+        if (len == 1) {
+            written = _writeCard(_cache + order[start] * 512, first, 1);
+        } else {
+            for (int k = 0; k < len; k++) {
+                memcpy(_stage[0] + k * 512, _cache + order[start + k] * 512, 512);
+            }
+            written = _writeCard(_stage[0], first, len);
         }
-        _initialized = false;
+        for (int k = 0; written && k < len; k++) {
+            _cacheEntries[order[start + k]].dirty = false;
+        }
+        ok &= written;
+        start += len;
     }
+
+    _ioStats.flushes++;
+    return ok;
 }
 
+// ============================================
+// CamS3_SD Card Information
+// ============================================
+
 sdcard_type_t CamS3_SD::getCardType() {
-    if (!_initialized) return CARD_NONE;
-    return SD.cardType();
+    if (!_initialized || !_card) return CARD_NONE;
+    if (_card->is_mmc) return CARD_MMC;
+    return (_card->ocr & SD_OCR_SDHC_CAP) ? CARD_SDHC : CARD_SD;
 }
 
 const char* CamS3_SD::getCardTypeName() {
@@ -842,25 +2593,39 @@ const char* CamS3_SD::getCardTypeName() {
     }
 }
 
+bool CamS3_SD::_fsSpace(uint64_t& total, uint64_t& free) {
+    if (!_initialized || _drive < 0) return false;
+
+    char drive[3]      = {(char)('0' + _drive), ':', 0};
+    FATFS* fs          = nullptr;
+    DWORD freeClusters = 0;
+    if (f_getfree(drive, &freeClusters, &fs) != FR_OK) return false;
+
+    uint64_t cluster = (uint64_t)fs->csize * 512;
+    total            = (uint64_t)(fs->n_fatent - 2) * cluster;
+    free             = (uint64_t)freeClusters * cluster;
+    return true;
+}
+
 uint64_t CamS3_SD::getTotalBytes() {
-    if (!_initialized) return 0;
-    return SD.totalBytes();
+    uint64_t total, free;
+    return _fsSpace(total, free) ? total : 0;
 }
 
 uint64_t CamS3_SD::getUsedBytes() {
-    if (!_initialized) return 0;
-    return SD.usedBytes();
+    uint64_t total, free;
+    return _fsSpace(total, free) ? total - free : 0;
 }
 
 uint64_t CamS3_SD::getFreeBytes() {
-    if (!_initialized) return 0;
-    return SD.totalBytes() - SD.usedBytes();
+    uint64_t total, free;
+    return _fsSpace(total, free) ? free : 0;
 }
 
 bool CamS3_SD::writeFile(const char* path, const uint8_t* data, size_t len) {
     if (!_initialized) return false;
 
-    File file = SD.open(path, FILE_WRITE);
+    File file = _fs.open(path, FILE_WRITE);
     if (!file) {
         Serial.printf("[CamS3 SD] Failed to open file for writing: %s\n", path);
         return false;
@@ -880,7 +2645,7 @@ bool CamS3_SD::writeFile(const char* path, const uint8_t* data, size_t len) {
 bool CamS3_SD::appendFile(const char* path, const uint8_t* data, size_t len) {
     if (!_initialized) return false;
 
-    File file = SD.open(path, FILE_APPEND);
+    File file = _fs.open(path, FILE_APPEND);
     if (!file) {
         Serial.printf("[CamS3 SD] Failed to open file for appending: %s\n", path);
         return false;
@@ -895,7 +2660,7 @@ bool CamS3_SD::appendFile(const char* path, const uint8_t* data, size_t len) {
 int32_t CamS3_SD::readFile(const char* path, uint8_t* buffer, size_t maxLen) {
     if (!_initialized) return -1;
 
-    File file = SD.open(path, FILE_READ);
+    File file = _fs.open(path, FILE_READ);
     if (!file) {
         Serial.printf("[CamS3 SD] Failed to open file for reading: %s\n", path);
         return -1;
@@ -909,33 +2674,33 @@ int32_t CamS3_SD::readFile(const char* path, uint8_t* buffer, size_t maxLen) {
 
 bool CamS3_SD::exists(const char* path) {
     if (!_initialized) return false;
-    return SD.exists(path);
+    return _fs.exists(path);
 }
 
 bool CamS3_SD::remove(const char* path) {
     if (!_initialized) return false;
-    return SD.remove(path);
+    return _fs.remove(path);
 }
 
 bool CamS3_SD::rename(const char* pathFrom, const char* pathTo) {
     if (!_initialized) return false;
-    return SD.rename(pathFrom, pathTo);
+    return _fs.rename(pathFrom, pathTo);
 }
 
 bool CamS3_SD::mkdir(const char* path) {
     if (!_initialized) return false;
-    return SD.mkdir(path);
+    return _fs.mkdir(path);
 }
 
 bool CamS3_SD::rmdir(const char* path) {
     if (!_initialized) return false;
-    return SD.rmdir(path);
+    return _fs.rmdir(path);
 }
 
 int64_t CamS3_SD::getFileSize(const char* path) {
     if (!_initialized) return -1;
 
-    File file = SD.open(path, FILE_READ);
+    File file = _fs.open(path, FILE_READ);
     if (!file) {
         return -1;
     }
@@ -953,7 +2718,7 @@ void CamS3_SD::listDir(const char* dirname, uint8_t levels) {
 
     Serial.printf("Listing directory: %s\n", dirname);
 
-    File root = SD.open(dirname);
+    File root = _fs.open(dirname);
     if (!root) {
         Serial.println("Failed to open directory");
         return;
@@ -977,7 +2742,39 @@ void CamS3_SD::listDir(const char* dirname, uint8_t levels) {
     }
 }
 
-bool CamS3_SD::saveFrame(camera_fb_t* fb, const char* path) {
+// CRC-32 of a frame, computed by a worker on the other core alongside the file write
+typedef struct {
+    const uint8_t* data;
+    size_t len;
+    uint32_t crc;
+    SemaphoreHandle_t done;
+} cams3_crc_job_t;
+
+static void crcTaskMain(void* arg) {
+    cams3_crc_job_t* job = (cams3_crc_job_t*)arg;
+    job->crc             = esp_rom_crc32_le(0, job->data, job->len);
+    xSemaphoreGive(job->done);
+    vTaskDelete(nullptr);
+}
+
+static void startCrc(cams3_crc_job_t& job) {
+    job.done = xSemaphoreCreateBinary();
+    if (job.done && xTaskCreatePinnedToCore(crcTaskMain, "cams3_crc", 2048, &job, uxTaskPriorityGet(nullptr), nullptr,
+                                            xPortGetCoreID() ^ 1) != pdPASS) {
+        vSemaphoreDelete(job.done);
+        job.done = nullptr;
+    }
+}
+
+static uint32_t finishCrc(cams3_crc_job_t& job) {
+    if (!job.done) return esp_rom_crc32_le(0, job.data, job.len);  // Worker could not be started
+    xSemaphoreTake(job.done, portMAX_DELAY);
+    vSemaphoreDelete(job.done);
+    job.done = nullptr;
+    return job.crc;
+}
+
+bool CamS3_SD::saveFrame(camera_fb_t* fb, const char* path, const cams3_frame_stats_t* stats) {
     if (!_initialized || !fb) return false;
 
     String filename;
@@ -987,18 +2784,767 @@ bool CamS3_SD::saveFrame(camera_fb_t* fb, const char* path) {
         filename = String(path);
     }
 
-    bool result = writeFile(filename.c_str(), fb->buf, fb->len);
+    // The CRC-32 for the metadata log runs on the other core while this one waits on the card
+    cams3_crc_job_t crc = {fb->buf, fb->len, 0, nullptr};
+    bool withCrc        = _metaLog.isOpen();
+    if (withCrc) startCrc(crc);
+
+    int64_t start  = esp_timer_get_time();
+    bool result    = writeFile(filename.c_str(), fb->buf, fb->len);
+    int64_t end    = esp_timer_get_time();
+    uint32_t crc32 = withCrc ? finishCrc(crc) : 0;
 
     if (result) {
         Serial.printf("[CamS3 SD] Saved: %s (%d bytes)\n", filename.c_str(), fb->len);
+
+        if (_metaLog.isOpen()) {
+            cams3_meta_record_t rec = {};
+            rec.captureUs           = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+            rec.writtenUs           = end;
+            rec.jpegSize            = fb->len;
+            rec.writeLatencyUs      = end - start;
+            rec.crc32               = crc32;
+            if (stats) {
+                // Zero where the sensor could not report the value
+                rec.frameSequence = stats->sequence;
+                rec.exposure      = stats->exposure;
+                rec.gainX16       = stats->gainX16;
+            }
+            strncpy(rec.path, filename.c_str(), sizeof(rec.path) - 1);
+            _metaLog.append(rec);
+        }
+
+        if (_catalog.isOpen()) {
+            _catalog.append(filename.c_str(), fb->len, fb->width, fb->height, _thumbEnabled ? CAMS3_CATALOG_THUMB : 0);
+        }
+
+        if (_thumbEnabled) {
+            char job[CAMS3_THUMB_PATH_LEN] = {0};
+            strncpy(job, filename.c_str(), sizeof(job) - 1);
+            if (xQueueSend(_thumbQueue, job, 0) != pdTRUE) {
+                _thumbDropped++;
+            }
+        }
+
+        if (_archiveEnabled) {
+            char job[CAMS3_THUMB_PATH_LEN] = {0};
+            strncpy(job, filename.c_str(), sizeof(job) - 1);
+            if (xQueueSend(_archiveQueue, job, 0) != pdTRUE) {
+                _archiveDropped++;
+            }
+        }
     }
 
     return result;
 }
 
+// ============================================
+// Thumbnails
+// ============================================
+
+bool CamS3_SD::setThumbnails(bool enable, uint16_t width, uint16_t height, uint8_t quality) {
+    if (!enable) {
+        _thumbEnabled = false;
+        return true;
+    }
+    if (width == 0 || height == 0) return false;
+
+    _thumbWidth   = width;
+    _thumbHeight  = height;
+    _thumbQuality = quality;
+
+    if (!_thumbQueue) {
+        _thumbQueue = xQueueCreate(CAMS3_THUMB_QUEUE_LEN, CAMS3_THUMB_PATH_LEN);
+        if (!_thumbQueue) return false;
+    }
+    if (!_thumbTask) {
+        // Lowest useful priority: thumbnails only run when capture and writes are idle
+        if (xTaskCreate(_thumbTaskMain, "cams3_thumb", 16384, this, tskIDLE_PRIORITY + 1, &_thumbTask) != pdPASS) {
+            Serial.println("[CamS3 SD] Failed to start thumbnail task");
+            _thumbTask = nullptr;
+            return false;
+        }
+    }
+
+    _thumbEnabled = true;
+    return true;
+}
+
+void CamS3_SD::_thumbTaskMain(void* arg) {
+    CamS3_SD* self = (CamS3_SD*)arg;
+    char path[CAMS3_THUMB_PATH_LEN];
+
+    for (;;) {
+        if (xQueueReceive(self->_thumbQueue, path, portMAX_DELAY) == pdTRUE) {
+            if (self->_initialized) {
+                self->makeThumbnail(path);
+            }
+        }
+    }
+}
+
+String CamS3_SD::thumbnailPath(const char* path) {
+    String p   = String(path);
+    int dot    = p.lastIndexOf('.');
+    int slash  = p.lastIndexOf('/');
+    String base = (dot > slash) ? p.substring(0, dot) : p;
+    return base + CAMS3_THUMB_SUFFIX;
+}
+
+bool CamS3_SD::makeThumbnail(const char* path) {
+    if (!_initialized || !path) return false;
+    if (String(path).endsWith(CAMS3_THUMB_SUFFIX)) return false;
+
+    File file = _fs.open(path, FILE_READ);
+    if (!file) {
+        Serial.printf("[CamS3 SD] Failed to open file for thumbnail: %s\n", path);
+        return false;
+    }
+    size_t len    = file.size();
+    uint8_t* data = (uint8_t*)malloc(len);
+    if (!data) {
+        file.close();
+        Serial.println("[CamS3 SD] Failed to allocate thumbnail source buffer");
+        return false;
+    }
+    size_t got = file.read(data, len);
+    file.close();
+
+    bool ok                 = false;
+    uint8_t* dc             = nullptr;
+    uint8_t* thumb          = nullptr;
+    uint8_t* jpg            = nullptr;
+    size_t jpgLen           = 0;
+    CamS3_JpegDecoder* jpeg = new CamS3_JpegDecoder();
+
+    do {
+        if (got != len || !jpeg->parse(data, len)) break;
+
+        uint16_t dcW = jpeg->getDCWidth();
+        uint16_t dcH = jpeg->getDCHeight();
+        dc           = (uint8_t*)malloc((size_t)dcW * dcH * 3);
+        if (!dc || !jpeg->decodeDCColor(dc, (size_t)dcW * dcH * 3)) break;
+
+        // Fit inside the requested box, keeping the aspect ratio, never upscaling
+        uint16_t outW = dcW;
+        uint16_t outH = dcH;
+        if (outW > _thumbWidth || outH > _thumbHeight) {
+            if ((uint32_t)dcW * _thumbHeight > (uint32_t)dcH * _thumbWidth) {
+                outW = _thumbWidth;
+                outH = (uint32_t)dcH * _thumbWidth / dcW;
+            } else {
+                outH = _thumbHeight;
+                outW = (uint32_t)dcW * _thumbHeight / dcH;
+            }
+            if (outW == 0) outW = 1;
+            if (outH == 0) outH = 1;
+        }
+
+        thumb = (uint8_t*)malloc((size_t)outW * outH * 3);
+        if (!thumb) break;
+
+        // Box filter from the DC image
+        for (uint16_t oy = 0; oy < outH; oy++) {
+            uint32_t y0 = (uint32_t)oy * dcH / outH;
+            uint32_t y1 = (uint32_t)(oy + 1) * dcH / outH;
+            if (y1 <= y0) y1 = y0 + 1;
+            for (uint16_t ox = 0; ox < outW; ox++) {
+                uint32_t x0     = (uint32_t)ox * dcW / outW;
+                uint32_t x1     = (uint32_t)(ox + 1) * dcW / outW;
+                if (x1 <= x0) x1 = x0 + 1;
+                uint32_t sum[3] = {0, 0, 0};
+                for (uint32_t y = y0; y < y1; y++) {
+                    const uint8_t* px = dc + (y * dcW + x0) * 3;
+                    for (uint32_t x = x0; x < x1; x++, px += 3) {
+                        sum[0] += px[0];
+                        sum[1] += px[1];
+                        sum[2] += px[2];
+                    }
+                }
+                uint32_t n   = (y1 - y0) * (x1 - x0);
+                uint8_t* out = thumb + ((size_t)oy * outW + ox) * 3;
+                out[0]       = sum[0] / n;
+                out[1]       = sum[1] / n;
+                out[2]       = sum[2] / n;
+            }
+        }
+
+        // fmt2jpg takes RGB888 in B, G, R byte order, as produced by decodeDCColor()
+        if (!fmt2jpg(thumb, (size_t)outW * outH * 3, outW, outH, PIXFORMAT_RGB888, _thumbQuality, &jpg, &jpgLen)) {
+            break;
+        }
+        ok = writeFile(thumbnailPath(path).c_str(), jpg, jpgLen);
+    } while (0);
+
+    if (!ok) {
+        Serial.printf("[CamS3 SD] Thumbnail failed: %s\n", path);
+    }
+
+    delete jpeg;
+    free(jpg);
+    free(thumb);
+    free(dc);
+    free(data);
+    return ok;
+}
+
+// ============================================
+// Archival Re-encoding
+// ============================================
+
+bool CamS3_SD::setArchiving(bool enable) {
+    if (!enable) {
+        _archiveEnabled = false;
+        return true;
+    }
+
+    if (!_archiveQueue) {
+        _archiveQueue = xQueueCreate(CAMS3_ARCHIVE_QUEUE_LEN, CAMS3_THUMB_PATH_LEN);
+        if (!_archiveQueue) return false;
+    }
+    if (!_archiveTask) {
+        // Idle priority: below thumbnails, so a frame's thumbnail is normally made from the original first
+        if (xTaskCreate(_archiveTaskMain, "cams3_archive", 8192, this, tskIDLE_PRIORITY, &_archiveTask) != pdPASS) {
+            Serial.println("[CamS3 SD] Failed to start archive task");
+            _archiveTask = nullptr;
+            return false;
+        }
+    }
+
+    _archiveEnabled = true;
+    return true;
+}
+
+void CamS3_SD::_archiveTaskMain(void* arg) {
+    CamS3_SD* self = (CamS3_SD*)arg;
+    char path[CAMS3_THUMB_PATH_LEN];
+
+    for (;;) {
+        if (xQueueReceive(self->_archiveQueue, path, portMAX_DELAY) == pdTRUE) {
+            if (self->_initialized) {
+                self->archiveFile(path);
+            }
+        }
+    }
+}
+
+// Archive output goes to the temporary file and is digested on the way for the metadata log
+typedef struct {
+    File* file;
+    uint32_t crc;
+} cams3_archive_sink_t;
+
+static bool archiveSink(const uint8_t* data, size_t len, void* ctx) {
+    cams3_archive_sink_t* sink = (cams3_archive_sink_t*)ctx;
+    sink->crc                  = esp_rom_crc32_le(sink->crc, data, len);
+    return sink->file->write(data, len) == len;
+}
+
+static bool fileCrc32(fs::FS& fs, const char* path, uint32_t* crc) {
+    File file = fs.open(path, FILE_READ);
+    if (!file) return false;
+
+    uint8_t* buf = (uint8_t*)malloc(4096);
+    if (!buf) {
+        file.close();
+        return false;
+    }
+    uint32_t c = 0;
+    size_t n;
+    while ((n = file.read(buf, 4096)) > 0) {
+        c = esp_rom_crc32_le(c, buf, n);
+    }
+    free(buf);
+    file.close();
+    *crc = c;
+    return true;
+}
+
+bool CamS3_SD::archiveFile(const char* path) {
+    if (!_initialized || !path) return false;
+
+    int64_t srcSize = getFileSize(path);
+    if (srcSize <= 0) return false;
+
+    // The metadata log links the archived digest to the one it replaces
+    uint32_t srcCrc = 0;
+    if (_metaLog.isOpen() && !fileCrc32(_fs, path, &srcCrc)) return false;
+
+    String tmpPath = String(path) + CAMS3_ARCHIVE_SUFFIX;
+    File out       = _fs.open(tmpPath.c_str(), FILE_WRITE);
+    if (!out) {
+        Serial.printf("[CamS3 SD] Failed to open archive output: %s\n", tmpPath.c_str());
+        return false;
+    }
+
+    // Same tables and crop as the source, only the entropy coding changes
+    CamS3_JpegTranscoder* tc = new CamS3_JpegTranscoder();
+    tc->setOptimizeHuffman(true);
+    cams3_archive_sink_t sink = {&out, 0};
+    bool ok                   = tc->transcodeFile(_fs, path, archiveSink, &sink);
+    size_t outSize            = tc->getOutputSize();
+    delete tc;
+    out.close();
+
+    if (!ok) {
+        Serial.printf("[CamS3 SD] Archive failed: %s\n", path);
+        _fs.remove(tmpPath.c_str());
+        return false;
+    }
+    if (outSize >= (size_t)srcSize) {
+        _fs.remove(tmpPath.c_str());
+        return true;
+    }
+
+    // FAT rename will not overwrite: move the original aside, and only drop it once the archive is in place
+    String backupPath = String(path) + CAMS3_ARCHIVE_BACKUP;
+    if (!_fs.rename(path, backupPath.c_str())) {
+        Serial.printf("[CamS3 SD] Failed to replace %s\n", path);
+        _fs.remove(tmpPath.c_str());
+        return false;
+    }
+    if (!_fs.rename(tmpPath.c_str(), path)) {
+        Serial.printf("[CamS3 SD] Failed to replace %s\n", path);
+        _fs.rename(backupPath.c_str(), path);
+        _fs.remove(tmpPath.c_str());
+        return false;
+    }
+    _fs.remove(backupPath.c_str());
+    _archivedFiles++;
+    _archiveSaved += srcSize - outSize;
+
+    // Keep the integrity records in step with the file that is now on the card
+    if (_metaLog.isOpen()) {
+        cams3_meta_record_t rec = {};
+        rec.writtenUs           = esp_timer_get_time();
+        rec.jpegSize            = outSize;
+        rec.crc32               = sink.crc;
+        rec.prevCrc32           = srcCrc;
+        rec.flags               = CAMS3_META_ARCHIVED;
+        strncpy(rec.path, path, sizeof(rec.path) - 1);
+        _metaLog.append(rec);
+        _metaLog.flush();
+    }
+    if (_catalog.isOpen() && !_catalog.update(path, outSize, CAMS3_CATALOG_ARCHIVED)) {
+        Serial.printf("[CamS3 SD] No catalog entry for %s\n", path);
+    }
+    return true;
+}
+
 String CamS3_SD::generateFilename(const char* prefix, const char* extension) {
     _fileCounter++;
     char filename[64];
     snprintf(filename, sizeof(filename), "/%s_%lu_%lu.%s", prefix, millis(), _fileCounter, extension);
     return String(filename);
 }
+
+// ============================================
+// CamS3_SDFS Implementation
+// ============================================
+
+sdcard_type_t CamS3_SDFS::cardType() {
+    return _sd->getCardType();
+}
+
+uint64_t CamS3_SDFS::cardSize() {
+    return (uint64_t)numSectors() * sectorSize();
+}
+
+size_t CamS3_SDFS::numSectors() {
+    return (_sd->_initialized && _sd->_card) ? _sd->_card->csd.capacity : 0;
+}
+
+size_t CamS3_SDFS::sectorSize() {
+    return (_sd->_initialized && _sd->_card) ? _sd->_card->csd.sector_size : 0;
+}
+
+uint64_t CamS3_SDFS::totalBytes() {
+    return _sd->getTotalBytes();
+}
+
+uint64_t CamS3_SDFS::usedBytes() {
+    return _sd->getUsedBytes();
+}
+
+bool CamS3_SDFS::readRAW(uint8_t* buffer, uint32_t sector) {
+    if (!_sd->_initialized || _sd->_drive < 0) return false;
+    return ff_disk_read(_sd->_drive, buffer, sector, 1) == RES_OK;
+}
+
+bool CamS3_SDFS::writeRAW(uint8_t* buffer, uint32_t sector) {
+    if (!_sd->_initialized || _sd->_drive < 0) return false;
+    return ff_disk_write(_sd->_drive, buffer, sector, 1) == RES_OK;
+}
+
+// ============================================
+// CamS3_MetaLog Implementation
+// ============================================
+
+// Schema descriptor stored in the log header so readers need no built-in layout
+typedef struct __attribute__((packed)) {
+    char name[16];
+    uint16_t offset;
+    uint8_t type;  // 'u' unsigned, 'i' signed, 's' string
+    uint8_t size;
+} cams3_meta_field_t;
+
+#define META_FIELD(member, type) \
+    {#member, (uint16_t)offsetof(cams3_meta_record_t, member), type, (uint8_t)sizeof(((cams3_meta_record_t*)0)->member)}
+
+static const cams3_meta_field_t metaFields[] = {
+    META_FIELD(sequence, 'u'),  META_FIELD(frameSequence, 'u'),  META_FIELD(captureUs, 'i'),
+    META_FIELD(writtenUs, 'i'), META_FIELD(exposure, 'u'),       META_FIELD(gainX16, 'u'),
+    META_FIELD(jpegSize, 'u'),  META_FIELD(writeLatencyUs, 'u'), META_FIELD(crc32, 'u'),
+    META_FIELD(flags, 'u'),     META_FIELD(prevCrc32, 'u'),      META_FIELD(path, 's'),
+};
+
+bool CamS3_MetaLog::open(fs::FS& fs, const char* path) {
+    if (_open) {
+        close();
+    }
+
+    if (!_lock) {
+        _lock = xSemaphoreCreateMutex();
+        if (!_lock) return false;
+    }
+
+    _sequence = 0;
+    _count    = 0;
+
+    bool isNew = !fs.exists(path);
+    if (!isNew) {
+        File existing    = fs.open(path, FILE_READ);
+        uint16_t version = 0;
+        if (!existing || !_checkHeader(existing, version)) {
+            Serial.printf("[CamS3 Meta] Not a compatible metadata log: %s\n", path);
+            if (existing) existing.close();
+            return false;
+        }
+        _sequence = (existing.size() - CAMS3_METALOG_HEADER_SIZE) / sizeof(cams3_meta_record_t);
+        existing.close();
+
+        // Records of another version must not follow its schema header: keep the old log aside
+        if (version != CAMS3_METALOG_VERSION) {
+            String old = String(path) + ".v" + String(version);
+            if (!fs.rename(path, old.c_str())) {
+                Serial.printf("[CamS3 Meta] Failed to move version %u log to %s\n", version, old.c_str());
+                return false;
+            }
+            Serial.printf("[CamS3 Meta] Version %u log moved to %s\n", version, old.c_str());
+            _sequence = 0;
+            isNew     = true;
+        }
+    }
+
+    _file = fs.open(path, FILE_APPEND);
+    if (!_file) {
+        Serial.printf("[CamS3 Meta] Failed to open log: %s\n", path);
+        return false;
+    }
+
+    if (isNew && !_writeHeader()) {
+        _file.close();
+        return false;
+    }
+
+    _buffer = (cams3_meta_record_t*)malloc(CAMS3_METALOG_BUFFER_RECORDS * sizeof(cams3_meta_record_t));
+    if (!_buffer) {
+        Serial.println("[CamS3 Meta] Failed to allocate buffer");
+        _file.close();
+        return false;
+    }
+
+    _open = true;
+    return true;
+}
+
+bool CamS3_MetaLog::_writeHeader() {
+    uint8_t header[CAMS3_METALOG_HEADER_SIZE] = {0};
+    uint16_t fieldCount                       = sizeof(metaFields) / sizeof(metaFields[0]);
+    uint16_t recordSize                       = sizeof(cams3_meta_record_t);
+    uint16_t version                          = CAMS3_METALOG_VERSION;
+    uint16_t headerSize                       = CAMS3_METALOG_HEADER_SIZE;
+
+    memcpy(header, CAMS3_METALOG_MAGIC, 4);
+    memcpy(header + 4, &version, 2);
+    memcpy(header + 6, &headerSize, 2);
+    memcpy(header + 8, &recordSize, 2);
+    memcpy(header + 10, &fieldCount, 2);
+    memcpy(header + 16, metaFields, sizeof(metaFields));
+
+    if (_file.write(header, sizeof(header)) != sizeof(header)) {
+        Serial.println("[CamS3 Meta] Failed to write header");
+        return false;
+    }
+    _file.flush();
+    return true;
+}
+
+bool CamS3_MetaLog::_checkHeader(File& file, uint16_t& version) {
+    uint8_t header[12];
+    if (file.read(header, sizeof(header)) != sizeof(header)) return false;
+    if (memcmp(header, CAMS3_METALOG_MAGIC, 4) != 0) return false;
+
+    // Other versions are moved aside by open(), whatever their layout
+    uint16_t recordSize;
+    memcpy(&version, header + 4, 2);
+    memcpy(&recordSize, header + 8, 2);
+    return version != CAMS3_METALOG_VERSION || recordSize == sizeof(cams3_meta_record_t);
+}
+
+bool CamS3_MetaLog::append(const cams3_meta_record_t& record) {
+    if (!_open) return false;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (!_open) {
+        xSemaphoreGive(_lock);
+        return false;
+    }
+    cams3_meta_record_t* slot = &_buffer[_count++];
+    memcpy(slot, &record, sizeof(record));
+    slot->sequence = _sequence++;
+
+    bool ok = (_count == CAMS3_METALOG_BUFFER_RECORDS) ? _flushLocked() : true;
+    xSemaphoreGive(_lock);
+    return ok;
+}
+
+bool CamS3_MetaLog::flush() {
+    if (!_open) return false;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    bool ok = _open && _flushLocked();
+    xSemaphoreGive(_lock);
+    return ok;
+}
+
+bool CamS3_MetaLog::_flushLocked() {
+    if (_count == 0) return true;
+
+    size_t len     = _count * sizeof(cams3_meta_record_t);
+    size_t written = _file.write((const uint8_t*)_buffer, len);
+    _file.flush();
+    _count = 0;
+
+    if (written != len) {
+        Serial.printf("[CamS3 Meta] Write incomplete: %d/%d bytes\n", written, len);
+        return false;
+    }
+    return true;
+}
+
+void CamS3_MetaLog::close() {
+    if (!_open) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _flushLocked();
+    _file.close();
+    free(_buffer);
+    _buffer = nullptr;
+    _open   = false;
+    xSemaphoreGive(_lock);
+}
+
+// ============================================
+// CamS3_Catalog Implementation
+// ============================================
+
+bool CamS3_Catalog::open(fs::FS& fs, const char* path) {
+    if (_open) {
+        close();
+    }
+
+    if (!_lock) {
+        _lock = xSemaphoreCreateMutex();
+        if (!_lock) return false;
+    }
+
+    _count    = 0;
+    _lastTime = 0;
+
+    bool isNew = !fs.exists(path);
+    if (!isNew) {
+        File existing = fs.open(path, FILE_READ);
+        cams3_catalog_entry_t header;
+        if (!existing || existing.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+            memcmp(&header, CAMS3_CATALOG_MAGIC, 4) != 0) {
+            Serial.printf("[CamS3 Catalog] Not a capture catalog: %s\n", path);
+            if (existing) existing.close();
+            return false;
+        }
+        _count = existing.size() / sizeof(cams3_catalog_entry_t) - 1;
+
+        // Resume the time ordering from the last entry
+        cams3_catalog_entry_t last;
+        if (_count > 0 && existing.seek(_count * sizeof(cams3_catalog_entry_t)) &&
+            existing.read((uint8_t*)&last, sizeof(last)) == sizeof(last)) {
+            _lastTime = last.time;
+        }
+        existing.close();
+    }
+
+    _file = fs.open(path, FILE_APPEND);
+    if (!_file) {
+        Serial.printf("[CamS3 Catalog] Failed to open: %s\n", path);
+        return false;
+    }
+
+    if (isNew) {
+        cams3_catalog_entry_t header = {};
+        memcpy(&header, CAMS3_CATALOG_MAGIC, 4);
+        header.time = CAMS3_CATALOG_VERSION;
+        header.size = sizeof(cams3_catalog_entry_t);
+        if (_file.write((const uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+            _file.close();
+            return false;
+        }
+        _file.flush();
+    }
+
+    _fs   = &fs;
+    _path = String(path);
+    _open = true;
+    return true;
+}
+
+void CamS3_Catalog::close() {
+    if (!_open) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _file.close();
+    _open = false;
+    xSemaphoreGive(_lock);
+}
+
+bool CamS3_Catalog::append(const char* path, uint32_t size, uint16_t width, uint16_t height, uint32_t flags) {
+    if (!_open || !path) return false;
+
+    // A truncated path would name another file, or none
+    if (strlen(path) >= CAMS3_CATALOG_PATH_LEN) {
+        Serial.printf("[CamS3 Catalog] Path too long (max %d): %s\n", CAMS3_CATALOG_PATH_LEN - 1, path);
+        return false;
+    }
+
+    // Paging relies on non-decreasing times, even if the clock steps back
+    time_t now = time(nullptr);
+    uint32_t t = (now > 1600000000) ? (uint32_t)now : millis() / 1000;
+    if (t < _lastTime) t = _lastTime;
+
+    cams3_catalog_entry_t entry = {};
+    entry.time                  = t;
+    entry.size                  = size;
+    entry.width                 = width;
+    entry.height                = height;
+    entry.flags                 = flags;
+    strncpy(entry.path, path, sizeof(entry.path) - 1);
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    entry.id = _count;
+    bool ok  = _file.write((const uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+    _file.flush();
+    if (ok) {
+        _lastTime = t;
+        _count++;
+    }
+    xSemaphoreGive(_lock);
+    return ok;
+}
+
+bool CamS3_Catalog::read(uint32_t id, cams3_catalog_entry_t* entry) {
+    if (!_open || !entry || id >= _count) return false;
+
+    File file = _fs->open(_path.c_str(), FILE_READ);
+    if (!file) return false;
+    bool ok = file.seek((id + 1) * sizeof(cams3_catalog_entry_t)) &&
+              file.read((uint8_t*)entry, sizeof(*entry)) == sizeof(*entry);
+    file.close();
+    return ok;
+}
+
+bool CamS3_Catalog::update(const char* path, uint32_t size, uint32_t setFlags) {
+    if (!_open || !path) return false;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+
+    // The append handle always writes at the end, so patch the entry through a second handle;
+    // it is closed first since FatFs may refuse a second writer on the same file
+    _file.close();
+    File file  = _fs->open(_path.c_str(), "r+");
+    bool found = false;
+    bool ok    = false;
+
+    // Newest entry first: a path reused after deletion refers to the latest capture
+    cams3_catalog_entry_t chunk[16];
+    uint32_t end = file ? _count : 0;
+    while (end > 0 && !found) {
+        uint32_t n     = (end < 16) ? end : 16;
+        uint32_t start = end - n;
+        if (!file.seek((start + 1) * sizeof(cams3_catalog_entry_t)) ||
+            file.read((uint8_t*)chunk, n * sizeof(cams3_catalog_entry_t)) != n * sizeof(cams3_catalog_entry_t)) {
+            break;
+        }
+        for (int32_t i = n - 1; i >= 0; i--) {
+            cams3_catalog_entry_t& entry = chunk[i];
+            if (strncmp(entry.path, path, sizeof(entry.path)) != 0) continue;
+
+            entry.size = size;
+            entry.flags |= setFlags;
+            found = true;
+            ok    = file.seek((start + i + 1) * sizeof(cams3_catalog_entry_t)) &&
+                    file.write((const uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+            break;
+        }
+        end = start;
+    }
+    if (file) file.close();
+
+    _file = _fs->open(_path.c_str(), FILE_APPEND);
+    if (!_file) {
+        Serial.printf("[CamS3 Catalog] Failed to reopen: %s\n", _path.c_str());
+        _open = false;
+    }
+    xSemaphoreGive(_lock);
+    return ok;
+}
+
+size_t CamS3_Catalog::page(uint32_t before, cams3_catalog_entry_t* entries, size_t maxEntries, uint32_t beforeId) {
+    if (!_open || !entries || maxEntries == 0 || _count == 0) return 0;
+
+    File file = _fs->open(_path.c_str(), FILE_READ);
+    if (!file) return 0;
+
+    // First id whose time is >= before; the page ends just below it
+    uint32_t end = (beforeId < _count) ? beforeId : _count;
+    if (before != 0) {
+        uint32_t lo = 0;
+        uint32_t hi = end;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            cams3_catalog_entry_t probe;
+            if (!file.seek((mid + 1) * sizeof(probe)) || file.read((uint8_t*)&probe, sizeof(probe)) != sizeof(probe)) {
+                file.close();
+                return 0;
+            }
+            if (probe.time < before) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        end = lo;
+    }
+
+    size_t n       = (end < maxEntries) ? end : maxEntries;
+    uint32_t start = end - n;
+    size_t got     = 0;
+    if (n > 0 && file.seek((start + 1) * sizeof(cams3_catalog_entry_t))) {
+        got = file.read((uint8_t*)entries, n * sizeof(cams3_catalog_entry_t)) / sizeof(cams3_catalog_entry_t);
+    }
+    file.close();
+
+    // Newest first
+    for (size_t i = 0; i < got / 2; i++) {
+        cams3_catalog_entry_t tmp = entries[i];
+        entries[i]                = entries[got - 1 - i];
+        entries[got - 1 - i]      = tmp;
+    }
+    return got;
+}
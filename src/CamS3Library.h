@@ -14,9 +14,24 @@
 #include <esp_camera.h>
 #include <FS.h>
 #include <SD.h>
+#include <vfs_api.h>
 #include <SPI.h>
+#include <sdmmc_cmd.h>
+#include <diskio_impl.h>
 #include <driver/i2s_pdm.h>
 #include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include <esp_idf_version.h>
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+#include <driver/i2c_master.h>
+#endif
+
+#include "CamS3_Color.h"
+#include "CamS3_Copy.h"
+#include "CamS3_Jpeg.h"
 
 // ============================================
 // M5Stack Unit CamS3-5MP GPIO Pin Definitions
@@ -53,10 +68,32 @@
 // Default SD SPI frequency (40 MHz)
 #define CAMS3_SD_SPI_FREQ     40000000
 
+// SD transfer tuning
+#define CAMS3_SD_SPI_HOST      SPI3_HOST
+#define CAMS3_SD_STAGE_SECTORS 16  // Per ping-pong buffer; also the largest write from a non-DMA buffer
+#define CAMS3_SD_PREERASE_MIN  8   // Multi-block writes of at least this many sectors get a pre-erase hint
+
+// SD write-back metadata cache
+#define CAMS3_SD_CACHE_SECTORS  32    // Cached sectors (16 KB of internal RAM)
+#define CAMS3_SD_CACHE_FLUSH_MS 1000  // Default interval between background flushes
+
 // PDM Microphone pins
 #define CAMS3_MIC_CLK_PIN     47
 #define CAMS3_MIC_DATA_PIN    48
 
+// Default thumbnail settings
+#define CAMS3_THUMB_WIDTH      160
+#define CAMS3_THUMB_HEIGHT     120
+#define CAMS3_THUMB_QUALITY    70
+#define CAMS3_THUMB_QUEUE_LEN  8
+#define CAMS3_THUMB_PATH_LEN   64
+#define CAMS3_THUMB_SUFFIX     "_thumb.jpg"
+
+// Default archival settings
+#define CAMS3_ARCHIVE_QUEUE_LEN 16
+#define CAMS3_ARCHIVE_SUFFIX    ".arc"
+#define CAMS3_ARCHIVE_BACKUP    ".orig"  // Original kept until the archive is in place
+
 // Default microphone settings
 #define CAMS3_MIC_SAMPLE_RATE     16000
 #define CAMS3_MIC_SAMPLE_BITS     16
@@ -81,6 +118,158 @@ typedef enum {
     CAMS3_HW_VERSION_NEW = 0x01
 } cams3_hw_version_t;
 
+// ============================================
+// Software auto-exposure
+// ============================================
+typedef enum {
+    CAMS3_FLICKER_OFF = 0,  // No mains-flicker quantization
+    CAMS3_FLICKER_AUTO,     // Use the sensor's 50/60 Hz light detector
+    CAMS3_FLICKER_50HZ,
+    CAMS3_FLICKER_60HZ
+} cams3_flicker_mode_t;
+
+typedef struct {
+    uint8_t targetLuma;            // Target mean luma 0-255
+    uint8_t tolerance;             // Dead band around the target
+    cams3_flicker_mode_t flicker;  // Mains-flicker handling
+    uint8_t settleFrames;          // Frames skipped after each register update
+    uint8_t maxGain;               // Highest AGC gain index used (0-30)
+} cams3_ae_config_t;
+
+#define CAMS3_AE_CONFIG_DEFAULT {110, 6, CAMS3_FLICKER_AUTO, 2, 30}
+
+// ============================================
+// Per-frame sensor statistics
+// ============================================
+
+// Fields of cams3_frame_stats_t the sensor reported; the others are 0
+#define CAMS3_STATS_EXPOSURE 0x01
+#define CAMS3_STATS_GAIN     0x02
+#define CAMS3_STATS_AWB      0x04
+
+typedef struct {
+    uint32_t sequence;        // Frame counter since begin()
+    int64_t timestampUs;      // Frame timestamp from the camera driver
+    uint32_t exposure;        // Exposure time in sensor lines, as applied by the AEC
+    uint16_t gainX16;         // Analog gain, 16 = 1x
+    uint16_t awbRed;          // White balance gains applied by the ISP, 1024 = 1x
+    uint16_t awbGreen;
+    uint16_t awbBlue;
+    int8_t chipTemperature;   // ESP32-S3 die temperature in C; the camera sensor has no readable one
+    uint8_t fields;           // CAMS3_STATS_* read back for this frame
+    bool valid;               // false until the first readback succeeds
+} cams3_frame_stats_t;
+
+// ============================================
+// Camera health monitor
+// ============================================
+#define CAMS3_HEALTH_OK         0x00
+#define CAMS3_HEALTH_BLACK      0x01  // Mean luma at or below darkLuma
+#define CAMS3_HEALTH_SATURATED  0x02  // Mean luma at or above brightLuma
+#define CAMS3_HEALTH_FROZEN     0x04  // frozenFrames identical frames in a row
+#define CAMS3_HEALTH_OBSTRUCTED 0x08  // Lit but featureless (covered or painted lens)
+#define CAMS3_HEALTH_DEFOCUSED  0x10  // Detail collapsed relative to the learned baseline
+
+#define CAMS3_HEALTH_HASH_CHUNKS 16   // Frame hash samples this many 256-byte chunks
+
+typedef struct {
+    uint8_t interval;          // Analyze every Nth frame
+    uint8_t holdFrames;        // Analyzed frames a condition must persist before it is raised or cleared
+    uint8_t darkLuma;          // Mean luma threshold for black
+    uint8_t brightLuma;        // Mean luma threshold for saturated
+    uint8_t frozenFrames;      // Identical frames in a row for frozen
+    uint8_t minContrast;       // Luma std-dev below this is obstructed
+    uint8_t sharpnessDropPct;  // Sharpness below this percentage of the baseline is defocused
+} cams3_health_config_t;
+
+#define CAMS3_HEALTH_CONFIG_DEFAULT {1, 3, 12, 245, 5, 5, 40}
+
+typedef struct {
+    uint8_t flags;              // CAMS3_HEALTH_* bits currently raised
+    uint8_t meanLuma;           // 0-255
+    uint8_t contrast;           // Luma standard deviation
+    uint16_t sharpness;         // Mean gradient over contrast, x1024
+    uint16_t baseline;          // Learned sharpness of healthy frames (0 while warming up)
+    uint16_t identicalFrames;   // Consecutive frames with the same hash
+    uint32_t analyzeUs;         // Cost of the last analysis
+    uint32_t events;            // Flag changes since the monitor was enabled
+} cams3_health_t;
+
+typedef void (*cams3_health_callback_t)(const cams3_health_t* health, uint8_t changed, void* ctx);
+
+// ============================================
+// Capture-stall watchdog
+// ============================================
+#define CAMS3_WATCHDOG_STALL_MS 500  // VSYNC silence that counts as a stall
+
+typedef enum {
+    CAMS3_RECOVER_FLUSH = 0,   // Return the held frame buffer
+    CAMS3_RECOVER_REGISTERS,   // Soft-reset the sensor and re-apply its settings
+    CAMS3_RECOVER_RESET_PIN,   // Pulse the sensor reset line, then re-apply settings
+    CAMS3_RECOVER_REINIT,      // deinit() and begin() the driver
+    CAMS3_RECOVER_STEPS
+} cams3_recovery_step_t;
+
+typedef struct {
+    uint32_t stalls;                        // Stall events (each runs one recovery step)
+    uint32_t recoveries;                    // Stalls that ended with a good frame
+    uint32_t steps[CAMS3_RECOVER_STEPS];    // Recovery steps run, by step
+    cams3_recovery_step_t lastStep;         // Step run for the most recent stall event
+    uint32_t lastRecoveryMs;                // Detection to first good frame
+    uint32_t meanRecoveryMs;
+    uint32_t maxRecoveryMs;
+} cams3_watchdog_stats_t;
+
+// ============================================
+// Exposure-synchronized flash
+// ============================================
+#define CAMS3_FLASH_GUARD_US 200  // LED margin around the target frame's integration window
+
+typedef struct {
+    uint32_t frameUs;       // Measured VSYNC period
+    uint32_t exposureUs;    // Exposure time the LED window was built from
+    uint32_t readoutUs;     // First to last row readout
+    uint32_t onTimeUs;      // Actual LED on-time
+    int32_t onErrorUs;      // Actual minus scheduled LED on (positive = late)
+    int32_t offErrorUs;     // Actual minus scheduled LED off
+    int32_t frameErrorUs;   // Returned frame timestamp minus the predicted VSYNC
+    uint8_t staleFrames;    // Frames discarded before the target
+    bool covered;           // The LED was lit for the whole integration window of every row
+} cams3_flash_result_t;
+
+// ============================================
+// Sensor standby
+// ============================================
+typedef struct {
+    uint32_t standbys;      // standby() calls that entered standby
+    uint32_t wakes;         // Wakes completed by a fresh frame
+    uint32_t lastWakeUs;    // wake() to the VSYNC of the first frame started after it
+    uint32_t meanWakeUs;
+    uint32_t maxWakeUs;
+    uint32_t staleFrames;   // Frames from before standby discarded by get()
+} cams3_standby_stats_t;
+
+// ============================================
+// High frame rate presets
+// ============================================
+typedef enum {
+    CAMS3_FPS_DEFAULT = 0,  // Driver timing for the current frame size
+    CAMS3_FPS_QVGA_60,      // 320x240, full field of view, 2x2 binned
+    CAMS3_FPS_VGA_60,       // 640x480, full field of view, 2x2 binned (JPEG or grayscale)
+    CAMS3_FPS_QVGA_120,     // 320x240, binned center crop (half the field of view)
+    CAMS3_FPS_QQVGA_120,    // 160x120, binned center crop (half the field of view)
+    CAMS3_FPS_PRESETS
+} cams3_fps_preset_t;
+
+typedef struct {
+    uint32_t frames;       // Frames delivered by get()
+    uint32_t valid;        // Frames with the expected size and a complete payload
+    uint32_t timeouts;     // get() calls that returned no frame
+    uint32_t maxGapUs;     // Longest interval between frame timestamps
+    float fps;             // Measured from frame timestamps
+    float expectedFps;     // From the preset timing (0 for CAMS3_FPS_DEFAULT)
+} cams3_fps_benchmark_t;
+
 // ============================================
 // Camera Class
 // ============================================
@@ -89,8 +278,120 @@ class CamS3_Camera {
     cams3_sensor_type_t _sensorType = CAMS3_SENSOR_UNKNOWN;
     bool _initialized               = false;
 
+    // Software auto-exposure state
+    bool _aeEnabled             = false;
+    cams3_ae_config_t _aeConfig = CAMS3_AE_CONFIG_DEFAULT;
+    uint8_t _aeSettle           = 0;
+    uint16_t _aeExposure        = 0;
+    uint16_t _aeMaxExposure     = 0;
+    uint8_t _aeGain             = 0;
+    uint8_t _aeLuma             = 0;
+    uint8_t _aeFlickerHz        = 0;
+    bool _aeConverged           = false;
+
+    // Sensor AEC/AGC settings replaced by software AE, put back when it is turned off
+    struct AePrior {
+        bool aec;
+        bool agc;
+        uint16_t exposure;
+        uint8_t gain;
+        int16_t bandManual;  // OV_REG_BAND_MANUAL / OV_REG_BAND_SELECT, -1 if not changed
+        int16_t bandSelect;
+    } _aePrior = {};
+
+    uint8_t* _lumaBuf           = nullptr;
+    size_t _lumaBufSize         = 0;
+    CamS3_JpegDecoder _jpeg;
+    CamS3_JpegEncoder _encoder;
+    CamS3_ColorCorrector _color;
+    bool _colorEnabled = false;
+
+    // Per-frame statistics
+    bool _statsEnabled = false;
+    uint32_t _frameSeq = 0;
+    uint32_t _tempSampledMs = 0;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+    i2c_master_dev_handle_t _sccbDev = nullptr;  // Sensor on the camera driver's SCCB bus
+#endif
+    cams3_frame_stats_t _stats = {};
+
+    // Health monitor; shares the luma preview with software AE
+    bool _healthEnabled                 = false;
+    cams3_health_config_t _healthConfig = CAMS3_HEALTH_CONFIG_DEFAULT;
+    cams3_health_t _health              = {};
+    cams3_health_callback_t _healthCb   = nullptr;
+    void* _healthCtx                    = nullptr;
+    uint8_t _healthRun[5]               = {0};
+    uint32_t _healthHash                = 0;
+    uint32_t _baselineQ4                = 0;
+    uint16_t _baselineSamples           = 0;
+    uint32_t _lumaSeq                   = 0;
+    uint16_t _lumaWidth                 = 0;
+    uint16_t _lumaHeight                = 0;
+
+    // Capture-stall watchdog
+    bool _wdtEnabled                 = false;
+    uint32_t _wdtStallMs             = CAMS3_WATCHDOG_STALL_MS;
+    uint8_t _wdtLevel                = 0;
+    int64_t _wdtStallStartUs         = 0;
+    uint64_t _wdtTotalMs             = 0;
+    volatile uint32_t _vsyncCount    = 0;
+    uint32_t _vsyncSeen              = 0;
+    int64_t _vsyncSeenUs             = 0;
+    uint32_t _wdtStepVsync           = 0;      // VSYNC count when the last recovery step ran
+    volatile bool _inFbGet           = false;  // get() is waiting in esp_camera_fb_get()
+    SemaphoreHandle_t _wdtLock       = nullptr;
+    TaskHandle_t _wdtTask            = nullptr;
+    cams3_watchdog_stats_t _wdtStats = {};
+
+    // Exposure-synchronized flash; shares the VSYNC tap with the watchdog
+    bool _flashEnabled            = false;
+    esp_timer_handle_t _flashOn   = nullptr;
+    esp_timer_handle_t _flashOff  = nullptr;
+    volatile int64_t _flashOnUs   = 0;  // Actual switch times, set by the timer callbacks
+    volatile int64_t _flashOffUs  = 0;
+    volatile int64_t _vsyncLastUs = 0;
+    bool _vsyncAttached           = false;
+
+    // Sensor standby
+    bool _standby                       = false;
+    int64_t _wakeStartUs                = 0;
+    uint64_t _wakeTotalUs               = 0;
+    cams3_standby_stats_t _standbyStats = {};
+
+    // High frame rate preset; AEC limits are saved when the first one is applied, the frame size
+    // whenever one replaces the driver timing
+    cams3_fps_preset_t _fpsPreset = CAMS3_FPS_DEFAULT;
+    uint8_t _fpsAecSaved[11]      = {0};
+    bool _fpsAecValid             = false;
+    framesize_t _fpsBaseSize      = FRAMESIZE_INVALID;
+
+    bool _copyPending = false;  // copyFrame() still reading fb
+
     void _applySensorDefaults();
+    void _beginWire();
     uint8_t _readRegister(uint8_t slaveAddr, uint16_t regAddr);
+    bool _readRegisters(uint16_t regAddr, uint8_t* buf, uint8_t len);
+    void _readFrameStats();
+    void _runSoftAE();
+    uint16_t _bandLines();
+    void _writeExposure(uint16_t exposure, uint8_t gain);
+    bool _lumaPreview();
+    void _runHealth();
+    bool _vsyncStalled();
+    void _recoverStall();
+    void _frameRecovered();
+    static void _wdtTaskMain(void* arg);
+    bool _restoreSensor(const camera_status_t& st);
+    bool _applyFpsPreset(cams3_fps_preset_t preset);
+    void _skipStaleFrames();
+    static void _vsyncISR(void* arg);
+    void _attachVsync();
+    void _detachVsync();
+    bool _waitVsync(int64_t& us, uint32_t timeoutMs);
+    void _flashTiming(uint32_t frameUs, uint32_t& exposureUs, uint32_t& readoutUs);
+    static void _flashOnCb(void* arg);
+    static void _flashOffCb(void* arg);
 
    public:
     camera_fb_t* fb       = nullptr;
@@ -112,16 +413,40 @@ class CamS3_Camera {
 
     /**
      * @brief Get a frame from the camera
+     *
+     * A frame still held from the previous get() is returned to the driver
+     * once the new one has arrived.
+     *
      * @return true if successful
      */
     bool get();
 
     /**
      * @brief Free the current frame buffer
+     *
+     * Waits for a copyFrame() still reading it.
+     *
      * @return true if successful
      */
     bool free();
 
+    /**
+     * @brief Copy the current frame out on the GDMA copy engine
+     *
+     * Returns as soon as the copy is queued, so the frame can be analyzed
+     * while it is copied; free() waits for the copy to finish. Used for burst
+     * capture into PSRAM buffers (allocate them with CAMS3_COPY_PSRAM_ALIGN
+     * alignment, or the CPU does the copy). Claims the GDMA channel on first
+     * use.
+     *
+     * @param dst Destination buffer
+     * @param cap Destination size; fails if the frame is larger
+     * @param cb Completion callback, ISR context (optional)
+     * @param arg Passed to the callback
+     * @return true if the copy was started
+     */
+    bool copyFrame(uint8_t* dst, size_t cap, cams3_copy_cb_t cb = nullptr, void* arg = nullptr);
+
     /**
      * @brief Deinitialize the camera
      * @return true if successful
@@ -160,11 +485,166 @@ class CamS3_Camera {
         return _initialized;
     }
 
+    /**
+     * @brief Enable/disable per-frame statistics readback
+     *
+     * When enabled, every get() reads the exposure and gain the sensor's
+     * AEC applied, and on the OV5640 the white balance gains, with one
+     * sequential burst per register block on the camera driver's SCCB bus.
+     * The values are cached for getFrameStats(). The sensor may already be
+     * exposing the next frame by then, so while the AEC is moving the values
+     * can lead the image by a frame. Fields a sensor cannot report are left
+     * out of cams3_frame_stats_t::fields.
+     *
+     * @param enable true to read statistics for every frame
+     */
+    void setFrameStats(bool enable) {
+        _statsEnabled = enable;
+    }
+
+    /**
+     * @brief Get the statistics of the frame returned by the last get()
+     * @return Cached per-frame statistics
+     */
+    const cams3_frame_stats_t& getFrameStats() {
+        return _stats;
+    }
+
+    /**
+     * @brief Enable/disable the camera health monitor
+     *
+     * Every analyzed frame is reduced to a 1/8-scale luma preview (the DC
+     * image for JPEG, no IDCT) and checked for black, saturated, frozen,
+     * obstructed and defocused conditions. The preview is shared with
+     * software AE, so with both enabled a JPEG frame is decoded once.
+     *
+     * @param enable true to analyze frames in get()
+     * @param healthConfig Thresholds (nullptr for CAMS3_HEALTH_CONFIG_DEFAULT)
+     * @return true if successful
+     */
+    bool setHealthMonitor(bool enable, const cams3_health_config_t* healthConfig = nullptr);
+
+    /**
+     * @brief Set the function called from get() when health flags change
+     * @param callback Called with the new state and the bits that changed (nullptr to remove)
+     * @param ctx User context for the callback
+     */
+    void setHealthCallback(cams3_health_callback_t callback, void* ctx = nullptr) {
+        _healthCb  = callback;
+        _healthCtx = ctx;
+    }
+
+    /**
+     * @brief Get the latest health analysis
+     * @return Cached health state
+     */
+    const cams3_health_t& getHealth() {
+        return _health;
+    }
+
+    /**
+     * @brief Forget the learned sharpness, e.g. after the camera was re-aimed on purpose
+     */
+    void resetHealthBaseline();
+
+    /**
+     * @brief Enable/disable the capture-stall watchdog
+     *
+     * A frame timeout, or no VSYNC edge for @p stallMs, is a stall. Each
+     * stall runs one recovery step, escalating until a frame arrives: flush,
+     * re-apply registers, pulse the reset pin, re-initialize. A background
+     * task watches VSYNC while get() waits for a frame and runs the steps up
+     * to the reset pin itself, so the wait ends when the sensor restarts
+     * instead of at the driver's frame timeout (about 4 s). While a stall is
+     * being recovered, get() returns false at once until VSYNC resumes.
+     *
+     * @param enable true to watch get()
+     * @param stallMs VSYNC silence treated as a stall (default: 500)
+     * @return true if successful
+     */
+    bool setWatchdog(bool enable, uint32_t stallMs = CAMS3_WATCHDOG_STALL_MS);
+
+    /**
+     * @brief Get the watchdog counters and recovery times
+     * @return Watchdog statistics
+     */
+    const cams3_watchdog_stats_t& getWatchdogStats() {
+        return _wdtStats;
+    }
+
+    /**
+     * @brief Check if a stall is being recovered
+     * @return true between stall detection and the next good frame
+     */
+    bool isStalled() {
+        return _wdtStallStartUs != 0;
+    }
+
+    /**
+     * @brief Put the sensor into software standby
+     *
+     * The sensor stops streaming with its registers retained, then XCLK is
+     * stopped, so no pixels reach the capture DMA. get() returns false at
+     * once while in standby and the watchdog does not treat the silence as
+     * a stall. Much faster to leave than deinit()/begin().
+     *
+     * @return true if successful, false if the sensor has no standby mode
+     */
+    bool standby();
+
+    /**
+     * @brief Resume streaming after standby()
+     *
+     * The next get() skips frames that were queued or cut short by standby
+     * and records the wake-to-first-frame latency in getStandbyStats().
+     *
+     * @return true if successful
+     */
+    bool wake();
+
+    bool isStandby() {
+        return _standby;
+    }
+
+    /**
+     * @brief Get standby counters and wake latencies
+     * @return Standby statistics
+     */
+    const cams3_standby_stats_t& getStandbyStats() {
+        return _standbyStats;
+    }
+
     // LED control
     void ledOn();
     void ledOff();
     void ledSet(bool state);
 
+    /**
+     * @brief Enable/disable exposure-synchronized flash capture
+     *
+     * Taps VSYNC (shared with the watchdog) and sets up the timers that
+     * switch the LED for captureFlash().
+     *
+     * @param enable true to allow captureFlash()
+     * @return true if successful
+     */
+    bool setFlashSync(bool enable);
+
+    /**
+     * @brief Capture one frame lit by the LED for exactly its exposure
+     *
+     * The frame period is measured from VSYNC, the exposure and readout
+     * times come from the sensor's exposure, VTS and window registers. The
+     * LED is switched on just before the first row of the target frame
+     * starts integrating and off just after the last row is read, then get()
+     * skips frames that started earlier. Use manual exposure for repeatable
+     * shots: AEC reacts to the flash one or two frames later.
+     *
+     * @param result Receives timing and measured alignment (optional)
+     * @return true if the target frame is in fb (release with free())
+     */
+    bool captureFlash(cams3_flash_result_t* result = nullptr);
+
     // ============================================
     // Sensor Settings - Basic
     // ============================================
@@ -210,6 +690,57 @@ class CamS3_Camera {
      */
     bool resetSensor();
 
+    // ============================================
+    // Sensor Settings - High Frame Rate
+    // ============================================
+
+    /**
+     * @brief Switch to a high frame rate sensor mode
+     *
+     * Presets combine 2x2 binning, an optional center crop and tuned line
+     * length (HTS), frame length (VTS) and PLL settings, and cap the sensor
+     * AEC at one frame so exposure cannot stretch the frame time. The camera
+     * must have been started with a frame size at least as large as the
+     * preset's. The first frames after a switch may be incomplete.
+     *
+     * @param preset Preset, or CAMS3_FPS_DEFAULT to restore the driver timing and the frame size
+     *               in effect before the first preset
+     * @return true if successful, false if the sensor or pixel format does not support it
+     */
+    bool setFpsPreset(cams3_fps_preset_t preset);
+
+    cams3_fps_preset_t getFpsPreset() {
+        return _fpsPreset;
+    }
+
+    /**
+     * @brief Get the frame rate a preset's timing produces on this sensor
+     * @param preset Preset
+     * @return Frames per second at the configured XCLK, or 0 if unsupported
+     */
+    float getExpectedFps(cams3_fps_preset_t preset);
+
+    /**
+     * @brief Get a preset name such as "QVGA 60"
+     * @param preset Preset
+     * @return Preset name
+     */
+    const char* getFpsPresetName(cams3_fps_preset_t preset);
+
+    /**
+     * @brief Capture frames and measure the delivered frame rate
+     *
+     * A frame is valid when it has the frame size the driver reports and a
+     * complete payload: width x height x bytes per pixel for raw formats, SOI
+     * and EOI markers for JPEG. A few frames are discarded first so a preset
+     * switch settles.
+     *
+     * @param frames Frames to measure
+     * @param result Receives the measurement
+     * @return true if at least two frames were captured
+     */
+    bool benchmarkFps(uint16_t frames, cams3_fps_benchmark_t* result);
+
     // ============================================
     // Image Quality & Enhancement
     // ============================================
@@ -334,6 +865,85 @@ class CamS3_Camera {
      */
     bool setAGCGain(int gain);
 
+    /**
+     * @brief Enable/disable the software auto-exposure loop
+     *
+     * Replaces the sensor AEC/AGC with a histogram-driven controller run from
+     * get(). Exposure and gain are written together once per frame, exposure is
+     * quantized to whole mains-flicker periods when the sensor supports it.
+     *
+     * @param enable true to enable software AE (sensor AEC/AGC are turned off);
+     *               false restores the AEC/AGC modes, manual exposure/gain and
+     *               flicker setting that were in effect when it was enabled
+     * @param aeConfig Controller settings (nullptr for CAMS3_AE_CONFIG_DEFAULT)
+     * @return true if successful
+     */
+    bool setSoftAE(bool enable, const cams3_ae_config_t* aeConfig = nullptr);
+
+    /**
+     * @brief Check if software auto-exposure is running
+     * @return true if enabled
+     */
+    bool isSoftAEEnabled() {
+        return _aeEnabled;
+    }
+
+    /**
+     * @brief Check if software auto-exposure reached its target
+     * @return true if the last measured luma was within tolerance
+     */
+    bool isSoftAEConverged() {
+        return _aeConverged;
+    }
+
+    /**
+     * @brief Get the mean luma measured by the software AE loop
+     * @return Mean luma 0-255
+     */
+    uint8_t getSoftAELuma() {
+        return _aeLuma;
+    }
+
+    /**
+     * @brief Get the mains frequency used for flicker avoidance
+     * @return 50 or 60 Hz, or 0 if not quantizing
+     */
+    uint8_t getFlickerFrequency() {
+        return _aeFlickerHz;
+    }
+
+    /**
+     * @brief Compute a 256-bin luma histogram of a frame
+     *
+     * JPEG frames are measured on their DC image (1/8 scale, no IDCT),
+     * other formats are subsampled every 4th pixel.
+     *
+     * @param frame Camera frame buffer
+     * @param hist Output histogram (256 entries)
+     * @return true if successful
+     */
+    bool computeLumaHistogram(camera_fb_t* frame, uint32_t* hist);
+
+    /**
+     * @brief Encode an RGB565 frame to JPEG in software, using both cores
+     * @param frame Camera frame buffer (PIXFORMAT_RGB565)
+     * @param quality JPEG quality 1-100, higher is better
+     * @param out Receives a malloc'd JPEG buffer (release with free())
+     * @param outLen Receives the JPEG length
+     * @param bands Bands encoded in parallel, 1 = single core (default: 2)
+     * @return true if successful
+     */
+    bool encodeJpeg(camera_fb_t* frame, uint8_t quality, uint8_t** out, size_t* outLen,
+                    uint8_t bands = CAMS3_JPEG_MAX_BANDS);
+
+    /**
+     * @brief Get the duration of the last encodeJpeg() call
+     * @return Time in microseconds
+     */
+    uint32_t getLastEncodeTime() {
+        return _encoder.getLastEncodeTime();
+    }
+
     // ============================================
     // Image Processing
     // ============================================
@@ -380,6 +990,27 @@ class CamS3_Camera {
      */
     bool setLensCorrection(bool enable);
 
+    /**
+     * @brief Enable/disable software color correction of RGB565 frames
+     *
+     * Applied in get() after statistics, software AE and the health monitor
+     * have seen the raw frame. Gamma, white-balance gains, vignetting and an
+     * optional tone curve are folded into lookup tables for a single pass.
+     *
+     * @param enable true to correct every RGB565 frame
+     * @param config Correction settings (nullptr keeps the current ones)
+     * @return true if successful
+     */
+    bool setColorCorrection(bool enable, const cams3_color_config_t* config = nullptr);
+
+    /**
+     * @brief Get the color corrector for tone curves and timing
+     * @return Reference to the color corrector
+     */
+    CamS3_ColorCorrector& getColorCorrector() {
+        return _color;
+    }
+
     // ============================================
     // Advanced Register & Low-Level Control
     // ============================================
@@ -549,19 +1180,329 @@ class CamS3_Mic {
     bool isSoundDetected(uint16_t threshold = 500, size_t samples = 256);
 };
 
+// ============================================
+// Binary Metadata Log
+// ============================================
+#define CAMS3_METALOG_MAGIC          "CS3M"
+#define CAMS3_METALOG_VERSION        2
+#define CAMS3_METALOG_HEADER_SIZE    512
+#define CAMS3_METALOG_BUFFER_RECORDS 32  // 32 x 96 bytes = 6 sectors per write
+#define CAMS3_META_ARCHIVED          0x01  // File was re-encoded; prevCrc32 is the digest it replaced
+
+// Fixed-size little-endian record, one per saved frame (and one per archived file)
+typedef struct __attribute__((packed)) {
+    uint32_t sequence;        // Record number in this log
+    uint32_t frameSequence;   // Camera frame counter (0 if unknown)
+    int64_t captureUs;        // Frame timestamp
+    int64_t writtenUs;        // Time the file write completed
+    uint32_t exposure;        // Exposure in sensor lines
+    uint16_t gainX16;         // Analog gain, 16 = 1x
+    uint16_t flags;           // CAMS3_META_* bits
+    uint32_t jpegSize;        // Bytes written
+    uint32_t writeLatencyUs;  // Open + write + close time
+    uint32_t crc32;           // CRC-32 of the image data
+    uint32_t prevCrc32;       // CRC-32 of the replaced image (CAMS3_META_ARCHIVED only)
+    char path[48];            // File path, truncated and NUL padded
+} cams3_meta_record_t;
+
+class CamS3_MetaLog {
+   private:
+    File _file;
+    bool _open                   = false;
+    SemaphoreHandle_t _lock      = nullptr;  // Saves and the archive task both append
+    cams3_meta_record_t* _buffer = nullptr;
+    uint16_t _count              = 0;
+    uint32_t _sequence           = 0;
+
+    bool _writeHeader();
+    bool _checkHeader(File& file, uint16_t& version);
+    bool _flushLocked();
+
+   public:
+    /**
+     * @brief Open (or continue) a metadata log
+     * @param fs File system holding the log
+     * @param path Log file path; a schema header is written to new files
+     * @return true if successful
+     */
+    bool open(fs::FS& fs, const char* path);
+
+    /**
+     * @brief Queue a record; only a copy unless the buffer is full
+     *
+     * The sequence field is assigned by the log. Full buffers are written
+     * as one sector-aligned block.
+     *
+     * @param record Record to append
+     * @return true if successful
+     */
+    bool append(const cams3_meta_record_t& record);
+
+    /**
+     * @brief Write buffered records to the card
+     * @return true if successful
+     */
+    bool flush();
+
+    /**
+     * @brief Flush and close the log
+     */
+    void close();
+
+    /**
+     * @brief Check if the log is open
+     * @return true if open
+     */
+    bool isOpen() {
+        return _open;
+    }
+
+    /**
+     * @brief Get the number of records in the log, including buffered ones
+     * @return Record count
+     */
+    uint32_t getRecordCount() {
+        return _sequence;
+    }
+};
+
+// ============================================
+// Capture Catalog
+// ============================================
+#define CAMS3_CATALOG_MAGIC    "CS3C"
+#define CAMS3_CATALOG_VERSION  1
+#define CAMS3_CATALOG_PATH_LEN 44    // Path field size; longer paths are rejected
+#define CAMS3_CATALOG_THUMB    0x01  // A sidecar thumbnail was requested
+#define CAMS3_CATALOG_ARCHIVED 0x02  // The image was re-encoded; size is the archived size
+
+// Fixed-size little-endian index entry; the header occupies the first slot
+typedef struct __attribute__((packed)) {
+    uint32_t id;                        // Entry number, also its slot in the file
+    uint32_t time;                      // Unix time (or seconds since boot if the clock is unset), never decreasing
+    uint32_t size;                      // Image size in bytes
+    uint16_t width;
+    uint16_t height;
+    uint32_t flags;                     // CAMS3_CATALOG_* bits
+    char path[CAMS3_CATALOG_PATH_LEN];  // File path, NUL padded
+} cams3_catalog_entry_t;
+
+class CamS3_Catalog {
+   private:
+    fs::FS* _fs = nullptr;
+    File _file;
+    String _path;
+    bool _open              = false;
+    SemaphoreHandle_t _lock = nullptr;  // Saves append, the archive task updates
+    uint32_t _count         = 0;
+    uint32_t _lastTime      = 0;
+
+   public:
+    /**
+     * @brief Open (or continue) a capture catalog
+     * @param fs File system holding the catalog
+     * @param path Catalog file path
+     * @return true if successful
+     */
+    bool open(fs::FS& fs, const char* path);
+
+    /**
+     * @brief Close the catalog
+     */
+    void close();
+
+    /**
+     * @brief Check if the catalog is open
+     * @return true if open
+     */
+    bool isOpen() {
+        return _open;
+    }
+
+    /**
+     * @brief Get the number of catalog entries
+     * @return Entry count
+     */
+    uint32_t getCount() {
+        return _count;
+    }
+
+    /**
+     * @brief Add an entry for a saved capture
+     * @param path Image path, at most CAMS3_CATALOG_PATH_LEN - 1 characters
+     * @param size Image size in bytes
+     * @param width Image width
+     * @param height Image height
+     * @param flags CAMS3_CATALOG_* bits
+     * @return true if successful, false if the path is too long to store in full
+     */
+    bool append(const char* path, uint32_t size, uint16_t width, uint16_t height, uint32_t flags = 0);
+
+    /**
+     * @brief Read one entry
+     * @param id Entry id
+     * @param entry Output entry
+     * @return true if successful
+     */
+    bool read(uint32_t id, cams3_catalog_entry_t* entry);
+
+    /**
+     * @brief Update the newest entry for a path after the file was rewritten
+     * @param path Image path
+     * @param size New image size in bytes
+     * @param setFlags CAMS3_CATALOG_* bits to add
+     * @return true if an entry was found and updated
+     */
+    bool update(const char* path, uint32_t size, uint32_t setFlags = 0);
+
+    /**
+     * @brief Read a page of entries, newest first
+     *
+     * Entries are in time order on the card, so the start of the page is
+     * found by binary search and the page itself is one contiguous read.
+     * Ids follow the same order, so the next page continues below the id of
+     * the last entry returned; captures sharing a second are not skipped.
+     *
+     * @param before Only return entries older than this time (0 = newest)
+     * @param entries Output array
+     * @param maxEntries Output array capacity
+     * @param beforeId Only return entries with a smaller id (next page: last id returned)
+     * @return Number of entries returned
+     */
+    size_t page(uint32_t before, cams3_catalog_entry_t* entries, size_t maxEntries, uint32_t beforeId = UINT32_MAX);
+};
+
+// ============================================
+// SDFS-compatible File System
+// ============================================
+class CamS3_SD;
+
+/**
+ * @brief fs::FS on the card's mount, with the card methods of the Arduino SD object
+ *
+ * Code written against SD keeps working through CamS3.Sd.getFS(): files,
+ * cardType(), cardSize(), totalBytes() and raw sector access. Raw sectors
+ * go through the library's disk driver, so they see the write cache.
+ */
+class CamS3_SDFS : public fs::FS {
+   private:
+    CamS3_SD* _sd;
+
+   public:
+    CamS3_SDFS(fs::FSImplPtr impl, CamS3_SD* sd) : fs::FS(impl), _sd(sd) {}
+
+    sdcard_type_t cardType();
+    uint64_t cardSize();
+    size_t numSectors();
+    size_t sectorSize();
+    uint64_t totalBytes();
+    uint64_t usedBytes();
+    bool readRAW(uint8_t* buffer, uint32_t sector);
+    bool writeRAW(uint8_t* buffer, uint32_t sector);
+};
+
 // ============================================
 // SD Card Class
 // ============================================
+typedef struct {
+    uint32_t writes;       // Card write commands
+    uint32_t multiBlock;   // Of those, multi-block (CMD25)
+    uint32_t preErases;    // Pre-erase hints sent (ACMD23)
+    uint64_t sectors;      // Sectors written
+    uint64_t staged;       // Sectors copied through the ping-pong buffers from non-DMA memory
+    uint64_t writeUs;      // Time in card writes
+    uint32_t maxWriteUs;   // Slowest single write command
+    uint32_t cacheHits;    // Sector reads served from the metadata cache
+    uint32_t cacheReads;   // Sector reads that went to the card and were cached
+    uint32_t cacheWrites;  // Sector writes absorbed by the metadata cache
+    uint32_t flushes;      // Cache flushes that wrote to the card
+} cams3_sd_io_stats_t;
+
 class CamS3_SD {
+    friend class CamS3_SDFS;
+
    private:
-    bool _initialized  = false;
-    uint32_t _spiFreq  = CAMS3_SD_SPI_FREQ;
-    SPIClass* _spi     = nullptr;
+    bool _initialized     = false;
+    uint32_t _spiFreq     = CAMS3_SD_SPI_FREQ;
+    sdmmc_card_t* _card   = nullptr;
+    int8_t _drive         = -1;  // FatFs physical drive of the mounted card
+
+    // File system on the card's mount point; the Arduino SD object is never begun
+    fs::FSImplPtr _vfs = fs::FSImplPtr(new VFSImpl());
+    CamS3_SDFS _fs     = CamS3_SDFS(_vfs, this);
     uint32_t _fileCounter = 0;
+    CamS3_MetaLog _metaLog;
+    CamS3_Catalog _catalog;
+
+    // Sector I/O below FatFs: DMA-capable ping-pong buffers, filled by the copy engine
+    uint8_t* _stage[2]           = {nullptr, nullptr};
+    CamS3_CopyEngine _copy;
+    SemaphoreHandle_t _ioLock    = nullptr;
+    bool _preErase               = true;
+    cams3_sd_io_stats_t _ioStats = {};
+
+    // Write-back cache for single-sector I/O, which is how FatFs moves FAT, directory and FSInfo sectors
+    struct CacheEntry {
+        uint32_t sector;
+        uint32_t lastUse;
+        bool valid;
+        bool dirty;
+    };
+    uint8_t* _cache        = nullptr;  // CAMS3_SD_CACHE_SECTORS sectors, DMA-capable
+    CacheEntry _cacheEntries[CAMS3_SD_CACHE_SECTORS];
+    uint32_t _cacheClock   = 0;
+    uint32_t _cacheFlushMs = CAMS3_SD_CACHE_FLUSH_MS;
+    TaskHandle_t _syncTask = nullptr;
+    int8_t _lowVoltagePin  = -1;
+
+    // Background thumbnail generation
+    bool _thumbEnabled        = false;
+    uint16_t _thumbWidth      = CAMS3_THUMB_WIDTH;
+    uint16_t _thumbHeight     = CAMS3_THUMB_HEIGHT;
+    uint8_t _thumbQuality     = CAMS3_THUMB_QUALITY;
+    uint32_t _thumbDropped    = 0;
+    QueueHandle_t _thumbQueue = nullptr;
+    TaskHandle_t _thumbTask   = nullptr;
+
+    // Background Huffman re-encoding
+    bool _archiveEnabled        = false;
+    uint32_t _archiveDropped    = 0;
+    uint32_t _archivedFiles     = 0;
+    uint64_t _archiveSaved      = 0;
+    QueueHandle_t _archiveQueue = nullptr;
+    TaskHandle_t _archiveTask   = nullptr;
+
+    static void _thumbTaskMain(void* arg);
+    static void _archiveTaskMain(void* arg);
+
+    bool _fsSpace(uint64_t& total, uint64_t& free);
+    bool _writeSectors(const uint8_t* data, uint32_t sector, uint32_t count);
+    bool _writeCard(const uint8_t* data, uint32_t sector, uint32_t count);
+    bool _sendPreErase(uint32_t count);
+    int _cacheFind(uint32_t sector);
+    int _cacheSlot();
+    bool _cacheFlush();
+    static void _syncTaskMain(void* arg);
+    static void _lowVoltageISR(void* arg);
+
+    // FatFs disk driver for the card, registered over the IDF one
+    static CamS3_SD* _active;
+    static DSTATUS _diskInit(BYTE pdrv);
+    static DSTATUS _diskStatus(BYTE pdrv);
+    static DRESULT _diskRead(BYTE pdrv, BYTE* buff, uint32_t sector, UINT count);
+    static DRESULT _diskWrite(BYTE pdrv, const BYTE* buff, uint32_t sector, UINT count);
+    static DRESULT _diskIoctl(BYTE pdrv, BYTE cmd, void* buff);
 
    public:
     /**
      * @brief Initialize the SD card
+     *
+     * Mounts the card through the ESP-IDF sdspi host at /sd and serves its
+     * files through getFS() (not the Arduino SD object, which stays
+     * unmounted). Writes go to the card
+     * as multi-block transfers with a pre-erase hint; data outside
+     * DMA-capable memory (PSRAM frame buffers) is staged through two
+     * internal buffers, one filled by the GDMA while the other is sent.
+     *
      * @param spiFreq SPI frequency in Hz (default: 40MHz)
      * @return true if successful
      */
@@ -592,6 +1533,79 @@ class CamS3_SD {
      */
     const char* getCardTypeName();
 
+    /**
+     * @brief Get the FatFs physical drive the card is mounted on
+     *
+     * For raw sector access through the disk driver (see CamS3_RawLog).
+     *
+     * @return Drive number, or -1 if no card is mounted
+     */
+    int getDrive() {
+        return _initialized ? _drive : -1;
+    }
+
+    /**
+     * @brief Enable/disable pre-erase hints (ACMD23) before multi-block writes
+     * @param enable true to send the hint (default)
+     */
+    void setPreErase(bool enable) {
+        _preErase = enable;
+    }
+
+    /**
+     * @brief Get sector-level write statistics
+     * @return Statistics since begin() or resetIoStats()
+     */
+    const cams3_sd_io_stats_t& getIoStats() {
+        return _ioStats;
+    }
+
+    void resetIoStats() {
+        _ioStats = {};
+    }
+
+    /**
+     * @brief Enable/disable the write-back metadata cache
+     *
+     * FatFs updates FAT entries, directory entries and FSInfo one sector at
+     * a time, each a separate card write, several per saved file. With the
+     * cache on, single-sector writes stay in RAM and single-sector reads are
+     * served from it, so repeated creates in a directory rewrite the same
+     * cached sectors; dirty sectors reach the card as sorted, coalesced
+     * writes when the interval passes, on sync(), when the cache is full or
+     * on a low-voltage warning. Closing or flushing a file no longer makes
+     * its metadata durable by itself: up to flushMs of changes can be lost
+     * on power failure.
+     *
+     * @param enable true to cache, false to flush and release the cache and its flush task
+     * @param flushMs Background flush interval in milliseconds
+     * @return true if successful
+     */
+    bool setWriteCache(bool enable, uint32_t flushMs = CAMS3_SD_CACHE_FLUSH_MS);
+
+    bool isWriteCacheEnabled() {
+        return _cache != nullptr;
+    }
+
+    /**
+     * @brief Write every dirty cached sector to the card now
+     * @return true if successful (also when the cache is off)
+     */
+    bool sync();
+
+    /**
+     * @brief Flush the cache when a power supervisor signals low voltage
+     *
+     * The pin interrupt wakes a high-priority task that writes the cache
+     * out, ahead of the brownout. Requires setWriteCache(true); the pin is
+     * released again by setWriteCache(false) and end().
+     *
+     * @param pin GPIO of the low-voltage warning output
+     * @param mode Interrupt edge, e.g. FALLING for an active-low warning
+     * @return true if successful
+     */
+    bool attachLowVoltagePin(uint8_t pin, int mode = FALLING);
+
     /**
      * @brief Get total card size in bytes
      * @return Total size in bytes
@@ -691,9 +1705,140 @@ class CamS3_SD {
      * @brief Save camera frame buffer to SD card
      * @param fb Camera frame buffer
      * @param path File path (if nullptr, auto-generates name)
+     * @param stats Frame statistics for the metadata log (optional)
      * @return true if successful
      */
-    bool saveFrame(camera_fb_t* fb, const char* path = nullptr);
+    bool saveFrame(camera_fb_t* fb, const char* path = nullptr, const cams3_frame_stats_t* stats = nullptr);
+
+    /**
+     * @brief Start logging a binary metadata record for every saveFrame()
+     * @param path Log file path (default: "/frames.cs3m")
+     * @return true if successful
+     */
+    bool openMetaLog(const char* path = "/frames.cs3m") {
+        return _initialized && _metaLog.open(_fs, path);
+    }
+
+    /**
+     * @brief Flush and close the metadata log
+     */
+    void closeMetaLog() {
+        _metaLog.close();
+    }
+
+    /**
+     * @brief Get the metadata log for custom records or explicit flushes
+     * @return Reference to the metadata log
+     */
+    CamS3_MetaLog& getMetaLog() {
+        return _metaLog;
+    }
+
+    /**
+     * @brief Start indexing every saveFrame() in an on-card capture catalog
+     * @param path Catalog file path (default: "/captures.cs3c")
+     * @return true if successful
+     */
+    bool openCatalog(const char* path = "/captures.cs3c") {
+        return _initialized && _catalog.open(_fs, path);
+    }
+
+    /**
+     * @brief Close the capture catalog
+     */
+    void closeCatalog() {
+        _catalog.close();
+    }
+
+    /**
+     * @brief Get the capture catalog
+     * @return Reference to the catalog
+     */
+    CamS3_Catalog& getCatalog() {
+        return _catalog;
+    }
+
+    /**
+     * @brief Enable/disable sidecar thumbnails for saved frames
+     *
+     * Thumbnails are made on a low-priority background task from a DC-only
+     * decode of the saved file, so saveFrame() only pays for a queue post.
+     * Jobs are dropped, never waited for, when the queue is full.
+     *
+     * @param enable true to write a thumbnail next to every saved frame
+     * @param width Maximum thumbnail width (default: 160)
+     * @param height Maximum thumbnail height (default: 120)
+     * @param quality Thumbnail JPEG quality 1-100, higher is better (default: 70)
+     * @return true if successful
+     */
+    bool setThumbnails(bool enable, uint16_t width = CAMS3_THUMB_WIDTH, uint16_t height = CAMS3_THUMB_HEIGHT,
+                       uint8_t quality = CAMS3_THUMB_QUALITY);
+
+    /**
+     * @brief Create the thumbnail for a JPEG file now, on the calling task
+     * @param path JPEG file path
+     * @return true if successful
+     */
+    bool makeThumbnail(const char* path);
+
+    /**
+     * @brief Get the sidecar thumbnail path for an image
+     * @param path Image path (e.g., "/IMG_1.jpg")
+     * @return Thumbnail path (e.g., "/IMG_1_thumb.jpg")
+     */
+    static String thumbnailPath(const char* path);
+
+    /**
+     * @brief Get the number of thumbnails skipped because the queue was full
+     * @return Dropped thumbnail count
+     */
+    uint32_t getThumbnailsDropped() {
+        return _thumbDropped;
+    }
+
+    /**
+     * @brief Enable/disable archival re-encoding of saved frames
+     *
+     * Each saved JPEG is re-encoded with Huffman tables optimized for that
+     * image on an idle-priority background task. Pixels are unchanged; the
+     * file is only replaced when the result is smaller. Jobs are dropped,
+     * never waited for, when the queue is full.
+     *
+     * @param enable true to archive every saved frame
+     * @return true if successful
+     */
+    bool setArchiving(bool enable);
+
+    /**
+     * @brief Re-encode a JPEG file with optimized Huffman tables now, on the calling task
+     * @param path JPEG file path
+     * @return true if the file was processed (replaced or already optimal)
+     */
+    bool archiveFile(const char* path);
+
+    /**
+     * @brief Get the total bytes saved by archival re-encoding
+     * @return Saved bytes
+     */
+    uint64_t getArchiveSavedBytes() {
+        return _archiveSaved;
+    }
+
+    /**
+     * @brief Get the number of files replaced by a smaller archival encoding
+     * @return Archived file count
+     */
+    uint32_t getArchivedFiles() {
+        return _archivedFiles;
+    }
+
+    /**
+     * @brief Get the number of archival jobs skipped because the queue was full
+     * @return Dropped job count
+     */
+    uint32_t getArchiveDropped() {
+        return _archiveDropped;
+    }
 
     /**
      * @brief Generate a unique filename for saving images
@@ -704,11 +1849,16 @@ class CamS3_SD {
     String generateFilename(const char* prefix = "IMG", const char* extension = "jpg");
 
     /**
-     * @brief Get the underlying SDFS object for advanced operations
-     * @return Reference to SD filesystem
+     * @brief Get the card's file system for advanced operations
+     *
+     * Stands in for the Arduino SD object, which this library does not
+     * mount: it has the same file and card methods, but is not an
+     * fs::SDFS.
+     *
+     * @return File system mounted at /sd
      */
-    fs::SDFS& getFS() {
-        return SD;
+    CamS3_SDFS& getFS() {
+        return _fs;
     }
 };
 
@@ -0,0 +1,341 @@
+/**
+ * @file CamS3_Avi.cpp
+ * @brief MJPEG AVI remux of captured JPEG sequences for CamS3Library
+ *
+ * @copyright MIT License
+ */
+
+#include "CamS3_Avi.h"
+#include <esp_heap_caps.h>
+
+#define AVIF_HASINDEX  0x10
+#define AVIIF_KEYFRAME 0x10
+
+static inline void put16(uint8_t* p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static inline void put32(uint8_t* p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static inline void putFourcc(uint8_t* p, const char* fourcc) {
+    memcpy(p, fourcc, 4);
+}
+
+// RIFF/hdrl/strl/movi headers; rewritten with the final counts when the job ends
+static void buildAviHeader(uint8_t* h, uint16_t width, uint16_t height, uint8_t fps, uint32_t frames,
+                           uint32_t maxFrame, uint32_t moviBytes, uint32_t riffSize) {
+    memset(h, 0, CAMS3_AVI_HEADER_SIZE);
+
+    putFourcc(h + 0, "RIFF");
+    put32(h + 4, riffSize);
+    putFourcc(h + 8, "AVI ");
+
+    putFourcc(h + 12, "LIST");
+    put32(h + 16, 192);
+    putFourcc(h + 20, "hdrl");
+
+    // avih: main AVI header
+    putFourcc(h + 24, "avih");
+    put32(h + 28, 56);
+    put32(h + 32, 1000000 / fps);       // dwMicroSecPerFrame
+    put32(h + 36, maxFrame * fps);      // dwMaxBytesPerSec
+    put32(h + 44, AVIF_HASINDEX);       // dwFlags
+    put32(h + 48, frames);              // dwTotalFrames
+    put32(h + 56, 1);                   // dwStreams
+    put32(h + 60, maxFrame);            // dwSuggestedBufferSize
+    put32(h + 64, width);
+    put32(h + 68, height);
+
+    putFourcc(h + 88, "LIST");
+    put32(h + 92, 116);
+    putFourcc(h + 96, "strl");
+
+    // strh: video stream header
+    putFourcc(h + 100, "strh");
+    put32(h + 104, 56);
+    putFourcc(h + 108, "vids");
+    putFourcc(h + 112, "MJPG");
+    put32(h + 128, 1);                  // dwScale
+    put32(h + 132, fps);                // dwRate
+    put32(h + 140, frames);             // dwLength
+    put32(h + 144, maxFrame);           // dwSuggestedBufferSize
+    put32(h + 148, 0xFFFFFFFF);         // dwQuality
+    put16(h + 160, width);              // rcFrame right
+    put16(h + 162, height);             // rcFrame bottom
+
+    // strf: BITMAPINFOHEADER
+    putFourcc(h + 164, "strf");
+    put32(h + 168, 40);
+    put32(h + 172, 40);
+    put32(h + 176, width);
+    put32(h + 180, height);
+    put16(h + 184, 1);                  // biPlanes
+    put16(h + 186, 24);                 // biBitCount
+    putFourcc(h + 188, "MJPG");
+    put32(h + 192, (uint32_t)width * height * 3);
+
+    putFourcc(h + 212, "LIST");
+    put32(h + 216, 4 + moviBytes);
+    putFourcc(h + 220, "movi");
+}
+
+// ============================================
+// CamS3_AviRemux Implementation
+// ============================================
+
+bool CamS3_AviRemux::begin(CamS3_SD& sd) {
+    if (!sd.isInitialized()) return false;
+    _sd = &sd;
+    return true;
+}
+
+void CamS3_AviRemux::setSourceCatalog(uint32_t firstId, uint32_t lastId) {
+    _useCatalog = true;
+    _first      = firstId;
+    _last       = lastId;
+}
+
+void CamS3_AviRemux::setSourcePattern(const char* pattern, uint32_t first, uint32_t last) {
+    _useCatalog = false;
+    _pattern    = String(pattern);
+    _first      = first;
+    _last       = last;
+}
+
+bool CamS3_AviRemux::_sourcePath(uint32_t n, char* path, size_t len) {
+    if (_useCatalog) {
+        cams3_catalog_entry_t entry;
+        if (!_sd->getCatalog().read(n, &entry)) return false;
+        strncpy(path, entry.path, len - 1);
+        path[len - 1] = '\0';
+        return true;
+    }
+    snprintf(path, len, _pattern.c_str(), n);
+    return true;
+}
+
+bool CamS3_AviRemux::run(const char* aviPath, uint8_t fps) {
+    if (!_sd || _state == CAMS3_REMUX_RUNNING || !aviPath || fps == 0 || _last < _first) return false;
+
+    _aviPath = String(aviPath);
+    _fps     = fps;
+    _state   = CAMS3_REMUX_RUNNING;
+    return _run();
+}
+
+bool CamS3_AviRemux::start(const char* aviPath, uint8_t fps) {
+    if (!_sd || _state == CAMS3_REMUX_RUNNING || !aviPath || fps == 0 || _last < _first) return false;
+
+    _aviPath = String(aviPath);
+    _fps     = fps;
+    _state   = CAMS3_REMUX_RUNNING;
+    if (xTaskCreate(_taskMain, "cams3_remux", 4096, this, tskIDLE_PRIORITY + 1, &_task) != pdPASS) {
+        _state = CAMS3_REMUX_FAILED;
+        return false;
+    }
+    return true;
+}
+
+void CamS3_AviRemux::_taskMain(void* arg) {
+    CamS3_AviRemux* self = (CamS3_AviRemux*)arg;
+    self->_run();
+    self->_task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+bool CamS3_AviRemux::_run() {
+    uint32_t startMs = millis();
+    _cancel          = false;
+    _framesDone      = 0;
+    _framesSkipped   = 0;
+    _framesTotal     = _last - _first + 1;
+    _bytes           = 0;
+    _moviBytes       = 0;
+    _maxFrame        = 0;
+    _idxCount        = 0;
+    _idxSpilled      = 0;
+    _width           = 0;
+    _height          = 0;
+    _writeFailed     = false;
+
+    // DMA-capable internal buffers avoid a bounce copy in the SD driver
+    _buf = (uint8_t*)heap_caps_malloc(CAMS3_AVI_IO_BUFFER, MALLOC_CAP_DMA);
+    if (!_buf) _buf = (uint8_t*)malloc(CAMS3_AVI_IO_BUFFER);
+    _idxBuf = (uint8_t*)malloc(CAMS3_AVI_INDEX_BATCH * 16);
+
+    String idxPath = _aviPath + ".idx";
+    _avi           = _sd->getFS().open(_aviPath.c_str(), FILE_WRITE);
+    _idx           = _sd->getFS().open(idxPath.c_str(), FILE_WRITE);
+    if (!_buf || !_idxBuf || !_avi || !_idx) {
+        Serial.println("[CamS3 AVI] Failed to start remux");
+        _release();
+        _sd->getFS().remove(idxPath.c_str());
+        _state = CAMS3_REMUX_FAILED;
+        return false;
+    }
+
+    // Placeholder header, patched once the counts are known
+    uint8_t header[CAMS3_AVI_HEADER_SIZE];
+    buildAviHeader(header, 0, 0, _fps, 0, 0, 0, 0);
+    bool ok = _avi.write(header, sizeof(header)) == sizeof(header);
+
+    char path[64];
+    for (uint32_t n = _first; ok && n <= _last; n++) {
+        if (_cancel) break;
+        if (!_sourcePath(n, path, sizeof(path)) || !_appendFrame(path)) {
+            _framesSkipped++;
+        }
+        _framesDone++;
+        ok = !_writeFailed;
+    }
+
+    if (ok && !_cancel) {
+        ok = _finish();
+    }
+    _elapsedMs = millis() - startMs;
+    _release();
+    _sd->getFS().remove(idxPath.c_str());
+
+    if (_cancel || !ok) {
+        _sd->getFS().remove(_aviPath.c_str());
+        _state = _cancel ? CAMS3_REMUX_CANCELLED : CAMS3_REMUX_FAILED;
+        return false;
+    }
+
+    Serial.printf("[CamS3 AVI] %s: %lu frames, %lu skipped, %lu KB/s\n", _aviPath.c_str(),
+                  (unsigned long)(_framesDone - _framesSkipped), (unsigned long)_framesSkipped,
+                  (unsigned long)getThroughputKBps());
+    _state = CAMS3_REMUX_DONE;
+    return true;
+}
+
+void CamS3_AviRemux::_release() {
+    if (_avi) _avi.close();
+    if (_idx) _idx.close();
+    free(_buf);
+    free(_idxBuf);
+    _buf    = nullptr;
+    _idxBuf = nullptr;
+}
+
+bool CamS3_AviRemux::_appendFrame(const char* path) {
+    File src = _sd->getFS().open(path, FILE_READ);
+    if (!src) return false;
+
+    size_t size = src.size();
+    if (size < 4 || (uint64_t)_moviBytes + size + 8 + 16ull * (_framesDone + 1) > 0xFFFF0000ull) {
+        src.close();
+        return false;  // Empty, or would overflow the 32-bit RIFF size
+    }
+
+    // First block doubles as the SOI check and, for the first frame, the size probe
+    size_t got = src.read(_buf, CAMS3_AVI_IO_BUFFER);
+    if (got < 4 || _buf[0] != 0xFF || _buf[1] != 0xD8) {
+        src.close();
+        return false;
+    }
+    if (_width == 0) {
+        CamS3_JpegDecoder* jpeg = new CamS3_JpegDecoder();
+        if (jpeg->parse(_buf, got)) {
+            _width  = jpeg->getInfo().width;
+            _height = jpeg->getInfo().height;
+        }
+        delete jpeg;
+    }
+
+    uint8_t chunk[8];
+    putFourcc(chunk, "00dc");
+    put32(chunk + 4, size);
+    uint32_t chunkOffset = 4 + _moviBytes;  // idx1 offsets count from the 'movi' fourcc
+    if (_avi.write(chunk, 8) != 8) {
+        src.close();
+        _writeFailed = true;
+        return false;
+    }
+
+    size_t total = 0;
+    while (got > 0) {
+        if (_avi.write(_buf, got) != got) {
+            src.close();
+            _writeFailed = true;
+            return false;
+        }
+        total += got;
+        got = src.read(_buf, CAMS3_AVI_IO_BUFFER);
+    }
+    src.close();
+    if (total != size) {
+        _writeFailed = true;  // Chunk header already claims the full size
+        return false;
+    }
+
+    uint32_t padded = size;
+    if (size & 1) {
+        uint8_t pad = 0;
+        if (_avi.write(&pad, 1) != 1) {
+            _writeFailed = true;
+            return false;
+        }
+        padded++;
+    }
+
+    uint8_t* e = _idxBuf + _idxCount * 16;
+    putFourcc(e, "00dc");
+    put32(e + 4, AVIIF_KEYFRAME);
+    put32(e + 8, chunkOffset);
+    put32(e + 12, size);
+    if (++_idxCount == CAMS3_AVI_INDEX_BATCH && !_spillIndex()) {
+        _writeFailed = true;
+        return false;
+    }
+
+    _moviBytes += 8 + padded;
+    _bytes += size;
+    if (size > _maxFrame) _maxFrame = size;
+    return true;
+}
+
+bool CamS3_AviRemux::_spillIndex() {
+    size_t len = _idxCount * 16;
+    if (_idx.write(_idxBuf, len) != len) return false;
+    _idxSpilled += _idxCount;
+    _idxCount = 0;
+    return true;
+}
+
+bool CamS3_AviRemux::_finish() {
+    if (_idxCount && !_spillIndex()) return false;
+    _idx.close();
+
+    uint32_t frames = _idxSpilled;
+    uint8_t chunk[8];
+    putFourcc(chunk, "idx1");
+    put32(chunk + 4, frames * 16);
+    if (_avi.write(chunk, 8) != 8) return false;
+
+    // Copy the spilled index back in large sequential blocks
+    String idxPath = _aviPath + ".idx";
+    File idx       = _sd->getFS().open(idxPath.c_str(), FILE_READ);
+    if (!idx) return false;
+    size_t got;
+    while ((got = idx.read(_buf, CAMS3_AVI_IO_BUFFER)) > 0) {
+        if (_avi.write(_buf, got) != got) {
+            idx.close();
+            return false;
+        }
+    }
+    idx.close();
+
+    uint32_t riffSize = CAMS3_AVI_HEADER_SIZE - 8 + _moviBytes + 8 + frames * 16;
+    uint8_t header[CAMS3_AVI_HEADER_SIZE];
+    buildAviHeader(header, _width, _height, _fps, frames, _maxFrame, _moviBytes, riffSize);
+    if (!_avi.seek(0) || _avi.write(header, sizeof(header)) != sizeof(header)) return false;
+    _avi.flush();
+    return true;
+}
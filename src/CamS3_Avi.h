@@ -0,0 +1,161 @@
+/**
+ * @file CamS3_Avi.h
+ * @brief MJPEG AVI remux of captured JPEG sequences for CamS3Library
+ *
+ * Streams existing JPEG files into a single AVI container without decoding
+ * or re-encoding. I/O is done in large sequential blocks and the idx1 index
+ * is spilled to the card in batches, so RAM use does not grow with the
+ * number of frames.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef _CAMS3_AVI_H_
+#define _CAMS3_AVI_H_
+
+#include "CamS3Library.h"
+
+// Remux settings
+#define CAMS3_AVI_IO_BUFFER   (32 * 1024)
+#define CAMS3_AVI_INDEX_BATCH 256  // idx1 entries buffered before spilling to the card
+#define CAMS3_AVI_HEADER_SIZE 224
+
+typedef enum {
+    CAMS3_REMUX_IDLE = 0,
+    CAMS3_REMUX_RUNNING,
+    CAMS3_REMUX_DONE,
+    CAMS3_REMUX_FAILED,
+    CAMS3_REMUX_CANCELLED
+} cams3_remux_state_t;
+
+// ============================================
+// AVI Remux Class
+// ============================================
+class CamS3_AviRemux {
+   private:
+    CamS3_SD* _sd      = nullptr;
+    bool _useCatalog   = true;
+    String _pattern;
+    uint32_t _first    = 0;
+    uint32_t _last     = 0;
+    String _aviPath;
+    uint8_t _fps       = 10;
+    TaskHandle_t _task = nullptr;
+
+    volatile cams3_remux_state_t _state = CAMS3_REMUX_IDLE;
+    volatile bool _cancel               = false;
+    volatile uint32_t _framesDone       = 0;
+    uint32_t _framesTotal               = 0;
+    uint32_t _framesSkipped             = 0;
+    uint64_t _bytes                     = 0;
+    uint32_t _elapsedMs                 = 0;
+
+    // Writer state
+    File _avi;
+    File _idx;
+    uint8_t* _buf       = nullptr;
+    uint8_t* _idxBuf    = nullptr;
+    uint16_t _idxCount  = 0;
+    uint32_t _idxSpilled = 0;
+    uint32_t _moviBytes = 0;
+    uint32_t _maxFrame  = 0;
+    uint16_t _width     = 0;
+    uint16_t _height    = 0;
+    bool _writeFailed   = false;
+
+    bool _sourcePath(uint32_t n, char* path, size_t len);
+    bool _appendFrame(const char* path);
+    bool _spillIndex();
+    bool _finish();
+    bool _run();
+    void _release();
+    static void _taskMain(void* arg);
+
+   public:
+    /**
+     * @brief Initialize the remuxer
+     * @param sd Mounted SD card
+     * @return true if successful
+     */
+    bool begin(CamS3_SD& sd);
+
+    /**
+     * @brief Use a range of capture catalog entries as the source
+     * @param firstId First catalog id (inclusive)
+     * @param lastId Last catalog id (inclusive)
+     */
+    void setSourceCatalog(uint32_t firstId, uint32_t lastId);
+
+    /**
+     * @brief Use numbered files as the source
+     * @param pattern printf pattern with one integer (e.g., "/images/IMG_%04d.jpg")
+     * @param first First number (inclusive)
+     * @param last Last number (inclusive)
+     */
+    void setSourcePattern(const char* pattern, uint32_t first, uint32_t last);
+
+    /**
+     * @brief Remux the source into an AVI on the calling task
+     * @param aviPath Output file path
+     * @param fps Playback frame rate
+     * @return true if successful
+     */
+    bool run(const char* aviPath, uint8_t fps = 10);
+
+    /**
+     * @brief Remux the source into an AVI on a low-priority background task
+     * @param aviPath Output file path
+     * @param fps Playback frame rate
+     * @return true if the job was started
+     */
+    bool start(const char* aviPath, uint8_t fps = 10);
+
+    /**
+     * @brief Ask a running job to stop; the partial output is deleted
+     */
+    void cancel() {
+        _cancel = true;
+    }
+
+    /**
+     * @brief Get the job state
+     * @return Current state
+     */
+    cams3_remux_state_t getState() {
+        return _state;
+    }
+
+    /**
+     * @brief Get the number of source frames processed
+     * @return Frames processed (written or skipped)
+     */
+    uint32_t getFramesDone() {
+        return _framesDone;
+    }
+
+    /**
+     * @brief Get the number of source frames in the range
+     * @return Total frames
+     */
+    uint32_t getFramesTotal() {
+        return _framesTotal;
+    }
+
+    /**
+     * @brief Get the number of frames skipped (missing or not JPEG)
+     * @return Skipped frames
+     */
+    uint32_t getFramesSkipped() {
+        return _framesSkipped;
+    }
+
+    /**
+     * @brief Get the average copy rate of the last job
+     * @return Throughput in KB/s
+     */
+    uint32_t getThroughputKBps() {
+        return _elapsedMs ? (uint32_t)(_bytes / _elapsedMs) : 0;
+    }
+};
+
+#endif  // _CAMS3_AVI_H_
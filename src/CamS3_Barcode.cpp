@@ -0,0 +1,1522 @@
+/**
+ * @file CamS3_Barcode.cpp
+ * @brief QR code and 1D barcode reader for CamS3Library
+ *
+ * @copyright MIT License
+ */
+
+#include "CamS3_Barcode.h"
+#include <esp_timer.h>
+#include <math.h>
+
+#define QR_MAX_DIM        177
+#define QR_MAX_CODEWORDS  3706
+#define QR_GRID_BYTES     (QR_MAX_DIM * QR_MAX_DIM)
+#define QR_WORK_BYTES     (QR_GRID_BYTES + QR_MAX_CODEWORDS * 3 + 128)
+#define QR_DARK           0x01
+#define QR_FUNCTION       0x02
+
+#define LINEAR_MAX_SYMBOLS 96  // Code 128 symbols per row
+
+// ============================================
+// QR Tables
+// ============================================
+
+typedef struct {
+    uint8_t ec;          // EC codewords per block
+    uint8_t shortBlocks;
+    uint8_t shortData;   // Data codewords in a short block
+    uint8_t longBlocks;  // Blocks with one more data codeword
+} qr_blocks_t;
+
+// Per version, levels L, M, Q, H
+static const qr_blocks_t kQRBlocks[40][4] = {
+    {{7, 1, 19, 0}, {10, 1, 16, 0}, {13, 1, 13, 0}, {17, 1, 9, 0}},  // 1
+    {{10, 1, 34, 0}, {16, 1, 28, 0}, {22, 1, 22, 0}, {28, 1, 16, 0}},  // 2
+    {{15, 1, 55, 0}, {26, 1, 44, 0}, {18, 2, 17, 0}, {22, 2, 13, 0}},  // 3
+    {{20, 1, 80, 0}, {18, 2, 32, 0}, {26, 2, 24, 0}, {16, 4, 9, 0}},  // 4
+    {{26, 1, 108, 0}, {24, 2, 43, 0}, {18, 2, 15, 2}, {22, 2, 11, 2}},  // 5
+    {{18, 2, 68, 0}, {16, 4, 27, 0}, {24, 4, 19, 0}, {28, 4, 15, 0}},  // 6
+    {{20, 2, 78, 0}, {18, 4, 31, 0}, {18, 2, 14, 4}, {26, 4, 13, 1}},  // 7
+    {{24, 2, 97, 0}, {22, 2, 38, 2}, {22, 4, 18, 2}, {26, 4, 14, 2}},  // 8
+    {{30, 2, 116, 0}, {22, 3, 36, 2}, {20, 4, 16, 4}, {24, 4, 12, 4}},  // 9
+    {{18, 2, 68, 2}, {26, 4, 43, 1}, {24, 6, 19, 2}, {28, 6, 15, 2}},  // 10
+    {{20, 4, 81, 0}, {30, 1, 50, 4}, {28, 4, 22, 4}, {24, 3, 12, 8}},  // 11
+    {{24, 2, 92, 2}, {22, 6, 36, 2}, {26, 4, 20, 6}, {28, 7, 14, 4}},  // 12
+    {{26, 4, 107, 0}, {22, 8, 37, 1}, {24, 8, 20, 4}, {22, 12, 11, 4}},  // 13
+    {{30, 3, 115, 1}, {24, 4, 40, 5}, {20, 11, 16, 5}, {24, 11, 12, 5}},  // 14
+    {{22, 5, 87, 1}, {24, 5, 41, 5}, {30, 5, 24, 7}, {24, 11, 12, 7}},  // 15
+    {{24, 5, 98, 1}, {28, 7, 45, 3}, {24, 15, 19, 2}, {30, 3, 15, 13}},  // 16
+    {{28, 1, 107, 5}, {28, 10, 46, 1}, {28, 1, 22, 15}, {28, 2, 14, 17}},  // 17
+    {{30, 5, 120, 1}, {26, 9, 43, 4}, {28, 17, 22, 1}, {28, 2, 14, 19}},  // 18
+    {{28, 3, 113, 4}, {26, 3, 44, 11}, {26, 17, 21, 4}, {26, 9, 13, 16}},  // 19
+    {{28, 3, 107, 5}, {26, 3, 41, 13}, {30, 15, 24, 5}, {28, 15, 15, 10}},  // 20
+    {{28, 4, 116, 4}, {26, 17, 42, 0}, {28, 17, 22, 6}, {30, 19, 16, 6}},  // 21
+    {{28, 2, 111, 7}, {28, 17, 46, 0}, {30, 7, 24, 16}, {24, 34, 13, 0}},  // 22
+    {{30, 4, 121, 5}, {28, 4, 47, 14}, {30, 11, 24, 14}, {30, 16, 15, 14}},  // 23
+    {{30, 6, 117, 4}, {28, 6, 45, 14}, {30, 11, 24, 16}, {30, 30, 16, 2}},  // 24
+    {{26, 8, 106, 4}, {28, 8, 47, 13}, {30, 7, 24, 22}, {30, 22, 15, 13}},  // 25
+    {{28, 10, 114, 2}, {28, 19, 46, 4}, {28, 28, 22, 6}, {30, 33, 16, 4}},  // 26
+    {{30, 8, 122, 4}, {28, 22, 45, 3}, {30, 8, 23, 26}, {30, 12, 15, 28}},  // 27
+    {{30, 3, 117, 10}, {28, 3, 45, 23}, {30, 4, 24, 31}, {30, 11, 15, 31}},  // 28
+    {{30, 7, 116, 7}, {28, 21, 45, 7}, {30, 1, 23, 37}, {30, 19, 15, 26}},  // 29
+    {{30, 5, 115, 10}, {28, 19, 47, 10}, {30, 15, 24, 25}, {30, 23, 15, 25}},  // 30
+    {{30, 13, 115, 3}, {28, 2, 46, 29}, {30, 42, 24, 1}, {30, 23, 15, 28}},  // 31
+    {{30, 17, 115, 0}, {28, 10, 46, 23}, {30, 10, 24, 35}, {30, 19, 15, 35}},  // 32
+    {{30, 17, 115, 1}, {28, 14, 46, 21}, {30, 29, 24, 19}, {30, 11, 15, 46}},  // 33
+    {{30, 13, 115, 6}, {28, 14, 46, 23}, {30, 44, 24, 7}, {30, 59, 16, 1}},  // 34
+    {{30, 12, 121, 7}, {28, 12, 47, 26}, {30, 39, 24, 14}, {30, 22, 15, 41}},  // 35
+    {{30, 6, 121, 14}, {28, 6, 47, 34}, {30, 46, 24, 10}, {30, 2, 15, 64}},  // 36
+    {{30, 17, 122, 4}, {28, 29, 46, 14}, {30, 49, 24, 10}, {30, 24, 15, 46}},  // 37
+    {{30, 4, 122, 18}, {28, 13, 46, 32}, {30, 48, 24, 14}, {30, 42, 15, 32}},  // 38
+    {{30, 20, 117, 4}, {28, 40, 47, 7}, {30, 43, 24, 22}, {30, 10, 15, 67}},  // 39
+    {{30, 19, 118, 6}, {28, 18, 47, 31}, {30, 34, 24, 34}, {30, 20, 15, 61}},  // 40
+};
+
+// Alignment pattern centers per version (row and column coordinates)
+static const uint8_t kQRAlign[40][7] = {
+    {}, {6, 18}, {6, 22}, {6, 26}, {6, 30}, {6, 34}, {6, 22, 38}, {6, 24, 42}, {6, 26, 46}, {6, 28, 50}, {6, 30, 54},
+    {6, 32, 58}, {6, 34, 62}, {6, 26, 46, 66}, {6, 26, 48, 70}, {6, 26, 50, 74}, {6, 30, 54, 78}, {6, 30, 56, 82},
+    {6, 30, 58, 86}, {6, 34, 62, 90}, {6, 28, 50, 72, 94}, {6, 26, 50, 74, 98}, {6, 30, 54, 78, 102},
+    {6, 28, 54, 80, 106}, {6, 32, 58, 84, 110}, {6, 30, 58, 86, 114}, {6, 34, 62, 90, 118}, {6, 26, 50, 74, 98, 122},
+    {6, 30, 54, 78, 102, 126}, {6, 26, 52, 78, 104, 130}, {6, 30, 56, 82, 108, 134}, {6, 34, 60, 86, 112, 138},
+    {6, 30, 58, 86, 114, 142}, {6, 34, 62, 90, 118, 146}, {6, 30, 54, 78, 102, 126, 150},
+    {6, 24, 50, 76, 102, 128, 154}, {6, 28, 54, 80, 106, 132, 158}, {6, 32, 58, 84, 110, 136, 162},
+    {6, 26, 54, 82, 110, 138, 166}, {6, 30, 58, 86, 114, 142, 170},
+};
+
+// Format info level bits (M=00, L=01, H=10, Q=11) to table column
+static const uint8_t kQRLevel[4] = {1, 0, 3, 2};
+
+static const char kAlnum[46] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+
+// ============================================
+// 1D Tables
+// ============================================
+
+// EAN L-code element widths (space, bar, space, bar); R codes share them, G codes are reversed
+static const uint8_t kEanL[10][4] = {{3, 2, 1, 1}, {2, 2, 2, 1}, {2, 1, 2, 2}, {1, 4, 1, 1}, {1, 1, 3, 2},
+                                     {1, 2, 3, 1}, {1, 1, 1, 4}, {1, 3, 1, 2}, {1, 2, 1, 3}, {3, 1, 1, 2}};
+
+// EAN-13 first digit from the L/G parity of the left half (G = 1, first digit is the MSB)
+static const uint8_t kEanFirst[10] = {0x00, 0x0B, 0x0D, 0x0E, 0x13, 0x19, 0x1C, 0x15, 0x16, 0x1A};
+
+static const uint8_t kGuard[5] = {1, 1, 1, 1, 1};
+
+// Code 128 element widths (bar, space, ...), values 0-105
+static const uint8_t kCode128[106][6] = {
+    {2, 1, 2, 2, 2, 2}, {2, 2, 2, 1, 2, 2}, {2, 2, 2, 2, 2, 1}, {1, 2, 1, 2, 2, 3}, {1, 2, 1, 3, 2, 2},
+    {1, 3, 1, 2, 2, 2}, {1, 2, 2, 2, 1, 3}, {1, 2, 2, 3, 1, 2}, {1, 3, 2, 2, 1, 2}, {2, 2, 1, 2, 1, 3},
+    {2, 2, 1, 3, 1, 2}, {2, 3, 1, 2, 1, 2}, {1, 1, 2, 2, 3, 2}, {1, 2, 2, 1, 3, 2}, {1, 2, 2, 2, 3, 1},
+    {1, 1, 3, 2, 2, 2}, {1, 2, 3, 1, 2, 2}, {1, 2, 3, 2, 2, 1}, {2, 2, 3, 2, 1, 1}, {2, 2, 1, 1, 3, 2},
+    {2, 2, 1, 2, 3, 1}, {2, 1, 3, 2, 1, 2}, {2, 2, 3, 1, 1, 2}, {3, 1, 2, 1, 3, 1}, {3, 1, 1, 2, 2, 2},
+    {3, 2, 1, 1, 2, 2}, {3, 2, 1, 2, 2, 1}, {3, 1, 2, 2, 1, 2}, {3, 2, 2, 1, 1, 2}, {3, 2, 2, 2, 1, 1},
+    {2, 1, 2, 1, 2, 3}, {2, 1, 2, 3, 2, 1}, {2, 3, 2, 1, 2, 1}, {1, 1, 1, 3, 2, 3}, {1, 3, 1, 1, 2, 3},
+    {1, 3, 1, 3, 2, 1}, {1, 1, 2, 3, 1, 3}, {1, 3, 2, 1, 1, 3}, {1, 3, 2, 3, 1, 1}, {2, 1, 1, 3, 1, 3},
+    {2, 3, 1, 1, 1, 3}, {2, 3, 1, 3, 1, 1}, {1, 1, 2, 1, 3, 3}, {1, 1, 2, 3, 3, 1}, {1, 3, 2, 1, 3, 1},
+    {1, 1, 3, 1, 2, 3}, {1, 1, 3, 3, 2, 1}, {1, 3, 3, 1, 2, 1}, {3, 1, 3, 1, 2, 1}, {2, 1, 1, 3, 3, 1},
+    {2, 3, 1, 1, 3, 1}, {2, 1, 3, 1, 1, 3}, {2, 1, 3, 3, 1, 1}, {2, 1, 3, 1, 3, 1}, {3, 1, 1, 1, 2, 3},
+    {3, 1, 1, 3, 2, 1}, {3, 3, 1, 1, 2, 1}, {3, 1, 2, 1, 1, 3}, {3, 1, 2, 3, 1, 1}, {3, 3, 2, 1, 1, 1},
+    {3, 1, 4, 1, 1, 1}, {2, 2, 1, 4, 1, 1}, {4, 3, 1, 1, 1, 1}, {1, 1, 1, 2, 2, 4}, {1, 1, 1, 4, 2, 2},
+    {1, 2, 1, 1, 2, 4}, {1, 2, 1, 4, 2, 1}, {1, 4, 1, 1, 2, 2}, {1, 4, 1, 2, 2, 1}, {1, 1, 2, 2, 1, 4},
+    {1, 1, 2, 4, 1, 2}, {1, 2, 2, 1, 1, 4}, {1, 2, 2, 4, 1, 1}, {1, 4, 2, 1, 1, 2}, {1, 4, 2, 2, 1, 1},
+    {2, 4, 1, 2, 1, 1}, {2, 2, 1, 1, 1, 4}, {4, 1, 3, 1, 1, 1}, {2, 4, 1, 1, 1, 2}, {1, 3, 4, 1, 1, 1},
+    {1, 1, 1, 2, 4, 2}, {1, 2, 1, 1, 4, 2}, {1, 2, 1, 2, 4, 1}, {1, 1, 4, 2, 1, 2}, {1, 2, 4, 1, 1, 2},
+    {1, 2, 4, 2, 1, 1}, {4, 1, 1, 2, 1, 2}, {4, 2, 1, 1, 1, 2}, {4, 2, 1, 2, 1, 1}, {2, 1, 2, 1, 4, 1},
+    {2, 1, 4, 1, 2, 1}, {4, 1, 2, 1, 2, 1}, {1, 1, 1, 1, 4, 3}, {1, 1, 1, 3, 4, 1}, {1, 3, 1, 1, 4, 1},
+    {1, 1, 4, 1, 1, 3}, {1, 1, 4, 3, 1, 1}, {4, 1, 1, 1, 1, 3}, {4, 1, 1, 3, 1, 1}, {1, 1, 3, 1, 4, 1},
+    {1, 1, 4, 1, 3, 1}, {3, 1, 1, 1, 4, 1}, {4, 1, 1, 1, 3, 1}, {2, 1, 1, 4, 1, 2}, {2, 1, 1, 2, 1, 4},
+    {2, 1, 1, 2, 3, 2}
+};
+static const uint8_t kCode128Stop[7] = {2, 3, 3, 1, 1, 1, 2};
+
+#define CODE128_START_A 103
+#define CODE128_SHIFT   98
+#define CODE128_CODE_C  99
+#define CODE128_CODE_B  100
+#define CODE128_CODE_A  101
+#define CODE128_FNC1    102
+
+// ============================================
+// Reed-Solomon over GF(256)
+// ============================================
+
+static uint8_t sGfExp[512];
+static uint8_t sGfLog[256];
+static bool sGfBuilt = false;
+
+static void buildGf() {
+    if (sGfBuilt) return;
+    uint16_t x = 1;
+    for (int i = 0; i < 255; i++) {
+        sGfExp[i] = x;
+        sGfLog[x] = i;
+        x <<= 1;
+        if (x & 0x100) x ^= 0x11D;
+    }
+    for (int i = 255; i < 512; i++) sGfExp[i] = sGfExp[i - 255];
+    sGfBuilt = true;
+}
+
+static inline uint8_t gfMul(uint8_t a, uint8_t b) {
+    return (a && b) ? sGfExp[sGfLog[a] + sGfLog[b]] : 0;
+}
+
+static inline uint8_t gfDiv(uint8_t a, uint8_t b) {
+    return a ? sGfExp[sGfLog[a] + 255 - sGfLog[b]] : 0;
+}
+
+static bool rsSyndromes(const uint8_t* c, int n, int ec, uint8_t* s) {
+    bool clean = true;
+    for (int k = 0; k < ec; k++) {
+        uint8_t v = 0;
+        for (int t = 0; t < n; t++) v = gfMul(v, sGfExp[k]) ^ c[t];
+        s[k] = v;
+        if (v) clean = false;
+    }
+    return clean;
+}
+
+/**
+ * Corrects one block in place (c[0] is the highest-degree coefficient,
+ * generator roots a^0 .. a^(ec-1) as QR uses). Berlekamp-Massey finds the
+ * error locator, a Chien search its roots and Forney the magnitudes.
+ * Returns the number of repaired codewords, or -1 if the block is beyond repair.
+ */
+static int rsCorrect(uint8_t* c, int n, int ec) {
+    uint8_t s[32];
+    if (rsSyndromes(c, n, ec, s)) return 0;
+
+    uint8_t lambda[32] = {1};
+    uint8_t prev[32]   = {1};
+    uint8_t tmp[32];
+    int errors = 0;
+    int shift  = 1;
+    uint8_t lastD = 1;
+    for (int r = 0; r < ec; r++) {
+        uint8_t d = s[r];
+        for (int i = 1; i <= errors; i++) d ^= gfMul(lambda[i], s[r - i]);
+        if (d == 0) {
+            shift++;
+            continue;
+        }
+        uint8_t coef = gfDiv(d, lastD);
+        if (2 * errors <= r) {
+            memcpy(tmp, lambda, sizeof(lambda));
+            for (int i = 0; i + shift <= ec; i++) lambda[i + shift] ^= gfMul(coef, prev[i]);
+            errors = r + 1 - errors;
+            memcpy(prev, tmp, sizeof(prev));
+            lastD = d;
+            shift = 1;
+        } else {
+            for (int i = 0; i + shift <= ec; i++) lambda[i + shift] ^= gfMul(coef, prev[i]);
+            shift++;
+        }
+    }
+    if (2 * errors > ec) return -1;
+
+    // Error evaluator: S(x) * lambda(x) mod x^ec
+    uint8_t omega[32];
+    for (int i = 0; i < ec; i++) {
+        uint8_t v = 0;
+        for (int j = 0; j <= i && j <= errors; j++) v ^= gfMul(lambda[j], s[i - j]);
+        omega[i] = v;
+    }
+
+    int found = 0;
+    for (int t = 0; t < n; t++) {
+        int p        = n - 1 - t;
+        uint8_t xinv = sGfExp[(255 - p % 255) % 255];
+        uint8_t v    = 0;
+        for (int i = errors; i >= 0; i--) v = gfMul(v, xinv) ^ lambda[i];
+        if (v) continue;
+
+        // Formal derivative keeps the odd terms
+        uint8_t deriv = 0;
+        uint8_t pw    = 1;
+        uint8_t x2    = gfMul(xinv, xinv);
+        for (int i = 1; i <= errors; i += 2) {
+            deriv ^= gfMul(lambda[i], pw);
+            pw = gfMul(pw, x2);
+        }
+        uint8_t ov = 0;
+        for (int i = ec - 1; i >= 0; i--) ov = gfMul(ov, xinv) ^ omega[i];
+        if (!deriv) return -1;
+        c[t] ^= gfMul(sGfExp[p % 255], gfDiv(ov, deriv));
+        found++;
+    }
+    if (found != errors) return -1;
+    return rsSyndromes(c, n, ec, s) ? found : -1;
+}
+
+// ============================================
+// Geometry
+// ============================================
+
+// Projective map of the unit square onto quad q (corners (0,0), (1,0), (1,1), (0,1))
+static void squareToQuad(const float* q, float* m) {
+    float dx3 = q[0] - q[2] + q[4] - q[6];
+    float dy3 = q[1] - q[3] + q[5] - q[7];
+    if (fabsf(dx3) < 1e-4f && fabsf(dy3) < 1e-4f) {
+        m[0] = q[2] - q[0];
+        m[1] = q[4] - q[2];
+        m[2] = q[0];
+        m[3] = q[3] - q[1];
+        m[4] = q[5] - q[3];
+        m[5] = q[1];
+        m[6] = 0;
+        m[7] = 0;
+    } else {
+        float dx1   = q[2] - q[4];
+        float dx2   = q[6] - q[4];
+        float dy1   = q[3] - q[5];
+        float dy2   = q[7] - q[5];
+        float denom = dx1 * dy2 - dx2 * dy1;
+        m[6]        = (dx3 * dy2 - dx2 * dy3) / denom;
+        m[7]        = (dx1 * dy3 - dx3 * dy1) / denom;
+        m[0]        = q[2] - q[0] + m[6] * q[2];
+        m[1]        = q[6] - q[0] + m[7] * q[6];
+        m[2]        = q[0];
+        m[3]        = q[3] - q[1] + m[6] * q[3];
+        m[4]        = q[7] - q[1] + m[7] * q[7];
+        m[5]        = q[1];
+    }
+    m[8] = 1;
+}
+
+// Projective map taking quad src onto quad dst
+static void quadToQuad(const float* src, const float* dst, float* m) {
+    float a[9], b[9], inv[9];
+    squareToQuad(dst, a);
+    squareToQuad(src, b);
+    // Adjugate is the inverse up to scale, which a projective map ignores
+    inv[0] = b[4] * b[8] - b[5] * b[7];
+    inv[1] = b[2] * b[7] - b[1] * b[8];
+    inv[2] = b[1] * b[5] - b[2] * b[4];
+    inv[3] = b[5] * b[6] - b[3] * b[8];
+    inv[4] = b[0] * b[8] - b[2] * b[6];
+    inv[5] = b[2] * b[3] - b[0] * b[5];
+    inv[6] = b[3] * b[7] - b[4] * b[6];
+    inv[7] = b[1] * b[6] - b[0] * b[7];
+    inv[8] = b[0] * b[4] - b[1] * b[3];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            m[r * 3 + c] = a[r * 3] * inv[c] + a[r * 3 + 1] * inv[3 + c] + a[r * 3 + 2] * inv[6 + c];
+        }
+    }
+}
+
+static inline bool mapPoint(const float* m, float u, float v, float& x, float& y) {
+    float w = m[6] * u + m[7] * v + m[8];
+    if (fabsf(w) < 1e-9f) return false;
+    x = (m[0] * u + m[1] * v + m[2]) / w;
+    y = (m[3] * u + m[4] * v + m[5]) / w;
+    return true;
+}
+
+// ============================================
+// Helpers
+// ============================================
+
+// 1:1:3:1:1 within half a module per element
+static bool finderRatio(const uint32_t* c) {
+    uint32_t total = c[0] + c[1] + c[2] + c[3] + c[4];
+    if (total < 7) return false;
+    int32_t m = (int32_t)(total << 8) / 7;
+    int32_t v = m / 2;
+    return abs((int32_t)(c[0] << 8) - m) < v && abs((int32_t)(c[1] << 8) - m) < v &&
+           abs((int32_t)(c[2] << 8) - 3 * m) < 3 * v && abs((int32_t)(c[3] << 8) - m) < v &&
+           abs((int32_t)(c[4] << 8) - m) < v;
+}
+
+static bool qrMask(uint8_t mask, int i, int j) {
+    switch (mask) {
+        case 0:
+            return ((i + j) & 1) == 0;
+        case 1:
+            return (i & 1) == 0;
+        case 2:
+            return j % 3 == 0;
+        case 3:
+            return (i + j) % 3 == 0;
+        case 4:
+            return ((i / 2 + j / 3) & 1) == 0;
+        case 5:
+            return (i * j) % 2 + (i * j) % 3 == 0;
+        case 6:
+            return (((i * j) % 2 + (i * j) % 3) & 1) == 0;
+        default:
+            return (((i * j) % 3 + (i + j) % 2) & 1) == 0;
+    }
+}
+
+static uint32_t bchCode(uint32_t data, uint32_t poly, uint8_t dataShift) {
+    uint32_t d = data << dataShift;
+    for (int bit = 31; bit >= dataShift; bit--) {
+        if (d & (1u << bit)) d ^= poly << (bit - dataShift);
+    }
+    return (data << dataShift) | d;
+}
+
+/**
+ * Width mismatch of n runs against a pattern of `modules` modules, in 1/16
+ * module per element summed over the elements.
+ */
+static uint32_t patternError(const uint16_t* runs, const uint8_t* widths, uint8_t n, uint8_t modules) {
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < n; i++) sum += runs[i];
+    if (sum < modules) return UINT32_MAX;
+    uint32_t err = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        err += abs((int32_t)(runs[i] * modules * 16) - (int32_t)(widths[i] * sum * 16));
+    }
+    return err / sum;
+}
+
+// Accepts up to 7/16 module of average deviation
+static inline bool patternOk(uint32_t err, uint8_t n) {
+    return err <= (uint32_t)n * 7;
+}
+
+static int bestDigit(const uint16_t* runs, bool reversed, uint32_t& err) {
+    int best = -1;
+    err      = UINT32_MAX;
+    for (int d = 0; d < 10; d++) {
+        uint8_t w[4];
+        for (int i = 0; i < 4; i++) w[i] = kEanL[d][reversed ? 3 - i : i];
+        uint32_t e = patternError(runs, w, 4, 7);
+        if (e < err) {
+            err  = e;
+            best = d;
+        }
+    }
+    return patternOk(err, 4) ? best : -1;
+}
+
+struct BitReader {
+    const uint8_t* data;
+    size_t len;
+    size_t bit;
+
+    uint32_t available() {
+        return len * 8 - bit;
+    }
+
+    uint32_t read(uint8_t n) {
+        uint32_t v = 0;
+        while (n--) {
+            v = (v << 1) | ((data[bit >> 3] >> (7 - (bit & 7))) & 1);
+            bit++;
+        }
+        return v;
+    }
+};
+
+static void appendChar(cams3_barcode_t& code, char ch) {
+    if (code.length < CAMS3_BARCODE_MAX_TEXT) code.text[code.length++] = ch;
+}
+
+// ============================================
+// CamS3_BarcodeReader Implementation
+// ============================================
+
+CamS3_BarcodeReader::~CamS3_BarcodeReader() {
+    end();
+}
+
+bool CamS3_BarcodeReader::begin(const cams3_barcode_config_t* config) {
+    if (config) {
+        if (config->threshold >= 100 || config->scanLines == 0) return false;
+        _config = *config;
+    }
+    buildGf();
+    if (!_grid) _grid = (uint8_t*)malloc(QR_WORK_BYTES);
+    if (!_grid) return false;
+    _count = 0;
+    resetStats();
+    return true;
+}
+
+void CamS3_BarcodeReader::end() {
+    free(_bin);
+    free(_luma);
+    free(_colSum);
+    free(_prefix);
+    free(_runs);
+    free(_grid);
+    _bin      = nullptr;
+    _luma     = nullptr;
+    _colSum   = nullptr;
+    _prefix   = nullptr;
+    _runs     = nullptr;
+    _grid     = nullptr;
+    _binSize  = 0;
+    _lumaSize = 0;
+    _lineCap  = 0;
+    _count    = 0;
+}
+
+const char* CamS3_BarcodeReader::typeName(cams3_code_type_t type) {
+    switch (type) {
+        case CAMS3_CODE_QR:
+            return "QR";
+        case CAMS3_CODE_EAN13:
+            return "EAN-13";
+        case CAMS3_CODE_UPCA:
+            return "UPC-A";
+        case CAMS3_CODE_EAN8:
+            return "EAN-8";
+        case CAMS3_CODE_128:
+            return "Code 128";
+        default:
+            return "None";
+    }
+}
+
+bool CamS3_BarcodeReader::_reserve(uint16_t width, uint16_t height) {
+    size_t n = (size_t)width * height;
+    if (n > _binSize) {
+        uint8_t* grown = (uint8_t*)realloc(_bin, n);
+        if (!grown) return false;
+        _bin     = grown;
+        _binSize = n;
+    }
+    if (width + 1 > _lineCap) {
+        free(_colSum);
+        free(_prefix);
+        free(_runs);
+        _colSum = (uint32_t*)malloc(width * sizeof(uint32_t));
+        _prefix = (uint32_t*)malloc((width + 1) * sizeof(uint32_t));
+        _runs   = (uint16_t*)malloc(2 * (width + 1) * sizeof(uint16_t));
+        if (!_colSum || !_prefix || !_runs) {
+            _lineCap = 0;
+            return false;
+        }
+        _lineCap = width + 1;
+    }
+    _width  = width;
+    _height = height;
+    return true;
+}
+
+bool CamS3_BarcodeReader::_addResult(const cams3_barcode_t& code) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_results[i].type == code.type && _results[i].length == code.length &&
+            memcmp(_results[i].text, code.text, code.length) == 0) {
+            return false;
+        }
+    }
+    if (_count >= CAMS3_BARCODE_MAX_RESULTS) return false;
+    _results[_count]                  = code;
+    _results[_count].text[code.length] = '\0';
+    _results[_count].x += _originX;
+    _results[_count].y += _originY;
+    _count++;
+    return true;
+}
+
+// ============================================
+// Frame Sources
+// ============================================
+
+int CamS3_BarcodeReader::scan(const uint8_t* gray, uint16_t width, uint16_t height) {
+    if (!_grid || !gray || width == 0 || height == 0) return -1;
+    int64_t start = esp_timer_get_time();
+
+    uint16_t x = 0, y = 0, w = width, h = height;
+    if (_roiW && _roiH) {
+        if ((uint32_t)_roiX + _roiW > width || (uint32_t)_roiY + _roiH > height) return -1;
+        x = _roiX;
+        y = _roiY;
+        w = _roiW;
+        h = _roiH;
+    }
+    _originX = x;
+    _originY = y;
+    return _scan(gray + (size_t)y * width + x, w, h, width, start);
+}
+
+int CamS3_BarcodeReader::scanRGB565(const uint8_t* pixels, uint16_t width, uint16_t height) {
+    if (!_grid || !pixels || width == 0 || height == 0) return -1;
+    int64_t start = esp_timer_get_time();
+
+    uint16_t x = 0, y = 0, w = width, h = height;
+    if (_roiW && _roiH) {
+        if ((uint32_t)_roiX + _roiW > width || (uint32_t)_roiY + _roiH > height) return -1;
+        x = _roiX;
+        y = _roiY;
+        w = _roiW;
+        h = _roiH;
+    }
+    size_t n = (size_t)w * h;
+    if (n > _lumaSize) {
+        uint8_t* grown = (uint8_t*)realloc(_luma, n);
+        if (!grown) return -1;
+        _luma     = grown;
+        _lumaSize = n;
+    }
+
+    // Big-endian RGB565 as delivered by the camera DMA
+    uint8_t* out = _luma;
+    for (uint16_t j = 0; j < h; j++) {
+        const uint8_t* row = pixels + ((size_t)(y + j) * width + x) * 2;
+        for (uint16_t i = 0; i < w; i++) {
+            uint16_t px = (row[i * 2] << 8) | row[i * 2 + 1];
+            uint32_t r  = (px >> 8) & 0xF8;
+            uint32_t g  = (px >> 3) & 0xFC;
+            uint32_t b  = (px << 3) & 0xF8;
+            *out++      = (r * 77 + g * 150 + b * 29) >> 8;
+        }
+    }
+    _originX = x;
+    _originY = y;
+    return _scan(_luma, w, h, w, start);
+}
+
+int CamS3_BarcodeReader::scanJpeg(const uint8_t* jpeg, size_t len) {
+    if (!_grid || !jpeg || !_jpeg.parse(jpeg, len)) return -1;
+    int64_t start = esp_timer_get_time();
+
+    const cams3_jpeg_info_t& info = _jpeg.getInfo();
+    uint16_t x = 0, y = 0, w = info.width, h = info.height;
+    if (_roiW && _roiH) {
+        if ((uint32_t)_roiX + _roiW > info.width || (uint32_t)_roiY + _roiH > info.height) return -1;
+        x = _roiX;
+        y = _roiY;
+        w = _roiW;
+        h = _roiH;
+    }
+    size_t n = (size_t)w * h;
+    if (n > _lumaSize) {
+        uint8_t* grown = (uint8_t*)realloc(_luma, n);
+        if (!grown) return -1;
+        _luma     = grown;
+        _lumaSize = n;
+    }
+    if (!_jpeg.decodeRegion(x, y, w, h, _luma, _lumaSize)) return -1;
+    _originX = x;
+    _originY = y;
+    return _scan(_luma, w, h, w, start);
+}
+
+int CamS3_BarcodeReader::scanFrame(camera_fb_t* frame) {
+    if (!frame || !frame->buf) return -1;
+
+    if (_continuous) {
+        bool changed;
+        if (frame->format == PIXFORMAT_JPEG) {
+            changed = _scene.analyze(frame->buf, frame->len);
+        } else {
+            changed = _rawChanged(frame->buf, frame->width, frame->height,
+                                  frame->format == PIXFORMAT_RGB565 ? 2 : 1);
+        }
+        // Scan one more frame after a change: motion has usually settled by then
+        if (!changed && !_settle) {
+            _stats.skipped++;
+            return _count;
+        }
+        _settle = changed;
+    }
+
+    switch (frame->format) {
+        case PIXFORMAT_GRAYSCALE:
+            if (frame->len < (size_t)frame->width * frame->height) return -1;
+            return scan(frame->buf, frame->width, frame->height);
+        case PIXFORMAT_RGB565:
+            if (frame->len < (size_t)frame->width * frame->height * 2) return -1;
+            return scanRGB565(frame->buf, frame->width, frame->height);
+        case PIXFORMAT_JPEG:
+            return scanJpeg(frame->buf, frame->len);
+        default:
+            return -1;
+    }
+}
+
+bool CamS3_BarcodeReader::_rawChanged(const uint8_t* pixels, uint16_t width, uint16_t height, uint8_t bpp) {
+    uint32_t diff = 0;
+    uint8_t* s    = _sample;
+    for (uint16_t gy = 0; gy < 24; gy++) {
+        const uint8_t* row = pixels + (size_t)((gy * 2 + 1) * height / 48) * width * bpp;
+        for (uint16_t gx = 0; gx < 32; gx++) {
+            const uint8_t* p = row + (size_t)((gx * 2 + 1) * width / 64) * bpp;
+            uint8_t luma;
+            if (bpp == 2) {
+                uint16_t px = (p[0] << 8) | p[1];
+                luma = (((px >> 8) & 0xF8) * 77 + ((px >> 3) & 0xFC) * 150 + ((px << 3) & 0xF8) * 29) >> 8;
+            } else {
+                luma = p[0];
+            }
+            diff += abs((int)luma - (int)*s);
+            *s++ = luma;
+        }
+    }
+    bool changed = !_sampleValid || diff >= (uint32_t)_config.changeLevel * sizeof(_sample);
+    _sampleValid = true;
+    return changed;
+}
+
+// ============================================
+// Scan Pipeline
+// ============================================
+
+int CamS3_BarcodeReader::_scan(const uint8_t* gray, uint16_t width, uint16_t height, size_t stride, int64_t start) {
+    _count = 0;
+    if (width < 16 || height < 16 || !_reserve(width, height)) return -1;
+
+    _binarize(gray, stride);
+    _stats.binarizeUs = esp_timer_get_time() - start;
+
+    if (_config.symbologies & CAMS3_BARCODE_QR) {
+        _findFinders();
+        _decodeQRs();
+    }
+    if (_config.symbologies & (CAMS3_BARCODE_EAN | CAMS3_BARCODE_CODE128)) _scanLinear();
+
+    uint32_t us = esp_timer_get_time() - start;
+    _stats.frames++;
+    if (_count) _stats.decoded++;
+    _stats.lastUs = us;
+    _stats.totalUs += us;
+    if (us > _stats.maxUs) _stats.maxUs = us;
+    return _count;
+}
+
+/**
+ * Bradley-style adaptive threshold. The box sum around each pixel comes from
+ * an integral image that is only ever one row tall: per-column sums over the
+ * window rows are updated as the window slides down, and a prefix sum across
+ * them gives any horizontal span in two lookups.
+ */
+void CamS3_BarcodeReader::_binarize(const uint8_t* gray, size_t stride) {
+    const uint16_t w = _width;
+    const uint16_t h = _height;
+    uint16_t side    = w > h ? w : h;
+    int32_t r        = (side >> _config.windowShift) / 2;
+    if (r < 4) r = 4;
+    if (r > 64) r = 64;  // Keeps pixel * count * 100 within 32 bits
+    const uint32_t keep = 100 - _config.threshold;
+
+    memset(_colSum, 0, w * sizeof(uint32_t));
+    int32_t top = 0, bottom = -1;
+    for (int32_t y = 0; y < h; y++) {
+        int32_t wantTop    = y - r > 0 ? y - r : 0;
+        int32_t wantBottom = y + r < h - 1 ? y + r : h - 1;
+        while (bottom < wantBottom) {
+            const uint8_t* row = gray + (size_t)(++bottom) * stride;
+            for (uint16_t x = 0; x < w; x++) _colSum[x] += row[x];
+        }
+        while (top < wantTop) {
+            const uint8_t* row = gray + (size_t)(top++) * stride;
+            for (uint16_t x = 0; x < w; x++) _colSum[x] -= row[x];
+        }
+        const uint32_t rows = bottom - top + 1;
+
+        _prefix[0] = 0;
+        for (uint16_t x = 0; x < w; x++) _prefix[x + 1] = _prefix[x] + _colSum[x];
+
+        const uint8_t* in = gray + (size_t)y * stride;
+        uint8_t* out      = _bin + (size_t)y * w;
+        for (int32_t x = 0; x < w; x++) {
+            int32_t x0   = x - r > 0 ? x - r : 0;
+            int32_t x1   = x + r < w - 1 ? x + r : w - 1;
+            uint32_t sum = _prefix[x1 + 1] - _prefix[x0];
+            uint32_t cnt = (x1 - x0 + 1) * rows;
+            out[x]       = in[x] * cnt * 100 < sum * keep;
+        }
+    }
+}
+
+// ============================================
+// QR Localization
+// ============================================
+
+void CamS3_BarcodeReader::_findFinders() {
+    _finderCount = 0;
+    const uint16_t w = _width;
+
+    for (uint16_t y = 0; y < _height; y++) {
+        const uint8_t* row = _bin + (size_t)y * w;
+        uint32_t runs[5]   = {0};
+        uint16_t n         = 0;
+        uint16_t len       = 0;
+        uint8_t cur        = row[0];
+        for (uint16_t x = 0; x <= w; x++) {
+            uint8_t v = x < w ? row[x] : 2;
+            if (v == cur) {
+                len++;
+                continue;
+            }
+            memmove(runs, runs + 1, 4 * sizeof(uint32_t));
+            runs[4] = len;
+            n++;
+            // Runs alternate, so five ending on a dark one read dark-light-dark-light-dark
+            if (cur == 1 && n >= 5 && finderRatio(runs)) {
+                uint32_t total = runs[0] + runs[1] + runs[2] + runs[3] + runs[4];
+                float cx       = x - runs[4] - runs[3] - runs[2] / 2.0f;
+                float cy       = y + 0.5f;
+                if (_crossCheck(cx, cy, total, true) && _crossCheck(cx, cy, total, false)) {
+                    _addFinder(cx, cy, total / 7.0f);
+                }
+            }
+            cur = v;
+            len = 1;
+        }
+    }
+}
+
+bool CamS3_BarcodeReader::_crossCheck(float& cx, float& cy, uint32_t total, bool vertical) {
+    const int32_t len   = vertical ? _height : _width;
+    const int32_t fixed = vertical ? (int32_t)cx : (int32_t)cy;
+    const int32_t pos   = vertical ? (int32_t)cy : (int32_t)cx;
+    const size_t step   = vertical ? _width : 1;
+    const uint8_t* line = vertical ? _bin + fixed : _bin + (size_t)fixed * _width;
+    if (fixed < 0 || fixed >= (vertical ? _width : _height) || pos < 0 || pos >= len) return false;
+    if (!line[pos * step]) return false;
+
+    uint32_t c[5] = {0};
+    int32_t p     = pos;
+    while (p >= 0 && line[p * step]) {
+        c[2]++;
+        p--;
+    }
+    while (p >= 0 && !line[p * step] && c[1] <= total) {
+        c[1]++;
+        p--;
+    }
+    if (p < 0 || c[1] > total) return false;
+    while (p >= 0 && line[p * step] && c[0] <= total) {
+        c[0]++;
+        p--;
+    }
+    if (c[0] > total) return false;
+
+    p = pos + 1;
+    while (p < len && line[p * step]) {
+        c[2]++;
+        p++;
+    }
+    while (p < len && !line[p * step] && c[3] <= total) {
+        c[3]++;
+        p++;
+    }
+    if (p >= len || c[3] > total) return false;
+    while (p < len && line[p * step] && c[4] <= total) {
+        c[4]++;
+        p++;
+    }
+    if (c[4] > total) return false;
+
+    uint32_t sum = c[0] + c[1] + c[2] + c[3] + c[4];
+    if (5 * abs((int32_t)sum - (int32_t)total) >= 2 * (int32_t)total) return false;
+    if (!finderRatio(c)) return false;
+
+    float center = p - c[4] - c[3] - c[2] / 2.0f;
+    if (vertical) {
+        cy = center;
+    } else {
+        cx = center;
+    }
+    return true;
+}
+
+void CamS3_BarcodeReader::_addFinder(float x, float y, float module) {
+    for (uint8_t i = 0; i < _finderCount; i++) {
+        Finder& f = _finders[i];
+        if (fabsf(x - f.x) <= f.module && fabsf(y - f.y) <= f.module && fabsf(module - f.module) <= f.module) {
+            float n  = f.hits;
+            f.x      = (f.x * n + x) / (n + 1);
+            f.y      = (f.y * n + y) / (n + 1);
+            f.module = (f.module * n + module) / (n + 1);
+            f.hits++;
+            return;
+        }
+    }
+    if (_finderCount < CAMS3_BARCODE_MAX_FINDERS) _finders[_finderCount++] = {x, y, module, 1};
+}
+
+bool CamS3_BarcodeReader::_findAlignment(const Point& estimate, float module, Point& found) {
+    const int32_t radius = (int32_t)(module * 5) + 2;
+    const int32_t lo     = (int32_t)(module * 0.5f);
+    const int32_t hi     = (int32_t)(module * 1.5f) + 1;
+    int32_t x0 = (int32_t)estimate.x - radius, x1 = (int32_t)estimate.x + radius;
+    int32_t y0 = (int32_t)estimate.y - radius, y1 = (int32_t)estimate.y + radius;
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > _width - 1) x1 = _width - 1;
+    if (y1 > _height - 1) y1 = _height - 1;
+
+    float bestDist = 1e30f;
+    for (int32_t y = y0; y <= y1; y++) {
+        const uint8_t* row = _bin + (size_t)y * _width;
+        // Light-dark-light of about one module each, with dark on both sides
+        int32_t x = x0;
+        while (x <= x1) {
+            if (!row[x]) {
+                x++;
+                continue;
+            }
+            int32_t s = x;
+            while (x <= x1 && row[x]) x++;
+            int32_t darkLen = x - s;
+            if (darkLen < lo || darkLen > hi || s == 0 || x > x1) continue;
+            int32_t l = s - 1;
+            while (l >= 0 && !row[l]) l--;
+            int32_t r = x;
+            while (r < _width && !row[r]) r++;
+            int32_t leftLen = s - 1 - l, rightLen = r - x;
+            if (leftLen < lo || leftLen > hi || rightLen < lo || rightLen > hi || l < 0 || r >= _width) continue;
+
+            // Same structure down the center column
+            int32_t cx  = s + darkLen / 2;
+            int32_t top = y, bottom = y;
+            while (top > 0 && _bin[(size_t)(top - 1) * _width + cx]) top--;
+            while (bottom < _height - 1 && _bin[(size_t)(bottom + 1) * _width + cx]) bottom++;
+            int32_t vLen = bottom - top + 1;
+            if (vLen < lo || vLen > hi) continue;
+            int32_t u = top - 1;
+            while (u >= 0 && !_bin[(size_t)u * _width + cx]) u--;
+            int32_t d = bottom + 1;
+            while (d < _height && !_bin[(size_t)d * _width + cx]) d++;
+            int32_t upLen = top - 1 - u, downLen = d - bottom - 1;
+            if (upLen < lo || upLen > hi || downLen < lo || downLen > hi || u < 0 || d >= _height) continue;
+
+            float px   = s + darkLen / 2.0f;
+            float py   = (top + bottom + 1) / 2.0f;
+            float dist = (px - estimate.x) * (px - estimate.x) + (py - estimate.y) * (py - estimate.y);
+            if (dist < bestDist) {
+                bestDist = dist;
+                found    = {px, py};
+            }
+        }
+    }
+    return bestDist < 1e30f;
+}
+
+/**
+ * Distance from a finder center to its outer edge along (dx, dy), crossing
+ * the dark center, light ring and dark ring: 3.5 modules on the symbol's axis.
+ */
+float CamS3_BarcodeReader::_runAlong(const Point& from, float dx, float dy) {
+    float x       = from.x, y = from.y;
+    uint8_t state = 0;  // 0 center dark, 1 light ring, 2 dark ring
+    for (int32_t steps = 0; steps < _width + _height; steps++) {
+        int32_t px = (int32_t)x, py = (int32_t)y;
+        if (px < 0 || py < 0 || px >= _width || py >= _height) return -1;
+        bool dark = _bin[(size_t)py * _width + px];
+        if (dark != (state != 1)) {
+            if (++state == 3) return sqrtf((x - from.x) * (x - from.x) + (y - from.y) * (y - from.y));
+        }
+        x += dx;
+        y += dy;
+    }
+    return -1;
+}
+
+float CamS3_BarcodeReader::_moduleAlong(const Point& a, const Point& b) {
+    float len = sqrtf((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+    if (len < 1) return -1;
+    float dx = (b.x - a.x) / len, dy = (b.y - a.y) / len;
+
+    // Both finders, both directions
+    float r[4] = {_runAlong(a, dx, dy), _runAlong(a, -dx, -dy), _runAlong(b, -dx, -dy), _runAlong(b, dx, dy)};
+    float sum  = 0;
+    uint8_t n  = 0;
+    for (int i = 0; i < 4; i++) {
+        if (r[i] > 0) {
+            sum += r[i];
+            n++;
+        }
+    }
+    return n ? sum / (n * 3.5f) : -1;
+}
+
+void CamS3_BarcodeReader::_decodeQRs() {
+    // Keep finders confirmed on more than one row
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < _finderCount; i++) {
+        if (_finders[i].hits >= 2) _finders[n++] = _finders[i];
+    }
+    _finderCount = n;
+    if (n < 3) return;
+
+    bool used[CAMS3_BARCODE_MAX_FINDERS] = {false};
+    uint8_t attempts                     = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        for (uint8_t j = i + 1; j < n; j++) {
+            for (uint8_t k = j + 1; k < n; k++) {
+                if (used[i] || used[j] || used[k]) continue;
+                const Finder* f[3] = {&_finders[i], &_finders[j], &_finders[k]};
+                float mMin = f[0]->module, mMax = f[0]->module;
+                for (int q = 1; q < 3; q++) {
+                    if (f[q]->module < mMin) mMin = f[q]->module;
+                    if (f[q]->module > mMax) mMax = f[q]->module;
+                }
+                if (mMax > mMin * 1.5f) continue;
+
+                // The corner finder faces the longest side
+                float d[3];
+                for (int q = 0; q < 3; q++) {
+                    const Finder* a = f[(q + 1) % 3];
+                    const Finder* b = f[(q + 2) % 3];
+                    d[q]            = (a->x - b->x) * (a->x - b->x) + (a->y - b->y) * (a->y - b->y);
+                }
+                int c = d[0] > d[1] ? (d[0] > d[2] ? 0 : 2) : (d[1] > d[2] ? 1 : 2);
+                float s1 = d[(c + 1) % 3], s2 = d[(c + 2) % 3];
+                if (s1 > s2 * 2.0f || s2 > s1 * 2.0f) continue;
+                if (fabsf(d[c] - (s1 + s2)) > 0.3f * (s1 + s2)) continue;
+
+                Point tl = {f[c]->x, f[c]->y};
+                Point tr = {f[(c + 1) % 3]->x, f[(c + 1) % 3]->y};
+                Point bl = {f[(c + 2) % 3]->x, f[(c + 2) % 3]->y};
+                // Image y points down, so top-right to bottom-left turns clockwise
+                if ((tr.x - tl.x) * (bl.y - tl.y) - (tr.y - tl.y) * (bl.x - tl.x) < 0) {
+                    Point t = tr;
+                    tr      = bl;
+                    bl      = t;
+                }
+
+                // Rotated finders read wide on rows, so measure modules along the symbol's own axes
+                float moduleX = _moduleAlong(tl, tr);
+                float moduleY = _moduleAlong(tl, bl);
+                if (moduleX <= 0 || moduleY <= 0) continue;
+                float module = (moduleX + moduleY) / 2;
+                int32_t dim  = (int32_t)(lroundf(sqrtf(s1) / module) + lroundf(sqrtf(s2) / module)) / 2 + 7;
+                // Sizes are 4n + 1 modules
+                if ((dim & 3) == 0) dim++;
+                if ((dim & 3) == 2) dim--;
+                if ((dim & 3) == 3) dim += 2;
+                int32_t version = (dim - 17) / 4;
+                if (version < 1 || version > 40) continue;
+                if (++attempts > 12) return;
+
+                bool ok = _decodeQR(tl, tr, bl, module, version);
+                if (!ok && version < 40) ok = _decodeQR(tl, tr, bl, module, version + 1);
+                if (!ok && version > 1) ok = _decodeQR(tl, tr, bl, module, version - 1);
+                if (ok) {
+                    used[i] = used[j] = used[k] = true;
+                    if (_count >= CAMS3_BARCODE_MAX_RESULTS) return;
+                }
+            }
+        }
+    }
+}
+
+// ============================================
+// QR Decoding
+// ============================================
+
+bool CamS3_BarcodeReader::_decodeQR(const Point& tl, const Point& tr, const Point& bl, float module,
+                                    uint8_t version, bool stated) {
+    const int32_t dim = 17 + 4 * version;
+
+    // Module centers of the finders, then the bottom-right alignment pattern if one is found
+    float src[8] = {3.5f, 3.5f, dim - 3.5f, 3.5f, dim - 3.5f, dim - 3.5f, 3.5f, dim - 3.5f};
+    float dst[8] = {tl.x, tl.y, tr.x, tr.y, tr.x + bl.x - tl.x, tr.y + bl.y - tl.y, bl.x, bl.y};
+    bool aligned = false;
+    if (version >= 2) {
+        float t        = (dim - 10.0f) / (dim - 7.0f);
+        Point estimate = {tl.x + t * (tr.x - tl.x + bl.x - tl.x), tl.y + t * (tr.y - tl.y + bl.y - tl.y)};
+        Point align;
+        if (_findAlignment(estimate, module, align)) {
+            src[4] = src[5] = dim - 6.5f;
+            dst[4]          = align.x;
+            dst[5]          = align.y;
+            aligned         = true;
+        }
+    }
+
+    // Without an alignment pattern the fourth corner is a parallelogram guess that a tilted
+    // symbol misses; walk outward from it and let the format and Reed-Solomon checks decide
+    const int32_t reach = aligned ? 0 : 3;
+    const float baseX   = dst[4];
+    const float baseY   = dst[5];
+    for (int32_t ring = 0; ring <= reach; ring++) {
+        for (int32_t oy = -ring; oy <= ring; oy++) {
+            for (int32_t ox = -ring; ox <= ring; ox++) {
+                if (abs(ox) != ring && abs(oy) != ring) continue;
+                dst[4]     = baseX + ox * module;
+                dst[5]     = baseY + oy * module;
+                int result = _sampleQR(src, dst, version);
+                if (result == 1) return true;
+                // The symbol stated another size: the finder spacing was misread
+                if (result > 1) return !stated && _decodeQR(tl, tr, bl, module, result, true);
+            }
+        }
+    }
+    return false;
+}
+
+int CamS3_BarcodeReader::_sampleQR(const float* src, const float* dst, uint8_t version) {
+    const int32_t dim = 17 + 4 * version;
+    float m[9];
+    quadToQuad(src, dst, m);
+
+    for (int32_t i = 0; i < dim; i++) {
+        for (int32_t j = 0; j < dim; j++) {
+            float x, y;
+            if (!mapPoint(m, j + 0.5f, i + 0.5f, x, y)) return 0;
+            int32_t px = (int32_t)x, py = (int32_t)y;
+            if (px < -1 || py < -1 || px > _width || py > _height) return 0;
+            px = px < 0 ? 0 : (px >= _width ? _width - 1 : px);
+            py = py < 0 ? 0 : (py >= _height ? _height - 1 : py);
+            _grid[i * dim + j] = _bin[(size_t)py * _width + px];
+        }
+    }
+
+    // From version 7 the symbol states its size
+    if (version >= 7) {
+        uint32_t a = 0, b = 0;
+        for (int32_t i = 17; i >= 0; i--) {
+            a = (a << 1) | (_grid[(i / 3) * dim + dim - 11 + i % 3] & QR_DARK);
+            b = (b << 1) | (_grid[(dim - 11 + i % 3) * dim + i / 3] & QR_DARK);
+        }
+        int best = -1, bestDist = 4;
+        for (int v = 7; v <= 40; v++) {
+            uint32_t code = bchCode(v, 0x1F25, 12);
+            int dist      = __builtin_popcount(code ^ a);
+            int distB     = __builtin_popcount(code ^ b);
+            if (distB < dist) dist = distB;
+            if (dist < bestDist) {
+                bestDist = dist;
+                best     = v;
+            }
+        }
+        if (best < 0) return 0;
+        if (best != version) return best;
+    }
+
+    uint8_t* data = _grid + QR_GRID_BYTES + QR_MAX_CODEWORDS * 2;
+    size_t dataLen;
+    uint8_t corrected;
+    if (!_readGrid(version, data, dataLen, corrected)) return 0;
+
+    cams3_barcode_t code = {};
+    code.type            = CAMS3_CODE_QR;
+    code.version         = version;
+    if (!_parseSegments(data, dataLen, version, code)) return 0;
+
+    // The grid was sampled through the same transform, so a degenerate center means a bad fit
+    float cx, cy;
+    if (!mapPoint(m, dim / 2.0f, dim / 2.0f, cx, cy)) return 0;
+    code.x         = cx < 0 ? 0 : (uint16_t)cx;
+    code.y         = cy < 0 ? 0 : (uint16_t)cy;
+    code.corrected = corrected;
+    _addResult(code);
+    return 1;
+}
+
+bool CamS3_BarcodeReader::_readGrid(uint8_t version, uint8_t* data, size_t& len, uint8_t& corrected) {
+    const int32_t dim = 17 + 4 * version;
+    uint8_t* grid     = _grid;
+
+    // Format info, two copies; take the nearest valid codeword
+    uint32_t a = 0, b = 0;
+    for (int i = 14; i >= 0; i--) {
+        int32_t row = i < 6 ? i : (i < 8 ? i + 1 : dim - 15 + i);
+        int32_t col = i < 8 ? dim - 1 - i : (i < 9 ? 7 : 14 - i);
+        a           = (a << 1) | (grid[row * dim + 8] & QR_DARK);
+        b           = (b << 1) | (grid[8 * dim + col] & QR_DARK);
+    }
+    int format = -1, bestDist = 4;
+    for (uint32_t f = 0; f < 32; f++) {
+        uint32_t code = bchCode(f, 0x537, 10) ^ 0x5412;
+        int dist      = __builtin_popcount(code ^ a);
+        int distB     = __builtin_popcount(code ^ b);
+        if (distB < dist) dist = distB;
+        if (dist < bestDist) {
+            bestDist = dist;
+            format   = f;
+        }
+    }
+    if (format < 0) return false;
+    const uint8_t level = kQRLevel[format >> 3];
+    const uint8_t mask  = format & 7;
+
+    // Flag function patterns
+    auto mark = [&](int32_t r0, int32_t c0, int32_t h, int32_t w) {
+        for (int32_t r = r0; r < r0 + h; r++) {
+            for (int32_t c = c0; c < c0 + w; c++) grid[r * dim + c] |= QR_FUNCTION;
+        }
+    };
+    mark(0, 0, 9, 9);
+    mark(0, dim - 8, 9, 8);
+    mark(dim - 8, 0, 8, 9);
+    mark(6, 0, 1, dim);
+    mark(0, 6, dim, 1);
+    const uint8_t* align = kQRAlign[version - 1];
+    uint8_t alignCount   = 0;
+    while (alignCount < 7 && align[alignCount]) alignCount++;
+    const uint8_t last = alignCount ? align[alignCount - 1] : 0;
+    for (uint8_t p = 0; p < alignCount; p++) {
+        for (uint8_t q = 0; q < alignCount; q++) {
+            uint8_t r = align[p], c = align[q];
+            if ((r == 6 && c == 6) || (r == 6 && c == last) || (r == last && c == 6)) continue;
+            mark(r - 2, c - 2, 5, 5);
+        }
+    }
+    if (version >= 7) {
+        mark(0, dim - 11, 6, 3);
+        mark(dim - 11, 0, 3, 6);
+    }
+
+    // Read codewords in the two-column zigzag, unmasking as we go
+    const qr_blocks_t& blk = kQRBlocks[version - 1][level];
+    const uint8_t blocks   = blk.shortBlocks + blk.longBlocks;
+    const size_t total     = blocks * (size_t)(blk.shortData + blk.ec) + blk.longBlocks;
+    uint8_t* raw = _grid + QR_GRID_BYTES;
+    memset(raw, 0, total);
+    size_t bit   = 0;
+    bool upward  = true;
+    for (int32_t right = dim - 1; right >= 1 && bit < total * 8; right -= 2) {
+        if (right == 6) right = 5;
+        for (int32_t v = 0; v < dim; v++) {
+            int32_t i = upward ? dim - 1 - v : v;
+            for (int32_t k = 0; k < 2; k++) {
+                int32_t j    = right - k;
+                uint8_t cell = grid[i * dim + j];
+                if (cell & QR_FUNCTION) continue;
+                if (bit >= total * 8) break;
+                if ((cell & QR_DARK) ^ qrMask(mask, i, j)) raw[bit >> 3] |= 0x80 >> (bit & 7);
+                bit++;
+            }
+        }
+        upward = !upward;
+    }
+
+    // De-interleave and repair each block
+    uint8_t* block = raw + QR_MAX_CODEWORDS;
+    size_t out     = 0;
+    corrected      = 0;
+    for (uint8_t b = 0; b < blocks; b++) {
+        const uint8_t dataLen = blk.shortData + (b >= blk.shortBlocks);
+        size_t k              = b;
+        for (uint8_t i = 0; i < dataLen; i++) {
+            // Short blocks drop out of the last data round
+            block[i] = raw[k];
+            k += (i + 1 == blk.shortData) ? blk.longBlocks : blocks;
+        }
+        k = (size_t)blocks * blk.shortData + blk.longBlocks + b;
+        for (uint8_t i = 0; i < blk.ec; i++, k += blocks) block[dataLen + i] = raw[k];
+
+        int fixed = rsCorrect(block, dataLen + blk.ec, blk.ec);
+        if (fixed < 0) return false;
+        corrected += fixed;
+        memcpy(data + out, block, dataLen);
+        out += dataLen;
+    }
+    len = out;
+    return true;
+}
+
+bool CamS3_BarcodeReader::_parseSegments(const uint8_t* data, size_t len, uint8_t version, cams3_barcode_t& code) {
+    static const uint8_t kCountBits[4][3] = {{10, 12, 14}, {9, 11, 13}, {8, 16, 16}, {8, 10, 12}};
+    const uint8_t group                   = version <= 9 ? 0 : (version <= 26 ? 1 : 2);
+    BitReader br                          = {data, len, 0};
+    bool any                              = false;
+
+    while (br.available() >= 4) {
+        uint8_t mode = br.read(4);
+        if (mode == 0) break;
+        uint8_t kind;
+        switch (mode) {
+            case 1:  // Numeric
+                kind = 0;
+                break;
+            case 2:  // Alphanumeric
+                kind = 1;
+                break;
+            case 4:  // Byte
+                kind = 2;
+                break;
+            case 8:  // Kanji
+                kind = 3;
+                break;
+            case 7: {  // ECI: only the designator length matters here
+                if (br.available() < 8) return false;
+                uint8_t first = br.read(8);
+                uint8_t extra = (first & 0x80) == 0 ? 0 : ((first & 0x40) == 0 ? 1 : 2);
+                if (br.available() < extra * 8u) return false;
+                br.read(extra * 8);
+                continue;
+            }
+            case 3:  // Structured append
+                if (br.available() < 16) return false;
+                br.read(16);
+                continue;
+            case 5:  // FNC1, first position
+                continue;
+            case 9:  // FNC1, second position
+                if (br.available() < 8) return false;
+                br.read(8);
+                continue;
+            default:
+                return false;
+        }
+
+        uint8_t bits = kCountBits[kind][group];
+        if (br.available() < bits) return false;
+        uint32_t count = br.read(bits);
+        if (kind == 0) {
+            while (count >= 3) {
+                if (br.available() < 10) return false;
+                uint32_t v = br.read(10);
+                if (v > 999) return false;
+                appendChar(code, '0' + v / 100);
+                appendChar(code, '0' + v / 10 % 10);
+                appendChar(code, '0' + v % 10);
+                count -= 3;
+            }
+            if (count) {
+                uint8_t n = count == 2 ? 7 : 4;
+                if (br.available() < n) return false;
+                uint32_t v = br.read(n);
+                if (count == 2) appendChar(code, '0' + v / 10);
+                appendChar(code, '0' + v % 10);
+            }
+        } else if (kind == 1) {
+            while (count >= 2) {
+                if (br.available() < 11) return false;
+                uint32_t v = br.read(11);
+                if (v >= 45 * 45) return false;
+                appendChar(code, kAlnum[v / 45]);
+                appendChar(code, kAlnum[v % 45]);
+                count -= 2;
+            }
+            if (count) {
+                if (br.available() < 6) return false;
+                uint32_t v = br.read(6);
+                if (v >= 45) return false;
+                appendChar(code, kAlnum[v]);
+            }
+        } else if (kind == 2) {
+            if (br.available() < count * 8) return false;
+            while (count--) appendChar(code, br.read(8));
+        } else {
+            // Kanji: 13-bit values back to Shift JIS byte pairs
+            if (br.available() < count * 13) return false;
+            while (count--) {
+                uint32_t v  = br.read(13);
+                uint32_t sj = ((v / 0xC0) << 8) | (v % 0xC0);
+                sj += sj < 0x1F00 ? 0x8140 : 0xC140;
+                appendChar(code, sj >> 8);
+                appendChar(code, sj & 0xFF);
+            }
+        }
+        any = true;
+    }
+    return any;
+}
+
+// ============================================
+// 1D Codes
+// ============================================
+
+void CamS3_BarcodeReader::_scanLinear() {
+    const uint16_t w = _width;
+    uint16_t* fwd    = _runs;
+    uint16_t* rev    = _runs + _lineCap;
+
+    for (uint16_t k = 0; k < _config.scanLines; k++) {
+        uint16_t y         = (uint32_t)_height * (2 * k + 1) / (2 * _config.scanLines);
+        const uint8_t* row = _bin + (size_t)y * w;
+        uint16_t n         = 0;
+        uint16_t len       = 1;
+        for (uint16_t x = 1; x < w; x++) {
+            if (row[x] == row[x - 1]) {
+                len++;
+            } else {
+                fwd[n++] = len;
+                len      = 1;
+            }
+        }
+        fwd[n++]       = len;
+        bool firstDark = row[0];
+        bool lastDark  = row[w - 1];
+        for (uint16_t i = 0; i < n; i++) rev[i] = fwd[n - 1 - i];
+
+        for (int dir = 0; dir < 2; dir++) {
+            const uint16_t* runs = dir ? rev : fwd;
+            bool dark            = dir ? lastDark : firstDark;
+            if (_config.symbologies & CAMS3_BARCODE_EAN) _decodeEan(runs, n, dark, y, dir);
+            if (_config.symbologies & CAMS3_BARCODE_CODE128) _decodeCode128(runs, n, dark, y, dir);
+            if (_count >= CAMS3_BARCODE_MAX_RESULTS) return;
+        }
+    }
+}
+
+bool CamS3_BarcodeReader::_decodeEan(const uint16_t* runs, uint16_t count, bool firstDark, uint16_t row,
+                                     bool reversed) {
+    bool found = false;
+    int32_t x  = 0;
+    for (uint16_t s = 0; s + 3 <= count; x += runs[s], s++) {
+        // Bars only, each with a quiet zone of at least three modules before it
+        if (((s & 1) == 0) != firstDark || s == 0) continue;
+        for (int kind = 0; kind < 2; kind++) {
+            const uint8_t digits  = kind ? 8 : 13;
+            const uint8_t nruns   = kind ? 43 : 59;
+            const uint8_t modules = kind ? 67 : 95;
+            const uint8_t half    = kind ? 4 : 6;
+            if (s + nruns >= count) continue;
+
+            uint32_t total = 0;
+            for (uint8_t i = 0; i < nruns; i++) total += runs[s + i];
+            if (runs[s - 1] * modules < 3 * total || runs[s + nruns] * modules < 3 * total) continue;
+            if (!patternOk(patternError(runs + s, kGuard, 3, 3), 3)) continue;
+            const uint16_t mid = s + 3 + half * 4;
+            if (!patternOk(patternError(runs + mid, kGuard, 5, 5), 5)) continue;
+            if (!patternOk(patternError(runs + s + nruns - 3, kGuard, 3, 3), 3)) continue;
+
+            uint8_t d[13];
+            uint8_t parity = 0;
+            bool ok        = true;
+            for (uint8_t i = 0; i < half && ok; i++) {
+                const uint16_t* r = runs + s + 3 + i * 4;
+                uint32_t errL, errG = UINT32_MAX;
+                int dl = bestDigit(r, false, errL);
+                int dg = kind ? -1 : bestDigit(r, true, errG);
+                if (dl < 0 && dg < 0) ok = false;
+                bool g              = dg >= 0 && errG < errL;
+                d[kind ? i : i + 1] = g ? dg : dl;
+                parity              = (parity << 1) | g;
+            }
+            for (uint8_t i = 0; i < half && ok; i++) {
+                uint32_t err;
+                int dr = bestDigit(runs + mid + 5 + i * 4, false, err);
+                if (dr < 0) ok = false;
+                d[(kind ? 4 : 7) + i] = dr;
+            }
+            if (!ok) continue;
+
+            if (!kind) {
+                d[0] = 10;
+                for (uint8_t i = 0; i < 10; i++) {
+                    if (kEanFirst[i] == parity) d[0] = i;
+                }
+                if (d[0] > 9) continue;
+            }
+
+            uint32_t sum = 0;
+            for (uint8_t i = 0; i + 1 < digits; i++) {
+                bool heavy = kind ? (i & 1) == 0 : (i & 1) == 1;
+                sum += d[i] * (heavy ? 3 : 1);
+            }
+            if ((10 - sum % 10) % 10 != d[digits - 1]) continue;
+
+            cams3_barcode_t code = {};
+            code.type            = kind ? CAMS3_CODE_EAN8 : (d[0] == 0 ? CAMS3_CODE_UPCA : CAMS3_CODE_EAN13);
+            const uint8_t first  = code.type == CAMS3_CODE_UPCA ? 1 : 0;
+            for (uint8_t i = first; i < digits; i++) appendChar(code, '0' + d[i]);
+            int32_t cx = x + total / 2;
+            code.x     = reversed ? _width - 1 - cx : cx;
+            code.y     = row;
+            _addResult(code);
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool CamS3_BarcodeReader::_decodeCode128(const uint16_t* runs, uint16_t count, bool firstDark, uint16_t row,
+                                         bool reversed) {
+    bool found = false;
+    int32_t x  = 0;
+    for (uint16_t s = 0; s + 6 <= count; x += runs[s], s++) {
+        if (((s & 1) == 0) != firstDark || s == 0) continue;
+
+        // Start symbol, with a quiet zone of at least three modules
+        uint32_t symWidth = 0;
+        for (uint8_t i = 0; i < 6; i++) symWidth += runs[s + i];
+        if (runs[s - 1] * 11 < 3 * symWidth) continue;
+        uint8_t vals[LINEAR_MAX_SYMBOLS];
+        uint8_t n = 0;
+        for (uint8_t v = CODE128_START_A; v < 106; v++) {
+            if (patternOk(patternError(runs + s, kCode128[v], 6, 11), 6)) vals[n++] = v;
+        }
+        if (n != 1) continue;
+
+        uint16_t pos = s + 6;
+        bool stopped = false;
+        uint32_t end = 0;
+        while (pos + 6 <= count && n < LINEAR_MAX_SYMBOLS) {
+            uint32_t width = 0;
+            for (uint8_t i = 0; i < 6; i++) width += runs[pos + i];
+            uint32_t stopErr = pos + 7 <= count ? patternError(runs + pos, kCode128Stop, 7, 13) : UINT32_MAX;
+            uint32_t bestErr = UINT32_MAX;
+            int best         = -1;
+            // Symbols must keep the start symbol's width within a quarter
+            if (4 * width >= 3 * symWidth && 4 * width <= 5 * symWidth) {
+                for (uint8_t v = 0; v < 106; v++) {
+                    uint32_t e = patternError(runs + pos, kCode128[v], 6, 11);
+                    if (e < bestErr) {
+                        bestErr = e;
+                        best    = v;
+                    }
+                }
+            }
+            if (patternOk(stopErr, 7) && stopErr <= bestErr) {
+                end     = pos + 7;
+                stopped = true;
+                break;
+            }
+            if (!patternOk(bestErr, 6)) break;
+            vals[n++] = best;
+            pos += 6;
+        }
+        if (!stopped || n < 3) continue;
+        if (end < count && runs[end] * 11 < 3 * symWidth) continue;
+
+        uint32_t check = vals[0];
+        for (uint8_t i = 1; i + 1 < n; i++) check += (uint32_t)i * vals[i];
+        if (check % 103 != vals[n - 1]) continue;
+
+        cams3_barcode_t code = {};
+        code.type            = CAMS3_CODE_128;
+        uint8_t set          = vals[0] - CODE128_START_A;  // 0 = A, 1 = B, 2 = C
+        bool shift           = false;
+        bool ok              = true;
+        for (uint8_t i = 1; i + 1 < n && ok; i++) {
+            uint8_t v = vals[i];
+            if (v >= CODE128_START_A) {
+                ok = false;
+            } else if (set == 2) {
+                if (v < 100) {
+                    appendChar(code, '0' + v / 10);
+                    appendChar(code, '0' + v % 10);
+                } else if (v == CODE128_CODE_B) {
+                    set = 1;
+                } else if (v == CODE128_CODE_A) {
+                    set = 0;
+                } else if (i > 1) {
+                    appendChar(code, 0x1D);  // FNC1 inside the data is the GS1 separator
+                }
+            } else {
+                uint8_t cur = shift ? set ^ 1 : set;
+                shift       = false;
+                if (v < 96) {
+                    appendChar(code, cur == 1 ? v + 32 : (v < 64 ? v + 32 : v - 64));
+                } else if (v == CODE128_SHIFT) {
+                    shift = true;
+                } else if (v == CODE128_CODE_C) {
+                    set = 2;
+                } else if (v == CODE128_CODE_B && set == 0) {
+                    set = 1;
+                } else if (v == CODE128_CODE_A && set == 1) {
+                    set = 0;
+                } else if (v == CODE128_FNC1 && i > 1) {
+                    appendChar(code, 0x1D);
+                }
+                // FNC2-4 are dropped
+            }
+        }
+        if (!ok) continue;
+
+        uint32_t total = 0;
+        for (uint16_t i = s; i < end; i++) total += runs[i];
+        int32_t cx = x + total / 2;
+        code.x     = reversed ? _width - 1 - cx : cx;
+        code.y     = row;
+        _addResult(code);
+        found = true;
+    }
+    return found;
+}
@@ -0,0 +1,267 @@
+/**
+ * @file CamS3_Barcode.h
+ * @brief QR code and 1D barcode reader for CamS3Library
+ *
+ * Reads QR codes (versions 1-40, all error-correction levels), EAN-13,
+ * UPC-A, EAN-8 and Code 128 from grayscale or RGB565 frames, or from a
+ * region decoded out of a hardware JPEG frame. The front end binarizes the
+ * image against a local mean taken from a rolling integral image, so it
+ * copes with uneven lighting and needs only O(width) working memory beyond
+ * the bit plane.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef _CAMS3_BARCODE_H_
+#define _CAMS3_BARCODE_H_
+
+#include "CamS3Library.h"
+
+// Reader limits
+#define CAMS3_BARCODE_MAX_RESULTS 4
+#define CAMS3_BARCODE_MAX_TEXT    256  // Longer payloads are truncated
+#define CAMS3_BARCODE_MAX_FINDERS 24   // QR finder pattern candidates per frame
+
+// Symbologies (cams3_barcode_config_t::symbologies)
+#define CAMS3_BARCODE_QR      0x01
+#define CAMS3_BARCODE_EAN     0x02  // EAN-13, UPC-A and EAN-8
+#define CAMS3_BARCODE_CODE128 0x04
+#define CAMS3_BARCODE_ALL     0x07
+
+typedef enum {
+    CAMS3_CODE_NONE = 0,
+    CAMS3_CODE_QR,
+    CAMS3_CODE_EAN13,
+    CAMS3_CODE_UPCA,
+    CAMS3_CODE_EAN8,
+    CAMS3_CODE_128
+} cams3_code_type_t;
+
+typedef struct {
+    uint8_t symbologies;   // CAMS3_BARCODE_* flags to look for
+    uint8_t threshold;     // A pixel is dark when this many percent below its local mean
+    uint8_t windowShift;   // Local mean window is the larger image side >> n
+    uint8_t scanLines;     // Rows scanned for 1D codes
+    uint8_t changeLevel;   // Continuous mode, raw frames: mean luma change that counts as a new scene
+} cams3_barcode_config_t;
+
+#define CAMS3_BARCODE_CONFIG_DEFAULT {CAMS3_BARCODE_ALL, 15, 4, 16, 6}
+
+typedef struct {
+    cams3_code_type_t type;
+    uint16_t x, y;          // Center in frame pixels
+    uint16_t length;        // Bytes in text (QR byte segments may contain zeros)
+    uint8_t version;        // QR version (0 for 1D codes)
+    uint8_t corrected;      // Codewords repaired by Reed-Solomon (QR)
+    char text[CAMS3_BARCODE_MAX_TEXT + 1];
+} cams3_barcode_t;
+
+typedef struct {
+    uint32_t frames;      // Frames scanned
+    uint32_t decoded;     // Frames where at least one code was read
+    uint32_t skipped;     // Frames skipped as unchanged (continuous mode)
+    uint32_t lastUs;      // Last scan, including RGB565 conversion or JPEG decode
+    uint32_t binarizeUs;  // Front-end share of the last scan
+    uint32_t maxUs;
+    uint64_t totalUs;
+} cams3_barcode_stats_t;
+
+// ============================================
+// Barcode Reader Class
+// ============================================
+class CamS3_BarcodeReader {
+   private:
+    struct Finder {
+        float x, y;
+        float module;  // Module size in pixels
+        uint16_t hits;
+    };
+
+    struct Point {
+        float x, y;
+    };
+
+    cams3_barcode_config_t _config = CAMS3_BARCODE_CONFIG_DEFAULT;
+    cams3_barcode_t _results[CAMS3_BARCODE_MAX_RESULTS];
+    uint8_t _count                 = 0;
+    cams3_barcode_stats_t _stats   = {};
+
+    // Working buffers, grown on demand
+    uint8_t* _bin       = nullptr;  // One byte per pixel, 1 = dark
+    size_t _binSize     = 0;
+    uint8_t* _luma      = nullptr;  // Converted or decoded frame
+    size_t _lumaSize    = 0;
+    uint32_t* _colSum   = nullptr;  // Rolling integral image: column sums and row prefix
+    uint32_t* _prefix   = nullptr;
+    uint16_t* _runs     = nullptr;
+    uint16_t _lineCap   = 0;
+    uint8_t* _grid      = nullptr;  // Sampled QR modules: bit 0 dark, bit 1 function pattern
+    uint16_t _width     = 0;
+    uint16_t _height    = 0;
+    uint16_t _originX   = 0;
+    uint16_t _originY   = 0;
+
+    Finder _finders[CAMS3_BARCODE_MAX_FINDERS];
+    uint8_t _finderCount = 0;
+
+    // Region of interest (0 width = whole frame)
+    uint16_t _roiX = 0, _roiY = 0, _roiW = 0, _roiH = 0;
+
+    // Continuous mode
+    bool _continuous = false;
+    bool _settle     = false;
+    CamS3_SceneDetector _scene;
+    CamS3_JpegDecoder _jpeg;
+    uint8_t _sample[32 * 24];
+    bool _sampleValid = false;
+
+    bool _reserve(uint16_t width, uint16_t height);
+    int _scan(const uint8_t* gray, uint16_t width, uint16_t height, size_t stride, int64_t start);
+    void _binarize(const uint8_t* gray, size_t stride);
+    bool _rawChanged(const uint8_t* pixels, uint16_t width, uint16_t height, uint8_t bpp);
+    bool _addResult(const cams3_barcode_t& code);
+
+    // QR
+    void _findFinders();
+    bool _crossCheck(float& cx, float& cy, uint32_t total, bool vertical);
+    void _addFinder(float x, float y, float module);
+    void _decodeQRs();
+    float _runAlong(const Point& from, float dx, float dy);
+    float _moduleAlong(const Point& a, const Point& b);
+    bool _findAlignment(const Point& estimate, float module, Point& found);
+    bool _decodeQR(const Point& tl, const Point& tr, const Point& bl, float module, uint8_t version,
+                   bool stated = false);
+    int _sampleQR(const float* src, const float* dst, uint8_t version);
+    bool _readGrid(uint8_t version, uint8_t* data, size_t& len, uint8_t& corrected);
+    bool _parseSegments(const uint8_t* data, size_t len, uint8_t version, cams3_barcode_t& code);
+
+    // 1D
+    void _scanLinear();
+    bool _decodeEan(const uint16_t* runs, uint16_t count, bool firstDark, uint16_t row, bool reversed);
+    bool _decodeCode128(const uint16_t* runs, uint16_t count, bool firstDark, uint16_t row, bool reversed);
+
+   public:
+    ~CamS3_BarcodeReader();
+
+    /**
+     * @brief Set up the reader
+     * @param config Reader settings (nullptr for CAMS3_BARCODE_CONFIG_DEFAULT)
+     * @return true if successful
+     */
+    bool begin(const cams3_barcode_config_t* config = nullptr);
+
+    /**
+     * @brief Release all working buffers
+     */
+    void end();
+
+    /**
+     * @brief Restrict scanning to a rectangle of the frame
+     *
+     * For JPEG frames only this region is decoded, which is the cheapest way
+     * to read codes from high-resolution captures.
+     *
+     * @param x Left edge in pixels
+     * @param y Top edge in pixels
+     * @param w Width in pixels (0 for the whole frame)
+     * @param h Height in pixels
+     */
+    void setRegion(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+        _roiX = x;
+        _roiY = y;
+        _roiW = w;
+        _roiH = h;
+    }
+
+    /**
+     * @brief Only scan frames that differ from the last one
+     *
+     * JPEG frames go through CamS3_SceneDetector; raw frames are compared on
+     * a 32x24 luma sample. The frame after a change is scanned too, since it
+     * is usually the first sharp one. Skipped frames keep the last results.
+     *
+     * @param enable true to skip unchanged frames in scanFrame()
+     */
+    void setContinuous(bool enable) {
+        _continuous  = enable;
+        _sampleValid = false;
+        _scene.reset();
+    }
+
+    /**
+     * @brief Read codes from an 8-bit grayscale image
+     * @param gray Luma, one byte per pixel
+     * @param width Image width
+     * @param height Image height
+     * @return Number of codes read, or -1 on error
+     */
+    int scan(const uint8_t* gray, uint16_t width, uint16_t height);
+
+    /**
+     * @brief Read codes from a big-endian RGB565 image
+     * @return Number of codes read, or -1 on error
+     */
+    int scanRGB565(const uint8_t* pixels, uint16_t width, uint16_t height);
+
+    /**
+     * @brief Read codes from a JPEG, decoding only the region set by setRegion()
+     * @return Number of codes read, or -1 on error
+     */
+    int scanJpeg(const uint8_t* jpeg, size_t len);
+
+    /**
+     * @brief Read codes from a camera frame (GRAYSCALE, RGB565 or JPEG)
+     * @param frame Camera frame buffer
+     * @return Number of codes read (the previous count for skipped frames), or -1 on error
+     */
+    int scanFrame(camera_fb_t* frame);
+
+    uint8_t getCount() {
+        return _count;
+    }
+
+    const cams3_barcode_t& getResult(uint8_t i) {
+        return _results[i];
+    }
+
+    /**
+     * @brief Get the bit plane of the last scan (1 = dark)
+     * @return Binary image the size of the scanned region, or nullptr
+     */
+    const uint8_t* getBinary() {
+        return _bin;
+    }
+
+    const cams3_barcode_stats_t& getStats() {
+        return _stats;
+    }
+
+    /**
+     * @brief Get the share of scanned frames where a code was read
+     * @return Success rate in percent
+     */
+    float getSuccessRate() {
+        return _stats.frames ? _stats.decoded * 100.0f / _stats.frames : 0.0f;
+    }
+
+    /**
+     * @brief Get the mean scan latency
+     * @return Time in microseconds
+     */
+    uint32_t getAverageTime() {
+        return _stats.frames ? (uint32_t)(_stats.totalUs / _stats.frames) : 0;
+    }
+
+    void resetStats() {
+        _stats = {};
+    }
+
+    /**
+     * @brief Get a printable name for a code type
+     * @param type Code type
+     * @return Name such as "QR" or "EAN-13"
+     */
+    static const char* typeName(cams3_code_type_t type);
+};
+
+#endif  // _CAMS3_BARCODE_H_
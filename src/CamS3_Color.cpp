@@ -0,0 +1,241 @@
+/**
+ * @file CamS3_Color.cpp
+ * @brief LUT-based color correction for RGB565 frames
+ *
+ * @copyright MIT License
+ */
+
+#include "CamS3_Color.h"
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#include <math.h>
+
+static const uint32_t kLinMax = CAMS3_COLOR_LIN_LEVELS - 1;
+
+CamS3_ColorCorrector::~CamS3_ColorCorrector() {
+    end();
+}
+
+bool CamS3_ColorCorrector::begin(const cams3_color_config_t* config) {
+    end();
+    if (config) {
+        _config = *config;
+    }
+
+    // The output tables are read at random for every pixel, so keep them out of PSRAM if possible
+    const size_t size = 3 * CAMS3_COLOR_LIN_LEVELS * sizeof(uint16_t);
+    _out              = (uint16_t*)heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!_out) _out = (uint16_t*)malloc(size);
+    if (!_out) {
+        Serial.println("[CamS3 Color] Table allocation failed");
+        return false;
+    }
+
+    if (!setConfig(_config)) {
+        end();
+        return false;
+    }
+    _ready = true;
+    return true;
+}
+
+void CamS3_ColorCorrector::end() {
+    free(_out);
+    free(_colSq);
+    _out       = nullptr;
+    _colSq     = nullptr;
+    _mapWidth  = 0;
+    _mapHeight = 0;
+    _ready     = false;
+}
+
+bool CamS3_ColorCorrector::setConfig(const cams3_color_config_t& config) {
+    if (config.gainR <= 0 || config.gainR > CAMS3_COLOR_MAX_GAIN || config.gainG <= 0 ||
+        config.gainG > CAMS3_COLOR_MAX_GAIN || config.gainB <= 0 || config.gainB > CAMS3_COLOR_MAX_GAIN) {
+        Serial.println("[CamS3 Color] Channel gains must be in (0, 4]");
+        return false;
+    }
+    if (config.inputGamma < 0.1f || config.inputGamma > 5.0f || config.outputGamma < 0.1f ||
+        config.outputGamma > 5.0f) {
+        Serial.println("[CamS3 Color] Gamma must be in [0.1, 5]");
+        return false;
+    }
+    if (config.blackLevel >= 128) {
+        Serial.println("[CamS3 Color] Black level must be below 128");
+        return false;
+    }
+
+    _config = config;
+    if (_out) _buildTables();
+    return true;
+}
+
+void CamS3_ColorCorrector::setToneCurve(const uint8_t* curve) {
+    _hasCurve = curve != nullptr;
+    if (_hasCurve) memcpy(_curve, curve, sizeof(_curve));
+    if (_out) _buildTables();
+}
+
+void CamS3_ColorCorrector::_buildTables() {
+    // Input: expand 5/6-bit fields to 8 bits the way the sensor packed them, drop the black
+    // level, linearize and take the square root; the gain becomes sqrt(gain) in that domain
+    const float black     = _config.blackLevel;
+    const float range     = 255.0f - black;
+    const float halfGamma = _config.inputGamma * 0.5f;
+    for (uint8_t v = 0; v < 64; v++) {
+        float e6 = (float)((v << 2) | (v >> 4));
+        float x6 = e6 > black ? powf((e6 - black) / range, halfGamma) * kLinMax : 0.0f;
+        _inG[v]  = (uint16_t)fminf(x6 * sqrtf(_config.gainG) + 0.5f, 65535.0f);
+        if (v < 32) {
+            float e5 = (float)((v << 3) | (v >> 2));
+            float x5 = e5 > black ? powf((e5 - black) / range, halfGamma) * kLinMax : 0.0f;
+            _inR[v]  = (uint16_t)fminf(x5 * sqrtf(_config.gainR) + 0.5f, 65535.0f);
+            _inB[v]  = (uint16_t)fminf(x5 * sqrtf(_config.gainB) + 0.5f, 65535.0f);
+        }
+    }
+
+    // Output: back to the encoded domain, through the tone curve, then into the RGB565 fields
+    const float outExp = 2.0f / _config.outputGamma;
+    uint16_t* outR     = _out;
+    uint16_t* outG     = _out + CAMS3_COLOR_LIN_LEVELS;
+    uint16_t* outB     = _out + 2 * CAMS3_COLOR_LIN_LEVELS;
+    for (uint32_t i = 0; i <= kLinMax; i++) {
+        uint32_t e = (uint32_t)(powf((float)i / kLinMax, outExp) * 255.0f + 0.5f);
+        if (e > 255) e = 255;
+        if (_hasCurve) e = _curve[e];
+        outR[i] = (uint16_t)(((e * 31 + 127) / 255) << 11);
+        outG[i] = (uint16_t)(((e * 63 + 127) / 255) << 5);
+        outB[i] = (uint16_t)((e * 31 + 127) / 255);
+    }
+
+    // Vignetting: gain over normalized r^2, stored as sqrt(gain) in Q8
+    _flat = _config.vignetteK1 == 0 && _config.vignetteK2 == 0;
+    for (uint16_t i = 0; i <= 256; i++) {
+        float r2     = i / 256.0f;
+        float gain   = 1.0f + _config.vignetteK1 * r2 + _config.vignetteK2 * r2 * r2;
+        gain         = fminf(fmaxf(gain, 0.0f), CAMS3_COLOR_MAX_GAIN);
+        _vignette[i] = (uint16_t)(sqrtf(gain) * 256.0f + 0.5f);
+    }
+}
+
+bool CamS3_ColorCorrector::_buildMap(uint16_t width, uint16_t height) {
+    if (width == _mapWidth && height == _mapHeight) return true;
+
+    uint32_t* colSq = (uint32_t*)realloc(_colSq, width * sizeof(uint32_t));
+    if (!colSq) return false;
+    _colSq = colSq;
+
+    // r^2 = 1 at the corners, in 1/65536 steps so the row and column terms add to a table index
+    const float cx = width * 0.5f;
+    const float cy = height * 0.5f;
+    _rowScale      = 65536.0f / (cx * cx + cy * cy);
+    for (uint16_t x = 0; x < width; x++) {
+        float dx  = x + 0.5f - cx;
+        _colSq[x] = (uint32_t)(dx * dx * _rowScale);
+    }
+    _mapWidth  = width;
+    _mapHeight = height;
+    return true;
+}
+
+void CamS3_ColorCorrector::_applyRows(uint8_t* pixels, uint16_t firstRow, uint16_t lastRow) {
+    const uint16_t* outR = _out;
+    const uint16_t* outG = _out + CAMS3_COLOR_LIN_LEVELS;
+    const uint16_t* outB = _out + 2 * CAMS3_COLOR_LIN_LEVELS;
+    const float cy       = _height * 0.5f;
+
+    for (uint16_t y = firstRow; y < lastRow; y++) {
+        uint8_t* p = pixels + (size_t)y * _width * 2;
+
+        if (_flat) {
+            for (uint16_t x = 0; x < _width; x++, p += 2) {
+                uint16_t px = (p[0] << 8) | p[1];
+                uint32_t r  = _inR[px >> 11];
+                uint32_t g  = _inG[(px >> 5) & 0x3F];
+                uint32_t b  = _inB[px & 0x1F];
+                if (r > kLinMax) r = kLinMax;
+                if (g > kLinMax) g = kLinMax;
+                if (b > kLinMax) b = kLinMax;
+                uint16_t out = outR[r] | outG[g] | outB[b];
+                p[0]         = out >> 8;
+                p[1]         = out & 0xFF;
+            }
+            continue;
+        }
+
+        float dy              = y + 0.5f - cy;
+        uint32_t rowSq        = (uint32_t)(dy * dy * _rowScale);
+        const uint32_t* colSq = _colSq;
+        for (uint16_t x = 0; x < _width; x++, p += 2) {
+            uint16_t px   = (p[0] << 8) | p[1];
+            uint32_t idx  = (colSq[x] + rowSq) >> 8;
+            uint32_t gain = _vignette[idx > 256 ? 256 : idx];
+            uint32_t r    = (_inR[px >> 11] * gain) >> 8;
+            uint32_t g    = (_inG[(px >> 5) & 0x3F] * gain) >> 8;
+            uint32_t b    = (_inB[px & 0x1F] * gain) >> 8;
+            if (r > kLinMax) r = kLinMax;
+            if (g > kLinMax) g = kLinMax;
+            if (b > kLinMax) b = kLinMax;
+            uint16_t out = outR[r] | outG[g] | outB[b];
+            p[0]         = out >> 8;
+            p[1]         = out & 0xFF;
+        }
+    }
+}
+
+void CamS3_ColorCorrector::_bandTask(void* arg) {
+    Band* band = (Band*)arg;
+    band->cc->_applyRows(band->pixels, band->firstRow, band->lastRow);
+    xSemaphoreGive(band->done);
+    vTaskDelete(nullptr);
+}
+
+bool CamS3_ColorCorrector::apply(uint8_t* rgb565, uint16_t width, uint16_t height, uint8_t bands) {
+    if (!_ready || !rgb565 || width == 0 || height == 0) return false;
+
+    int64_t start = esp_timer_get_time();
+    if (!_flat && !_buildMap(width, height)) {
+        Serial.println("[CamS3 Color] Vignetting map allocation failed");
+        return false;
+    }
+    _width  = width;
+    _height = height;
+
+    if (bands < 1) bands = 1;
+    if (bands > CAMS3_COLOR_MAX_BANDS) bands = CAMS3_COLOR_MAX_BANDS;
+    if (bands > height) bands = height;
+
+    Band band[CAMS3_COLOR_MAX_BANDS];
+    for (uint8_t i = 0; i < bands; i++) {
+        band[i].cc       = this;
+        band[i].pixels   = rgb565;
+        band[i].firstRow = (uint32_t)height * i / bands;
+        band[i].lastRow  = (uint32_t)height * (i + 1) / bands;
+        band[i].done     = nullptr;
+    }
+
+    // Bands 1.. on the other core, band 0 on the calling task
+    const BaseType_t otherCore = xPortGetCoreID() ^ 1;
+    for (uint8_t i = 1; i < bands; i++) {
+        band[i].done = xSemaphoreCreateBinary();
+        if (!band[i].done ||
+            xTaskCreatePinnedToCore(_bandTask, "cams3_color", 2048, &band[i], uxTaskPriorityGet(nullptr), nullptr,
+                                    otherCore) != pdPASS) {
+            if (band[i].done) vSemaphoreDelete(band[i].done);
+            band[i].done = nullptr;
+        }
+    }
+    _applyRows(rgb565, band[0].firstRow, band[0].lastRow);
+    for (uint8_t i = 1; i < bands; i++) {
+        if (band[i].done) {
+            xSemaphoreTake(band[i].done, portMAX_DELAY);
+            vSemaphoreDelete(band[i].done);
+        } else {
+            _applyRows(rgb565, band[i].firstRow, band[i].lastRow);  // Worker could not be started
+        }
+    }
+
+    _lastUs = (uint32_t)(esp_timer_get_time() - start);
+    return true;
+}
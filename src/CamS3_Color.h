@@ -0,0 +1,149 @@
+/**
+ * @file CamS3_Color.h
+ * @brief LUT-based color correction for RGB565 frames
+ *
+ * Undoes the sensor gamma through small per-channel tables (with the
+ * white-balance gains folded in), applies a radial vignetting gain in
+ * linear light and re-encodes through 4096-entry output tables that hold
+ * the output gamma and an optional tone curve. Everything runs in one
+ * fused pass over the frame, split across both cores.
+ *
+ * Linear light is carried square-root encoded: gains stay plain multiplies
+ * (by the square root of the gain) while 12 bits still resolve the darkest
+ * 6-bit green step, which true linear Q12 would round to black.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef _CAMS3_COLOR_H_
+#define _CAMS3_COLOR_H_
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#define CAMS3_COLOR_MAX_BANDS  2
+#define CAMS3_COLOR_LIN_LEVELS 4096  // Output table entries per channel
+#define CAMS3_COLOR_MAX_GAIN   4.0f  // Largest channel or vignetting gain
+
+typedef struct {
+    float gainR;        // White-balance gains, applied in linear light
+    float gainG;
+    float gainB;
+    float vignetteK1;   // Vignetting gain 1 + k1 r^2 + k2 r^4, r = 1 at the frame corners
+    float vignetteK2;
+    float inputGamma;   // Gamma the sensor encoded the frame with
+    float outputGamma;  // Gamma to re-encode with (same as input for a neutral tone)
+    uint8_t blackLevel; // Subtracted from the 8-bit encoded input before linearizing
+} cams3_color_config_t;
+
+#define CAMS3_COLOR_CONFIG_DEFAULT {1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 2.2f, 2.2f, 0}
+
+// ============================================
+// Color Corrector Class
+// ============================================
+class CamS3_ColorCorrector {
+   private:
+    struct Band {
+        CamS3_ColorCorrector* cc;
+        uint8_t* pixels;
+        uint16_t firstRow;
+        uint16_t lastRow;  // Exclusive
+        SemaphoreHandle_t done;
+    };
+
+    cams3_color_config_t _config = CAMS3_COLOR_CONFIG_DEFAULT;
+    bool _ready                  = false;
+
+    // Encoded 5/6-bit input to sqrt(linear) in Q12, channel gain and black level folded in
+    uint16_t _inR[32];
+    uint16_t _inG[64];
+    uint16_t _inB[32];
+
+    // Linear light to RGB565 fields already in position, one table per channel
+    uint16_t* _out = nullptr;
+    uint8_t _curve[256];
+    bool _hasCurve = false;
+
+    // sqrt(radial gain) in Q8 indexed by normalized r^2 in 1/256 steps, and per-column dx^2 for it
+    uint16_t _vignette[257];
+    bool _flat          = true;  // No vignetting term: skip the per-pixel gain
+    uint32_t* _colSq    = nullptr;
+    uint16_t _mapWidth  = 0;
+    uint16_t _mapHeight = 0;
+    float _rowScale     = 0;  // 65536 / (half diagonal)^2
+
+    uint16_t _width  = 0;
+    uint16_t _height = 0;
+    uint32_t _lastUs = 0;
+
+    void _buildTables();
+    bool _buildMap(uint16_t width, uint16_t height);
+    void _applyRows(uint8_t* pixels, uint16_t firstRow, uint16_t lastRow);
+    static void _bandTask(void* arg);
+
+   public:
+    ~CamS3_ColorCorrector();
+
+    /**
+     * @brief Allocate the output tables and build all lookups
+     * @param config Correction settings (nullptr for CAMS3_COLOR_CONFIG_DEFAULT)
+     * @return true if successful
+     */
+    bool begin(const cams3_color_config_t* config = nullptr);
+
+    /**
+     * @brief Release all tables
+     */
+    void end();
+
+    /**
+     * @brief Change the correction settings and rebuild the tables
+     * @param config Correction settings
+     * @return true if the settings are valid
+     */
+    bool setConfig(const cams3_color_config_t& config);
+
+    const cams3_color_config_t& getConfig() {
+        return _config;
+    }
+
+    /**
+     * @brief Set a tone curve applied after the output gamma
+     * @param curve 256 entries mapping 8-bit encoded values (nullptr to remove)
+     */
+    void setToneCurve(const uint8_t* curve);
+
+    /**
+     * @brief Correct a big-endian RGB565 image in place
+     * @param rgb565 Pixel data as delivered by the camera (high byte first)
+     * @param width Image width
+     * @param height Image height
+     * @param bands Row bands processed in parallel, 1 = single core (default: 2)
+     * @return true if successful
+     */
+    bool apply(uint8_t* rgb565, uint16_t width, uint16_t height, uint8_t bands = CAMS3_COLOR_MAX_BANDS);
+
+    bool isReady() {
+        return _ready;
+    }
+
+    /**
+     * @brief Get the duration of the last apply() call
+     * @return Time in microseconds
+     */
+    uint32_t getLastApplyTime() {
+        return _lastUs;
+    }
+
+    /**
+     * @brief Get the cost of the last apply() call per megapixel
+     * @return Milliseconds per megapixel
+     */
+    float getMsPerMegapixel() {
+        uint32_t pixels = (uint32_t)_width * _height;
+        return pixels ? _lastUs * 1000.0f / pixels : 0.0f;
+    }
+};
+
+#endif  // _CAMS3_COLOR_H_
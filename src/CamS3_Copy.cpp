@@ -0,0 +1,186 @@
+/**
+ * @file CamS3_Copy.cpp
+ * @brief Asynchronous memory copies on the ESP32-S3 GDMA
+ *
+ * @copyright MIT License
+ */
+
+#include "CamS3_Copy.h"
+#include <esp_timer.h>
+
+#if CAMS3_COPY_HAS_GDMA
+#include <esp_memory_utils.h>
+#include <esp32s3/rom/cache.h>
+#endif
+
+CamS3_CopyEngine CamS3Copy;
+
+CamS3_CopyEngine::~CamS3_CopyEngine() {
+    end();
+}
+
+bool CamS3_CopyEngine::begin() {
+#if CAMS3_COPY_HAS_GDMA
+    if (_mcp) return true;
+    if (_unavailable) return false;  // Not retried until end()
+
+    _slots = xSemaphoreCreateCounting(CAMS3_COPY_BACKLOG, CAMS3_COPY_BACKLOG);
+    _done  = xSemaphoreCreateBinary();
+    if (!_slots || !_done) {
+        end();
+        return false;
+    }
+
+    async_memcpy_config_t config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+    config.backlog               = CAMS3_COPY_BACKLOG;
+    config.sram_trans_align      = 4;
+    config.psram_trans_align     = CAMS3_COPY_PSRAM_ALIGN;
+    if (esp_async_memcpy_install(&config, &_mcp) != ESP_OK) {
+        Serial.println("[CamS3 Copy] No GDMA channel, copying on the CPU");
+        _mcp = nullptr;
+        end();
+        _unavailable = true;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CamS3_CopyEngine::end() {
+    wait();
+#if CAMS3_COPY_HAS_GDMA
+    if (_mcp) esp_async_memcpy_uninstall(_mcp);
+    _mcp = nullptr;
+#endif
+    if (_slots) vSemaphoreDelete(_slots);
+    if (_done) vSemaphoreDelete(_done);
+    _slots       = nullptr;
+    _done        = nullptr;
+    _unavailable = false;
+}
+
+bool CamS3_CopyEngine::_dmaPossible(const uint8_t* dst, const uint8_t* src, size_t n, size_t& head, size_t& body) {
+#if CAMS3_COPY_HAS_GDMA
+    if (!_mcp || n < CAMS3_COPY_MIN_DMA) return false;
+
+    // The DMA moves the aligned middle; both ends have to reach alignment after the same head
+    bool external = esp_ptr_external_ram(dst) || esp_ptr_external_ram(src);
+    size_t align  = external ? CAMS3_COPY_PSRAM_ALIGN : 4;
+    if (((uintptr_t)dst ^ (uintptr_t)src) & (align - 1)) return false;
+    if (!esp_ptr_external_ram(dst) && !esp_ptr_dma_capable(dst)) return false;
+    if (!esp_ptr_external_ram(src) && !esp_ptr_dma_capable(src)) return false;
+
+    head = (align - ((uintptr_t)src & (align - 1))) & (align - 1);
+    body = (n - head) & ~(align - 1);
+    return body >= CAMS3_COPY_MIN_DMA;
+#else
+    return false;
+#endif
+}
+
+bool CamS3_CopyEngine::copy(void* dst, const void* src, size_t n, cams3_copy_cb_t cb, void* arg) {
+    if (!dst || !src) return false;
+    wait();
+
+    int64_t start = esp_timer_get_time();
+    uint8_t* d    = (uint8_t*)dst;
+    uint8_t* s    = (uint8_t*)src;
+    size_t head   = 0;
+    size_t body   = 0;
+
+    if (!_dmaPossible(d, s, n, head, body)) {
+        memcpy(d, s, n);
+        _stats.cpuCopies++;
+        _stats.cpuBytes += n;
+        _stats.lastUs    = (uint32_t)(esp_timer_get_time() - start);
+        _stats.lastCpuUs = _stats.lastUs;
+        if (cb) cb(arg);
+        return true;
+    }
+
+#if CAMS3_COPY_HAS_GDMA
+    // The unaligned ends first, then flush them and the source so the DMA sees what the CPU wrote
+    size_t tail = n - head - body;
+    memcpy(d, s, head);
+    memcpy(d + head + body, s + head + body, tail);
+    if (esp_ptr_external_ram(s)) Cache_WriteBack_Addr((uintptr_t)(s + head), body);
+    if (esp_ptr_external_ram(d)) Cache_WriteBack_Addr((uintptr_t)d, n);
+
+    _dst     = d + head;
+    _len     = body;
+    _cb      = cb;
+    _cbArg   = arg;
+    _startUs = start;
+    _pending = 1;  // Held by the queueing loop so a fast completion cannot finish early
+    _busy    = true;
+    _stats.dmaCopies++;
+    _stats.cpuBytes += head + tail;
+
+    for (size_t off = 0; off < body; off += CAMS3_COPY_CHUNK) {
+        size_t len = body - off < CAMS3_COPY_CHUNK ? body - off : CAMS3_COPY_CHUNK;
+        xSemaphoreTake(_slots, portMAX_DELAY);
+        portENTER_CRITICAL(&_lock);
+        _pending++;
+        portEXIT_CRITICAL(&_lock);
+        if (esp_async_memcpy(_mcp, d + head + off, s + head + off, len, _onTransfer, this) != ESP_OK) {
+            // Channel refused the transfer: finish the rest on the CPU
+            portENTER_CRITICAL(&_lock);
+            _pending--;
+            portEXIT_CRITICAL(&_lock);
+            xSemaphoreGive(_slots);
+            memcpy(d + head + off, s + head + off, body - off);
+            _stats.cpuBytes += body - off;
+            break;
+        }
+        _stats.dmaBytes += len;
+    }
+
+    portENTER_CRITICAL(&_lock);
+    bool last = --_pending == 0;
+    portEXIT_CRITICAL(&_lock);
+    if (last) _finish(nullptr);
+
+    _stats.lastCpuUs = (uint32_t)(esp_timer_get_time() - start);
+#endif
+    return true;
+}
+
+void IRAM_ATTR CamS3_CopyEngine::_finish(BaseType_t* woken) {
+#if CAMS3_COPY_HAS_GDMA
+    // Drop lines the CPU may have cached while the DMA was writing behind it; the body starts
+    // and ends on cache line boundaries, so no line is shared with the CPU-copied ends
+    if (esp_ptr_external_ram(_dst)) Cache_Invalidate_Addr((uintptr_t)_dst, _len);
+#endif
+    _stats.lastUs = (uint32_t)(esp_timer_get_time() - _startUs);
+    if (_cb) _cb(_cbArg);
+    if (woken) {
+        xSemaphoreGiveFromISR(_done, woken);
+    } else {
+        xSemaphoreGive(_done);
+    }
+}
+
+#if CAMS3_COPY_HAS_GDMA
+bool IRAM_ATTR CamS3_CopyEngine::_onTransfer(async_memcpy_handle_t mcp, async_memcpy_event_t* event, void* arg) {
+    CamS3_CopyEngine* engine = (CamS3_CopyEngine*)arg;
+    BaseType_t woken         = pdFALSE;
+    xSemaphoreGiveFromISR(engine->_slots, &woken);
+
+    // Zero once every transfer has landed and the queueing loop has let go
+    portENTER_CRITICAL_ISR(&engine->_lock);
+    bool last = --engine->_pending == 0;
+    portEXIT_CRITICAL_ISR(&engine->_lock);
+    if (last) engine->_finish(&woken);
+    return woken == pdTRUE;
+}
+#endif
+
+bool CamS3_CopyEngine::wait(uint32_t timeoutMs) {
+    if (!_busy) return true;
+    TickType_t ticks = timeoutMs == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+    if (xSemaphoreTake(_done, ticks) != pdTRUE) return false;
+    _busy = false;
+    return true;
+}
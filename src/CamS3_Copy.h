@@ -0,0 +1,167 @@
+/**
+ * @file CamS3_Copy.h
+ * @brief Asynchronous memory copies on the ESP32-S3 GDMA
+ *
+ * Large copies out of PSRAM keep the CPU waiting on the external memory bus
+ * for milliseconds per frame. The copy engine hands them to an async memcpy
+ * GDMA channel instead: copy() returns once the transfer is queued, and a
+ * completion callback or wait() reports when it is done. Bytes the DMA
+ * cannot move (misaligned heads and tails, short copies) are copied by the
+ * CPU, and builds without the IDF async memcpy driver copy everything on
+ * the CPU through the same API.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef _CAMS3_COPY_H_
+#define _CAMS3_COPY_H_
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#if __has_include(<esp_async_memcpy.h>)
+#include <esp_async_memcpy.h>
+#define CAMS3_COPY_HAS_GDMA 1
+#else
+#define CAMS3_COPY_HAS_GDMA 0
+#endif
+
+#define CAMS3_COPY_BACKLOG     8      // DMA transfers queued at once
+#define CAMS3_COPY_CHUNK       32768  // Largest single DMA transfer
+#define CAMS3_COPY_MIN_DMA     2048   // Shorter copies are cheaper on the CPU
+
+// GDMA address and size alignment for PSRAM: a whole data cache line, so invalidating
+// the destination after the DMA never drops CPU writes to a neighbouring buffer
+#ifdef CONFIG_ESP32S3_DATA_CACHE_LINE_SIZE
+#define CAMS3_COPY_PSRAM_ALIGN CONFIG_ESP32S3_DATA_CACHE_LINE_SIZE
+#else
+#define CAMS3_COPY_PSRAM_ALIGN 64
+#endif
+
+/**
+ * @brief Copy completion callback
+ *
+ * Runs in the DMA interrupt for GDMA copies and in copy() itself for CPU
+ * copies, so keep it short and ISR-safe (IRAM_ATTR, FromISR calls).
+ */
+typedef void (*cams3_copy_cb_t)(void* arg);
+
+typedef struct {
+    uint32_t dmaCopies;  // Copies that went (at least partly) through the GDMA
+    uint32_t cpuCopies;  // Copies done entirely by the CPU
+    uint64_t dmaBytes;
+    uint64_t cpuBytes;   // Includes the heads and tails of DMA copies
+    uint32_t lastUs;     // Last copy, from copy() to completion
+    uint32_t lastCpuUs;  // CPU time the caller spent in the last copy()
+} cams3_copy_stats_t;
+
+// ============================================
+// Copy Engine Class
+// ============================================
+class CamS3_CopyEngine {
+   private:
+#if CAMS3_COPY_HAS_GDMA
+    async_memcpy_handle_t _mcp = nullptr;
+#endif
+    SemaphoreHandle_t _slots = nullptr;  // Free transfer slots on the channel
+    SemaphoreHandle_t _done  = nullptr;  // Given when the last transfer of a copy completes
+    portMUX_TYPE _lock       = portMUX_INITIALIZER_UNLOCKED;
+    bool _unavailable        = false;  // No channel could be claimed
+
+    // Copy in flight
+    volatile bool _busy        = false;
+    volatile uint32_t _pending = 0;  // Transfers outstanding, plus one while still queueing
+    uint8_t* _dst              = nullptr;
+    size_t _len                = 0;
+    cams3_copy_cb_t _cb        = nullptr;
+    void* _cbArg               = nullptr;
+    int64_t _startUs           = 0;
+
+    cams3_copy_stats_t _stats = {};
+
+    bool _dmaPossible(const uint8_t* dst, const uint8_t* src, size_t n, size_t& head, size_t& body);
+    void _finish(BaseType_t* woken);
+#if CAMS3_COPY_HAS_GDMA
+    static bool _onTransfer(async_memcpy_handle_t mcp, async_memcpy_event_t* event, void* arg);
+#endif
+
+   public:
+    ~CamS3_CopyEngine();
+
+    /**
+     * @brief Claim a GDMA channel for async copies
+     *
+     * Without it (or without GDMA support in the build) every copy runs on
+     * the CPU. Calling it again is harmless; after a failed claim it returns
+     * false at once until end().
+     *
+     * @return true if GDMA copies are available
+     */
+    bool begin();
+
+    /**
+     * @brief Wait for the copy in flight and release the channel
+     */
+    void end();
+
+    bool isDma() {
+#if CAMS3_COPY_HAS_GDMA
+        return _mcp != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Start copying n bytes from src to dst
+     *
+     * Only one copy is in flight at a time: a copy started while another is
+     * running waits for it first. Leave both buffers alone until the copy
+     * completes; src may be read meanwhile, dst must not be touched. Buffers
+     * in PSRAM need CAMS3_COPY_PSRAM_ALIGN-aligned addresses (one cache
+     * line) for the DMA to take part; otherwise the CPU does the copy.
+     *
+     * @param dst Destination (must not overlap src)
+     * @param src Source
+     * @param n Bytes to copy
+     * @param cb Completion callback (optional)
+     * @param arg Passed to the callback
+     * @return true if the copy was started (or, on the CPU path, done)
+     */
+    bool copy(void* dst, const void* src, size_t n, cams3_copy_cb_t cb = nullptr, void* arg = nullptr);
+
+    /**
+     * @brief Wait for the copy in flight to complete
+     * @param timeoutMs Maximum wait
+     * @return true if no copy is in flight any more
+     */
+    bool wait(uint32_t timeoutMs = portMAX_DELAY);
+
+    /**
+     * @brief Copy and wait for completion
+     * @return true if successful
+     */
+    bool copySync(void* dst, const void* src, size_t n) {
+        return copy(dst, src, n) && wait();
+    }
+
+    bool isBusy() {
+        return _busy;
+    }
+
+    const cams3_copy_stats_t& getStats() {
+        return _stats;
+    }
+
+    void resetStats() {
+        _stats = {};
+    }
+};
+
+/**
+ * @brief Engine shared by the library's copy sites
+ */
+extern CamS3_CopyEngine CamS3Copy;
+
+#endif  // _CAMS3_COPY_H_
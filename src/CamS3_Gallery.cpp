@@ -0,0 +1,315 @@
+/**
+ * @file CamS3_Gallery.cpp
+ * @brief HTTP/JSON capture gallery for CamS3Library
+ *
+ * @copyright MIT License
+ */
+
+#include "CamS3_Gallery.h"
+#include <esp_heap_caps.h>
+
+// ============================================
+// CamS3_Gallery Implementation
+// ============================================
+
+bool CamS3_Gallery::begin(CamS3_SD& sd, size_t cacheBytes) {
+    if (!sd.getCatalog().isOpen()) {
+        Serial.println("[CamS3 Gallery] Capture catalog not open");
+        return false;
+    }
+
+    if (!_lock) {
+        _lock = xSemaphoreCreateMutex();
+        if (!_lock) return false;
+    }
+
+    // Thumbnails cached by an earlier begin()
+    clearCache();
+
+    _sd          = &sd;
+    _cacheBudget = cacheBytes;
+    return true;
+}
+
+void CamS3_Gallery::end() {
+    clearCache();
+    _sd = nullptr;
+}
+
+void CamS3_Gallery::clearCache() {
+    if (!_lock) return;
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    for (int i = 0; i < CAMS3_GALLERY_CACHE_ENTRIES; i++) {
+        if (_cache[i].data) {
+            heap_caps_free(_cache[i].data);
+            _cache[i].data = nullptr;
+        }
+    }
+    _cacheUsed = 0;
+    xSemaphoreGive(_lock);
+}
+
+// ============================================
+// Thumbnail Cache
+// ============================================
+
+CamS3_Gallery::CacheEntry* CamS3_Gallery::_lookup(uint32_t id) {
+    for (int i = 0; i < CAMS3_GALLERY_CACHE_ENTRIES; i++) {
+        if (_cache[i].data && _cache[i].id == id) {
+            _cache[i].lastUse = ++_useClock;
+            return &_cache[i];
+        }
+    }
+    return nullptr;
+}
+
+bool CamS3_Gallery::_evict(size_t needed) {
+    if (needed > _cacheBudget) return false;
+
+    // Drop least recently used entries until the new one fits
+    while (_cacheUsed + needed > _cacheBudget) {
+        CacheEntry* oldest = nullptr;
+        for (int i = 0; i < CAMS3_GALLERY_CACHE_ENTRIES; i++) {
+            if (_cache[i].data && (!oldest || _cache[i].lastUse < oldest->lastUse)) {
+                oldest = &_cache[i];
+            }
+        }
+        if (!oldest) return false;
+        heap_caps_free(oldest->data);
+        _cacheUsed -= oldest->len;
+        oldest->data = nullptr;
+    }
+    return true;
+}
+
+uint8_t* CamS3_Gallery::_readThumb(uint32_t id, size_t& len) {
+    cams3_catalog_entry_t entry;
+    if (!_sd->getCatalog().read(id, &entry)) return nullptr;
+
+    String thumb = CamS3_SD::thumbnailPath(entry.path);
+    if (!_sd->exists(thumb.c_str()) && !_sd->makeThumbnail(entry.path)) {
+        return nullptr;
+    }
+
+    int64_t size = _sd->getFileSize(thumb.c_str());
+    if (size <= 0) return nullptr;
+
+    uint8_t* data = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (!data) return nullptr;
+    if (_sd->readFile(thumb.c_str(), data, size) != size) {
+        heap_caps_free(data);
+        return nullptr;
+    }
+    len = size;
+    return data;
+}
+
+CamS3_Gallery::CacheEntry* CamS3_Gallery::_insert(uint32_t id, uint8_t* data, size_t len) {
+    if (!_evict(len)) return nullptr;
+
+    // A free slot, or the least recently used one
+    CacheEntry* slot = nullptr;
+    for (int i = 0; i < CAMS3_GALLERY_CACHE_ENTRIES; i++) {
+        if (!_cache[i].data) {
+            slot = &_cache[i];
+            break;
+        }
+        if (!slot || _cache[i].lastUse < slot->lastUse) {
+            slot = &_cache[i];
+        }
+    }
+    if (slot->data) {
+        heap_caps_free(slot->data);
+        _cacheUsed -= slot->len;
+        slot->data = nullptr;
+    }
+
+    slot->id      = id;
+    slot->data    = data;
+    slot->len     = len;
+    slot->lastUse = ++_useClock;
+    _cacheUsed += len;
+    return slot;
+}
+
+// ============================================
+// JSON Pages
+// ============================================
+
+// Append a quoted JSON string; catalog paths come from file names and may hold any byte
+static void appendJsonString(String& json, const char* s) {
+    json += '"';
+    for (; *s; s++) {
+        char c = *s;
+        if (c == '"' || c == '\\') {
+            json += '\\';
+            json += c;
+        } else if ((uint8_t)c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", (uint8_t)c);
+            json += esc;
+        } else {
+            json += c;
+        }
+    }
+    json += '"';
+}
+
+String CamS3_Gallery::pageJson(uint32_t before, uint16_t limit, uint32_t cursor) {
+    if (!_sd) return String("{\"items\":[],\"next\":null}");
+    if (limit == 0) limit = CAMS3_GALLERY_PAGE_DEFAULT;
+    if (limit > CAMS3_GALLERY_PAGE_MAX) limit = CAMS3_GALLERY_PAGE_MAX;
+
+    cams3_catalog_entry_t entries[CAMS3_GALLERY_PAGE_MAX];
+    size_t n = _sd->getCatalog().page(before, entries, limit, cursor);
+
+    String json = "{\"items\":[";
+    char item[96];
+    for (size_t i = 0; i < n; i++) {
+        const cams3_catalog_entry_t& e = entries[i];
+        char path[sizeof(e.path) + 1];
+        memcpy(path, e.path, sizeof(e.path));
+        path[sizeof(e.path)] = '\0';
+
+        snprintf(item, sizeof(item), "%s{\"id\":%lu,\"time\":%lu,\"path\":", i ? "," : "", (unsigned long)e.id,
+                 (unsigned long)e.time);
+        json += item;
+        appendJsonString(json, path);
+        snprintf(item, sizeof(item), ",\"size\":%lu,\"width\":%u,\"height\":%u}", (unsigned long)e.size, e.width,
+                 e.height);
+        json += item;
+    }
+    json += "],\"next\":";
+
+    // Ids are in time order, so the next page continues below the last id; a short page reached the start
+    if (n == limit && entries[n - 1].id > 0) {
+        json += String((unsigned long)entries[n - 1].id);
+    } else {
+        json += "null";
+    }
+    json += "}";
+    return json;
+}
+
+// ============================================
+// HTTP Handlers
+// ============================================
+
+bool CamS3_Gallery::registerHandlers(httpd_handle_t server) {
+    if (!_sd || !server) return false;
+
+    httpd_uri_t pageUri  = {"/api/gallery", HTTP_GET, _handlePage, this};
+    httpd_uri_t thumbUri = {"/api/thumb", HTTP_GET, _handleThumb, this};
+    httpd_uri_t imageUri = {"/api/image", HTTP_GET, _handleImage, this};
+
+    return httpd_register_uri_handler(server, &pageUri) == ESP_OK &&
+           httpd_register_uri_handler(server, &thumbUri) == ESP_OK &&
+           httpd_register_uri_handler(server, &imageUri) == ESP_OK;
+}
+
+uint32_t CamS3_Gallery::_queryParam(httpd_req_t* req, const char* key, uint32_t defaultValue) {
+    char query[96];
+    char value[16];
+    size_t len = httpd_req_get_url_query_len(req);
+    if (len == 0 || len >= sizeof(query)) return defaultValue;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) return defaultValue;
+    if (httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) return defaultValue;
+    return strtoul(value, nullptr, 10);
+}
+
+esp_err_t CamS3_Gallery::_handlePage(httpd_req_t* req) {
+    CamS3_Gallery* self = (CamS3_Gallery*)req->user_ctx;
+    uint32_t before     = _queryParam(req, "before", 0);
+    uint32_t limit      = _queryParam(req, "limit", CAMS3_GALLERY_PAGE_DEFAULT);
+    uint32_t cursor     = _queryParam(req, "cursor", UINT32_MAX);
+
+    String json = self->pageJson(before, limit > 0xFFFF ? 0xFFFF : limit, cursor);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_send(req, json.c_str(), json.length());
+}
+
+esp_err_t CamS3_Gallery::_handleThumb(httpd_req_t* req) {
+    CamS3_Gallery* self = (CamS3_Gallery*)req->user_ctx;
+    uint32_t id         = _queryParam(req, "id", 0xFFFFFFFF);
+    if (!self->_sd) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Gallery stopped");
+    }
+
+    // The entry stays locked while it is sent so it cannot be evicted mid-response
+    xSemaphoreTake(self->_lock, portMAX_DELAY);
+    CacheEntry* entry = self->_lookup(id);
+    if (entry) {
+        self->_hits++;
+    } else {
+        self->_misses++;
+        xSemaphoreGive(self->_lock);
+
+        // Card reads and thumbnail decoding happen unlocked, so cached thumbnails keep being served
+        size_t len    = 0;
+        uint8_t* data = self->_readThumb(id, len);
+        if (!data) {
+            return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Thumbnail not found");
+        }
+
+        xSemaphoreTake(self->_lock, portMAX_DELAY);
+        entry = self->_lookup(id);  // Another request may have loaded it meanwhile
+        if (entry) {
+            heap_caps_free(data);
+        } else {
+            entry = self->_insert(id, data, len);
+        }
+        if (!entry) {
+            // Larger than the whole cache: sent once, uncached
+            xSemaphoreGive(self->_lock);
+            esp_err_t err = _sendThumb(req, data, len);
+            heap_caps_free(data);
+            return err;
+        }
+    }
+
+    esp_err_t err = _sendThumb(req, entry->data, entry->len);
+    xSemaphoreGive(self->_lock);
+    return err;
+}
+
+esp_err_t CamS3_Gallery::_sendThumb(httpd_req_t* req, const uint8_t* data, size_t len) {
+    httpd_resp_set_type(req, "image/jpeg");
+    httpd_resp_set_hdr(req, "Cache-Control", "max-age=86400");
+    return httpd_resp_send(req, (const char*)data, len);
+}
+
+esp_err_t CamS3_Gallery::_handleImage(httpd_req_t* req) {
+    CamS3_Gallery* self = (CamS3_Gallery*)req->user_ctx;
+    uint32_t id         = _queryParam(req, "id", 0xFFFFFFFF);
+
+    cams3_catalog_entry_t entry;
+    if (!self->_sd || !self->_sd->getCatalog().read(id, &entry)) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Capture not found");
+    }
+    File file = self->_sd->getFS().open(entry.path, FILE_READ);
+    if (!file) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Capture file missing");
+    }
+
+    httpd_resp_set_type(req, "image/jpeg");
+    const size_t chunk = 8 * 1024;
+    uint8_t* buf       = (uint8_t*)malloc(chunk);
+    esp_err_t err      = ESP_OK;
+    if (!buf) {
+        file.close();
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+
+    size_t n;
+    while (err == ESP_OK && (n = file.read(buf, chunk)) > 0) {
+        err = httpd_resp_send_chunk(req, (const char*)buf, n);
+    }
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, nullptr, 0);
+    }
+
+    free(buf);
+    file.close();
+    return err;
+}
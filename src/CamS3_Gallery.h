@@ -0,0 +1,127 @@
+/**
+ * @file CamS3_Gallery.h
+ * @brief HTTP/JSON capture gallery for CamS3Library
+ *
+ * Pages through the capture catalog by time and serves thumbnails from an
+ * LRU cache in PSRAM, so browsing does not rescan or re-read the SD card.
+ * Include this header explicitly; it pulls in esp_http_server.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef _CAMS3_GALLERY_H_
+#define _CAMS3_GALLERY_H_
+
+#include <esp_http_server.h>
+#include <freertos/semphr.h>
+
+#include "CamS3Library.h"
+
+// Default gallery settings
+#define CAMS3_GALLERY_CACHE_BYTES   (1024 * 1024)
+#define CAMS3_GALLERY_CACHE_ENTRIES 64
+#define CAMS3_GALLERY_PAGE_DEFAULT  20
+#define CAMS3_GALLERY_PAGE_MAX      50
+
+// ============================================
+// Gallery Class
+// ============================================
+class CamS3_Gallery {
+   private:
+    struct CacheEntry {
+        uint32_t id;
+        uint8_t* data;
+        size_t len;
+        uint32_t lastUse;
+    };
+
+    CamS3_SD* _sd              = nullptr;
+    SemaphoreHandle_t _lock    = nullptr;
+    CacheEntry _cache[CAMS3_GALLERY_CACHE_ENTRIES] = {};
+    size_t _cacheBudget        = CAMS3_GALLERY_CACHE_BYTES;
+    size_t _cacheUsed          = 0;
+    uint32_t _useClock         = 0;
+    uint32_t _hits             = 0;
+    uint32_t _misses           = 0;
+
+    CacheEntry* _lookup(uint32_t id);
+    uint8_t* _readThumb(uint32_t id, size_t& len);
+    CacheEntry* _insert(uint32_t id, uint8_t* data, size_t len);
+    bool _evict(size_t needed);
+
+    static esp_err_t _handlePage(httpd_req_t* req);
+    static esp_err_t _handleThumb(httpd_req_t* req);
+    static esp_err_t _sendThumb(httpd_req_t* req, const uint8_t* data, size_t len);
+    static esp_err_t _handleImage(httpd_req_t* req);
+    static uint32_t _queryParam(httpd_req_t* req, const char* key, uint32_t defaultValue);
+
+   public:
+    /**
+     * @brief Initialize the gallery
+     * @param sd SD card with an open capture catalog (see CamS3_SD::openCatalog())
+     * @param cacheBytes Thumbnail cache budget in PSRAM (default: 1MB)
+     * @return true if successful
+     */
+    bool begin(CamS3_SD& sd, size_t cacheBytes = CAMS3_GALLERY_CACHE_BYTES);
+
+    /**
+     * @brief Release the thumbnail cache
+     */
+    void end();
+
+    /**
+     * @brief Build one page of the gallery as JSON
+     *
+     * {"items":[{"id":..,"time":..,"path":"..","size":..,"width":..,"height":..}],"next":<id>|null}
+     * Pass "next" as @p cursor to get the following (older) page.
+     *
+     * @param before Only list captures older than this time (0 = newest)
+     * @param limit Page size (max CAMS3_GALLERY_PAGE_MAX)
+     * @param cursor Only list captures with a smaller id ("next" of the previous page)
+     * @return JSON document
+     */
+    String pageJson(uint32_t before = 0, uint16_t limit = CAMS3_GALLERY_PAGE_DEFAULT, uint32_t cursor = UINT32_MAX);
+
+    /**
+     * @brief Register the gallery endpoints on an esp_http_server instance
+     *
+     * GET /api/gallery?before=&cursor=&limit=  page of captures (JSON)
+     * GET /api/thumb?id=                        thumbnail JPEG (cached)
+     * GET /api/image?id=                        full image JPEG (streamed)
+     *
+     * @param server Running HTTP server handle
+     * @return true if successful
+     */
+    bool registerHandlers(httpd_handle_t server);
+
+    /**
+     * @brief Drop all cached thumbnails
+     */
+    void clearCache();
+
+    /**
+     * @brief Get the bytes currently held by the thumbnail cache
+     * @return Cached bytes
+     */
+    size_t getCacheBytes() {
+        return _cacheUsed;
+    }
+
+    /**
+     * @brief Get the number of thumbnail requests served from the cache
+     * @return Cache hits
+     */
+    uint32_t getCacheHits() {
+        return _hits;
+    }
+
+    /**
+     * @brief Get the number of thumbnail requests read from the SD card
+     * @return Cache misses
+     */
+    uint32_t getCacheMisses() {
+        return _misses;
+    }
+};
+
+#endif  // _CAMS3_GALLERY_H_
@@ -0,0 +1,1835 @@
+/**
+ * @file CamS3_Jpeg.cpp
+ * @brief Baseline JPEG bitstream tools for CamS3Library
+ *
+ * @copyright MIT License
+ */
+
+#include "CamS3_Jpeg.h"
+#include <esp_timer.h>
+#include <freertos/task.h>
+
+// JPEG markers
+#define JPEG_SOI  0xD8
+#define JPEG_EOI  0xD9
+#define JPEG_APP0 0xE0
+#define JPEG_SOF0 0xC0
+#define JPEG_SOF1 0xC1
+#define JPEG_DHT  0xC4
+#define JPEG_DQT  0xDB
+#define JPEG_DRI  0xDD
+#define JPEG_SOS  0xDA
+#define JPEG_RST0 0xD0
+
+// Zigzag position -> natural (row-major) position
+static const uint8_t kZigzag[64] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+    41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+    30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+// ============================================
+// Bit Reader
+// ============================================
+
+void CamS3_JpegDecoder::BitReader::reset(const uint8_t* start, const uint8_t* stop) {
+    p      = start;
+    end    = stop;
+    acc    = 0;
+    bits   = 0;
+    marker = false;
+}
+
+void CamS3_JpegDecoder::BitReader::fill() {
+    while (bits <= 24) {
+        uint32_t b = 0;
+        if (!marker && p < end) {
+            b = *p;
+            if (b == 0xFF) {
+                uint8_t next = (p + 1 < end) ? p[1] : 0xD9;
+                if (next == 0x00) {
+                    p += 2;  // Stuffed byte
+                } else {
+                    marker = true;  // Stop at marker, feed zeros
+                    b      = 0;
+                }
+            } else {
+                p++;
+            }
+        }
+        acc |= b << (24 - bits);
+        bits += 8;
+    }
+}
+
+uint32_t CamS3_JpegDecoder::BitReader::get(int n) {
+    if (n == 0) return 0;
+    if (bits < n) fill();
+    uint32_t v = acc >> (32 - n);
+    acc <<= n;
+    bits -= n;
+    return v;
+}
+
+bool CamS3_JpegDecoder::BitReader::restart() {
+    // Drop the padding bits and skip to the next RSTn marker
+    acc  = 0;
+    bits = 0;
+    while (p + 1 < end) {
+        if (p[0] == 0xFF && p[1] >= JPEG_RST0 && p[1] <= JPEG_RST0 + 7) {
+            p += 2;
+            marker = false;
+            return true;
+        }
+        p++;
+    }
+    return false;
+}
+
+// ============================================
+// Header Parsing
+// ============================================
+
+CamS3_JpegDecoder::~CamS3_JpegDecoder() {
+    free(_index);
+}
+
+bool CamS3_JpegDecoder::parse(const uint8_t* data, size_t len) {
+    _valid      = false;
+    _indexed    = false;
+    _indexCount = 0;
+    _data       = data;
+    _len        = len;
+    memset(&_info, 0, sizeof(_info));
+    memset(_dcTables, 0, sizeof(_dcTables));
+    memset(_acTables, 0, sizeof(_acTables));
+
+    if (!data || len < 4 || data[0] != 0xFF || data[1] != JPEG_SOI) {
+        return false;
+    }
+
+    size_t pos = 2;
+    while (pos + 4 <= len) {
+        if (data[pos] != 0xFF) {
+            return false;
+        }
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xFF) {
+            pos++;  // Fill byte
+            continue;
+        }
+        uint16_t segLen = (data[pos + 2] << 8) | data[pos + 3];
+        if (segLen < 2 || pos + 2 + segLen > len) {
+            return false;
+        }
+        const uint8_t* seg = data + pos + 4;
+        uint16_t payload   = segLen - 2;
+
+        switch (marker) {
+            case JPEG_SOF0:
+            case JPEG_SOF1:
+                if (!_parseSOF(seg, payload)) return false;
+                break;
+            case JPEG_DHT:
+                if (!_parseDHT(seg, payload)) return false;
+                break;
+            case JPEG_DQT:
+                if (!_parseDQT(seg, payload)) return false;
+                break;
+            case JPEG_DRI:
+                if (payload < 2) return false;
+                _info.restartInterval = (seg[0] << 8) | seg[1];
+                break;
+            case JPEG_SOS:
+                if (!_parseSOS(seg, payload)) return false;
+                _scanOffset = pos + 2 + segLen;
+                _valid      = true;
+                return true;
+            case JPEG_EOI:
+                return false;
+            default:
+                // Progressive, arithmetic and lossless frames are not supported
+                if (marker >= 0xC2 && marker <= 0xCF && marker != JPEG_DHT && marker != 0xC8 && marker != 0xCC) {
+                    return false;
+                }
+                break;
+        }
+        pos += 2 + segLen;
+    }
+    return false;
+}
+
+bool CamS3_JpegDecoder::_parseSOF(const uint8_t* p, uint16_t len) {
+    if (len < 6 || p[0] != 8) return false;  // 8-bit precision only
+
+    _info.height     = (p[1] << 8) | p[2];
+    _info.width      = (p[3] << 8) | p[4];
+    _info.components = p[5];
+    if (_info.components == 0 || _info.components > CAMS3_JPEG_MAX_COMPONENTS) return false;
+    if (len < 6 + _info.components * 3) return false;
+
+    _info.maxH = 1;
+    _info.maxV = 1;
+    for (uint8_t i = 0; i < _info.components; i++) {
+        cams3_jpeg_component_t& c = _info.comp[i];
+        c.id                      = p[6 + i * 3];
+        c.h                       = p[7 + i * 3] >> 4;
+        c.v                       = p[7 + i * 3] & 0x0F;
+        c.tq                      = p[8 + i * 3] & 0x03;
+        if (c.h == 0 || c.v == 0 || c.h > 2 || c.v > 2) return false;
+        if (c.h > _info.maxH) _info.maxH = c.h;
+        if (c.v > _info.maxV) _info.maxV = c.v;
+    }
+
+    _info.mcuWidth  = _info.maxH * 8;
+    _info.mcuHeight = _info.maxV * 8;
+    _info.mcusX     = (_info.width + _info.mcuWidth - 1) / _info.mcuWidth;
+    _info.mcusY     = (_info.height + _info.mcuHeight - 1) / _info.mcuHeight;
+    return _info.width > 0 && _info.height > 0;
+}
+
+bool CamS3_JpegDecoder::_parseDHT(const uint8_t* p, uint16_t len) {
+    while (len >= 17) {
+        uint8_t tc = p[0] >> 4;
+        uint8_t th = p[0] & 0x0F;
+        if (tc > 1 || th > 1) return false;
+
+        HuffTable& t  = (tc == 0) ? _dcTables[th] : _acTables[th];
+        uint16_t count = 0;
+        t.bits[0]      = 0;
+        for (int i = 1; i <= 16; i++) {
+            t.bits[i] = p[i];
+            count += p[i];
+        }
+        if (count > 256 || len < 17 + count) return false;
+        memcpy(t.vals, p + 17, count);
+        if (!_buildTable(t)) return false;
+
+        p += 17 + count;
+        len -= 17 + count;
+    }
+    return len == 0;
+}
+
+bool CamS3_JpegDecoder::_parseDQT(const uint8_t* p, uint16_t len) {
+    while (len >= 65) {
+        uint8_t pq = p[0] >> 4;
+        uint8_t tq = p[0] & 0x03;
+        if (pq != 0) return false;  // 16-bit tables are not baseline
+        for (int i = 0; i < 64; i++) {
+            _qt[tq][i] = p[1 + i];
+        }
+        p += 65;
+        len -= 65;
+    }
+    return len == 0;
+}
+
+bool CamS3_JpegDecoder::_parseSOS(const uint8_t* p, uint16_t len) {
+    if (len < 1) return false;
+    uint8_t ns = p[0];
+    // Only single interleaved scans are supported (what the sensor produces)
+    if (ns != _info.components || len < 1 + ns * 2 + 3) return false;
+
+    for (uint8_t i = 0; i < ns; i++) {
+        uint8_t id = p[1 + i * 2];
+        bool found = false;
+        for (uint8_t c = 0; c < _info.components; c++) {
+            if (_info.comp[c].id == id) {
+                _info.comp[c].td = (p[2 + i * 2] >> 4) & 0x01;
+                _info.comp[c].ta = p[2 + i * 2] & 0x01;
+                found            = true;
+            }
+        }
+        if (!found) return false;
+    }
+
+    for (uint8_t c = 0; c < _info.components; c++) {
+        if (!_dcTables[_info.comp[c].td].defined || !_acTables[_info.comp[c].ta].defined) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CamS3_JpegDecoder::_buildTable(HuffTable& t) {
+    int32_t code = 0;
+    int k        = 0;
+
+    memset(t.lookup, 0, sizeof(t.lookup));
+    for (int len = 1; len <= 16; len++) {
+        t.valptr[len]  = k;
+        t.mincode[len] = code;
+        for (int i = 0; i < t.bits[len]; i++) {
+            // More codes than fit in len bits (the all-ones code is reserved)
+            if (code + 1 >= (1 << len)) return false;
+            if (len <= 9) {
+                int shift   = 9 - len;
+                int first   = code << shift;
+                uint16_t e  = (len << 8) | t.vals[k];
+                for (int j = 0; j < (1 << shift); j++) {
+                    t.lookup[first + j] = e;
+                }
+            }
+            code++;
+            k++;
+        }
+        t.maxcode[len] = t.bits[len] ? code - 1 : -1;
+        code <<= 1;
+    }
+    t.maxcode[17] = 0x7FFFFFFF;
+    t.defined     = true;
+    return true;
+}
+
+// ============================================
+// Entropy Decoding
+// ============================================
+
+int CamS3_JpegDecoder::_decodeHuff(BitReader& br, const HuffTable& t) {
+    if (br.bits < 16) br.fill();
+
+    uint16_t e = t.lookup[br.acc >> 23];
+    if (e) {
+        br.acc <<= (e >> 8);
+        br.bits -= (e >> 8);
+        return e & 0xFF;
+    }
+
+    for (int len = 10; len <= 16; len++) {
+        int32_t code = br.acc >> (32 - len);
+        if (code <= t.maxcode[len]) {
+            br.acc <<= len;
+            br.bits -= len;
+            return t.vals[t.valptr[len] + code - t.mincode[len]];
+        }
+    }
+    return -1;  // Corrupt data
+}
+
+static inline int32_t extendBits(uint32_t v, int s) {
+    return (v < (1u << (s - 1))) ? (int32_t)v - (1 << s) + 1 : (int32_t)v;
+}
+
+bool CamS3_JpegDecoder::_decodeBlock(BitReader& br, uint8_t comp, int16_t* coef, int16_t& pred) {
+    const cams3_jpeg_component_t& c = _info.comp[comp];
+
+    int s = _decodeHuff(br, _dcTables[c.td]);
+    if (s < 0 || s > 11) return false;
+    int32_t diff = s ? extendBits(br.get(s), s) : 0;
+    pred += diff;
+
+    if (coef) {
+        memset(coef, 0, 64 * sizeof(int16_t));
+        coef[0] = pred;
+    }
+
+    const HuffTable& ac = _acTables[c.ta];
+    for (int k = 1; k < 64;) {
+        int rs = _decodeHuff(br, ac);
+        if (rs < 0) return false;
+        int r = rs >> 4;
+        s     = rs & 0x0F;
+        if (s == 0) {
+            if (r != 15) break;  // EOB
+            k += 16;             // ZRL
+            continue;
+        }
+        k += r;
+        if (k > 63) return false;
+        uint32_t v = br.get(s);
+        if (coef) {
+            coef[k] = extendBits(v, s);
+        }
+        k++;
+    }
+    return true;
+}
+
+// ============================================
+// DC Image
+// ============================================
+
+uint16_t CamS3_JpegDecoder::getDCWidth() {
+    if (!_valid) return 0;
+    uint32_t lumaWidth = (_info.width * _info.comp[0].h + _info.maxH - 1) / _info.maxH;
+    return (lumaWidth + 7) / 8;
+}
+
+uint16_t CamS3_JpegDecoder::getDCHeight() {
+    if (!_valid) return 0;
+    uint32_t lumaHeight = (_info.height * _info.comp[0].v + _info.maxV - 1) / _info.maxV;
+    return (lumaHeight + 7) / 8;
+}
+
+bool CamS3_JpegDecoder::decodeDC(uint8_t* luma, size_t size) {
+    return _decodeDCImage(luma, size, false);
+}
+
+bool CamS3_JpegDecoder::decodeDCColor(uint8_t* bgr, size_t size) {
+    return _decodeDCImage(bgr, size, true);
+}
+
+static inline uint8_t clamp8(int32_t v) {
+    return (v < 0) ? 0 : (v > 255) ? 255 : v;
+}
+
+bool CamS3_JpegDecoder::_decodeDCImage(uint8_t* out, size_t size, bool color, uint32_t* rowBytes) {
+    if (!_valid || !out) return false;
+
+    const uint16_t dcW = getDCWidth();
+    const uint16_t dcH = getDCHeight();
+    const size_t bpp   = color ? 3 : 1;
+    if (size < (size_t)dcW * dcH * bpp) return false;
+
+    BitReader br;
+    br.reset(_data + _scanOffset, _data + _len);
+    memset(_pred, 0, sizeof(_pred));
+
+    const uint8_t h0 = _info.comp[0].h;
+    const uint8_t v0 = _info.comp[0].v;
+    int32_t q[CAMS3_JPEG_MAX_COMPONENTS];
+    for (uint8_t c = 0; c < _info.components; c++) {
+        q[c] = _qt[_info.comp[c].tq][0];
+    }
+    const bool hasChroma = color && _info.components == 3;
+
+    // DC / 8 is the block average, +128 undoes the level shift
+    uint8_t blockAvg[CAMS3_JPEG_MAX_COMPONENTS][4];
+    uint32_t mcuCount  = 0;
+    uint32_t totalMcus = (uint32_t)_info.mcusX * _info.mcusY;
+    uint32_t rowStart  = 0;
+
+    for (uint16_t my = 0; my < _info.mcusY; my++) {
+        for (uint16_t mx = 0; mx < _info.mcusX; mx++) {
+            if (_info.restartInterval && mcuCount && (mcuCount % _info.restartInterval) == 0) {
+                if (!br.restart()) return false;
+                memset(_pred, 0, sizeof(_pred));
+            }
+
+            for (uint8_t c = 0; c < _info.components; c++) {
+                const cams3_jpeg_component_t& comp = _info.comp[c];
+                for (uint8_t b = 0; b < comp.h * comp.v; b++) {
+                    if (!_decodeBlock(br, c, nullptr, _pred[c])) return false;
+                    blockAvg[c][b] = clamp8(((_pred[c] * q[c]) >> 3) + 128);
+                }
+            }
+
+            for (uint8_t by = 0; by < v0; by++) {
+                for (uint8_t bx = 0; bx < h0; bx++) {
+                    uint32_t x = mx * h0 + bx;
+                    uint32_t y = my * v0 + by;
+                    if (x >= dcW || y >= dcH) continue;
+
+                    int32_t Y = blockAvg[0][by * h0 + bx];
+                    if (!color) {
+                        out[y * dcW + x] = Y;
+                        continue;
+                    }
+
+                    uint8_t* px = out + (y * dcW + x) * 3;
+                    if (!hasChroma) {
+                        px[0] = px[1] = px[2] = Y;
+                        continue;
+                    }
+
+                    // Chroma block covering this luma block
+                    const cams3_jpeg_component_t& c1 = _info.comp[1];
+                    const cams3_jpeg_component_t& c2 = _info.comp[2];
+                    int32_t cb = blockAvg[1][(by * c1.v / v0) * c1.h + bx * c1.h / h0] - 128;
+                    int32_t cr = blockAvg[2][(by * c2.v / v0) * c2.h + bx * c2.h / h0] - 128;
+
+                    px[0] = clamp8(Y + ((454 * cb) >> 8));              // B = Y + 1.772 Cb
+                    px[1] = clamp8(Y - ((88 * cb + 183 * cr) >> 8));    // G = Y - 0.344 Cb - 0.714 Cr
+                    px[2] = clamp8(Y + ((359 * cr) >> 8));              // R = Y + 1.402 Cr
+                }
+            }
+            mcuCount++;
+        }
+
+        if (rowBytes) {
+            // Scan bytes consumed so far, less those still buffered in the accumulator
+            uint32_t pos = (br.p - (_data + _scanOffset)) - br.bits / 8;
+            if (pos < rowStart) pos = rowStart;  // Zeros fed past the end of the scan
+            rowBytes[my] = pos - rowStart;
+            rowStart     = pos;
+        }
+    }
+    return mcuCount == totalMcus;
+}
+
+// ============================================
+// Region Decoding
+// ============================================
+
+bool CamS3_JpegDecoder::buildIndex() {
+    if (!_valid) return false;
+    if (_indexed) return true;
+
+    const uint32_t totalMcus = (uint32_t)_info.mcusX * _info.mcusY;
+    const uint8_t* end       = _data + _len;
+    uint32_t count           = _info.restartInterval ? (totalMcus + _info.restartInterval - 1) / _info.restartInterval
+                                                     : _info.mcusY;
+
+    if (count > _indexCap) {
+        SyncPoint* grown = (SyncPoint*)realloc(_index, count * sizeof(SyncPoint));
+        if (!grown) return false;
+        _index    = grown;
+        _indexCap = count;
+    }
+
+    SyncPoint* sp = _index;
+    sp->br.reset(_data + _scanOffset, end);
+    sp->mcu = 0;
+    memset(sp->pred, 0, sizeof(sp->pred));
+
+    if (_info.restartInterval) {
+        // Every interval starts right after an RSTn marker with zeroed predictors
+        const uint8_t* p = _data + _scanOffset;
+        uint32_t n       = 1;
+        while (n < count && p + 1 < end) {
+            p = (const uint8_t*)memchr(p, 0xFF, end - p - 1);
+            if (!p) break;
+            if (p[1] >= JPEG_RST0 && p[1] <= JPEG_RST0 + 7) {
+                sp = &_index[n];
+                sp->br.reset(p + 2, end);
+                sp->mcu = n * _info.restartInterval;
+                memset(sp->pred, 0, sizeof(sp->pred));
+                n++;
+                p += 2;
+            } else {
+                p++;
+            }
+        }
+        if (n < count) return false;
+    } else {
+        // No restart markers: skim the entropy data once and snapshot each MCU row
+        BitReader br = sp->br;
+        int16_t pred[CAMS3_JPEG_MAX_COMPONENTS] = {0};
+        for (uint16_t my = 0; my < _info.mcusY; my++) {
+            sp      = &_index[my];
+            sp->br  = br;
+            sp->mcu = (uint32_t)my * _info.mcusX;
+            memcpy(sp->pred, pred, sizeof(pred));
+            for (uint16_t mx = 0; mx < _info.mcusX; mx++) {
+                for (uint8_t c = 0; c < _info.components; c++) {
+                    for (uint8_t b = 0; b < _info.comp[c].h * _info.comp[c].v; b++) {
+                        if (!_decodeBlock(br, c, nullptr, pred[c])) return false;
+                    }
+                }
+            }
+        }
+    }
+
+    _indexCount = count;
+    _indexed    = true;
+    return true;
+}
+
+// Integer inverse DCT (the IJG "islow" algorithm) with dequantization, level shift and clamping
+#define IDCT_CONST_BITS 13
+#define IDCT_PASS1_BITS 2
+#define IDCT_DESCALE(x, n) (((x) + (1 << ((n) - 1))) >> (n))
+
+static void inverseDCT(const int16_t* zz, const uint16_t* qt, uint8_t* out) {
+    int32_t ws[64];
+    int32_t in[64];
+    memset(in, 0, sizeof(in));
+    for (int k = 0; k < 64; k++) {
+        if (zz[k]) in[kZigzag[k]] = zz[k] * qt[k];
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        const int32_t* src = pass ? ws : in;
+        for (int i = 0; i < 8; i++) {
+            // Pass 1 works on columns, pass 2 on rows
+            const int32_t* d = pass ? src + i * 8 : src + i;
+            const int step   = pass ? 1 : 8;
+
+            int32_t z2   = d[2 * step];
+            int32_t z3   = d[6 * step];
+            int32_t z1   = (z2 + z3) * 4433;
+            int32_t tmp2 = z1 - z3 * 15137;
+            int32_t tmp3 = z1 + z2 * 6270;
+
+            z2           = d[0];
+            z3           = d[4 * step];
+            int32_t tmp0 = (z2 + z3) << IDCT_CONST_BITS;
+            int32_t tmp1 = (z2 - z3) << IDCT_CONST_BITS;
+
+            int32_t tmp10 = tmp0 + tmp3;
+            int32_t tmp13 = tmp0 - tmp3;
+            int32_t tmp11 = tmp1 + tmp2;
+            int32_t tmp12 = tmp1 - tmp2;
+
+            tmp0       = d[7 * step];
+            tmp1       = d[5 * step];
+            tmp2       = d[3 * step];
+            tmp3       = d[1 * step];
+            z1         = tmp0 + tmp3;
+            z2         = tmp1 + tmp2;
+            z3         = tmp0 + tmp2;
+            int32_t z4 = tmp1 + tmp3;
+            int32_t z5 = (z3 + z4) * 9633;
+
+            tmp0 *= 2446;
+            tmp1 *= 16819;
+            tmp2 *= 25172;
+            tmp3 *= 12299;
+            z1 *= -7373;
+            z2 *= -20995;
+            z3 = z3 * -16069 + z5;
+            z4 = z4 * -3196 + z5;
+
+            tmp0 += z1 + z3;
+            tmp1 += z2 + z4;
+            tmp2 += z2 + z3;
+            tmp3 += z1 + z4;
+
+            int32_t r[8] = {tmp10 + tmp3, tmp11 + tmp2, tmp12 + tmp1, tmp13 + tmp0,
+                            tmp13 - tmp0, tmp12 - tmp1, tmp11 - tmp2, tmp10 - tmp3};
+            if (pass) {
+                for (int j = 0; j < 8; j++) {
+                    out[i * 8 + j] = clamp8(IDCT_DESCALE(r[j], IDCT_CONST_BITS + IDCT_PASS1_BITS + 3) + 128);
+                }
+            } else {
+                for (int j = 0; j < 8; j++) {
+                    ws[j * 8 + i] = IDCT_DESCALE(r[j], IDCT_CONST_BITS - IDCT_PASS1_BITS);
+                }
+            }
+        }
+    }
+}
+
+void CamS3_JpegDecoder::_renderMCU(const Region& r, uint16_t mx, uint16_t my, int16_t (*coef)[64]) {
+    uint8_t pix[CAMS3_JPEG_MAX_COMPONENTS * 4][64];
+    uint8_t base[CAMS3_JPEG_MAX_COMPONENTS];
+    const uint8_t comps = (r.color && _info.components == 3) ? 3 : 1;
+
+    uint8_t blk = 0;
+    for (uint8_t c = 0; c < _info.components; c++) {
+        base[c]       = blk;
+        uint8_t count = _info.comp[c].h * _info.comp[c].v;
+        if (c < comps) {
+            for (uint8_t b = 0; b < count; b++) {
+                inverseDCT(coef[blk + b], _qt[_info.comp[c].tq], pix[blk + b]);
+            }
+        }
+        blk += count;
+    }
+
+    // Part of this MCU inside the region
+    const int32_t px0 = mx * _info.mcuWidth;
+    const int32_t py0 = my * _info.mcuHeight;
+    const int32_t lx0 = (r.x > px0) ? r.x - px0 : 0;
+    const int32_t ly0 = (r.y > py0) ? r.y - py0 : 0;
+    const int32_t lx1 = (r.x + r.w < px0 + _info.mcuWidth) ? r.x + r.w - px0 : _info.mcuWidth;
+    const int32_t ly1 = (r.y + r.h < py0 + _info.mcuHeight) ? r.y + r.h - py0 : _info.mcuHeight;
+    const size_t bpp  = r.color ? 3 : 1;
+
+    for (int32_t ly = ly0; ly < ly1; ly++) {
+        uint8_t* dst = r.out + ((size_t)(py0 + ly - r.y) * r.w + (px0 + lx0 - r.x)) * bpp;
+        for (int32_t lx = lx0; lx < lx1; lx++) {
+            int32_t s[CAMS3_JPEG_MAX_COMPONENTS];
+            for (uint8_t c = 0; c < comps; c++) {
+                const cams3_jpeg_component_t& comp = _info.comp[c];
+                int32_t cx                         = lx * comp.h / _info.maxH;
+                int32_t cy                         = ly * comp.v / _info.maxV;
+                s[c] = pix[base[c] + (cy >> 3) * comp.h + (cx >> 3)][(cy & 7) * 8 + (cx & 7)];
+            }
+
+            if (!r.color) {
+                *dst++ = s[0];
+            } else if (comps == 1) {
+                dst[0] = dst[1] = dst[2] = s[0];
+                dst += 3;
+            } else {
+                int32_t cb = s[1] - 128;
+                int32_t cr = s[2] - 128;
+                dst[0]     = clamp8(s[0] + ((116130 * cb) >> 16));
+                dst[1]     = clamp8(s[0] - ((22554 * cb + 46802 * cr) >> 16));
+                dst[2]     = clamp8(s[0] + ((91881 * cr) >> 16));
+                dst += 3;
+            }
+        }
+    }
+}
+
+bool CamS3_JpegDecoder::_segmentHits(const Region& r, uint32_t seg) {
+    uint32_t first = _index[seg].mcu;
+    uint32_t last  = (seg + 1 < _indexCount) ? _index[seg + 1].mcu - 1 : (uint32_t)_info.mcusX * _info.mcusY - 1;
+    uint32_t rowA  = first / _info.mcusX;
+    uint32_t rowB  = last / _info.mcusX;
+    if (rowB < r.my0 || rowA > r.my1) return false;
+    if (rowB > rowA + 1) return true;  // Spans a whole row
+
+    uint32_t colA = first % _info.mcusX;
+    uint32_t colB = last % _info.mcusX;
+    if (rowA == rowB) return colB >= r.mx0 && colA <= r.mx1;
+    // Tail of rowA and head of rowB
+    return (rowA >= r.my0 && r.mx1 >= colA) || (rowB <= r.my1 && r.mx0 <= colB);
+}
+
+bool CamS3_JpegDecoder::_decodeSegments(const Region& r, uint32_t firstSeg, uint32_t lastSeg) {
+    int16_t coef[CAMS3_JPEG_MAX_COMPONENTS * 4][64];
+    const uint32_t totalMcus = (uint32_t)_info.mcusX * _info.mcusY;
+    const uint32_t lastMcu   = (uint32_t)r.my1 * _info.mcusX + r.mx1;
+    const uint8_t comps      = r.color ? _info.components : 1;
+
+    for (uint32_t seg = firstSeg; seg <= lastSeg; seg++) {
+        if (!_segmentHits(r, seg)) continue;
+
+        const SyncPoint& sp = _index[seg];
+        BitReader br        = sp.br;
+        int16_t pred[CAMS3_JPEG_MAX_COMPONENTS];
+        memcpy(pred, sp.pred, sizeof(pred));
+
+        uint32_t end = (seg + 1 < _indexCount) ? _index[seg + 1].mcu : totalMcus;
+        if (end > lastMcu + 1) end = lastMcu + 1;
+
+        for (uint32_t mcu = sp.mcu; mcu < end; mcu++) {
+            uint16_t mx = mcu % _info.mcusX;
+            uint16_t my = mcu / _info.mcusX;
+            bool inside = mx >= r.mx0 && mx <= r.mx1 && my >= r.my0 && my <= r.my1;
+
+            // Blocks outside the region are only entropy-decoded to keep the bit position
+            uint8_t blk = 0;
+            for (uint8_t c = 0; c < _info.components; c++) {
+                for (uint8_t b = 0; b < _info.comp[c].h * _info.comp[c].v; b++, blk++) {
+                    int16_t* dst = (inside && c < comps) ? coef[blk] : nullptr;
+                    if (!_decodeBlock(br, c, dst, pred[c])) return false;
+                }
+            }
+            if (inside) {
+                _renderMCU(r, mx, my, coef);
+            }
+        }
+    }
+    return true;
+}
+
+void CamS3_JpegDecoder::_regionTask(void* arg) {
+    RegionJob* job = (RegionJob*)arg;
+    job->ok        = job->dec->_decodeSegments(*job->region, job->firstSeg, job->lastSeg);
+    xSemaphoreGive(job->done);
+    vTaskDelete(nullptr);
+}
+
+bool CamS3_JpegDecoder::decodeRegion(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t* out, size_t size,
+                                     bool color, uint8_t bands) {
+    if (!_valid || !out || w == 0 || h == 0) return false;
+    if ((uint32_t)x + w > _info.width || (uint32_t)y + h > _info.height) return false;
+    if (size < (size_t)w * h * (color ? 3 : 1)) return false;
+    if (!buildIndex()) return false;
+
+    Region r;
+    r.x     = x;
+    r.y     = y;
+    r.w     = w;
+    r.h     = h;
+    r.mx0   = x / _info.mcuWidth;
+    r.my0   = y / _info.mcuHeight;
+    r.mx1   = (x + w - 1) / _info.mcuWidth;
+    r.my1   = (y + h - 1) / _info.mcuHeight;
+    r.out   = out;
+    r.color = color;
+
+    // Resume points covering the first and last MCU of the region
+    const uint32_t firstMcu = (uint32_t)r.my0 * _info.mcusX + r.mx0;
+    const uint32_t lastMcu  = (uint32_t)r.my1 * _info.mcusX + r.mx1;
+    const uint32_t per      = _info.restartInterval ? _info.restartInterval : _info.mcusX;
+    const uint32_t firstSeg = firstMcu / per;
+    const uint32_t lastSeg  = lastMcu / per;
+
+    if (bands < 1) bands = 1;
+    if (bands > CAMS3_JPEG_MAX_BANDS) bands = CAMS3_JPEG_MAX_BANDS;
+    if (bands > lastSeg - firstSeg + 1) bands = lastSeg - firstSeg + 1;
+
+    RegionJob job[CAMS3_JPEG_MAX_BANDS];
+    const uint32_t segs = lastSeg - firstSeg + 1;
+    for (uint8_t i = 0; i < bands; i++) {
+        job[i].dec      = this;
+        job[i].region   = &r;
+        job[i].firstSeg = firstSeg + segs * i / bands;
+        job[i].lastSeg  = firstSeg + segs * (i + 1) / bands - 1;
+        job[i].ok       = false;
+        job[i].done     = nullptr;
+    }
+
+    // Jobs 1.. on the other core, job 0 on the calling task
+    const BaseType_t otherCore = xPortGetCoreID() ^ 1;
+    for (uint8_t i = 1; i < bands; i++) {
+        job[i].done = xSemaphoreCreateBinary();
+        if (!job[i].done ||
+            xTaskCreatePinnedToCore(_regionTask, "cams3_jpegdec", 6144, &job[i], uxTaskPriorityGet(nullptr), nullptr,
+                                    otherCore) != pdPASS) {
+            if (job[i].done) vSemaphoreDelete(job[i].done);
+            job[i].done = nullptr;
+        }
+    }
+    job[0].ok = _decodeSegments(r, job[0].firstSeg, job[0].lastSeg);
+
+    bool ok = job[0].ok;
+    for (uint8_t i = 1; i < bands; i++) {
+        if (job[i].done) {
+            xSemaphoreTake(job[i].done, portMAX_DELAY);
+            vSemaphoreDelete(job[i].done);
+        } else {
+            job[i].ok = _decodeSegments(r, job[i].firstSeg, job[i].lastSeg);
+        }
+        ok = ok && job[i].ok;
+    }
+    return ok;
+}
+
+// ============================================
+// Encoder Tables
+// ============================================
+
+// ITU T.81 Annex K quantization tables (natural order)
+static const uint8_t kLumaQuant[64] = {
+    16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+    14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+    18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+
+static const uint8_t kChromaQuant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99,
+    99, 99, 47, 66, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99};
+
+// ITU T.81 Annex K Huffman tables: code counts per length 1-16, then symbols
+static const uint8_t kDCLumaBits[16]   = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t kDCChromaBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t kDCVals[12]       = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t kACLumaBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t kACLumaVals[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+    0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83,
+    0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+    0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+static const uint8_t kACChromaBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t kACChromaVals[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22,
+    0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1,
+    0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36,
+    0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a,
+    0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a,
+    0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba,
+    0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+static cams3_jpeg_huffcode_t sDCTables[2];
+static cams3_jpeg_huffcode_t sACTables[2];
+static bool sTablesBuilt = false;
+
+static void buildEncTable(cams3_jpeg_huffcode_t& t, const uint8_t* bits, const uint8_t* vals) {
+    memset(&t, 0, sizeof(t));
+    uint16_t code = 0;
+    int k         = 0;
+    for (int len = 1; len <= 16; len++) {
+        for (int i = 0; i < bits[len - 1]; i++) {
+            t.code[vals[k]] = code++;
+            t.size[vals[k]] = len;
+            k++;
+        }
+        code <<= 1;
+    }
+}
+
+static void buildEncTables() {
+    if (sTablesBuilt) return;
+    buildEncTable(sDCTables[0], kDCLumaBits, kDCVals);
+    buildEncTable(sDCTables[1], kDCChromaBits, kDCVals);
+    buildEncTable(sACTables[0], kACLumaBits, kACLumaVals);
+    buildEncTable(sACTables[1], kACChromaBits, kACChromaVals);
+    sTablesBuilt = true;
+}
+
+// ============================================
+// Bit Writer
+// ============================================
+
+void CamS3_JpegEncoder::BitWriter::reset(uint8_t* start, uint8_t* stop) {
+    p        = start;
+    end      = stop;
+    acc      = 0;
+    bits     = 0;
+    overflow = false;
+}
+
+void CamS3_JpegEncoder::BitWriter::put(uint32_t code, int size) {
+    acc = (acc << size) | (code & ((1u << size) - 1));
+    bits += size;
+    while (bits >= 8) {
+        bits -= 8;
+        uint8_t b = acc >> bits;
+        if (p + 2 > end) {
+            overflow = true;
+            return;
+        }
+        *p++ = b;
+        if (b == 0xFF) *p++ = 0x00;  // Byte stuffing
+    }
+}
+
+void CamS3_JpegEncoder::BitWriter::flush() {
+    // Pad the last byte with 1 bits
+    if (bits > 0) put(0x7F, 8 - bits);
+    acc  = 0;
+    bits = 0;
+}
+
+void CamS3_JpegEncoder::BitWriter::marker(uint8_t m) {
+    if (p + 2 > end) {
+        overflow = true;
+        return;
+    }
+    *p++ = 0xFF;
+    *p++ = m;
+}
+
+// ============================================
+// Forward DCT
+// ============================================
+
+// Integer forward DCT (the IJG "islow" algorithm), output scaled up by 8
+#define DCT_CONST_BITS 13
+#define DCT_PASS1_BITS 2
+#define DCT_DESCALE(x, n) (((x) + (1 << ((n) - 1))) >> (n))
+
+static void forwardDCT(int32_t* data) {
+    for (int pass = 0; pass < 2; pass++) {
+        const int step   = pass ? 8 : 1;   // Distance between samples
+        const int stride = pass ? 1 : 8;   // Distance between rows/columns
+        const int shift  = pass ? DCT_CONST_BITS + DCT_PASS1_BITS : DCT_CONST_BITS - DCT_PASS1_BITS;
+
+        for (int i = 0; i < 8; i++) {
+            int32_t* d   = data + i * stride;
+            int32_t tmp0 = d[0 * step] + d[7 * step];
+            int32_t tmp7 = d[0 * step] - d[7 * step];
+            int32_t tmp1 = d[1 * step] + d[6 * step];
+            int32_t tmp6 = d[1 * step] - d[6 * step];
+            int32_t tmp2 = d[2 * step] + d[5 * step];
+            int32_t tmp5 = d[2 * step] - d[5 * step];
+            int32_t tmp3 = d[3 * step] + d[4 * step];
+            int32_t tmp4 = d[3 * step] - d[4 * step];
+
+            int32_t tmp10 = tmp0 + tmp3;
+            int32_t tmp13 = tmp0 - tmp3;
+            int32_t tmp11 = tmp1 + tmp2;
+            int32_t tmp12 = tmp1 - tmp2;
+
+            if (pass) {
+                d[0 * step] = DCT_DESCALE(tmp10 + tmp11, DCT_PASS1_BITS);
+                d[4 * step] = DCT_DESCALE(tmp10 - tmp11, DCT_PASS1_BITS);
+            } else {
+                d[0 * step] = (tmp10 + tmp11) << DCT_PASS1_BITS;
+                d[4 * step] = (tmp10 - tmp11) << DCT_PASS1_BITS;
+            }
+
+            int32_t z1  = (tmp12 + tmp13) * 4433;
+            d[2 * step] = DCT_DESCALE(z1 + tmp13 * 6270, shift);
+            d[6 * step] = DCT_DESCALE(z1 - tmp12 * 15137, shift);
+
+            z1         = tmp4 + tmp7;
+            int32_t z2 = tmp5 + tmp6;
+            int32_t z3 = tmp4 + tmp6;
+            int32_t z4 = tmp5 + tmp7;
+            int32_t z5 = (z3 + z4) * 9633;
+
+            tmp4 *= 2446;
+            tmp5 *= 16819;
+            tmp6 *= 25172;
+            tmp7 *= 12299;
+            z1 *= -7373;
+            z2 *= -20995;
+            z3 = z3 * -16069 + z5;
+            z4 = z4 * -3196 + z5;
+
+            d[7 * step] = DCT_DESCALE(tmp4 + z1 + z3, shift);
+            d[5 * step] = DCT_DESCALE(tmp5 + z2 + z4, shift);
+            d[3 * step] = DCT_DESCALE(tmp6 + z2 + z3, shift);
+            d[1 * step] = DCT_DESCALE(tmp7 + z1 + z4, shift);
+        }
+    }
+}
+
+// ============================================
+// CamS3_JpegEncoder Implementation
+// ============================================
+
+void CamS3_JpegEncoder::_setQuality(uint8_t quality) {
+    if (quality < 1) quality = 1;
+    if (quality > 100) quality = 100;
+
+    // IJG quality scaling
+    int32_t scale = (quality < 50) ? 5000 / quality : 200 - quality * 2;
+    for (int t = 0; t < 2; t++) {
+        const uint8_t* base = t ? kChromaQuant : kLumaQuant;
+        for (int k = 0; k < 64; k++) {
+            int32_t q = (base[kZigzag[k]] * scale + 50) / 100;
+            q         = (q < 1) ? 1 : (q > 255) ? 255 : q;
+            _qt[t][k] = q;
+            _recip[t][kZigzag[k]] = 65536 / (q * 8);
+        }
+    }
+}
+
+static inline uint8_t* put16BE(uint8_t* p, uint16_t v) {
+    *p++ = v >> 8;
+    *p++ = v;
+    return p;
+}
+
+// Annex K tables as DHT segments: luma DC/AC, then chroma DC/AC
+static uint8_t* writeStandardDHT(uint8_t* p, int tables) {
+    const uint8_t* bits[4] = {kDCLumaBits, kACLumaBits, kDCChromaBits, kACChromaBits};
+    const uint8_t* vals[4] = {kDCVals, kACLumaVals, kDCVals, kACChromaVals};
+    const uint8_t ids[4]   = {0x00, 0x10, 0x01, 0x11};
+    for (int t = 0; t < tables; t++) {
+        int count = 0;
+        for (int i = 0; i < 16; i++) count += bits[t][i];
+        *p++ = 0xFF;
+        *p++ = JPEG_DHT;
+        p    = put16BE(p, 2 + 1 + 16 + count);
+        *p++ = ids[t];
+        memcpy(p, bits[t], 16);
+        p += 16;
+        memcpy(p, vals[t], count);
+        p += count;
+    }
+    return p;
+}
+
+static uint8_t* writeJFIF(uint8_t* p) {
+    static const uint8_t jfif[] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+    *p++                        = 0xFF;
+    *p++                        = JPEG_SOI;
+    *p++                        = 0xFF;
+    *p++                        = JPEG_APP0;
+    p                           = put16BE(p, 2 + sizeof(jfif));
+    memcpy(p, jfif, sizeof(jfif));
+    return p + sizeof(jfif);
+}
+
+size_t CamS3_JpegEncoder::_writeHeaders(uint8_t* out) {
+    uint8_t* p = writeJFIF(out);
+
+    *p++ = 0xFF;
+    *p++ = JPEG_DQT;
+    p    = put16BE(p, 2 + 2 * 65);
+    for (int t = 0; t < 2; t++) {
+        *p++ = t;
+        memcpy(p, _qt[t], 64);
+        p += 64;
+    }
+
+    // Y 2x2, Cb and Cr 1x1 (4:2:0)
+    *p++ = 0xFF;
+    *p++ = JPEG_SOF0;
+    p    = put16BE(p, 17);
+    *p++ = 8;
+    p    = put16BE(p, _height);
+    p    = put16BE(p, _width);
+    *p++ = 3;
+    static const uint8_t comps[] = {1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1};
+    memcpy(p, comps, sizeof(comps));
+    p += sizeof(comps);
+
+    p = writeStandardDHT(p, 4);
+
+    // One restart interval per MCU row, so every band starts on a marker
+    *p++ = 0xFF;
+    *p++ = JPEG_DRI;
+    p    = put16BE(p, 4);
+    p    = put16BE(p, _mcusX);
+
+    static const uint8_t sos[] = {3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0};
+    *p++                       = 0xFF;
+    *p++                       = JPEG_SOS;
+    p                          = put16BE(p, 2 + sizeof(sos));
+    memcpy(p, sos, sizeof(sos));
+    p += sizeof(sos);
+
+    return p - out;
+}
+
+void CamS3_JpegEncoder::_loadMCU(uint16_t mx, uint16_t my, int32_t* blocks) {
+    // blocks: Y0 Y1 Y2 Y3 Cb Cr, level shifted
+    int32_t sumR[64] = {0};
+    int32_t sumG[64] = {0};
+    int32_t sumB[64] = {0};
+
+    const uint32_t x0 = mx * 16;
+    const uint32_t y0 = my * 16;
+    for (int y = 0; y < 16; y++) {
+        uint32_t sy        = y0 + y;
+        if (sy >= _height) sy = _height - 1;  // Replicate the bottom edge
+        const uint8_t* row = _src + sy * _width * 2;
+        int32_t* yBlock    = blocks + ((y >> 3) * 2) * 64 + (y & 7) * 8;
+
+        for (int x = 0; x < 16; x++) {
+            uint32_t sx = x0 + x;
+            if (sx >= _width) sx = _width - 1;  // Replicate the right edge
+
+            // Big-endian RGB565, expanded to 8 bits per channel
+            uint8_t hi = row[sx * 2];
+            uint8_t lo = row[sx * 2 + 1];
+            int32_t r  = (hi & 0xF8) | (hi >> 5);
+            int32_t g  = ((hi & 0x07) << 5) | ((lo >> 3) & 0x1C) | ((hi >> 1) & 0x03);
+            int32_t b  = ((lo & 0x1F) << 3) | ((lo >> 2) & 0x07);
+
+            yBlock[(x >> 3) * 64 + (x & 7)] = ((77 * r + 150 * g + 29 * b + 128) >> 8) - 128;
+
+            int c = (y >> 1) * 8 + (x >> 1);
+            sumR[c] += r;
+            sumG[c] += g;
+            sumB[c] += b;
+        }
+    }
+
+    // 2x2 averaged chroma, already centered on zero
+    for (int i = 0; i < 64; i++) {
+        blocks[4 * 64 + i] = (-43 * sumR[i] - 85 * sumG[i] + 128 * sumB[i] + 512) >> 10;
+        blocks[5 * 64 + i] = (128 * sumR[i] - 107 * sumG[i] - 21 * sumB[i] + 512) >> 10;
+    }
+}
+
+void CamS3_JpegEncoder::_writeBlock(BitWriter& bw, const int32_t* zz, const cams3_jpeg_huffcode_t& dc,
+                                    const cams3_jpeg_huffcode_t& ac, int32_t& pred) {
+    int32_t diff = zz[0] - pred;
+    pred         = zz[0];
+    uint32_t mag = diff < 0 ? -diff : diff;
+    int nbits    = mag ? 32 - __builtin_clz(mag) : 0;
+    bw.put(dc.code[nbits], dc.size[nbits]);
+    if (nbits) bw.put(diff < 0 ? diff - 1 : diff, nbits);
+
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        int32_t v = zz[k];
+        if (v == 0) {
+            run++;
+            continue;
+        }
+        while (run > 15) {
+            bw.put(ac.code[0xF0], ac.size[0xF0]);  // ZRL
+            run -= 16;
+        }
+        mag     = v < 0 ? -v : v;
+        nbits   = 32 - __builtin_clz(mag);
+        int sym = (run << 4) | nbits;
+        bw.put(ac.code[sym], ac.size[sym]);
+        bw.put(v < 0 ? v - 1 : v, nbits);
+        run = 0;
+    }
+    if (run) bw.put(ac.code[0x00], ac.size[0x00]);  // EOB
+}
+
+void CamS3_JpegEncoder::_encodeBlock(BitWriter& bw, int32_t* block, uint8_t table, int32_t& pred) {
+    forwardDCT(block);
+
+    // Quantize in zigzag order
+    const uint16_t* recip = _recip[table];
+    int32_t zz[64];
+    for (int k = 0; k < 64; k++) {
+        int n     = kZigzag[k];
+        int32_t c = block[n];
+        if (c < 0) {
+            zz[k] = -(int32_t)(((uint32_t)-c * recip[n] + 32768) >> 16);
+        } else {
+            zz[k] = (int32_t)(((uint32_t)c * recip[n] + 32768) >> 16);
+        }
+    }
+    _writeBlock(bw, zz, sDCTables[table], sACTables[table], pred);
+}
+
+void CamS3_JpegEncoder::_encodeBand(Band& band) {
+    BitWriter bw;
+    bw.reset(band.out, band.out + band.cap);
+    int32_t blocks[6 * 64];
+
+    for (uint16_t my = band.firstRow; my < band.lastRow && !bw.overflow; my++) {
+        int32_t pred[3] = {0, 0, 0};
+        for (uint16_t mx = 0; mx < _mcusX; mx++) {
+            _loadMCU(mx, my, blocks);
+            for (int b = 0; b < 4; b++) {
+                _encodeBlock(bw, blocks + b * 64, 0, pred[0]);
+            }
+            _encodeBlock(bw, blocks + 4 * 64, 1, pred[1]);
+            _encodeBlock(bw, blocks + 5 * 64, 1, pred[2]);
+        }
+        bw.flush();
+        if (my + 1 < _mcusY) {
+            bw.marker(JPEG_RST0 + (my & 7));
+        }
+    }
+
+    band.len = bw.p - band.out;
+    band.ok  = !bw.overflow;
+}
+
+void CamS3_JpegEncoder::_bandTask(void* arg) {
+    Band* band = (Band*)arg;
+    band->enc->_encodeBand(*band);
+    xSemaphoreGive(band->done);
+    vTaskDelete(nullptr);
+}
+
+// Output bytes per MCU in a band's slot: typical frames stay near 8 bits per pixel, and the budget
+// doubles on overflow up to the worst case of six blocks of a 16-bit DC code + 11 bits and 63 AC
+// codes of 16 + 10 bits, doubled for 0xFF stuffing.
+static const size_t kTypicalMcuBytes = 256;
+static const size_t kWorstMcuBytes   = (6 * (16 + 11 + 63 * (16 + 10)) + 7) / 8 * 2;
+
+bool CamS3_JpegEncoder::_encodeBands(uint8_t* buf, size_t headerLen, size_t rowCap, uint8_t bands, size_t& len) {
+    // Every band gets its own slice of one output buffer
+    Band band[CAMS3_JPEG_MAX_BANDS];
+    uint8_t* slice = buf + headerLen;
+    for (uint8_t i = 0; i < bands; i++) {
+        band[i].enc      = this;
+        band[i].firstRow = (uint32_t)_mcusY * i / bands;
+        band[i].lastRow  = (uint32_t)_mcusY * (i + 1) / bands;
+        band[i].out      = slice;
+        band[i].cap      = rowCap * (band[i].lastRow - band[i].firstRow);
+        band[i].len      = 0;
+        band[i].ok       = false;
+        band[i].done     = nullptr;
+        slice += band[i].cap;
+    }
+
+    // Bands 1.. on the other core, band 0 on the calling task
+    const BaseType_t otherCore = xPortGetCoreID() ^ 1;
+    for (uint8_t i = 1; i < bands; i++) {
+        band[i].done = xSemaphoreCreateBinary();
+        if (!band[i].done ||
+            xTaskCreatePinnedToCore(_bandTask, "cams3_jpeg", 6144, &band[i], uxTaskPriorityGet(nullptr), nullptr,
+                                    otherCore) != pdPASS) {
+            if (band[i].done) vSemaphoreDelete(band[i].done);
+            band[i].done = nullptr;
+        }
+    }
+    _encodeBand(band[0]);
+    for (uint8_t i = 1; i < bands; i++) {
+        if (band[i].done) {
+            xSemaphoreTake(band[i].done, portMAX_DELAY);
+            vSemaphoreDelete(band[i].done);
+        } else {
+            _encodeBand(band[i]);  // Worker could not be started
+        }
+    }
+
+    // Slide each band down behind the previous one; the slices are in order so this is in place
+    size_t pos = headerLen;
+    bool ok    = true;
+    for (uint8_t i = 0; i < bands; i++) {
+        ok = ok && band[i].ok;
+        if (band[i].out != buf + pos) {
+            memmove(buf + pos, band[i].out, band[i].len);
+        }
+        pos += band[i].len;
+    }
+    len = pos;
+    return ok;
+}
+
+bool CamS3_JpegEncoder::encode(const uint8_t* rgb565, uint16_t width, uint16_t height, uint8_t quality,
+                               uint8_t** out, size_t* outLen, uint8_t bands) {
+    if (!rgb565 || !out || !outLen || width == 0 || height == 0) return false;
+
+    int64_t start = esp_timer_get_time();
+    buildEncTables();
+    _setQuality(quality);
+    _src    = rgb565;
+    _width  = width;
+    _height = height;
+    _mcusX  = (width + 15) / 16;
+    _mcusY  = (height + 15) / 16;
+
+    if (bands < 1) bands = 1;
+    if (bands > CAMS3_JPEG_MAX_BANDS) bands = CAMS3_JPEG_MAX_BANDS;
+    if (bands > _mcusY) bands = _mcusY;
+
+    // Sized for a typical frame first; one that does not fit (sensor noise, high quality) grows the
+    // buffer and is encoded again, so memory follows the image rather than the theoretical worst case
+    const size_t headerCap = 1024;
+    size_t mcuBytes        = kTypicalMcuBytes;
+    uint8_t* buf           = nullptr;
+    size_t pos             = 0;
+    bool ok                = false;
+    for (;;) {
+        const size_t rowCap = (size_t)_mcusX * mcuBytes + 8;
+        uint8_t* grown      = (uint8_t*)realloc(buf, headerCap + rowCap * _mcusY + 2);
+        if (!grown) {
+            Serial.printf("[CamS3 JPEG] Out of memory for %u bytes per MCU\n", (unsigned)mcuBytes);
+            break;
+        }
+        buf = grown;
+        ok  = _encodeBands(buf, _writeHeaders(buf), rowCap, bands, pos);
+        if (ok || mcuBytes == kWorstMcuBytes) break;
+        mcuBytes = (mcuBytes * 2 < kWorstMcuBytes) ? mcuBytes * 2 : kWorstMcuBytes;
+    }
+    if (!ok) {
+        free(buf);
+        return false;
+    }
+    buf[pos++] = 0xFF;
+    buf[pos++] = JPEG_EOI;
+
+    // Hand back the slack left in the band slots
+    uint8_t* fit = (uint8_t*)realloc(buf, pos);
+    if (fit) buf = fit;
+
+    *out       = buf;
+    *outLen    = pos;
+    _lastBands = bands;
+    _lastUs    = esp_timer_get_time() - start;
+    return true;
+}
+
+// ============================================
+// CamS3_JpegTranscoder Implementation
+// ============================================
+
+void CamS3_JpegTranscoder::setCrop(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    _cropX = x;
+    _cropY = y;
+    _cropW = w;
+    _cropH = h;
+}
+
+bool CamS3_JpegTranscoder::printSink(const uint8_t* data, size_t len, void* ctx) {
+    return ((Print*)ctx)->write(data, len) == len;
+}
+
+bool CamS3_JpegTranscoder::_emit(const uint8_t* data, size_t len) {
+    if (_sinkFailed) return false;
+    if (!_sink(data, len, _ctx)) {
+        _sinkFailed = true;
+        return false;
+    }
+    _outBytes += len;
+    return true;
+}
+
+void CamS3_JpegTranscoder::_drain(CamS3_JpegEncoder::BitWriter& bw) {
+    if (bw.p > _buf) {
+        _emit(_buf, bw.p - _buf);
+        bw.p = _buf;
+    }
+}
+
+size_t CamS3_JpegTranscoder::_writeHeaders(uint8_t* out) {
+    const cams3_jpeg_info_t& info = _dec._info;
+    uint8_t* p                    = writeJFIF(out);
+
+    uint8_t used = 0;
+    for (uint8_t c = 0; c < info.components; c++) {
+        used |= 1 << info.comp[c].tq;
+    }
+    for (uint8_t t = 0; t < 4; t++) {
+        if (!(used & (1 << t))) continue;
+        *p++ = 0xFF;
+        *p++ = JPEG_DQT;
+        p    = put16BE(p, 2 + 65);
+        *p++ = t;
+        memcpy(p, _qt[t], 64);
+        p += 64;
+    }
+
+    *p++ = 0xFF;
+    *p++ = JPEG_SOF0;
+    p    = put16BE(p, 8 + 3 * info.components);
+    *p++ = 8;
+    p    = put16BE(p, _outHeight);
+    p    = put16BE(p, _outWidth);
+    *p++ = info.components;
+    for (uint8_t c = 0; c < info.components; c++) {
+        *p++ = info.comp[c].id;
+        *p++ = (info.comp[c].h << 4) | info.comp[c].v;
+        *p++ = info.comp[c].tq;
+    }
+
+    // Luma tables for the first component, chroma for the rest
+    const int tables = info.components > 1 ? 4 : 2;
+    if (!_opt) {
+        p = writeStandardDHT(p, tables);
+    }
+    for (int t = 0; _opt && t < tables; t++) {
+        static const uint8_t ids[4] = {0x00, 0x10, 0x01, 0x11};
+        int count                   = 0;
+        for (int i = 0; i < 16; i++) count += _opt->bits[t][i];
+        *p++ = 0xFF;
+        *p++ = JPEG_DHT;
+        p    = put16BE(p, 2 + 1 + 16 + count);
+        *p++ = ids[t];
+        memcpy(p, _opt->bits[t], 16);
+        p += 16;
+        memcpy(p, _opt->vals[t], count);
+        p += count;
+    }
+
+    *p++ = 0xFF;
+    *p++ = JPEG_SOS;
+    p    = put16BE(p, 6 + 2 * info.components);
+    *p++ = info.components;
+    for (uint8_t c = 0; c < info.components; c++) {
+        *p++ = info.comp[c].id;
+        *p++ = c ? 0x11 : 0x00;
+    }
+    *p++ = 0;
+    *p++ = 63;
+    *p++ = 0;
+    return p - out;
+}
+
+// Optimal code lengths for the counted symbols (ITU T.81 Annex K.2), limited to 16 bits
+static void buildOptimalTable(uint32_t* freq, uint8_t* bits, uint8_t* vals) {
+    uint8_t codesize[257];
+    int16_t others[257];
+    memset(codesize, 0, sizeof(codesize));
+    memset(others, -1, sizeof(others));
+
+    // An unused table still gets one code, so the length counts below have a longest entry
+    bool used = false;
+    for (int i = 0; i < 256 && !used; i++) used = freq[i] != 0;
+    if (!used) freq[0] = 1;
+    freq[256] = 1;  // Reserved so no real code is all ones
+
+    for (;;) {
+        // Two least frequent symbols, larger index first on ties
+        int c1 = -1;
+        int c2 = -1;
+        uint32_t v1 = 0xFFFFFFFF;
+        uint32_t v2 = 0xFFFFFFFF;
+        for (int i = 0; i <= 256; i++) {
+            if (freq[i] && freq[i] <= v1) {
+                v1 = freq[i];
+                c1 = i;
+            }
+        }
+        for (int i = 0; i <= 256; i++) {
+            if (freq[i] && freq[i] <= v2 && i != c1) {
+                v2 = freq[i];
+                c2 = i;
+            }
+        }
+        if (c2 < 0) break;
+
+        freq[c1] += freq[c2];
+        freq[c2] = 0;
+        codesize[c1]++;
+        while (others[c1] >= 0) {
+            c1 = others[c1];
+            codesize[c1]++;
+        }
+        others[c1] = c2;
+        codesize[c2]++;
+        while (others[c2] >= 0) {
+            c2 = others[c2];
+            codesize[c2]++;
+        }
+    }
+
+    uint8_t count[33] = {0};
+    for (int i = 0; i <= 256; i++) {
+        if (codesize[i]) count[codesize[i]]++;
+    }
+
+    // Move codes longer than 16 bits up the tree
+    for (int i = 32; i > 16; i--) {
+        while (count[i] > 0) {
+            int j = i - 2;
+            while (count[j] == 0) j--;
+            count[i] -= 2;
+            count[i - 1]++;
+            count[j + 1] += 2;
+            count[j]--;
+        }
+    }
+    int i = 16;
+    while (count[i] == 0) i--;
+    count[i]--;  // Drop the reserved code
+
+    memcpy(bits, count + 1, 16);
+    int k = 0;
+    for (int len = 1; len <= 32; len++) {
+        for (int j = 0; j < 256; j++) {
+            if (codesize[j] == len) vals[k++] = j;
+        }
+    }
+}
+
+static void countBlock(const int32_t* zz, int32_t& pred, uint32_t* dcFreq, uint32_t* acFreq) {
+    int32_t diff = zz[0] - pred;
+    pred         = zz[0];
+    uint32_t mag = diff < 0 ? -diff : diff;
+    dcFreq[mag ? 32 - __builtin_clz(mag) : 0]++;
+
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        int32_t v = zz[k];
+        if (v == 0) {
+            run++;
+            continue;
+        }
+        while (run > 15) {
+            acFreq[0xF0]++;
+            run -= 16;
+        }
+        mag = v < 0 ? -v : v;
+        acFreq[(run << 4) | (32 - __builtin_clz(mag))]++;
+        run = 0;
+    }
+    if (run) acFreq[0x00]++;
+}
+
+bool CamS3_JpegTranscoder::_scan(const CamS3_JpegDecoder::Region& r, CamS3_JpegEncoder::BitWriter* bw) {
+    const cams3_jpeg_info_t& info = _dec._info;
+    int32_t outPred[CAMS3_JPEG_MAX_COMPONENTS] = {0};
+    int16_t coef[64];
+    int32_t zz[64];
+
+    const uint32_t totalMcus = (uint32_t)info.mcusX * info.mcusY;
+    const uint32_t firstMcu  = (uint32_t)r.my0 * info.mcusX + r.mx0;
+    const uint32_t lastMcu   = (uint32_t)r.my1 * info.mcusX + r.mx1;
+    const uint32_t per       = info.restartInterval ? info.restartInterval : info.mcusX;
+
+    // Resume points are visited in order, so output MCUs come out in raster order
+    for (uint32_t seg = firstMcu / per; seg <= lastMcu / per; seg++) {
+        if (!_dec._segmentHits(r, seg)) continue;
+
+        const CamS3_JpegDecoder::SyncPoint& sp = _dec._index[seg];
+        CamS3_JpegDecoder::BitReader br        = sp.br;
+        int16_t pred[CAMS3_JPEG_MAX_COMPONENTS];
+        memcpy(pred, sp.pred, sizeof(pred));
+
+        uint32_t end = (seg + 1 < _dec._indexCount) ? _dec._index[seg + 1].mcu : totalMcus;
+        if (end > lastMcu + 1) end = lastMcu + 1;
+
+        for (uint32_t mcu = sp.mcu; mcu < end; mcu++) {
+            uint16_t mx = mcu % info.mcusX;
+            uint16_t my = mcu / info.mcusX;
+            bool inside = mx >= r.mx0 && mx <= r.mx1 && my >= r.my0 && my <= r.my1;
+
+            for (uint8_t c = 0; c < info.components; c++) {
+                const uint16_t* qIn = _dec._qt[info.comp[c].tq];
+                const uint8_t* qOut = _qt[info.comp[c].tq];
+                const uint8_t t     = c ? 1 : 0;
+                for (uint8_t b = 0; b < info.comp[c].h * info.comp[c].v; b++) {
+                    if (!_dec._decodeBlock(br, c, inside ? coef : nullptr, pred[c])) return false;
+                    if (!inside) continue;
+
+                    // Rescale to the output table, rounding to nearest
+                    for (int k = 0; k < 64; k++) {
+                        int32_t v = coef[k];
+                        if (v && qIn[k] != qOut[k]) {
+                            int32_t num  = v * qIn[k];
+                            int32_t half = qOut[k] / 2;
+                            v            = (num >= 0) ? (num + half) / qOut[k] : -((half - num) / qOut[k]);
+                        }
+                        zz[k] = v;
+                    }
+
+                    if (!bw) {
+                        countBlock(zz, outPred[c], _opt->freq[t * 2], _opt->freq[t * 2 + 1]);
+                        continue;
+                    }
+
+                    // A block never needs more than ~450 bytes, even fully stuffed
+                    if (bw->end - bw->p < 512) _drain(*bw);
+                    if (_opt) {
+                        CamS3_JpegEncoder::_writeBlock(*bw, zz, _opt->codes[t * 2], _opt->codes[t * 2 + 1], outPred[c]);
+                    } else {
+                        CamS3_JpegEncoder::_writeBlock(*bw, zz, sDCTables[t], sACTables[t], outPred[c]);
+                    }
+                }
+            }
+            if (_sinkFailed) return false;
+        }
+    }
+    return true;
+}
+
+bool CamS3_JpegTranscoder::transcode(const uint8_t* jpeg, size_t len, cams3_jpeg_sink_t sink, void* ctx) {
+    int64_t start = esp_timer_get_time();
+    _outBytes     = 0;
+    if (!jpeg || !sink || !_dec.parse(jpeg, len)) return false;
+
+    const cams3_jpeg_info_t& info = _dec._info;
+
+    // Lossless crop: the top-left corner must sit on the MCU grid
+    uint32_t x0 = 0;
+    uint32_t y0 = 0;
+    uint32_t x1 = info.width;
+    uint32_t y1 = info.height;
+    if (_cropW && _cropH) {
+        if (_cropX >= info.width || _cropY >= info.height) return false;
+        x0 = _cropX / info.mcuWidth * info.mcuWidth;
+        y0 = _cropY / info.mcuHeight * info.mcuHeight;
+        if ((uint32_t)_cropX + _cropW < x1) x1 = _cropX + _cropW;
+        if ((uint32_t)_cropY + _cropH < y1) y1 = _cropY + _cropH;
+    }
+    _outWidth  = x1 - x0;
+    _outHeight = y1 - y0;
+
+    CamS3_JpegDecoder::Region r;
+    r.x     = x0;
+    r.y     = y0;
+    r.w     = _outWidth;
+    r.h     = _outHeight;
+    r.mx0   = x0 / info.mcuWidth;
+    r.my0   = y0 / info.mcuHeight;
+    r.mx1   = (x1 - 1) / info.mcuWidth;
+    r.my1   = (y1 - 1) / info.mcuHeight;
+    r.out   = nullptr;
+    r.color = true;
+
+    // Output tables: the source tables, or the IJG tables for the target quality if coarser
+    int32_t scale = 0;
+    if (_quality) {
+        scale = (_quality < 50) ? 5000 / _quality : 200 - _quality * 2;
+    }
+    for (uint8_t t = 0; t < 4; t++) {
+        const uint8_t* base = t ? kChromaQuant : kLumaQuant;
+        for (int k = 0; k < 64; k++) {
+            int32_t q = _dec._qt[t][k];
+            if (scale) {
+                int32_t target = (base[kZigzag[k]] * scale + 50) / 100;
+                if (target > q) q = target;
+            }
+            _qt[t][k] = (q < 1) ? 1 : (q > 255) ? 255 : q;
+        }
+    }
+
+    buildEncTables();
+    if (!_dec.buildIndex()) return false;
+
+    _sink       = sink;
+    _ctx        = ctx;
+    _sinkFailed = false;
+    _buf        = (uint8_t*)malloc(CAMS3_JPEG_SINK_BUFFER);
+    if (_optimize) {
+        _opt = (OptimalTables*)calloc(1, sizeof(OptimalTables));
+    }
+    bool ok = _buf && (!_optimize || _opt);
+
+    // Extra pass: count the symbols and derive tables for this image only
+    if (ok && _opt) {
+        ok = _scan(r, nullptr);
+        const int tables = _dec._info.components > 1 ? 4 : 2;  // Grayscale scans use no chroma tables
+        for (int t = 0; ok && t < tables; t++) {
+            buildOptimalTable(_opt->freq[t], _opt->bits[t], _opt->vals[t]);
+            buildEncTable(_opt->codes[t], _opt->bits[t], _opt->vals[t]);
+        }
+    }
+
+    if (ok) {
+        _emit(_buf, _writeHeaders(_buf));
+
+        CamS3_JpegEncoder::BitWriter bw;
+        bw.reset(_buf, _buf + CAMS3_JPEG_SINK_BUFFER);
+        ok = _scan(r, &bw);
+        if (ok) {
+            bw.flush();
+            bw.marker(JPEG_EOI);
+            _drain(bw);
+            ok = !bw.overflow && !_sinkFailed;
+        }
+    }
+
+    free(_opt);
+    free(_buf);
+    _opt    = nullptr;
+    _buf    = nullptr;
+    _lastUs = esp_timer_get_time() - start;
+    return ok;
+}
+
+bool CamS3_JpegTranscoder::transcodeFile(fs::FS& fs, const char* path, cams3_jpeg_sink_t sink, void* ctx) {
+    File file = fs.open(path, FILE_READ);
+    if (!file) return false;
+
+    size_t len    = file.size();
+    uint8_t* data = (uint8_t*)malloc(len);
+    if (!data) {
+        file.close();
+        return false;
+    }
+    bool ok = file.read(data, len) == len;
+    file.close();
+
+    ok = ok && transcode(data, len, sink, ctx);
+    free(data);
+    return ok;
+}
+
+// ============================================
+// CamS3_SceneDetector Implementation
+// ============================================
+
+CamS3_SceneDetector::~CamS3_SceneDetector() {
+    free(_rowBytes);
+    free(_rowPrev);
+    free(_rowMask);
+    free(_dcRef);
+    free(_dcCur);
+}
+
+bool CamS3_SceneDetector::_prepare(uint16_t rows, size_t dcSize) {
+    if (rows != _rowCount) {
+        free(_rowBytes);
+        free(_rowPrev);
+        free(_rowMask);
+        _rowBytes = (uint32_t*)malloc(rows * sizeof(uint32_t));
+        _rowPrev  = (uint32_t*)malloc(rows * sizeof(uint32_t));
+        _rowMask  = (uint8_t*)malloc(rows);
+        _rowCount = (_rowBytes && _rowPrev && _rowMask) ? rows : 0;
+        if (!_rowCount) return false;
+    }
+    if (dcSize != _dcSize) {
+        free(_dcRef);
+        free(_dcCur);
+        _dcRef  = (uint8_t*)malloc(dcSize);
+        _dcCur  = (uint8_t*)malloc(dcSize);
+        _dcSize = (_dcRef && _dcCur) ? dcSize : 0;
+        if (!_dcSize) return false;
+    }
+    return true;
+}
+
+bool CamS3_SceneDetector::_countRows() {
+    const cams3_jpeg_info_t& info = _dec._info;
+    if (!info.restartInterval) return false;
+    if (!_dec.buildIndex()) return false;
+
+    // Segment sizes from the resume points; every segment starts right after its marker
+    memset(_rowBytes, 0, _rowCount * sizeof(uint32_t));
+    const uint8_t* end = _dec._data + _dec._len;
+    for (uint32_t seg = 0; seg < _dec._indexCount; seg++) {
+        const CamS3_JpegDecoder::SyncPoint& sp = _dec._index[seg];
+        const uint8_t* next = (seg + 1 < _dec._indexCount) ? _dec._index[seg + 1].br.p : end;
+        uint16_t row        = sp.mcu / info.mcusX;
+        if (row < _rowCount && next > sp.br.p) _rowBytes[row] += next - sp.br.p;
+    }
+    return true;
+}
+
+bool CamS3_SceneDetector::_compareDC() {
+    const uint16_t w      = _dec.getDCWidth();
+    const uint16_t h      = _dec.getDCHeight();
+    const uint16_t perRow = _dec._info.mcuHeight / 8;  // DC rows per MCU row
+    uint32_t changed      = 0;
+    if (_dcValid) {
+        for (uint16_t y = 0; y < h; y++) {
+            const uint8_t* a = _dcCur + (size_t)y * w;
+            const uint8_t* b = _dcRef + (size_t)y * w;
+            uint32_t rowHits = 0;
+            for (uint16_t x = 0; x < w; x++) {
+                if (abs((int)a[x] - (int)b[x]) > _config.dcDelta) rowHits++;
+            }
+            changed += rowHits;
+            if (rowHits && y / perRow < _rowCount) _rowMask[y / perRow] = 1;
+        }
+    }
+
+    _result.blocksChanged = changed;
+    return changed * 1000 >= (uint32_t)_config.dcPermille * w * h;
+}
+
+bool CamS3_SceneDetector::analyze(const uint8_t* jpeg, size_t len) {
+    int64_t start = esp_timer_get_time();
+    memset(&_result, 0, sizeof(_result));
+
+    if (!jpeg || !_dec.parse(jpeg, len)) return false;
+    const cams3_jpeg_info_t& info = _dec._info;
+
+    // New geometry starts a new reference
+    bool fresh = !_primed || info.width != _width || info.height != _height;
+    if (fresh) {
+        if (!_prepare(info.mcusY, (size_t)_dec.getDCWidth() * _dec.getDCHeight())) return false;
+        _width     = info.width;
+        _height    = info.height;
+        _rowsValid = false;
+        _dcValid   = false;
+    }
+    memset(_rowMask, 0, _rowCount);
+
+    // Stage 1: compressed size
+    uint32_t sizePermille = 0;
+    if (!fresh && _prevLen) {
+        size_t diff  = (len > _prevLen) ? len - _prevLen : _prevLen - len;
+        sizePermille = (uint64_t)diff * 1000 / _prevLen;
+    }
+    _result.sizePermille = sizePermille > 0xFFFF ? 0xFFFF : sizePermille;
+    _prevLen             = len;
+    _primed              = true;
+
+    // Stage 2: bytes per MCU row, kept up to date on every frame it can run on. Restart markers give
+    // them for free; without markers they come from the DC pass, which then also serves stage 3
+    bool haveDC   = false;
+    bool haveRows = false;
+    if (!info.restartInterval && _config.skimRows) {
+        haveRows = haveDC = _dec._decodeDCImage(_dcCur, _dcSize, false, _rowBytes);
+    } else {
+        haveRows = _countRows();
+    }
+    if (haveRows) {
+        if (_rowsValid) {
+            _result.rows = _rowCount;
+            for (uint16_t r = 0; r < _rowCount; r++) {
+                uint32_t prev = _rowPrev[r] > 64 ? _rowPrev[r] : 64;  // Near-empty rows are all noise
+                uint32_t diff = (_rowBytes[r] > _rowPrev[r]) ? _rowBytes[r] - _rowPrev[r] : _rowPrev[r] - _rowBytes[r];
+                if (diff * 1000 >= (uint32_t)_config.rowPermille * prev) {
+                    _rowMask[r] = 1;
+                    _result.rowsChanged++;
+                }
+            }
+        }
+        uint32_t* t = _rowPrev;
+        _rowPrev    = _rowBytes;
+        _rowBytes   = t;
+        _rowsValid  = true;
+    } else {
+        _rowsValid = false;
+    }
+
+    if (fresh) {
+        _result.changed = true;
+    } else if (sizePermille >= _config.sizePermille) {
+        _result.changed = true;
+        _result.stage   = 1;
+    } else if (_result.rows && _result.rowsChanged >= _config.minRows) {
+        _result.changed = true;
+        _result.stage   = 2;
+    } else if (sizePermille < _config.quietPermille && _result.rowsChanged == 0) {
+        _result.stage = _result.rows ? 2 : 1;
+    } else if (_config.useDC) {
+        // Stage 3: only frames the cheap checks could not settle
+        if (!haveDC) haveDC = _dec.decodeDC(_dcCur, _dcSize);
+        _result.changed = haveDC && _compareDC();
+        _result.stage   = 3;
+    } else {
+        _result.stage = _result.rows ? 2 : 1;
+    }
+
+    // The DC reference follows every frame it was decoded for, and every changed frame, so an
+    // ambiguous frame is never compared against a scene that has since moved on
+    if (_config.useDC && _result.changed && !haveDC) haveDC = _dec.decodeDC(_dcCur, _dcSize);
+    if (haveDC) {
+        uint8_t* t = _dcRef;
+        _dcRef     = _dcCur;
+        _dcCur     = t;
+        _dcValid   = true;
+    }
+
+    _result.analyzeUs = esp_timer_get_time() - start;
+    return _result.changed;
+}
@@ -0,0 +1,571 @@
+/**
+ * @file CamS3_Jpeg.h
+ * @brief Baseline JPEG bitstream tools for CamS3Library
+ *
+ * Works directly on the entropy-coded data produced by the sensor's
+ * hardware JPEG encoder, so statistics and previews can be derived
+ * without a full pixel-domain decode.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef _CAMS3_JPEG_H_
+#define _CAMS3_JPEG_H_
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#define CAMS3_JPEG_MAX_COMPONENTS 3
+#define CAMS3_JPEG_MAX_BANDS      2     // Encoder bands, one per core
+#define CAMS3_JPEG_SINK_BUFFER    4096  // Transcoder output chunk size
+
+/**
+ * @brief Receives transcoder output in order
+ * @param data Output bytes
+ * @param len Number of bytes
+ * @param ctx User context passed to transcode()
+ * @return false to abort
+ */
+typedef bool (*cams3_jpeg_sink_t)(const uint8_t* data, size_t len, void* ctx);
+
+// ============================================
+// Scene-change detection
+// ============================================
+typedef struct {
+    uint16_t sizePermille;   // Compressed size change that is a scene change on its own
+    uint16_t quietPermille;  // Below this (and no row change) the frame is static without further checks
+    uint16_t rowPermille;    // Byte count change that marks an MCU row as changed
+    uint8_t minRows;         // Changed rows that make a scene change
+    uint8_t dcDelta;         // Luma change that marks an 8x8 block as changed
+    uint16_t dcPermille;     // Changed blocks that make a scene change
+    bool useDC;              // Settle ambiguous frames with a DC-image comparison
+    bool skimRows;           // Without restart markers, count row bytes during the DC pass (run every frame)
+} cams3_scene_config_t;
+
+#define CAMS3_SCENE_CONFIG_DEFAULT {60, 5, 30, 2, 12, 3, true, true}
+
+typedef struct {
+    bool changed;            // Likely scene change
+    uint8_t stage;           // Deciding check: 0 first frame, 1 size, 2 rows, 3 DC
+    uint16_t sizePermille;   // |size change| against the previous frame
+    uint16_t rows;           // MCU rows compared (0 if the row check did not run)
+    uint16_t rowsChanged;
+    uint32_t blocksChanged;  // 8x8 luma blocks over dcDelta (DC check only)
+    uint32_t analyzeUs;
+} cams3_scene_result_t;
+
+// ============================================
+// JPEG stream description
+// ============================================
+typedef struct {
+    uint8_t id;  // Component id from SOF
+    uint8_t h;   // Horizontal sampling factor
+    uint8_t v;   // Vertical sampling factor
+    uint8_t tq;  // Quantization table index
+    uint8_t td;  // DC Huffman table index (from SOS)
+    uint8_t ta;  // AC Huffman table index (from SOS)
+} cams3_jpeg_component_t;
+
+// Huffman codes for encoding, indexed by symbol
+typedef struct {
+    uint16_t code[256];
+    uint8_t size[256];
+} cams3_jpeg_huffcode_t;
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t components;
+    uint8_t maxH;
+    uint8_t maxV;
+    uint16_t mcuWidth;         // MCU width in pixels
+    uint16_t mcuHeight;        // MCU height in pixels
+    uint16_t mcusX;            // MCUs per row
+    uint16_t mcusY;            // MCU rows
+    uint16_t restartInterval;  // MCUs between RSTn markers (0 = none)
+    cams3_jpeg_component_t comp[CAMS3_JPEG_MAX_COMPONENTS];
+} cams3_jpeg_info_t;
+
+// ============================================
+// JPEG Decoder Class
+// ============================================
+class CamS3_JpegDecoder {
+    friend class CamS3_JpegTranscoder;
+    friend class CamS3_SceneDetector;
+
+   private:
+    struct HuffTable {
+        bool defined;
+        uint8_t bits[17];
+        uint8_t vals[256];
+        int32_t maxcode[18];
+        int32_t valptr[17];
+        int32_t mincode[17];
+        uint16_t lookup[512];  // 9-bit fast path: (length << 8) | value
+    };
+
+    struct BitReader {
+        const uint8_t* p;
+        const uint8_t* end;
+        uint32_t acc;
+        int bits;
+        bool marker;
+
+        void reset(const uint8_t* start, const uint8_t* stop);
+        void fill();
+        uint32_t get(int n);
+        bool restart();
+    };
+
+    // Point where decoding can resume: a restart interval or MCU row start
+    struct SyncPoint {
+        BitReader br;
+        uint32_t mcu;
+        int16_t pred[CAMS3_JPEG_MAX_COMPONENTS];
+    };
+
+    // Rectangle being decoded, shared read-only by the region workers
+    struct Region {
+        uint16_t x, y, w, h;
+        uint16_t mx0, my0, mx1, my1;  // Covering MCUs (inclusive)
+        uint8_t* out;
+        bool color;
+    };
+
+    struct RegionJob {
+        CamS3_JpegDecoder* dec;
+        const Region* region;
+        uint32_t firstSeg;
+        uint32_t lastSeg;  // Inclusive
+        bool ok;
+        SemaphoreHandle_t done;
+    };
+
+    const uint8_t* _data = nullptr;
+    size_t _len          = 0;
+    size_t _scanOffset   = 0;
+    bool _valid          = false;
+    cams3_jpeg_info_t _info;
+    uint16_t _qt[4][64];
+    HuffTable _dcTables[2];
+    HuffTable _acTables[2];
+    int16_t _pred[CAMS3_JPEG_MAX_COMPONENTS];
+
+    SyncPoint* _index    = nullptr;
+    uint32_t _indexCount = 0;
+    uint32_t _indexCap   = 0;
+    bool _indexed        = false;
+
+    bool _parseSOF(const uint8_t* p, uint16_t len);
+    bool _parseDHT(const uint8_t* p, uint16_t len);
+    bool _parseDQT(const uint8_t* p, uint16_t len);
+    bool _parseSOS(const uint8_t* p, uint16_t len);
+    bool _buildTable(HuffTable& t);
+    int _decodeHuff(BitReader& br, const HuffTable& t);
+    bool _decodeBlock(BitReader& br, uint8_t comp, int16_t* coef, int16_t& pred);
+    bool _decodeDCImage(uint8_t* out, size_t size, bool color, uint32_t* rowBytes = nullptr);
+    bool _segmentHits(const Region& r, uint32_t seg);
+    bool _decodeSegments(const Region& r, uint32_t firstSeg, uint32_t lastSeg);
+    void _renderMCU(const Region& r, uint16_t mx, uint16_t my, int16_t (*coef)[64]);
+    static void _regionTask(void* arg);
+
+   public:
+    ~CamS3_JpegDecoder();
+
+    /**
+     * @brief Parse the JPEG headers up to the start of scan
+     * @param data JPEG data (must stay valid while decoding)
+     * @param len Data length
+     * @return true if the stream is a supported baseline JPEG
+     */
+    bool parse(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Get the parsed stream description
+     * @return Stream info (valid after a successful parse())
+     */
+    const cams3_jpeg_info_t& getInfo() {
+        return _info;
+    }
+
+    /**
+     * @brief Width of the DC image produced by decodeDC() (1/8 luma scale)
+     * @return Width in pixels, or 0 if not parsed
+     */
+    uint16_t getDCWidth();
+
+    /**
+     * @brief Height of the DC image produced by decodeDC() (1/8 luma scale)
+     * @return Height in pixels, or 0 if not parsed
+     */
+    uint16_t getDCHeight();
+
+    /**
+     * @brief Decode only the luma DC coefficients into a 1/8 scale grayscale image
+     *
+     * AC coefficients are entropy-decoded and discarded, no IDCT is run.
+     *
+     * @param luma Output buffer of at least getDCWidth() * getDCHeight() bytes
+     * @param size Output buffer size in bytes
+     * @return true if successful
+     */
+    bool decodeDC(uint8_t* luma, size_t size);
+
+    /**
+     * @brief Decode the DC coefficients of all components into a 1/8 scale color image
+     *
+     * Same geometry as decodeDC(), chroma is replicated over the luma blocks it covers.
+     *
+     * @param bgr Output buffer of at least getDCWidth() * getDCHeight() * 3 bytes (B, G, R order)
+     * @param size Output buffer size in bytes
+     * @return true if successful
+     */
+    bool decodeDCColor(uint8_t* bgr, size_t size);
+
+    /**
+     * @brief Index the entropy-coded data for random access
+     *
+     * With restart markers (DRI) this is a byte scan for RSTn markers. Without
+     * them, one entropy-only pass records the decoder state at every MCU row.
+     * Called by decodeRegion() when needed; the index is kept until the next parse().
+     *
+     * @return true if successful
+     */
+    bool buildIndex();
+
+    /**
+     * @brief Get the number of resume points found by buildIndex()
+     * @return Restart intervals or MCU rows indexed
+     */
+    uint32_t getIndexSize() {
+        return _indexCount;
+    }
+
+    /**
+     * @brief Decode a rectangle of the image at full resolution
+     *
+     * Only the restart intervals or MCU rows that overlap the rectangle are
+     * entropy-decoded, and only MCUs inside it are dequantized and transformed.
+     * Independent intervals are split across both cores.
+     *
+     * @param x Left edge in pixels
+     * @param y Top edge in pixels
+     * @param w Width in pixels
+     * @param h Height in pixels
+     * @param out Output buffer of at least w * h bytes (w * h * 3 for color, B, G, R order)
+     * @param size Output buffer size in bytes
+     * @param color true for BGR888 output, false for 8-bit luma
+     * @param bands Number of workers, 1 to CAMS3_JPEG_MAX_BANDS (default: 2)
+     * @return true if successful
+     */
+    bool decodeRegion(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t* out, size_t size, bool color = false,
+                      uint8_t bands = CAMS3_JPEG_MAX_BANDS);
+};
+
+// ============================================
+// JPEG Encoder Class
+// ============================================
+class CamS3_JpegEncoder {
+    friend class CamS3_JpegTranscoder;
+
+   private:
+    struct BitWriter {
+        uint8_t* p;
+        uint8_t* end;
+        uint32_t acc;
+        int bits;
+        bool overflow;
+
+        void reset(uint8_t* start, uint8_t* stop);
+        void put(uint32_t code, int size);
+        void flush();
+        void marker(uint8_t m);
+    };
+
+    // One horizontal strip of MCU rows, encoded independently between restart markers
+    struct Band {
+        CamS3_JpegEncoder* enc;
+        uint16_t firstRow;
+        uint16_t lastRow;  // Exclusive
+        uint8_t* out;
+        size_t cap;
+        size_t len;
+        bool ok;
+        SemaphoreHandle_t done;
+    };
+
+    const uint8_t* _src = nullptr;
+    uint16_t _width     = 0;
+    uint16_t _height    = 0;
+    uint16_t _mcusX     = 0;
+    uint16_t _mcusY     = 0;
+    uint8_t _qt[2][64];      // Zigzag order, as written to DQT
+    uint16_t _recip[2][64];  // Natural order, 65536 / (q * 8)
+    uint32_t _lastUs    = 0;
+    uint8_t _lastBands  = 0;
+
+    void _setQuality(uint8_t quality);
+    size_t _writeHeaders(uint8_t* out);
+    void _loadMCU(uint16_t mx, uint16_t my, int32_t* blocks);
+    void _encodeBlock(BitWriter& bw, int32_t* block, uint8_t table, int32_t& pred);
+    static void _writeBlock(BitWriter& bw, const int32_t* zz, const cams3_jpeg_huffcode_t& dc,
+                            const cams3_jpeg_huffcode_t& ac, int32_t& pred);
+    void _encodeBand(Band& band);
+    bool _encodeBands(uint8_t* buf, size_t headerLen, size_t rowCap, uint8_t bands, size_t& len);
+    static void _bandTask(void* arg);
+
+   public:
+    /**
+     * @brief Encode a big-endian RGB565 image as a baseline 4:2:0 JPEG
+     *
+     * The image is split into horizontal bands of MCU rows with a restart
+     * marker after every row, so the bands can be entropy-coded on both
+     * cores at once and joined into one stream in the output buffer.
+     *
+     * @param rgb565 Pixel data as delivered by the camera (high byte first)
+     * @param width Image width
+     * @param height Image height
+     * @param quality JPEG quality 1-100, higher is better
+     * @param out Receives a malloc'd JPEG buffer (release with free())
+     * @param outLen Receives the JPEG length
+     * @param bands Number of bands to encode in parallel, 1 to CAMS3_JPEG_MAX_BANDS (default: 2)
+     * @return true if successful
+     */
+    bool encode(const uint8_t* rgb565, uint16_t width, uint16_t height, uint8_t quality, uint8_t** out,
+                size_t* outLen, uint8_t bands = CAMS3_JPEG_MAX_BANDS);
+
+    /**
+     * @brief Get the duration of the last encode() call
+     * @return Time in microseconds
+     */
+    uint32_t getLastEncodeTime() {
+        return _lastUs;
+    }
+
+    /**
+     * @brief Get the number of bands used by the last encode() call
+     * @return Band count
+     */
+    uint8_t getLastBands() {
+        return _lastBands;
+    }
+};
+
+// ============================================
+// JPEG Transcoder Class
+// ============================================
+class CamS3_JpegTranscoder {
+   private:
+    CamS3_JpegDecoder _dec;
+    uint16_t _cropX     = 0;
+    uint16_t _cropY     = 0;
+    uint16_t _cropW     = 0;  // 0 = no crop
+    uint16_t _cropH     = 0;
+    uint8_t _quality    = 0;  // 0 = keep the source tables
+    uint16_t _outWidth  = 0;
+    uint16_t _outHeight = 0;
+    size_t _outBytes    = 0;
+    uint32_t _lastUs    = 0;
+
+    bool _optimize      = false;
+
+    // Per-image Huffman tables: DC luma, AC luma, DC chroma, AC chroma
+    struct OptimalTables {
+        uint32_t freq[4][257];
+        uint8_t bits[4][16];
+        uint8_t vals[4][256];
+        cams3_jpeg_huffcode_t codes[4];
+    };
+
+    uint8_t _qt[4][64];  // Output tables, zigzag order
+
+    cams3_jpeg_sink_t _sink = nullptr;
+    void* _ctx              = nullptr;
+    uint8_t* _buf           = nullptr;
+    OptimalTables* _opt     = nullptr;
+    bool _sinkFailed        = false;
+
+    bool _emit(const uint8_t* data, size_t len);
+    void _drain(CamS3_JpegEncoder::BitWriter& bw);
+    size_t _writeHeaders(uint8_t* out);
+    bool _scan(const CamS3_JpegDecoder::Region& r, CamS3_JpegEncoder::BitWriter* bw);
+
+   public:
+    /**
+     * @brief Crop to a rectangle; the top-left corner is moved out to the enclosing MCU boundary
+     * @param x Left edge in pixels
+     * @param y Top edge in pixels
+     * @param w Width in pixels (0 = no crop)
+     * @param h Height in pixels
+     */
+    void setCrop(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+    /**
+     * @brief Requantize to a coarser quality (tables are never made finer than the source)
+     * @param quality JPEG quality 1-100, or 0 to keep the source tables
+     */
+    void setQuality(uint8_t quality) {
+        _quality = quality > 100 ? 100 : quality;
+    }
+
+    /**
+     * @brief Re-encode with Huffman tables computed for each image instead of the standard ones
+     *
+     * Adds one entropy-decode pass to count symbols. With no crop and no
+     * requantization the result is lossless and typically 5-15% smaller.
+     *
+     * @param enable true to build optimal tables
+     */
+    void setOptimizeHuffman(bool enable) {
+        _optimize = enable;
+    }
+
+    /**
+     * @brief Crop and/or requantize a JPEG in the DCT domain, without decoding pixels
+     *
+     * Coefficients are entropy-decoded, rescaled to the new tables and
+     * re-encoded with the standard (or optimized) Huffman tables. Output is
+     * produced in CAMS3_JPEG_SINK_BUFFER chunks as it is generated.
+     *
+     * @param jpeg Source JPEG (e.g., a frame buffer)
+     * @param len Source length
+     * @param sink Output callback
+     * @param ctx User context for the callback
+     * @return true if successful
+     */
+    bool transcode(const uint8_t* jpeg, size_t len, cams3_jpeg_sink_t sink, void* ctx);
+
+    /**
+     * @brief Transcode a JPEG file (read into PSRAM first)
+     * @param fs Filesystem (e.g., SD)
+     * @param path Source file path
+     * @param sink Output callback
+     * @param ctx User context for the callback
+     * @return true if successful
+     */
+    bool transcodeFile(fs::FS& fs, const char* path, cams3_jpeg_sink_t sink, void* ctx);
+
+    /**
+     * @brief Sink that writes to any Print (File, WiFiClient, ...)
+     * @param data Output bytes
+     * @param len Number of bytes
+     * @param ctx Print* to write to
+     * @return true if all bytes were written
+     */
+    static bool printSink(const uint8_t* data, size_t len, void* ctx);
+
+    /**
+     * @brief Get the output width of the last transcode
+     * @return Width in pixels
+     */
+    uint16_t getOutputWidth() {
+        return _outWidth;
+    }
+
+    /**
+     * @brief Get the output height of the last transcode
+     * @return Height in pixels
+     */
+    uint16_t getOutputHeight() {
+        return _outHeight;
+    }
+
+    /**
+     * @brief Get the output size of the last transcode
+     * @return Bytes passed to the sink
+     */
+    size_t getOutputSize() {
+        return _outBytes;
+    }
+
+    /**
+     * @brief Get the duration of the last transcode
+     * @return Time in microseconds
+     */
+    uint32_t getLastTranscodeTime() {
+        return _lastUs;
+    }
+};
+
+// ============================================
+// Scene-change Detector Class
+// ============================================
+class CamS3_SceneDetector {
+   private:
+    CamS3_JpegDecoder _dec;
+    cams3_scene_config_t _config = CAMS3_SCENE_CONFIG_DEFAULT;
+    cams3_scene_result_t _result = {};
+
+    // Reference frame
+    bool _primed        = false;
+    uint16_t _width     = 0;
+    uint16_t _height    = 0;
+    size_t _prevLen     = 0;
+    uint32_t* _rowBytes = nullptr;  // Previous frame, then current
+    uint32_t* _rowPrev  = nullptr;
+    uint8_t* _rowMask   = nullptr;
+    uint16_t _rowCount  = 0;
+    bool _rowsValid     = false;
+    uint8_t* _dcRef     = nullptr;  // Last DC image decoded or changed frame
+    uint8_t* _dcCur     = nullptr;
+    size_t _dcSize      = 0;
+    bool _dcValid       = false;
+
+    bool _prepare(uint16_t rows, size_t dcSize);
+    bool _countRows();
+    bool _compareDC();
+
+   public:
+    ~CamS3_SceneDetector();
+
+    /**
+     * @brief Set the detection thresholds
+     * @param config Thresholds (see CAMS3_SCENE_CONFIG_DEFAULT)
+     */
+    void setConfig(const cams3_scene_config_t& config) {
+        _config = config;
+    }
+
+    /**
+     * @brief Compare a JPEG frame against the previous one
+     *
+     * Checks run from cheapest to costliest and stop at the first verdict:
+     * compressed size, bytes per MCU row, then, only for frames the first two
+     * cannot settle, the DC image. Row sizes come from a scan for RSTn markers;
+     * without markers they come from the DC pass (skimRows), which then runs on
+     * every frame and also serves the DC check.
+     *
+     * @param jpeg JPEG data
+     * @param len Data length
+     * @return true if the scene likely changed (always true for the first frame)
+     */
+    bool analyze(const uint8_t* jpeg, size_t len);
+
+    /**
+     * @brief Get the details of the last analyze() call
+     * @return Result of the last frame
+     */
+    const cams3_scene_result_t& getResult() {
+        return _result;
+    }
+
+    /**
+     * @brief Check if an MCU row changed in the last frame
+     * @param row MCU row index
+     * @return true if the row check or DC check flagged the row
+     */
+    bool isRowChanged(uint16_t row) {
+        return _rowMask && row < _rowCount && _rowMask[row];
+    }
+
+    /**
+     * @brief Forget the reference frame; the next frame reports a change
+     */
+    void reset() {
+        _primed = false;
+    }
+};
+
+#endif  // _CAMS3_JPEG_H_
@@ -0,0 +1,293 @@
+/**
+ * @file CamS3_RawLog.cpp
+ * @brief Log-structured raw-sector recording for CamS3Library
+ *
+ * @copyright MIT License
+ */
+
+#include "CamS3_RawLog.h"
+#include <esp_heap_caps.h>
+#include <esp_random.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <ff.h>
+#include <diskio_impl.h>
+#include <stddef.h>
+
+static const size_t kBufferBytes = CAMS3_RAWLOG_BUFFER_SECTORS * CAMS3_RAWLOG_SECTOR;
+
+CamS3_RawLog::~CamS3_RawLog() {
+    end();
+}
+
+bool CamS3_RawLog::begin(CamS3_SD& sd, const char* path, uint64_t size) {
+    end();
+    _sd = &sd;
+    if (!sd.isInitialized() || !path || size < 64 * CAMS3_RAWLOG_SECTOR) return false;
+
+    if (!_mapRegion(path, size)) return false;
+
+    // DMA-capable internal buffers avoid a bounce copy in the SD driver
+    _buf = (uint8_t*)heap_caps_malloc(kBufferBytes, MALLOC_CAP_DMA);
+    if (!_buf) _buf = (uint8_t*)malloc(kBufferBytes);
+    if (!_buf) {
+        Serial.println("[CamS3 RawLog] Buffer allocation failed");
+        return false;
+    }
+
+    _bufSector      = 0;
+    _bufLen         = 0;
+    _session        = esp_random() | 1;
+    _sequence       = 0;
+    _checkpoint     = 0;
+    _startUs        = esp_timer_get_time();
+    _lastCheckpoint = millis();
+    _stats          = {};
+
+    // Clear the second slot first, so a checkpoint left by an earlier session can never win
+    memset(_buf, 0, CAMS3_RAWLOG_SECTOR);
+    if (!_writeSectors(1, _buf, 1) || !_writeCheckpoint()) {
+        Serial.println("[CamS3 RawLog] Failed to write the region header");
+        free(_buf);
+        _buf = nullptr;
+        return false;
+    }
+
+    _open = true;
+    Serial.printf("[CamS3 RawLog] %s: %lu MB in %u extent(s), session %08lx\n", path,
+                  (unsigned long)(getCapacity() / (1024 * 1024)), _extentCount, (unsigned long)_session);
+    return true;
+}
+
+void CamS3_RawLog::end() {
+    if (_open) {
+        checkpoint();
+    }
+    free(_buf);
+    _buf  = nullptr;
+    _open = false;
+}
+
+bool CamS3_RawLog::_mapRegion(const char* path, uint64_t size) {
+    int drive = _sd->getDrive();
+    if (drive < 0) {
+        Serial.println("[CamS3 RawLog] Card drive not found");
+        return false;
+    }
+    _drive = drive;
+
+    // Grow the file through FatFs directly: seeking past the end allocates clusters without writing them
+    char fatPath[96];
+    snprintf(fatPath, sizeof(fatPath), "%d:%s", drive, path);
+    FIL file;
+    if (f_open(&file, fatPath, FA_READ | FA_WRITE | FA_OPEN_ALWAYS) != FR_OK) {
+        Serial.printf("[CamS3 RawLog] Failed to open %s\n", path);
+        return false;
+    }
+    if (f_size(&file) < size && (f_lseek(&file, size) != FR_OK || f_tell(&file) != size)) {
+        Serial.println("[CamS3 RawLog] Not enough free space for the region");
+        f_close(&file);
+        return false;
+    }
+
+    FATFS* fs         = file.obj.fs;
+    uint32_t cluster  = file.obj.sclust;
+    uint64_t fileSize = f_size(&file);
+    bool contiguous   = false;
+#if FF_FS_EXFAT
+    contiguous = fs->fs_type == FS_EXFAT && (file.obj.stat & 2);  // exFAT "no FAT chain" flag
+#endif
+    if (f_close(&file) != FR_OK) return false;
+    if (fs->fs_type == FS_FAT12 || cluster < 2) {
+        Serial.println("[CamS3 RawLog] Unsupported file system");
+        return false;
+    }
+
+    // Walk the cluster chain once and merge runs of consecutive clusters into extents
+    const uint32_t csize    = fs->csize;
+    const uint32_t sectors  = (uint32_t)(fileSize / CAMS3_RAWLOG_SECTOR);
+    const uint32_t clusters = (sectors + csize - 1) / csize;
+    const uint32_t entry    = fs->fs_type == FS_FAT16 ? 2 : 4;
+    uint8_t fat[CAMS3_RAWLOG_SECTOR];
+    uint32_t fatSector = 0xFFFFFFFF;
+
+    _extentCount = 0;
+    for (uint32_t i = 0; i < clusters; i++) {
+        uint32_t physical = fs->database + (cluster - 2) * csize;
+        Extent* last      = _extentCount ? &_extents[_extentCount - 1] : nullptr;
+        if (last && last->physical + last->count == physical) {
+            last->count += csize;
+        } else if (_extentCount < CAMS3_RAWLOG_MAX_EXTENTS) {
+            _extents[_extentCount++] = {i * csize, physical, csize};
+        } else {
+            Serial.println("[CamS3 RawLog] Region file too fragmented, reformat the card");
+            return false;
+        }
+        if (i + 1 == clusters) break;
+
+        if (contiguous) {
+            cluster++;
+            continue;
+        }
+        uint32_t sector = fs->fatbase + cluster * entry / CAMS3_RAWLOG_SECTOR;
+        if (sector != fatSector) {
+            if (ff_disk_read(_drive, fat, sector, 1) != RES_OK) return false;
+            fatSector = sector;
+        }
+        const uint8_t* p = fat + cluster * entry % CAMS3_RAWLOG_SECTOR;
+        uint32_t next    = entry == 2 ? (uint32_t)(p[0] | p[1] << 8)
+                                      : (uint32_t)(p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24) & 0x0FFFFFFF;
+        if (next < 2 || next >= fs->n_fatent) {
+            Serial.println("[CamS3 RawLog] Broken cluster chain");
+            return false;
+        }
+        cluster = next;
+    }
+
+    // The last cluster may hold sectors past the end of the file
+    Extent& tail = _extents[_extentCount - 1];
+    tail.count   = sectors - tail.logical;
+    _dataSectors = sectors - CAMS3_RAWLOG_DATA_START;
+    return true;
+}
+
+bool CamS3_RawLog::_writeSectors(uint32_t logical, const uint8_t* data, uint32_t count) {
+    for (uint8_t i = 0; i < _extentCount && count; i++) {
+        const Extent& e = _extents[i];
+        if (logical >= e.logical + e.count) continue;
+
+        uint32_t n     = e.logical + e.count - logical < count ? e.logical + e.count - logical : count;
+        int64_t start  = esp_timer_get_time();
+        bool ok        = ff_disk_write(_drive, data, e.physical + (logical - e.logical), n) == RES_OK;
+        uint32_t took  = (uint32_t)(esp_timer_get_time() - start);
+        _stats.writes++;
+        _stats.writeUs += took;
+        if (took > _stats.maxWriteUs) _stats.maxWriteUs = took;
+        if (!ok) {
+            Serial.println("[CamS3 RawLog] Sector write failed");
+            return false;
+        }
+        logical += n;
+        data += (size_t)n * CAMS3_RAWLOG_SECTOR;
+        count -= n;
+    }
+    return count == 0;
+}
+
+bool CamS3_RawLog::_flushBuffer() {
+    if (_bufLen == 0) return true;
+
+    // A partial last sector is written zero padded and kept, to be rewritten once it fills
+    uint32_t full = _bufLen / CAMS3_RAWLOG_SECTOR;
+    size_t part   = _bufLen % CAMS3_RAWLOG_SECTOR;
+    if (part) memset(_buf + _bufLen, 0, CAMS3_RAWLOG_SECTOR - part);
+    if (!_writeSectors(CAMS3_RAWLOG_DATA_START + _bufSector, _buf, full + (part ? 1 : 0))) return false;
+
+    if (part) memmove(_buf, _buf + full * CAMS3_RAWLOG_SECTOR, part);
+    _bufSector += full;
+    _bufLen = part;
+    return true;
+}
+
+bool CamS3_RawLog::_put(const uint8_t* data, size_t len) {
+    while (len) {
+        // On a sector boundary, whole sectors go to the card straight from the caller's buffer
+        if (_bufLen % CAMS3_RAWLOG_SECTOR == 0 && len >= CAMS3_RAWLOG_SECTOR) {
+            if (!_flushBuffer()) return false;
+            uint32_t count = len / CAMS3_RAWLOG_SECTOR;
+            if (!_writeSectors(CAMS3_RAWLOG_DATA_START + _bufSector, data, count)) return false;
+            _bufSector += count;
+            data += (size_t)count * CAMS3_RAWLOG_SECTOR;
+            len -= (size_t)count * CAMS3_RAWLOG_SECTOR;
+            continue;
+        }
+
+        // Otherwise stage; ahead of a large payload only up to the next boundary
+        size_t take = kBufferBytes - _bufLen;
+        if (len >= CAMS3_RAWLOG_SECTOR) {
+            size_t boundary = CAMS3_RAWLOG_SECTOR - _bufLen % CAMS3_RAWLOG_SECTOR;
+            if (boundary < take) take = boundary;
+        }
+        if (len < take) take = len;
+        memcpy(_buf + _bufLen, data, take);
+        _bufLen += take;
+        data += take;
+        len -= take;
+        if (_bufLen == kBufferBytes && !_flushBuffer()) return false;
+    }
+    return true;
+}
+
+bool CamS3_RawLog::_writeCheckpoint() {
+    uint8_t sector[CAMS3_RAWLOG_SECTOR] __attribute__((aligned(4))) = {0};
+    cams3_rawlog_checkpoint_t* cp = (cams3_rawlog_checkpoint_t*)sector;
+    memcpy(cp->magic, CAMS3_RAWLOG_MAGIC, 4);
+    cp->version     = CAMS3_RAWLOG_VERSION;
+    cp->recordSize  = sizeof(cams3_rawlog_record_t);
+    cp->session     = _session;
+    cp->checkpoint  = _checkpoint;
+    cp->dataSectors = _dataSectors;
+    cp->records     = _sequence;
+    cp->head        = getUsedBytes();
+    cp->startUs     = _startUs;
+    cp->timeUs      = esp_timer_get_time();
+    cp->crc32       = esp_rom_crc32_le(0, sector, offsetof(cams3_rawlog_checkpoint_t, crc32));
+
+    // The records must reach the card before the checkpoint that covers them, also through the write-back cache
+    if (!_sd->sync() || !_writeSectors(_checkpoint & 1, sector, 1) || !_sd->sync()) return false;
+    _checkpoint++;
+    _stats.checkpoints++;
+    return true;
+}
+
+bool CamS3_RawLog::checkpoint() {
+    if (!_buf) return false;
+    _lastCheckpoint = millis();
+    return _flushBuffer() && _writeCheckpoint();
+}
+
+bool CamS3_RawLog::append(uint8_t type, const void* data, size_t len, int64_t timeUs, uint8_t format,
+                          uint32_t info) {
+    if (!_open || (!data && len)) return false;
+    if (getUsedBytes() + sizeof(cams3_rawlog_record_t) + len > getCapacity()) {
+        _stats.rejected++;
+        return false;
+    }
+
+    cams3_rawlog_record_t rec = {};
+    rec.magic                 = CAMS3_RAWLOG_RECORD_MAGIC;
+    rec.session               = _session;
+    rec.sequence              = _sequence;
+    rec.length                = len;
+    rec.timeUs                = timeUs;
+    rec.info                  = info;
+    rec.type                  = type;
+    rec.format                = format;
+    rec.payloadCrc            = esp_rom_crc32_le(0, (const uint8_t*)data, len);
+    rec.headerCrc             = esp_rom_crc32_le(0, (const uint8_t*)&rec, offsetof(cams3_rawlog_record_t, headerCrc));
+
+    // A failed write leaves a torn record, which the reader treats as the end of the log
+    if (!_put((const uint8_t*)&rec, sizeof(rec)) || !_put((const uint8_t*)data, len)) {
+        _open = false;
+        return false;
+    }
+    _sequence++;
+    _stats.records++;
+    _stats.bytes += sizeof(rec) + len;
+
+    if (_checkpointMs && millis() - _lastCheckpoint >= _checkpointMs) {
+        return checkpoint();
+    }
+    return true;
+}
+
+bool CamS3_RawLog::appendFrame(camera_fb_t* frame) {
+    if (!frame) return false;
+    int64_t timeUs = (int64_t)frame->timestamp.tv_sec * 1000000 + frame->timestamp.tv_usec;
+    return append(CAMS3_RAWLOG_FRAME, frame->buf, frame->len, timeUs, frame->format,
+                  (uint32_t)frame->width << 16 | frame->height);
+}
+
+bool CamS3_RawLog::appendAudio(const void* samples, size_t bytes, uint32_t sampleRate, uint8_t sampleBits) {
+    return append(CAMS3_RAWLOG_AUDIO, samples, bytes, esp_timer_get_time(), sampleBits, sampleRate);
+}
@@ -0,0 +1,223 @@
+/**
+ * @file CamS3_RawLog.h
+ * @brief Log-structured raw-sector recording for CamS3Library
+ *
+ * Reserves one large preallocated file on the card, looks up the sectors
+ * it occupies once, and from then on writes frame and audio records to
+ * those sectors through the disk driver, bypassing FatFs and the Arduino
+ * File layer. The FAT and directory entry are never touched while
+ * recording, so there are no metadata updates to stall or tear.
+ *
+ * Layout of the region (little-endian, 512-byte sectors):
+ *   sectors 0-1  two checkpoint slots, written alternately
+ *   sectors 2-   byte stream of records, each a cams3_rawlog_record_t
+ *                header followed by its payload, packed back to back
+ *
+ * Every record carries the session id and a sequence number and is CRC
+ * protected, so a reader finds the end of the log (including records
+ * written after the last checkpoint) without trusting stale data left
+ * from earlier sessions. tools/cams3_rawlog.py reads the file on a PC.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef _CAMS3_RAWLOG_H_
+#define _CAMS3_RAWLOG_H_
+
+#include "CamS3Library.h"
+
+#define CAMS3_RAWLOG_MAGIC          "CS3R"
+#define CAMS3_RAWLOG_RECORD_MAGIC   0x72335343  // "CS3r"
+#define CAMS3_RAWLOG_VERSION        1
+#define CAMS3_RAWLOG_SECTOR         512
+#define CAMS3_RAWLOG_DATA_START     2           // First data sector of the region
+#define CAMS3_RAWLOG_BUFFER_SECTORS 16          // Staging for small records
+#define CAMS3_RAWLOG_MAX_EXTENTS    32          // Fragments of the region file that can be mapped
+#define CAMS3_RAWLOG_CHECKPOINT_MS  1000
+
+// Record types
+#define CAMS3_RAWLOG_FRAME 1  // format = pixformat_t, info = width << 16 | height
+#define CAMS3_RAWLOG_AUDIO 2  // format = bits per sample, info = sample rate
+#define CAMS3_RAWLOG_USER  3  // Application data
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;       // CAMS3_RAWLOG_RECORD_MAGIC
+    uint32_t session;     // Session the record belongs to
+    uint32_t sequence;    // Record number in the session, from 0
+    uint32_t length;      // Payload bytes
+    int64_t timeUs;       // Capture time (esp_timer clock)
+    uint32_t info;        // Type-specific, see CAMS3_RAWLOG_FRAME / AUDIO
+    uint8_t type;         // CAMS3_RAWLOG_*
+    uint8_t format;
+    uint16_t reserved;
+    uint32_t payloadCrc;  // CRC-32 of the payload
+    uint32_t headerCrc;   // CRC-32 of the bytes above
+} cams3_rawlog_record_t;
+
+typedef struct __attribute__((packed)) {
+    char magic[4];         // CAMS3_RAWLOG_MAGIC
+    uint16_t version;
+    uint16_t recordSize;   // sizeof(cams3_rawlog_record_t)
+    uint32_t session;      // Random per begin()
+    uint32_t checkpoint;   // Counter; the slot is checkpoint & 1
+    uint32_t dataSectors;  // Capacity of the record stream
+    uint32_t records;      // Records durable at this checkpoint
+    uint64_t head;         // Stream bytes durable at this checkpoint
+    int64_t startUs;       // Session start (esp_timer clock)
+    int64_t timeUs;        // Checkpoint time
+    uint32_t crc32;        // CRC-32 of the bytes above
+} cams3_rawlog_checkpoint_t;
+
+typedef struct {
+    uint32_t records;
+    uint64_t bytes;         // Stream bytes, headers included
+    uint32_t writes;        // Disk write calls
+    uint32_t maxWriteUs;    // Slowest disk write call
+    uint64_t writeUs;       // Total time in disk writes
+    uint32_t checkpoints;
+    uint32_t rejected;      // Records that did not fit
+} cams3_rawlog_stats_t;
+
+// ============================================
+// Raw Log Class
+// ============================================
+class CamS3_RawLog {
+   private:
+    struct Extent {
+        uint32_t logical;   // First region sector
+        uint32_t physical;  // Card sector it maps to
+        uint32_t count;
+    };
+
+    CamS3_SD* _sd  = nullptr;
+    uint8_t _drive = 0;  // FatFs physical drive of the card
+    bool _open     = false;
+
+    Extent _extents[CAMS3_RAWLOG_MAX_EXTENTS];
+    uint8_t _extentCount  = 0;
+    uint32_t _dataSectors = 0;
+
+    // Staging: _buf holds the stream from data sector _bufSector on, _bufLen bytes of it
+    uint8_t* _buf       = nullptr;
+    uint32_t _bufSector = 0;
+    size_t _bufLen      = 0;
+
+    uint32_t _session           = 0;
+    uint32_t _sequence          = 0;
+    uint32_t _checkpoint        = 0;
+    int64_t _startUs            = 0;
+    uint32_t _checkpointMs      = CAMS3_RAWLOG_CHECKPOINT_MS;
+    uint32_t _lastCheckpoint    = 0;
+    cams3_rawlog_stats_t _stats = {};
+
+    bool _mapRegion(const char* path, uint64_t size);
+    bool _writeSectors(uint32_t logical, const uint8_t* data, uint32_t count);
+    bool _put(const uint8_t* data, size_t len);
+    bool _flushBuffer();
+    bool _writeCheckpoint();
+
+   public:
+    ~CamS3_RawLog();
+
+    /**
+     * @brief Reserve the region file and start a new recording session
+     *
+     * Creates the file (or grows it) to the given size without writing it,
+     * maps its clusters to card sectors and starts a fresh session at the
+     * beginning of the region. The file must not be written through the
+     * file system while the log is open.
+     *
+     * @param sd Mounted SD card
+     * @param path Region file path, e.g. "/record.cs3r"
+     * @param size Region size in bytes (existing files keep a larger size)
+     * @return true if successful
+     */
+    bool begin(CamS3_SD& sd, const char* path = "/record.cs3r", uint64_t size = 256ull * 1024 * 1024);
+
+    /**
+     * @brief Write a final checkpoint and release the buffers
+     */
+    void end();
+
+    bool isOpen() {
+        return _open;
+    }
+
+    /**
+     * @brief Append a record
+     *
+     * Payload sectors are written straight from the caller's buffer, only
+     * the unaligned ends go through the staging buffer. A checkpoint follows
+     * once the checkpoint interval has passed.
+     *
+     * @param type CAMS3_RAWLOG_* record type
+     * @param data Payload
+     * @param len Payload bytes
+     * @param timeUs Capture time (esp_timer clock)
+     * @param format Type-specific format byte
+     * @param info Type-specific info word
+     * @return true if successful; false once the region is full
+     */
+    bool append(uint8_t type, const void* data, size_t len, int64_t timeUs, uint8_t format = 0, uint32_t info = 0);
+
+    /**
+     * @brief Append a camera frame with its timestamp, format and size
+     * @return true if successful
+     */
+    bool appendFrame(camera_fb_t* frame);
+
+    /**
+     * @brief Append a block of microphone samples
+     * @param samples Sample data
+     * @param bytes Size in bytes
+     * @param sampleRate Sample rate in Hz
+     * @param sampleBits Bits per sample
+     * @return true if successful
+     */
+    bool appendAudio(const void* samples, size_t bytes, uint32_t sampleRate = CAMS3_MIC_SAMPLE_RATE,
+                     uint8_t sampleBits = CAMS3_MIC_SAMPLE_BITS);
+
+    /**
+     * @brief Make everything appended so far durable
+     *
+     * Writes the staged tail (a partial sector is rewritten in place later)
+     * and the next checkpoint slot.
+     *
+     * @return true if successful
+     */
+    bool checkpoint();
+
+    /**
+     * @brief Set the interval between automatic checkpoints
+     * @param ms Interval in milliseconds (0 = only explicit checkpoints)
+     */
+    void setCheckpointInterval(uint32_t ms) {
+        _checkpointMs = ms;
+    }
+
+    /**
+     * @brief Get the stream bytes written so far
+     * @return Bytes, record headers included
+     */
+    uint64_t getUsedBytes() {
+        return (uint64_t)_bufSector * CAMS3_RAWLOG_SECTOR + _bufLen;
+    }
+
+    uint64_t getCapacity() {
+        return (uint64_t)_dataSectors * CAMS3_RAWLOG_SECTOR;
+    }
+
+    const cams3_rawlog_stats_t& getStats() {
+        return _stats;
+    }
+
+    /**
+     * @brief Get the sustained write rate
+     * @return KB per second of disk write time
+     */
+    uint32_t getThroughputKBps() {
+        return _stats.writeUs ? (uint32_t)(_stats.bytes * 1000000 / 1024 / _stats.writeUs) : 0;
+    }
+};
+
+#endif  // _CAMS3_RAWLOG_H_
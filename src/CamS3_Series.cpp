@@ -0,0 +1,501 @@
+/**
+ * @file CamS3_Series.cpp
+ * @brief Compact on-card time-series store for CamS3Library
+ *
+ * @copyright MIT License
+ */
+
+#include "CamS3_Series.h"
+#include <esp_rom_crc.h>
+#include <math.h>
+#include <stddef.h>
+
+static const size_t kChunkHeader = sizeof(cams3_series_chunk_t);
+static const size_t kStreamSlack = 16;  // Room for one more row past a full chunk (at most 80 bits per stream)
+static const uint8_t kNoWindow   = 0xFF;
+
+// ============================================
+// Bit Streams
+// ============================================
+
+static void putBits(uint8_t* buf, uint32_t& pos, uint64_t value, uint8_t n) {
+    while (n--) {
+        uint8_t mask = 0x80 >> (pos & 7);
+        if ((value >> n) & 1) {
+            buf[pos >> 3] |= mask;
+        } else {
+            buf[pos >> 3] &= ~mask;
+        }
+        pos++;
+    }
+}
+
+struct BitReader {
+    const uint8_t* buf;
+    uint32_t pos;
+    uint32_t end;
+
+    // Reads past the end of the stream return zeros
+    uint64_t get(uint8_t n) {
+        uint64_t v = 0;
+        while (n--) {
+            uint8_t bit = pos < end ? (buf[pos >> 3] >> (7 - (pos & 7))) & 1 : 0;
+            v           = (v << 1) | bit;
+            pos++;
+        }
+        return v;
+    }
+};
+
+static inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static void putVarint(uint8_t* buf, uint32_t& pos, uint64_t v) {
+    while (v >= 0x80) {
+        putBits(buf, pos, (v & 0x7F) | 0x80, 8);
+        v >>= 7;
+    }
+    putBits(buf, pos, v, 8);
+}
+
+static uint64_t getVarint(BitReader& r) {
+    uint64_t v = 0;
+    for (uint8_t shift = 0; shift < 64; shift += 7) {
+        uint64_t b = r.get(8);
+        v |= (b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+// ============================================
+// CamS3_Series Implementation
+// ============================================
+
+CamS3_Series::~CamS3_Series() {
+    end();
+}
+
+bool CamS3_Series::begin(CamS3_SD& sd, const char* path, const cams3_series_column_t* columns, uint8_t count,
+                         uint16_t blockSize) {
+    end();
+    if (!sd.isInitialized() || !path || !columns || count == 0 || count > CAMS3_SERIES_MAX_COLUMNS) return false;
+    if (blockSize < 512 || blockSize > CAMS3_SERIES_MAX_BLOCK || blockSize % 512) return false;
+
+    if (!sd.exists(path) && !_create(sd.getFS(), path, columns, count, blockSize)) return false;
+    if (!_load(sd.getFS(), path)) return false;
+
+    bool same = _columns == count;
+    for (uint8_t i = 0; same && i < count; i++) {
+        same = strncmp(_names[i], columns[i].name, CAMS3_SERIES_NAME_LEN) == 0 && _types[i] == columns[i].type;
+    }
+    if (!same) {
+        Serial.printf("[CamS3 Series] %s was created with other columns\n", path);
+        end();
+        return false;
+    }
+    return true;
+}
+
+bool CamS3_Series::begin(CamS3_SD& sd, const char* path) {
+    end();
+    if (!sd.isInitialized() || !path || !sd.exists(path)) return false;
+    return _load(sd.getFS(), path);
+}
+
+void CamS3_Series::end() {
+    if (_open) {
+        flush();
+        _file.close();
+        _open = false;
+    }
+    free(_streams);
+    free(_block);
+    _streams = nullptr;
+    _block   = nullptr;
+    _rows    = 0;
+}
+
+bool CamS3_Series::_create(fs::FS& fs, const char* path, const cams3_series_column_t* columns, uint8_t count,
+                           uint16_t blockSize) {
+    uint8_t* block = (uint8_t*)calloc(1, blockSize);
+    if (!block) return false;
+
+    cams3_series_header_t* header = (cams3_series_header_t*)block;
+    memcpy(header->magic, CAMS3_SERIES_MAGIC, 4);
+    header->version   = CAMS3_SERIES_VERSION;
+    header->blockSize = blockSize;
+    header->columns   = count;
+    for (uint8_t i = 0; i < count; i++) {
+        strncpy(header->column[i].name, columns[i].name, CAMS3_SERIES_NAME_LEN);
+        header->column[i].type = columns[i].type;
+    }
+    header->crc32 = esp_rom_crc32_le(0, block, offsetof(cams3_series_header_t, crc32));
+
+    File file = fs.open(path, FILE_WRITE);
+    bool ok   = file && file.write(block, blockSize) == blockSize;
+    file.close();
+    free(block);
+    if (!ok) Serial.printf("[CamS3 Series] Failed to create %s\n", path);
+    return ok;
+}
+
+bool CamS3_Series::_load(fs::FS& fs, const char* path) {
+    _file = fs.open(path, "r+");
+    if (!_file) {
+        Serial.printf("[CamS3 Series] Failed to open %s\n", path);
+        return false;
+    }
+
+    cams3_series_header_t header;
+    bool valid = _file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                 memcmp(header.magic, CAMS3_SERIES_MAGIC, 4) == 0 &&
+                 header.crc32 == esp_rom_crc32_le(0, (const uint8_t*)&header, offsetof(cams3_series_header_t, crc32)) &&
+                 header.blockSize >= 512 && header.blockSize <= CAMS3_SERIES_MAX_BLOCK && header.blockSize % 512 == 0 &&
+                 header.columns > 0 && header.columns <= CAMS3_SERIES_MAX_COLUMNS;
+    if (!valid) {
+        Serial.printf("[CamS3 Series] %s is not a time-series store\n", path);
+        _file.close();
+        return false;
+    }
+
+    _blockSize = header.blockSize;
+    _columns   = header.columns;
+    for (uint8_t i = 0; i < _columns; i++) {
+        memcpy(_names[i], header.column[i].name, CAMS3_SERIES_NAME_LEN);
+        _names[i][CAMS3_SERIES_NAME_LEN] = '\0';
+        _types[i]                        = header.column[i].type;
+    }
+
+    _streams = (uint8_t*)malloc((_columns + 1) * (_blockSize + kStreamSlack));
+    _block   = (uint8_t*)malloc(_blockSize);
+    if (!_streams || !_block) {
+        Serial.println("[CamS3 Series] Buffer allocation failed");
+        _file.close();
+        return false;
+    }
+
+    // Continue after the last chunk; a torn last chunk is overwritten
+    uint32_t blocks = _file.size() / _blockSize;
+    _chunk          = blocks > 1 ? blocks - 1 : 0;
+    _lastMs         = 0;
+    if (_chunk > 0 && !_readBlock(_chunk - 1, _block, false)) {
+        _chunk--;
+    }
+    if (_chunk > 0 && _readBlock(_chunk - 1, _block, true)) {
+        _lastMs = ((cams3_series_chunk_t*)_block)->lastMs;
+    }
+
+    _reset();
+    _stats     = {};
+    _dirty     = false;
+    _lastFlush = millis();
+    _open      = true;
+    return true;
+}
+
+void CamS3_Series::_reset() {
+    memset(_state, 0, sizeof(_state));
+    _rows = 0;
+}
+
+void CamS3_Series::_encodeRow(int64_t timeMs, const double* values) {
+    const size_t stride = _blockSize + kStreamSlack;
+
+    // Timestamps: the first is in the chunk header, then delta-of-delta in Gorilla-style buckets
+    Stream& ts = _state[0];
+    if (_rows == 0) {
+        _firstMs = timeMs;
+    } else {
+        uint8_t* buf  = _streams;
+        int64_t delta = timeMs - (int64_t)ts.prev;
+        int64_t dod   = delta - ts.delta;
+        if (dod == 0) {
+            putBits(buf, ts.bits, 0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            putBits(buf, ts.bits, 0x2, 2);
+            putBits(buf, ts.bits, dod + 63, 7);
+        } else if (dod >= -255 && dod <= 256) {
+            putBits(buf, ts.bits, 0x6, 3);
+            putBits(buf, ts.bits, dod + 255, 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            putBits(buf, ts.bits, 0xE, 4);
+            putBits(buf, ts.bits, dod + 2047, 12);
+        } else {
+            putBits(buf, ts.bits, 0xF, 4);
+            putBits(buf, ts.bits, (uint64_t)dod, 64);
+        }
+        ts.delta = delta;
+    }
+    ts.prev = (uint64_t)timeMs;
+
+    for (uint8_t c = 0; c < _columns; c++) {
+        Stream& s    = _state[c + 1];
+        uint8_t* buf = _streams + (c + 1) * stride;
+
+        if (_types[c] == CAMS3_SERIES_INT) {
+            int64_t v = isfinite(values[c]) ? llround(values[c]) : 0;
+            putVarint(buf, s.bits, zigzag(v - (int64_t)s.prev));
+            s.prev = (uint64_t)v;
+            continue;
+        }
+
+        // Floats: XOR with the previous value, only the meaningful bits are stored
+        float f = (float)values[c];
+        uint32_t bits;
+        memcpy(&bits, &f, 4);
+        if (_rows == 0) {
+            putBits(buf, s.bits, bits, 32);
+            s.leading = kNoWindow;
+        } else {
+            uint32_t x = bits ^ (uint32_t)s.prev;
+            if (x == 0) {
+                putBits(buf, s.bits, 0, 1);
+            } else {
+                uint8_t lead  = __builtin_clz(x);
+                uint8_t trail = __builtin_ctz(x);
+                if (s.leading != kNoWindow && lead >= s.leading && trail >= s.trailing) {
+                    putBits(buf, s.bits, 0x2, 2);
+                    putBits(buf, s.bits, x >> s.trailing, 32 - s.leading - s.trailing);
+                } else {
+                    uint8_t len = 32 - lead - trail;
+                    putBits(buf, s.bits, 0x3, 2);
+                    putBits(buf, s.bits, lead, 5);
+                    putBits(buf, s.bits, len - 1, 5);
+                    putBits(buf, s.bits, x >> trail, len);
+                    s.leading  = lead;
+                    s.trailing = trail;
+                }
+            }
+        }
+        s.prev = bits;
+    }
+}
+
+size_t CamS3_Series::_chunkBytes() {
+    size_t bytes = kChunkHeader + (_columns + 1) * sizeof(uint16_t);
+    for (uint8_t i = 0; i <= _columns; i++) {
+        bytes += (_state[i].bits + 7) / 8;
+    }
+    return bytes;
+}
+
+void CamS3_Series::_buildBlock(uint8_t* block) {
+    memset(block, 0, _blockSize);
+
+    cams3_series_chunk_t* chunk = (cams3_series_chunk_t*)block;
+    chunk->magic                = CAMS3_SERIES_CHUNK_MAGIC;
+    chunk->sequence             = _chunk;
+    chunk->firstMs              = _firstMs;
+    chunk->lastMs               = _lastMs;
+    chunk->rows                 = _rows;
+    chunk->columns              = _columns;
+
+    uint16_t* ends = (uint16_t*)(block + kChunkHeader);
+    size_t pos     = kChunkHeader + (_columns + 1) * sizeof(uint16_t);
+    for (uint8_t i = 0; i <= _columns; i++) {
+        size_t len = (_state[i].bits + 7) / 8;
+        memcpy(block + pos, _streams + i * (_blockSize + kStreamSlack), len);
+        // The unused bits of the last byte are left over from rolled-back rows
+        if (_state[i].bits & 7) block[pos + len - 1] &= 0xFF00 >> (_state[i].bits & 7);
+        pos += len;
+        ends[i] = pos;
+    }
+    chunk->crc32 = esp_rom_crc32_le(0, block, _blockSize);
+}
+
+bool CamS3_Series::_writeChunk() {
+    _buildBlock(_block);
+    bool ok = _file.seek((uint64_t)(_chunk + 1) * _blockSize) && _file.write(_block, _blockSize) == _blockSize;
+    _file.flush();
+    _stats.writes++;
+    _lastFlush = millis();
+    if (!ok) {
+        Serial.println("[CamS3 Series] Chunk write failed");
+        return false;
+    }
+    _dirty = false;
+    return true;
+}
+
+bool CamS3_Series::_seal() {
+    if (!_writeChunk()) return false;
+    _chunk++;
+    _stats.chunks++;
+    _reset();
+    return true;
+}
+
+bool CamS3_Series::append(int64_t timeMs, const double* values) {
+    if (!_open || !values) return false;
+    if ((_rows || _chunk) && timeMs < _lastMs) return false;
+
+    if (_rows == UINT16_MAX && !_seal()) return false;
+
+    // Encode into the open chunk; if the row makes it overflow, seal the chunk without it
+    Stream saved[CAMS3_SERIES_MAX_COLUMNS + 1];
+    memcpy(saved, _state, sizeof(Stream) * (_columns + 1));
+    _encodeRow(timeMs, values);
+    if (_chunkBytes() > _blockSize) {
+        memcpy(_state, saved, sizeof(Stream) * (_columns + 1));
+        if (!_seal()) return false;
+        _encodeRow(timeMs, values);
+    }
+
+    _rows++;
+    _lastMs = timeMs;
+    _dirty  = true;
+    _stats.rows++;
+
+    if (_flushMs && millis() - _lastFlush >= _flushMs) {
+        flush();
+    }
+    return true;
+}
+
+bool CamS3_Series::flush() {
+    if (!_open) return false;
+    if (!_dirty || _rows == 0) return true;
+    return _writeChunk();
+}
+
+bool CamS3_Series::_readBlock(uint32_t chunk, uint8_t* block, bool headerOnly) {
+    size_t len = headerOnly ? kChunkHeader : _blockSize;
+    if (!_file.seek((uint64_t)(chunk + 1) * _blockSize) || _file.read(block, len) != len) return false;
+
+    cams3_series_chunk_t* header = (cams3_series_chunk_t*)block;
+    if (header->magic != CAMS3_SERIES_CHUNK_MAGIC || header->sequence != chunk) return false;
+    if (headerOnly) return true;
+
+    uint32_t crc  = header->crc32;
+    header->crc32 = 0;
+    bool valid    = esp_rom_crc32_le(0, block, _blockSize) == crc;
+    header->crc32 = crc;
+    return valid;
+}
+
+bool CamS3_Series::_decode(const uint8_t* block, int64_t fromMs, int64_t toMs, cams3_series_cb_t cb, void* arg,
+                           int32_t& delivered) {
+    const cams3_series_chunk_t* chunk = (const cams3_series_chunk_t*)block;
+    if (chunk->columns != _columns) return true;
+
+    BitReader streams[CAMS3_SERIES_MAX_COLUMNS + 1];
+    const uint16_t* ends = (const uint16_t*)(block + kChunkHeader);
+    uint32_t start       = kChunkHeader + (_columns + 1) * sizeof(uint16_t);
+    for (uint8_t i = 0; i <= _columns; i++) {
+        if (ends[i] < start || ends[i] > _blockSize) return true;
+        streams[i] = {block, start * 8, (uint32_t)ends[i] * 8};
+        start      = ends[i];
+    }
+
+    Stream state[CAMS3_SERIES_MAX_COLUMNS + 1] = {};
+    double values[CAMS3_SERIES_MAX_COLUMNS];
+    int64_t timeMs = chunk->firstMs;
+
+    for (uint16_t row = 0; row < chunk->rows; row++) {
+        if (row > 0) {
+            BitReader& r = streams[0];
+            int64_t dod;
+            if (r.get(1) == 0) {
+                dod = 0;
+            } else if (r.get(1) == 0) {
+                dod = (int64_t)r.get(7) - 63;
+            } else if (r.get(1) == 0) {
+                dod = (int64_t)r.get(9) - 255;
+            } else if (r.get(1) == 0) {
+                dod = (int64_t)r.get(12) - 2047;
+            } else {
+                dod = (int64_t)r.get(64);
+            }
+            state[0].delta += dod;
+            timeMs += state[0].delta;
+        }
+
+        for (uint8_t c = 0; c < _columns; c++) {
+            BitReader& r = streams[c + 1];
+            Stream& s    = state[c + 1];
+
+            if (_types[c] == CAMS3_SERIES_INT) {
+                int64_t v = (int64_t)s.prev + unzigzag(getVarint(r));
+                s.prev    = (uint64_t)v;
+                values[c] = (double)v;
+                continue;
+            }
+
+            uint32_t bits;
+            if (row == 0) {
+                bits = r.get(32);
+            } else if (r.get(1) == 0) {
+                bits = s.prev;
+            } else if (r.get(1) == 0) {
+                bits = s.prev ^ (r.get(32 - s.leading - s.trailing) << s.trailing);
+            } else {
+                s.leading   = r.get(5);
+                uint8_t len = r.get(5) + 1;
+                s.trailing  = 32 - s.leading - len;
+                bits        = s.prev ^ (r.get(len) << s.trailing);
+            }
+            s.prev = bits;
+            float f;
+            memcpy(&f, &bits, 4);
+            values[c] = f;
+        }
+
+        if (timeMs > toMs) return false;
+        if (timeMs >= fromMs) {
+            delivered++;
+            if (!cb(timeMs, values, arg)) return false;
+        }
+    }
+    return true;
+}
+
+int32_t CamS3_Series::query(int64_t fromMs, int64_t toMs, cams3_series_cb_t cb, void* arg) {
+    if (!_open || !cb) return -1;
+    _stats.queryChunks = 0;
+    int32_t delivered  = 0;
+    if (fromMs > toMs) return 0;
+
+    // First chunk that ends at or after fromMs
+    uint32_t lo = 0, hi = _chunk;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        cams3_series_chunk_t header;
+        if (!_readBlock(mid, (uint8_t*)&header, true)) return -1;
+        if (header.lastMs < fromMs) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (uint32_t c = lo; c < _chunk; c++) {
+        if (!_readBlock(c, _block, false)) {
+            Serial.printf("[CamS3 Series] Chunk %lu is damaged, skipped\n", (unsigned long)c);
+            continue;
+        }
+        if (((cams3_series_chunk_t*)_block)->firstMs > toMs) return delivered;
+        _stats.queryChunks++;
+        if (!_decode(_block, fromMs, toMs, cb, arg, delivered)) return delivered;
+    }
+
+    // Rows of the open chunk, which may be newer in RAM than on the card
+    if (_rows && _lastMs >= fromMs && _firstMs <= toMs) {
+        _buildBlock(_block);
+        _stats.queryChunks++;
+        _decode(_block, fromMs, toMs, cb, arg, delivered);
+    }
+    return delivered;
+}
+
+int CamS3_Series::getColumn(const char* name) {
+    for (uint8_t i = 0; name && i < _columns; i++) {
+        if (strcmp(_names[i], name) == 0) return i;
+    }
+    return -1;
+}
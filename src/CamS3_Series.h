@@ -0,0 +1,241 @@
+/**
+ * @file CamS3_Series.h
+ * @brief Compact on-card time-series store for CamS3Library
+ *
+ * Stores rows of numeric telemetry (a timestamp and a fixed set of
+ * columns) in one file of fixed-size blocks, normally one card sector
+ * each. Every block is a self-contained columnar chunk: the timestamps
+ * of its rows as delta-of-delta codes, then each column on its own, float
+ * columns XOR-coded against the previous value and integer columns as
+ * zigzag varint deltas. Regular sampling costs one bit per timestamp and
+ * slowly changing values a few bits each.
+ *
+ * File layout (little-endian, blockSize bytes per block):
+ *   block 0   cams3_series_header_t, the column schema
+ *   block n   chunk n-1: cams3_series_chunk_t, then a uint16_t table with
+ *             the end offset of each stream (timestamps, then one per
+ *             column), then the streams
+ *
+ * Chunks are in time order, so a range query binary-searches the chunk
+ * headers and decodes only the chunks that overlap the range.
+ * tools/cams3_series.py reads the file on a PC.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef _CAMS3_SERIES_H_
+#define _CAMS3_SERIES_H_
+
+#include "CamS3Library.h"
+
+#define CAMS3_SERIES_MAGIC       "CS3S"
+#define CAMS3_SERIES_CHUNK_MAGIC 0x74335343  // "CS3t"
+#define CAMS3_SERIES_VERSION     1
+#define CAMS3_SERIES_BLOCK       512         // One sector per chunk by default
+#define CAMS3_SERIES_MAX_BLOCK   4096
+#define CAMS3_SERIES_MAX_COLUMNS 16
+#define CAMS3_SERIES_NAME_LEN    15
+#define CAMS3_SERIES_FLUSH_MS    10000
+
+// Column types
+#define CAMS3_SERIES_FLOAT 0  // 32-bit float, XOR-coded
+#define CAMS3_SERIES_INT   1  // 64-bit integer, zigzag varint deltas
+
+typedef struct __attribute__((packed)) {
+    char name[CAMS3_SERIES_NAME_LEN];  // NUL-padded
+    uint8_t type;                      // CAMS3_SERIES_FLOAT / INT
+} cams3_series_column_t;
+
+typedef struct __attribute__((packed)) {
+    char magic[4];  // CAMS3_SERIES_MAGIC
+    uint16_t version;
+    uint16_t blockSize;
+    uint8_t columns;
+    uint8_t reserved[3];
+    cams3_series_column_t column[CAMS3_SERIES_MAX_COLUMNS];
+    uint32_t crc32;  // CRC-32 of the bytes above
+} cams3_series_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;     // CAMS3_SERIES_CHUNK_MAGIC
+    uint32_t sequence;  // Chunk number, from 0
+    int64_t firstMs;    // Time of the first row
+    int64_t lastMs;     // Time of the last row
+    uint16_t rows;
+    uint8_t columns;
+    uint8_t reserved;
+    uint32_t crc32;     // CRC-32 of the whole block, computed with this field 0
+} cams3_series_chunk_t;
+
+typedef struct {
+    uint64_t rows;         // Rows appended this session
+    uint32_t chunks;       // Chunks sealed this session
+    uint32_t writes;       // Block writes, partial chunk rewrites included
+    uint32_t queryChunks;  // Chunks decoded by the last query
+} cams3_series_stats_t;
+
+/**
+ * @brief Row callback for range queries
+ * @param timeMs Row time
+ * @param values One value per column
+ * @param arg User argument
+ * @return false to stop the query
+ */
+typedef bool (*cams3_series_cb_t)(int64_t timeMs, const double* values, void* arg);
+
+// ============================================
+// Time Series Class
+// ============================================
+class CamS3_Series {
+   private:
+    struct Stream {
+        uint32_t bits;    // Encoded length
+        uint64_t prev;    // Previous value: float bits, integer or time
+        int64_t delta;    // Timestamps: previous delta
+        uint8_t leading;  // Floats: meaningful-bit window of the last XOR
+        uint8_t trailing;
+    };
+
+    File _file;
+    bool _open          = false;
+    uint16_t _blockSize = CAMS3_SERIES_BLOCK;
+    uint8_t _columns    = 0;
+    uint8_t _types[CAMS3_SERIES_MAX_COLUMNS];
+    char _names[CAMS3_SERIES_MAX_COLUMNS][CAMS3_SERIES_NAME_LEN + 1];
+
+    // Open chunk: stream 0 holds the timestamps, stream i + 1 column i
+    uint8_t* _streams = nullptr;  // One buffer per stream, _blockSize + kStreamSlack bytes each
+    Stream _state[CAMS3_SERIES_MAX_COLUMNS + 1];
+    uint16_t _rows    = 0;
+    int64_t _firstMs  = 0;
+    int64_t _lastMs   = 0;
+    uint32_t _chunk   = 0;        // Sequence of the open chunk = number of chunks before it
+    uint8_t* _block   = nullptr;  // Block being written or decoded
+
+    uint32_t _flushMs           = CAMS3_SERIES_FLUSH_MS;
+    uint32_t _lastFlush         = 0;
+    bool _dirty                 = false;
+    cams3_series_stats_t _stats = {};
+
+    bool _create(fs::FS& fs, const char* path, const cams3_series_column_t* columns, uint8_t count,
+                 uint16_t blockSize);
+    bool _load(fs::FS& fs, const char* path);
+    void _reset();
+    void _encodeRow(int64_t timeMs, const double* values);
+    size_t _chunkBytes();
+    void _buildBlock(uint8_t* block);
+    bool _writeChunk();
+    bool _seal();
+    bool _readBlock(uint32_t chunk, uint8_t* block, bool headerOnly);
+    bool _decode(const uint8_t* block, int64_t fromMs, int64_t toMs, cams3_series_cb_t cb, void* arg,
+                 int32_t& delivered);
+
+   public:
+    ~CamS3_Series();
+
+    /**
+     * @brief Create a store, or continue an existing one with the same columns
+     *
+     * @param sd Mounted SD card
+     * @param path Store file path, e.g. "/telemetry.cs3t"
+     * @param columns Column names and types
+     * @param count Number of columns (1 to 16)
+     * @param blockSize Chunk size, a multiple of 512 up to 4096 (new files only)
+     * @return true if successful; false if the file exists with other columns
+     */
+    bool begin(CamS3_SD& sd, const char* path, const cams3_series_column_t* columns, uint8_t count,
+               uint16_t blockSize = CAMS3_SERIES_BLOCK);
+
+    /**
+     * @brief Open an existing store with the columns it was created with
+     * @return true if successful
+     */
+    bool begin(CamS3_SD& sd, const char* path);
+
+    /**
+     * @brief Write the open chunk and close the file
+     */
+    void end();
+
+    bool isOpen() {
+        return _open;
+    }
+
+    /**
+     * @brief Append a row
+     *
+     * Rows are encoded into the open chunk in RAM; a full chunk is written
+     * as one block. The open chunk is also rewritten in place once the
+     * flush interval has passed, so at most that much data is at risk.
+     *
+     * @param timeMs Row time, e.g. epoch milliseconds; must not go backwards, also across sessions
+     * @param values One value per column
+     * @return true if successful
+     */
+    bool append(int64_t timeMs, const double* values);
+
+    /**
+     * @brief Write the open chunk now
+     * @return true if successful
+     */
+    bool flush();
+
+    /**
+     * @brief Set the longest time appended rows stay in RAM only
+     * @param ms Interval in milliseconds (0 = only full chunks and explicit flushes)
+     */
+    void setFlushInterval(uint32_t ms) {
+        _flushMs = ms;
+    }
+
+    /**
+     * @brief Read the rows with fromMs <= time <= toMs, oldest first
+     *
+     * Only the chunks overlapping the range are read from the card, found
+     * by a binary search over the chunk headers. Rows not yet flushed are
+     * included.
+     *
+     * @param fromMs Range start
+     * @param toMs Range end (inclusive)
+     * @param cb Called for every row in the range
+     * @param arg Passed to the callback
+     * @return Rows delivered, or -1 on a read error
+     */
+    int32_t query(int64_t fromMs, int64_t toMs, cams3_series_cb_t cb, void* arg = nullptr);
+
+    uint8_t getColumnCount() {
+        return _columns;
+    }
+
+    /**
+     * @brief Get a column index by name
+     * @return Index, or -1 if there is no such column
+     */
+    int getColumn(const char* name);
+
+    const char* getColumnName(uint8_t column) {
+        return column < _columns ? _names[column] : "";
+    }
+
+    /**
+     * @brief Get the number of chunks in the store, the open one included
+     * @return Chunk count
+     */
+    uint32_t getChunkCount() {
+        return _chunk + (_rows ? 1 : 0);
+    }
+
+    /**
+     * @brief Get the time of the newest row
+     * @return Time, or 0 if the store is empty
+     */
+    int64_t getLastTime() {
+        return _lastMs;
+    }
+
+    const cams3_series_stats_t& getStats() {
+        return _stats;
+    }
+};
+
+#endif  // _CAMS3_SERIES_H_
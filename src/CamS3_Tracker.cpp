@@ -0,0 +1,347 @@
+/**
+ * @file CamS3_Tracker.cpp
+ * @brief Blob tracking and line-crossing counting for CamS3Library
+ *
+ * @copyright MIT License
+ */
+
+#include "CamS3_Tracker.h"
+#include <esp_timer.h>
+
+// ============================================
+// CamS3_Tracker Implementation
+// ============================================
+
+CamS3_Tracker::~CamS3_Tracker() {
+    end();
+}
+
+bool CamS3_Tracker::begin(const cams3_tracker_config_t* config) {
+    if (config) {
+        if (config->maxDistance == 0) return false;
+        _config = *config;
+    }
+    if (!_runs) _runs = (Run*)malloc(CAMS3_TRACKER_MAX_RUNS * sizeof(Run));
+    if (!_parent) _parent = (uint16_t*)malloc(CAMS3_TRACKER_MAX_RUNS * sizeof(uint16_t));
+    if (!_runs || !_parent) {
+        end();
+        return false;
+    }
+    _blobCount  = 0;
+    _trackCount = 0;
+    _bgValid    = false;
+    return true;
+}
+
+void CamS3_Tracker::end() {
+    free(_runs);
+    free(_parent);
+    free(_dc);
+    free(_bg);
+    free(_mask);
+    _runs       = nullptr;
+    _parent     = nullptr;
+    _dc         = nullptr;
+    _bg         = nullptr;
+    _mask       = nullptr;
+    _maskSize   = 0;
+    _bgValid    = false;
+    _blobCount  = 0;
+    _trackCount = 0;
+}
+
+int CamS3_Tracker::addLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    if (_lineCount >= CAMS3_TRACKER_MAX_LINES || (x0 == x1 && y0 == y1)) return -1;
+
+    Line& line    = _lines[_lineCount];
+    line.x0       = x0;
+    line.y0       = y0;
+    line.x1       = x1;
+    line.y1       = y1;
+    line.forward  = 0;
+    line.backward = 0;
+
+    // Existing tracks have not been placed relative to the new line yet
+    for (uint8_t i = 0; i < _trackCount; i++) {
+        _tracks[i].side[_lineCount] = _side(line, _tracks[i].t.cx, _tracks[i].t.cy);
+    }
+    return _lineCount++;
+}
+
+void CamS3_Tracker::resetCounts() {
+    for (uint8_t i = 0; i < _lineCount; i++) {
+        _lines[i].forward  = 0;
+        _lines[i].backward = 0;
+    }
+}
+
+// ============================================
+// Connected Components
+// ============================================
+
+uint16_t CamS3_Tracker::_find(uint16_t label) {
+    while (_parent[label] != label) {
+        _parent[label] = _parent[_parent[label]];  // Path halving
+        label          = _parent[label];
+    }
+    return label;
+}
+
+bool CamS3_Tracker::_label(const uint8_t* mask, uint16_t width, uint16_t height) {
+    uint16_t count     = 0;
+    uint16_t prevStart = 0;  // Runs of the previous row: [prevStart, prevEnd)
+    uint16_t prevEnd   = 0;
+
+    for (uint16_t y = 0; y < height; y++) {
+        const uint8_t* row = mask + (size_t)y * width;
+        uint16_t rowStart  = count;
+        uint16_t p         = prevStart;
+
+        uint16_t x = 0;
+        while (x < width) {
+            if (!row[x]) {
+                x++;
+                continue;
+            }
+            uint16_t x0 = x;
+            while (x < width && row[x]) x++;
+            if (count >= CAMS3_TRACKER_MAX_RUNS) return false;
+
+            Run& r         = _runs[count];
+            r.row          = y;
+            r.x0           = x0;
+            r.x1           = x - 1;
+            r.label        = count;
+            _parent[count] = count;
+
+            // Join every run above that touches this one, diagonals included
+            while (p < prevEnd && _runs[p].x1 + 1 < r.x0) p++;
+            for (uint16_t q = p; q < prevEnd && _runs[q].x0 <= r.x1 + 1; q++) {
+                uint16_t a = _find(_runs[q].label);
+                uint16_t b = _find(r.label);
+                if (a != b) {
+                    if (a < b) {
+                        _parent[b] = a;
+                    } else {
+                        _parent[a] = b;
+                    }
+                }
+            }
+            count++;
+        }
+        prevStart = rowStart;
+        prevEnd   = count;
+    }
+
+    // Gather statistics per root; roots are mapped to blob slots on first sight
+    uint32_t sumX[CAMS3_TRACKER_MAX_BLOBS];
+    uint32_t sumY[CAMS3_TRACKER_MAX_BLOBS];
+    uint16_t root[CAMS3_TRACKER_MAX_BLOBS];
+    uint16_t x1[CAMS3_TRACKER_MAX_BLOBS];
+    uint16_t y1[CAMS3_TRACKER_MAX_BLOBS];
+    uint8_t n = 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        const Run& r = _runs[i];
+        uint16_t lbl = _find(r.label);
+        uint8_t b    = 0;
+        while (b < n && root[b] != lbl) b++;
+        if (b == n) {
+            if (n == CAMS3_TRACKER_MAX_BLOBS) continue;  // Budget: extra components are ignored
+            root[n]        = lbl;
+            sumX[n]        = 0;
+            sumY[n]        = 0;
+            _blobs[n].x    = r.x0;
+            _blobs[n].y    = r.row;
+            x1[n]          = r.x1;
+            y1[n]          = r.row;
+            _blobs[n].area = 0;
+            n++;
+        }
+
+        uint32_t len = r.x1 - r.x0 + 1;
+        _blobs[b].area += len;
+        sumX[b] += len * (r.x0 + r.x1) * 8;  // Sum of cell centres, x16
+        sumY[b] += len * (r.row * 16 + 8);
+        if (r.x0 < _blobs[b].x) _blobs[b].x = r.x0;
+        if (r.x1 > x1[b]) x1[b] = r.x1;
+        if (r.row > y1[b]) y1[b] = r.row;
+    }
+
+    _blobCount = 0;
+    for (uint8_t b = 0; b < n; b++) {
+        if (_blobs[b].area < _config.minArea) continue;
+        cams3_blob_t& out = _blobs[_blobCount++];
+        out               = _blobs[b];
+        out.w             = x1[b] - out.x + 1;
+        out.h             = y1[b] - out.y + 1;
+        out.cx            = sumX[b] / out.area + 8;
+        out.cy            = sumY[b] / out.area;
+    }
+    return true;
+}
+
+// ============================================
+// Tracking
+// ============================================
+
+int8_t CamS3_Tracker::_side(const Line& line, uint16_t cx, uint16_t cy) {
+    // Centroid in permille of the frame
+    int32_t px = (int32_t)cx * 1000 / (16 * _maskW);
+    int32_t py = (int32_t)cy * 1000 / (16 * _maskH);
+    int32_t c  = (line.x1 - line.x0) * (py - line.y0) - (line.y1 - line.y0) * (px - line.x0);
+    return (c > 0) - (c < 0);
+}
+
+void CamS3_Tracker::_checkLines(Track& tr, uint16_t oldX, uint16_t oldY) {
+    for (uint8_t l = 0; l < _lineCount; l++) {
+        const Line& line = _lines[l];
+        int8_t side      = _side(line, tr.t.cx, tr.t.cy);
+        if (side == 0) continue;  // On the line: keep the last side until it leaves
+        int8_t last = tr.side[l];
+        tr.side[l]  = side;
+        if (last == 0 || last == side) continue;
+
+        // The path changed sides of the infinite line; it must also pass between the end points
+        Line path = {(int32_t)oldX * 1000 / (16 * _maskW), (int32_t)oldY * 1000 / (16 * _maskH),
+                     (int32_t)tr.t.cx * 1000 / (16 * _maskW), (int32_t)tr.t.cy * 1000 / (16 * _maskH), 0, 0};
+        int32_t a = (path.x1 - path.x0) * (line.y0 - path.y0) - (path.y1 - path.y0) * (line.x0 - path.x0);
+        int32_t b = (path.x1 - path.x0) * (line.y1 - path.y0) - (path.y1 - path.y0) * (line.x1 - path.x0);
+        if ((a > 0 && b > 0) || (a < 0 && b < 0)) continue;
+
+        // With y pointing down, the left-hand side of the line has the negative cross product
+        bool forward = side < 0;
+        if (forward) {
+            _lines[l].forward++;
+        } else {
+            _lines[l].backward++;
+        }
+        if (_callback) _callback(l, forward, &tr.t, _ctx);
+    }
+}
+
+void CamS3_Tracker::_match() {
+    bool blobUsed[CAMS3_TRACKER_MAX_BLOBS]   = {false};
+    bool trackUsed[CAMS3_TRACKER_MAX_TRACKS] = {false};
+    const uint32_t maxDist                   = (uint32_t)_config.maxDistance * 16;
+
+    // Greedy nearest pairs first; small counts make the quadratic scan cheap
+    for (;;) {
+        uint32_t best = maxDist * maxDist + 1;
+        int bt        = -1;
+        int bb        = -1;
+        for (uint8_t t = 0; t < _trackCount; t++) {
+            if (trackUsed[t]) continue;
+            for (uint8_t b = 0; b < _blobCount; b++) {
+                if (blobUsed[b]) continue;
+                int32_t dx = (int32_t)_blobs[b].cx - _tracks[t].t.cx;
+                int32_t dy = (int32_t)_blobs[b].cy - _tracks[t].t.cy;
+                uint32_t d = dx * dx + dy * dy;
+                if (d < best) {
+                    best = d;
+                    bt   = t;
+                    bb   = b;
+                }
+            }
+        }
+        if (bt < 0) break;
+
+        Track& tr     = _tracks[bt];
+        uint16_t oldX = tr.t.cx;
+        uint16_t oldY = tr.t.cy;
+        tr.t.cx       = _blobs[bb].cx;
+        tr.t.cy       = _blobs[bb].cy;
+        tr.t.blob     = _blobs[bb];
+        tr.t.missed   = 0;
+        if (tr.t.age < 0xFFFF) tr.t.age++;
+        trackUsed[bt] = true;
+        blobUsed[bb]  = true;
+        _checkLines(tr, oldX, oldY);
+    }
+
+    // Age out unmatched tracks, keeping the array packed
+    uint8_t kept = 0;
+    for (uint8_t t = 0; t < _trackCount; t++) {
+        if (!trackUsed[t] && ++_tracks[t].t.missed > _config.maxMissed) continue;
+        if (kept != t) _tracks[kept] = _tracks[t];
+        kept++;
+    }
+    _trackCount = kept;
+
+    // Unmatched blobs start new tracks
+    for (uint8_t b = 0; b < _blobCount && _trackCount < CAMS3_TRACKER_MAX_TRACKS; b++) {
+        if (blobUsed[b]) continue;
+        Track& tr   = _tracks[_trackCount++];
+        tr.t.id     = _nextId++;
+        tr.t.cx     = _blobs[b].cx;
+        tr.t.cy     = _blobs[b].cy;
+        tr.t.age    = 0;
+        tr.t.missed = 0;
+        tr.t.blob   = _blobs[b];
+        if (_nextId == 0) _nextId = 1;
+        for (uint8_t l = 0; l < _lineCount; l++) {
+            tr.side[l] = _side(_lines[l], tr.t.cx, tr.t.cy);
+        }
+    }
+}
+
+bool CamS3_Tracker::process(const uint8_t* mask, uint16_t width, uint16_t height) {
+    if (!_runs || !mask || width == 0 || height == 0) return false;
+    int64_t start = esp_timer_get_time();
+
+    // A new mask size invalidates track positions
+    if (width != _maskW || height != _maskH) {
+        _maskW      = width;
+        _maskH      = height;
+        _trackCount = 0;
+    }
+
+    if (!_label(mask, width, height)) {
+        _skipped++;
+        _lastUs = esp_timer_get_time() - start;
+        return false;
+    }
+    _match();
+    _lastUs = esp_timer_get_time() - start;
+    return true;
+}
+
+bool CamS3_Tracker::processJpeg(const uint8_t* jpeg, size_t len) {
+    if (!_runs || !jpeg || !_jpeg.parse(jpeg, len)) return false;
+    int64_t start = esp_timer_get_time();
+
+    const uint16_t w = _jpeg.getDCWidth();
+    const uint16_t h = _jpeg.getDCHeight();
+    const size_t n   = (size_t)w * h;
+    if (n != _maskSize) {
+        free(_dc);
+        free(_bg);
+        free(_mask);
+        _dc       = (uint8_t*)malloc(n);
+        _bg       = (uint16_t*)malloc(n * sizeof(uint16_t));
+        _mask     = (uint8_t*)malloc(n);
+        _maskSize = (_dc && _bg && _mask) ? n : 0;
+        _bgValid  = false;
+        if (!_maskSize) return false;
+    }
+    if (!_jpeg.decodeDC(_dc, n)) return false;
+
+    if (!_bgValid) {
+        for (size_t i = 0; i < n; i++) _bg[i] = _dc[i] << 8;
+        _bgValid = true;
+    }
+
+    // Foreground cells adapt too, only slower, so parked objects fade into the background
+    const uint8_t shift = _config.backgroundShift;
+    for (size_t i = 0; i < n; i++) {
+        int32_t bg   = _bg[i];
+        int32_t diff = ((int32_t)_dc[i] << 8) - bg;
+        bool moving  = abs(diff) > ((int32_t)_config.motionThreshold << 8);
+        _mask[i]     = moving;
+        _bg[i]       = bg + (diff >> (moving ? shift + 2 : shift));
+    }
+
+    bool ok = process(_mask, w, h);
+    _lastUs = esp_timer_get_time() - start;
+    return ok;
+}
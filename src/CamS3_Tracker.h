@@ -0,0 +1,245 @@
+/**
+ * @file CamS3_Tracker.h
+ * @brief Blob tracking and line-crossing counting for CamS3Library
+ *
+ * Takes binary motion masks (from any source, or built here from the DC
+ * image of hardware JPEG frames), extracts connected components with
+ * run-length labeling, follows them across frames by centroid matching and
+ * counts crossings of virtual lines. Work per frame is bounded by the fixed
+ * run, blob and track limits below.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef _CAMS3_TRACKER_H_
+#define _CAMS3_TRACKER_H_
+
+#include "CamS3Library.h"
+
+// Tracker limits
+#define CAMS3_TRACKER_MAX_RUNS   2048  // Mask runs per frame; busier frames are skipped
+#define CAMS3_TRACKER_MAX_BLOBS  32
+#define CAMS3_TRACKER_MAX_TRACKS 16
+#define CAMS3_TRACKER_MAX_LINES  4
+
+typedef struct {
+    uint16_t minArea;         // Smallest blob kept, in mask cells
+    uint16_t maxDistance;     // Largest centroid jump matched to a track, in mask cells
+    uint8_t maxMissed;        // Frames a track survives without a matching blob
+    uint8_t motionThreshold;  // Luma difference from the background that counts as motion (JPEG masks)
+    uint8_t backgroundShift;  // Background adapts by 1/2^n of the difference per frame (JPEG masks)
+} cams3_tracker_config_t;
+
+#define CAMS3_TRACKER_CONFIG_DEFAULT {4, 12, 3, 20, 4}
+
+typedef struct {
+    uint16_t x, y, w, h;  // Bounding box in mask cells
+    uint16_t cx, cy;      // Centroid in mask cells, x16
+    uint32_t area;
+} cams3_blob_t;
+
+typedef struct {
+    uint16_t id;
+    uint16_t cx, cy;      // Centroid in mask cells, x16
+    uint16_t age;         // Frames since the track started
+    uint8_t missed;       // Frames since it last matched a blob
+    cams3_blob_t blob;    // Last matched blob
+} cams3_track_t;
+
+/**
+ * @brief Called when a track crosses a counting line
+ * @param line Line index
+ * @param forward true if crossing toward the left-hand side of the line (walking from its first to second point)
+ * @param track Track that crossed
+ * @param ctx User context
+ */
+typedef void (*cams3_crossing_callback_t)(uint8_t line, bool forward, const cams3_track_t* track, void* ctx);
+
+// ============================================
+// Tracker Class
+// ============================================
+class CamS3_Tracker {
+   private:
+    struct Run {
+        uint16_t row;
+        uint16_t x0, x1;  // Inclusive
+        uint16_t label;
+    };
+
+    struct Line {
+        int32_t x0, y0, x1, y1;  // Permille of the frame
+        uint32_t forward;
+        uint32_t backward;
+    };
+
+    struct Track {
+        cams3_track_t t;
+        int8_t side[CAMS3_TRACKER_MAX_LINES];  // Last side of each line: -1, 0 (on it) or 1
+    };
+
+    cams3_tracker_config_t _config = CAMS3_TRACKER_CONFIG_DEFAULT;
+
+    Run* _runs         = nullptr;
+    uint16_t* _parent  = nullptr;
+    cams3_blob_t _blobs[CAMS3_TRACKER_MAX_BLOBS];
+    uint8_t _blobCount = 0;
+    Track _tracks[CAMS3_TRACKER_MAX_TRACKS];
+    uint8_t _trackCount = 0;
+    uint16_t _nextId    = 1;
+    Line _lines[CAMS3_TRACKER_MAX_LINES];
+    uint8_t _lineCount  = 0;
+    uint16_t _maskW     = 0;
+    uint16_t _maskH     = 0;
+
+    cams3_crossing_callback_t _callback = nullptr;
+    void* _ctx                          = nullptr;
+    uint32_t _skipped                   = 0;
+    uint32_t _lastUs                    = 0;
+
+    // Background model for masks built from JPEG frames
+    CamS3_JpegDecoder _jpeg;
+    uint8_t* _dc      = nullptr;
+    uint16_t* _bg     = nullptr;  // Luma x256
+    uint8_t* _mask    = nullptr;
+    size_t _maskSize  = 0;
+    bool _bgValid     = false;
+
+    uint16_t _find(uint16_t label);
+    bool _label(const uint8_t* mask, uint16_t width, uint16_t height);
+    void _match();
+    void _checkLines(Track& tr, uint16_t oldX, uint16_t oldY);
+    int8_t _side(const Line& line, uint16_t cx, uint16_t cy);
+
+   public:
+    ~CamS3_Tracker();
+
+    /**
+     * @brief Allocate the run buffers
+     * @param config Tracker settings (nullptr for CAMS3_TRACKER_CONFIG_DEFAULT)
+     * @return true if successful
+     */
+    bool begin(const cams3_tracker_config_t* config = nullptr);
+
+    /**
+     * @brief Release all buffers and tracks
+     */
+    void end();
+
+    /**
+     * @brief Add a counting line
+     *
+     * Coordinates are in permille of the frame (0-1000), so lines do not
+     * depend on the mask resolution.
+     *
+     * @return Line index, or -1 if CAMS3_TRACKER_MAX_LINES lines exist
+     */
+    int addLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+    /**
+     * @brief Remove all lines
+     *
+     * Only the line count is reset: getCount() returns 0 for the old
+     * indices, and addLine() numbers lines from 0 again with fresh counts.
+     * Tracks and their IDs are kept.
+     */
+    void clearLines() {
+        _lineCount = 0;
+    }
+
+    /**
+     * @brief Set the function called for every line crossing
+     * @param callback Crossing handler (nullptr to remove)
+     * @param ctx User context for the callback
+     */
+    void setCallback(cams3_crossing_callback_t callback, void* ctx = nullptr) {
+        _callback = callback;
+        _ctx      = ctx;
+    }
+
+    /**
+     * @brief Track blobs in a binary motion mask
+     * @param mask One byte per cell, nonzero = motion
+     * @param width Mask width
+     * @param height Mask height
+     * @return true if the frame was processed (false if it had more than CAMS3_TRACKER_MAX_RUNS runs)
+     */
+    bool process(const uint8_t* mask, uint16_t width, uint16_t height);
+
+    /**
+     * @brief Build a motion mask from a JPEG frame's DC image and track it
+     *
+     * Each 8x8 luma block is compared with a running-average background; no
+     * IDCT is run.
+     *
+     * @param jpeg JPEG data
+     * @param len Data length
+     * @return true if the frame was processed
+     */
+    bool processJpeg(const uint8_t* jpeg, size_t len);
+
+    /**
+     * @brief Get the mask built by the last processJpeg() call
+     * @return Mask (getMaskWidth() x getMaskHeight()), or nullptr
+     */
+    const uint8_t* getMask() {
+        return _mask;
+    }
+
+    uint16_t getMaskWidth() {
+        return _maskW;
+    }
+
+    uint16_t getMaskHeight() {
+        return _maskH;
+    }
+
+    /**
+     * @brief Get the crossings of a line
+     * @param line Line index
+     * @param forward true for crossings toward the line's left-hand side
+     * @return Crossing count
+     */
+    uint32_t getCount(uint8_t line, bool forward) {
+        if (line >= _lineCount) return 0;
+        return forward ? _lines[line].forward : _lines[line].backward;
+    }
+
+    /**
+     * @brief Reset the crossing counts of all lines
+     */
+    void resetCounts();
+
+    uint8_t getBlobCount() {
+        return _blobCount;
+    }
+
+    const cams3_blob_t& getBlob(uint8_t i) {
+        return _blobs[i];
+    }
+
+    uint8_t getTrackCount() {
+        return _trackCount;
+    }
+
+    const cams3_track_t& getTrack(uint8_t i) {
+        return _tracks[i].t;
+    }
+
+    /**
+     * @brief Get the number of frames skipped for exceeding the run budget
+     * @return Skipped frames
+     */
+    uint32_t getSkippedFrames() {
+        return _skipped;
+    }
+
+    /**
+     * @brief Get the duration of the last process() or processJpeg() call
+     * @return Time in microseconds
+     */
+    uint32_t getLastProcessTime() {
+        return _lastUs;
+    }
+};
+
+#endif  // _CAMS3_TRACKER_H_
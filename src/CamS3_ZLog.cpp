@@ -0,0 +1,314 @@
+/**
+ * @file CamS3_ZLog.cpp
+ * @brief Compressed text log writer for CamS3Library
+ *
+ * @copyright MIT License
+ */
+
+#include "CamS3_ZLog.h"
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <stddef.h>
+
+// LZ4 block format limits
+static const size_t kMinMatch     = 4;
+static const size_t kLastLiterals = 5;   // The block always ends with this many literals
+static const size_t kMatchLimit   = 12;  // No match may start closer than this to the end
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t hash4(const uint8_t* p) {
+    return (read32(p) * 2654435761u) >> (32 - CAMS3_ZLOG_HASH_BITS);
+}
+
+static size_t packedBound(size_t len) {
+    return len + len / 255 + 16;
+}
+
+// Length beyond the 15 that fit in a token nibble
+static uint8_t* putLength(uint8_t* op, size_t len) {
+    for (len -= 15; len >= 255; len -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// One sequence: literals, then a match (matchLen 0 for the final literals-only sequence)
+static uint8_t* putSequence(uint8_t* op, const uint8_t* literals, size_t literalLen, size_t offset, size_t matchLen) {
+    uint8_t* token = op++;
+    *token         = (uint8_t)((literalLen < 15 ? literalLen : 15) << 4);
+    if (literalLen >= 15) op = putLength(op, literalLen);
+    memcpy(op, literals, literalLen);
+    op += literalLen;
+    if (!matchLen) return op;
+
+    *op++     = (uint8_t)offset;
+    *op++     = (uint8_t)(offset >> 8);
+    size_t ml = matchLen - kMinMatch;
+    *token |= (uint8_t)(ml < 15 ? ml : 15);
+    if (ml >= 15) op = putLength(op, ml);
+    return op;
+}
+
+CamS3_ZLog::~CamS3_ZLog() {
+    end();
+    if (_lock) vSemaphoreDelete(_lock);
+}
+
+bool CamS3_ZLog::begin(CamS3_SD& sd, const char* path, uint16_t blockSize) {
+    end();
+    if (!sd.isInitialized() || !path) return false;
+    if (blockSize < 512 || blockSize > CAMS3_ZLOG_MAX_BLOCK) return false;
+
+    _blockSize = blockSize;
+    _offset    = 0;
+    bool isNew = !sd.exists(path);
+    if (!isNew) {
+        File existing = sd.getFS().open(path, FILE_READ);
+        bool ok       = existing && _resume(existing);
+        existing.close();
+        if (!ok) {
+            Serial.printf("[CamS3 ZLog] %s is not a compressed log\n", path);
+            return false;
+        }
+    }
+
+    if (!_lock) {
+        _lock = xSemaphoreCreateMutex();
+        if (!_lock) return false;
+    }
+
+    _in    = (uint8_t*)malloc(_blockSize);
+    _out   = (uint8_t*)malloc(sizeof(cams3_zlog_block_t) + packedBound(_blockSize));
+    _table = (uint16_t*)malloc(sizeof(uint16_t) << CAMS3_ZLOG_HASH_BITS);
+    if (!_in || !_out || !_table) {
+        Serial.println("[CamS3 ZLog] Buffer allocation failed");
+        end();
+        return false;
+    }
+
+    _file = sd.getFS().open(path, FILE_APPEND);
+    if (!_file) {
+        Serial.printf("[CamS3 ZLog] Failed to open %s\n", path);
+        end();
+        return false;
+    }
+    if (isNew && !_writeHeader()) {
+        Serial.println("[CamS3 ZLog] Failed to write the header");
+        end();
+        return false;
+    }
+
+    _inLen = 0;
+    _stats = {};
+    _open  = true;
+
+    if (xTaskCreate(_taskMain, "cams3_zlog", 4096, this, tskIDLE_PRIORITY + 1, &_task) != pdPASS) {
+        Serial.println("[CamS3 ZLog] Failed to start flush task");
+        _task = nullptr;
+        end();
+        return false;
+    }
+    return true;
+}
+
+void CamS3_ZLog::end() {
+    if (_task) {
+        // Holding the lock, the task is waiting and never inside a write
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        vTaskDelete(_task);
+        _task = nullptr;
+        xSemaphoreGive(_lock);
+    }
+    if (_open) {
+        sync();
+        _file.close();
+        _open = false;
+    }
+    free(_in);
+    free(_out);
+    free(_table);
+    _in    = nullptr;
+    _out   = nullptr;
+    _table = nullptr;
+    _inLen = 0;
+}
+
+bool CamS3_ZLog::_writeHeader() {
+    cams3_zlog_header_t header = {};
+    memcpy(header.magic, CAMS3_ZLOG_MAGIC, 4);
+    header.version    = CAMS3_ZLOG_VERSION;
+    header.blockSize  = _blockSize;
+    header.headerSize = sizeof(cams3_zlog_block_t);
+    header.crc32      = esp_rom_crc32_le(0, (const uint8_t*)&header, offsetof(cams3_zlog_header_t, crc32));
+    return _file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+}
+
+bool CamS3_ZLog::_resume(File& file) {
+    cams3_zlog_header_t header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) return false;
+    if (memcmp(header.magic, CAMS3_ZLOG_MAGIC, 4) != 0 ||
+        header.crc32 != esp_rom_crc32_le(0, (const uint8_t*)&header, offsetof(cams3_zlog_header_t, crc32)) ||
+        header.headerSize != sizeof(cams3_zlog_block_t) || header.blockSize < 512 ||
+        header.blockSize > CAMS3_ZLOG_MAX_BLOCK) {
+        return false;
+    }
+    _blockSize = header.blockSize;
+
+    // A block is never larger than its header plus blockSize, so the last complete one starts within
+    // the last two of those, even after a torn write at the end of the file
+    size_t size  = file.size();
+    size_t span  = 2 * (sizeof(cams3_zlog_block_t) + _blockSize);
+    size_t start = size > sizeof(header) + span ? size - span : sizeof(header);
+    size_t n     = size - start;
+    if (n < sizeof(cams3_zlog_block_t)) return true;
+
+    uint8_t* tail = (uint8_t*)malloc(n);
+    if (!tail) return false;
+    if (!file.seek(start) || file.read(tail, n) != n) {
+        free(tail);
+        return false;
+    }
+    for (size_t i = n - sizeof(cams3_zlog_block_t) + 1; i-- > 0;) {
+        cams3_zlog_block_t block;
+        memcpy(&block, tail + i, sizeof(block));
+        if (block.magic == CAMS3_ZLOG_BLOCK_MAGIC &&
+            block.headerCrc ==
+                (uint16_t)esp_rom_crc32_le(0, (const uint8_t*)&block, offsetof(cams3_zlog_block_t, headerCrc)) &&
+            i + sizeof(block) + block.packedLen <= n) {
+            _offset = block.offset + block.rawLen;
+            break;
+        }
+    }
+    free(tail);
+    return true;
+}
+
+size_t CamS3_ZLog::write(const uint8_t* data, size_t len) {
+    if (!_open) return 0;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    bool started = _inLen == 0;
+    size_t done  = 0;
+    while (done < len) {
+        if (_inLen == 0) _pendingSince = millis();
+        size_t n = min(len - done, (size_t)(_blockSize - _inLen));
+        memcpy(_in + _inLen, data + done, n);
+        _inLen += n;
+        done += n;
+        if (_inLen == _blockSize && !_writeBlock()) break;
+    }
+    xSemaphoreGive(_lock);
+
+    // A new partial block: the flush task starts timing it
+    if (started && _task) xTaskNotifyGive(_task);
+    return done;
+}
+
+bool CamS3_ZLog::sync() {
+    if (!_open) return false;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    bool ok = _writeBlock();
+    _file.flush();
+    xSemaphoreGive(_lock);
+    return ok;
+}
+
+void CamS3_ZLog::_taskMain(void* arg) {
+    CamS3_ZLog* self = (CamS3_ZLog*)arg;
+
+    for (;;) {
+        TickType_t wait = portMAX_DELAY;
+        xSemaphoreTake(self->_lock, portMAX_DELAY);
+        if (self->_flushMs && self->_inLen) {
+            uint32_t waited = millis() - self->_pendingSince;
+            if (waited >= self->_flushMs) {
+                self->_writeBlock();
+                self->_file.flush();
+            } else {
+                wait = pdMS_TO_TICKS(self->_flushMs - waited);
+            }
+        }
+        xSemaphoreGive(self->_lock);
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+bool CamS3_ZLog::_writeBlock() {
+    if (_inLen == 0) return true;
+
+    int64_t start             = esp_timer_get_time();
+    cams3_zlog_block_t* block = (cams3_zlog_block_t*)_out;
+    uint8_t* payload          = _out + sizeof(cams3_zlog_block_t);
+
+    size_t packed  = _compress(_in, _inLen, payload);
+    uint16_t flags = 0;
+    if (packed >= _inLen) {
+        memcpy(payload, _in, _inLen);
+        packed = _inLen;
+        flags  = CAMS3_ZLOG_STORED;
+    }
+
+    block->magic     = CAMS3_ZLOG_BLOCK_MAGIC;
+    block->rawLen    = _inLen;
+    block->packedLen = packed;
+    block->offset    = _offset;
+    block->rawCrc    = esp_rom_crc32_le(0, _in, _inLen);
+    block->flags     = flags;
+    block->headerCrc = esp_rom_crc32_le(0, _out, offsetof(cams3_zlog_block_t, headerCrc));
+    _stats.compressUs += esp_timer_get_time() - start;
+
+    size_t total = sizeof(cams3_zlog_block_t) + packed;
+    if (_file.write(_out, total) != total) {
+        Serial.println("[CamS3 ZLog] Block write failed");
+        return false;
+    }
+
+    _stats.blocks++;
+    if (flags & CAMS3_ZLOG_STORED) _stats.stored++;
+    _stats.rawBytes += _inLen;
+    _stats.packedBytes += total;
+    _offset += _inLen;
+    _inLen = 0;
+    return true;
+}
+
+size_t CamS3_ZLog::_compress(const uint8_t* src, size_t len, uint8_t* dst) {
+    memset(_table, 0, sizeof(uint16_t) << CAMS3_ZLOG_HASH_BITS);
+
+    uint8_t* op   = dst;
+    size_t anchor = 0;
+    size_t ip     = 0;
+
+    // Greedy parse: take the most recent earlier position with the same 4-byte hash if it matches
+    if (len > kMatchLimit) {
+        const size_t matchEnd = len - kLastLiterals;
+        while (ip < len - kMatchLimit) {
+            uint32_t h = hash4(src + ip);
+            size_t ref = _table[h];
+            _table[h]  = (uint16_t)(ip + 1);
+            if (ref == 0 || read32(src + ref - 1) != read32(src + ip)) {
+                ip++;
+                continue;
+            }
+            ref--;
+
+            size_t matchLen = kMinMatch;
+            while (ip + matchLen < matchEnd && src[ref + matchLen] == src[ip + matchLen]) {
+                matchLen++;
+            }
+            op = putSequence(op, src + anchor, ip - anchor, ip - ref, matchLen);
+            ip += matchLen;
+            anchor = ip;
+        }
+    }
+
+    op = putSequence(op, src + anchor, len - anchor, 0, 0);
+    return op - dst;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file CamS3_ZLog.h
+ * @brief Compressed text log writer for CamS3Library
+ *
+ * A Print that compresses what is written to it before it reaches the
+ * card. Text is collected into fixed-size blocks, and each full block is
+ * compressed on its own with an LZ4-compatible block coder, so memory is
+ * bounded by the block size and any block can be decoded without the
+ * ones before it.
+ *
+ * File layout (little-endian):
+ *   cams3_zlog_header_t   once, at the start of the file
+ *   blocks                back to back, each a cams3_zlog_block_t header
+ *                         followed by packedLen bytes of LZ4 block data
+ *                         (or the raw bytes when CAMS3_ZLOG_STORED is set)
+ *
+ * Every block header carries its offset in the uncompressed stream, so a
+ * reader finds a byte range by hopping from header to header and decodes
+ * only the blocks that overlap it. tools/cams3_zlog.py decompresses the
+ * file on a PC.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef _CAMS3_ZLOG_H_
+#define _CAMS3_ZLOG_H_
+
+#include "CamS3Library.h"
+
+#define CAMS3_ZLOG_MAGIC       "CS3Z"
+#define CAMS3_ZLOG_BLOCK_MAGIC 0x7A335343  // "CS3z"
+#define CAMS3_ZLOG_VERSION     1
+#define CAMS3_ZLOG_BLOCK       4096        // Default block (and window) size
+#define CAMS3_ZLOG_MAX_BLOCK   32768
+#define CAMS3_ZLOG_HASH_BITS   11          // Match finder table: 2 KB
+#define CAMS3_ZLOG_FLUSH_MS    5000
+
+// Block flags
+#define CAMS3_ZLOG_STORED 0x0001  // Payload is the uncompressed bytes
+
+typedef struct __attribute__((packed)) {
+    char magic[4];        // CAMS3_ZLOG_MAGIC
+    uint16_t version;
+    uint16_t blockSize;   // Largest rawLen of any block
+    uint16_t headerSize;  // sizeof(cams3_zlog_block_t)
+    uint16_t reserved;
+    uint32_t crc32;       // CRC-32 of the bytes above
+} cams3_zlog_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;       // CAMS3_ZLOG_BLOCK_MAGIC
+    uint16_t rawLen;      // Uncompressed bytes
+    uint16_t packedLen;   // Payload bytes following the header
+    uint64_t offset;      // Uncompressed stream offset of the first byte
+    uint32_t rawCrc;      // CRC-32 of the uncompressed bytes
+    uint16_t flags;       // CAMS3_ZLOG_*
+    uint16_t headerCrc;   // Low 16 bits of the CRC-32 of the bytes above
+} cams3_zlog_block_t;
+
+typedef struct {
+    uint32_t blocks;
+    uint32_t stored;       // Blocks that did not compress
+    uint64_t rawBytes;
+    uint64_t packedBytes;  // Block headers included
+    uint64_t compressUs;   // Time spent compressing
+} cams3_zlog_stats_t;
+
+// ============================================
+// Compressed Log Class
+// ============================================
+class CamS3_ZLog : public Print {
+   private:
+    File _file;
+    bool _open          = false;
+    uint16_t _blockSize = CAMS3_ZLOG_BLOCK;
+    uint8_t* _in        = nullptr;  // Block being collected
+    size_t _inLen       = 0;
+    uint8_t* _out       = nullptr;  // Block header + compressed payload
+    uint16_t* _table    = nullptr;  // Match finder: last position + 1 for each hash
+
+    uint64_t _offset          = 0;  // Uncompressed bytes already in the file
+    uint32_t _flushMs         = CAMS3_ZLOG_FLUSH_MS;
+    uint32_t _pendingSince    = 0;  // millis() of the oldest buffered byte
+    cams3_zlog_stats_t _stats = {};
+
+    // Writes a partial block once it is due, even if nothing else is logged
+    SemaphoreHandle_t _lock = nullptr;
+    TaskHandle_t _task      = nullptr;
+
+    static void _taskMain(void* arg);
+    bool _writeHeader();
+    bool _resume(File& file);
+    bool _writeBlock();
+    size_t _compress(const uint8_t* src, size_t len, uint8_t* dst);
+
+   public:
+    ~CamS3_ZLog();
+
+    /**
+     * @brief Open (or continue) a compressed log
+     *
+     * A new file gets a header; an existing one is continued after its last
+     * complete block, in the block size it was created with.
+     *
+     * @param sd Mounted SD card
+     * @param path Log file path, e.g. "/diag.cs3z"
+     * @param blockSize Uncompressed bytes per block, 512 to 32768 (new files only)
+     * @return true if successful
+     */
+    bool begin(CamS3_SD& sd, const char* path, uint16_t blockSize = CAMS3_ZLOG_BLOCK);
+
+    /**
+     * @brief Write the partial block and close the file
+     */
+    void end();
+
+    bool isOpen() {
+        return _open;
+    }
+
+    /**
+     * @brief Append bytes to the log
+     *
+     * Only a copy until a block fills up; then the block is compressed and
+     * written. A partial block is written by a background task once its
+     * oldest byte has waited for the flush interval. Safe to call from
+     * several tasks.
+     *
+     * @return Bytes accepted
+     */
+    size_t write(const uint8_t* data, size_t len) override;
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    using Print::write;
+
+    /**
+     * @brief Compress and write the partial block now
+     *
+     * The next bytes start a new block, so frequent syncs cost ratio.
+     *
+     * @return true if successful
+     */
+    bool sync();
+
+    void flush() override {
+        sync();
+    }
+
+    /**
+     * @brief Set the longest time buffered text waits before it is written
+     * @param ms Interval in milliseconds (0 = only full blocks and explicit syncs)
+     */
+    void setFlushInterval(uint32_t ms) {
+        _flushMs = ms;
+        if (_task) xTaskNotifyGive(_task);  // Recompute the deadline
+    }
+
+    /**
+     * @brief Get the uncompressed size of the log, buffered bytes included
+     * @return Bytes
+     */
+    uint64_t getSize() {
+        return _offset + _inLen;
+    }
+
+    const cams3_zlog_stats_t& getStats() {
+        return _stats;
+    }
+
+    /**
+     * @brief Get the compression ratio of this session
+     * @return Uncompressed / written bytes (0 before the first block)
+     */
+    float getRatio() {
+        return _stats.packedBytes ? (float)_stats.rawBytes / _stats.packedBytes : 0;
+    }
+};
+
+#endif  // _CAMS3_ZLOG_H_
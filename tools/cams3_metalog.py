@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+"""Decode a CamS3Library binary metadata log (.cs3m) to CSV.
+
+The record layout is read from the schema header written by CamS3_MetaLog,
+so older and newer logs decode without changes to this tool.
+
+Usage: cams3_metalog.py frames.cs3m [-o out.csv]
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+MAGIC = b"CS3M"
+INT_FORMATS = {("u", 1): "B", ("u", 2): "H", ("u", 4): "I", ("u", 8): "Q",
+               ("i", 1): "b", ("i", 2): "h", ("i", 4): "i", ("i", 8): "q"}
+
+
+def read_schema(data):
+    if data[:4] != MAGIC:
+        raise ValueError("not a CamS3 metadata log")
+    version, header_size, record_size, field_count = struct.unpack_from("<HHHH", data, 4)
+    fields = []
+    for i in range(field_count):
+        name, offset, ftype, size = struct.unpack_from("<16sHBB", data, 16 + i * 20)
+        fields.append((name.rstrip(b"\0").decode(), offset, chr(ftype), size))
+    return version, header_size, record_size, fields
+
+
+def decode_field(record, offset, ftype, size):
+    raw = record[offset:offset + size]
+    if ftype == "s":
+        return raw.split(b"\0", 1)[0].decode(errors="replace")
+    return struct.unpack("<" + INT_FORMATS[(ftype, size)], raw)[0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log")
+    parser.add_argument("-o", "--output", help="CSV output file (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.log, "rb") as f:
+        data = f.read()
+    version, header_size, record_size, fields = read_schema(data)
+
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.writer(out)
+    writer.writerow([name for name, _, _, _ in fields])
+
+    body = data[header_size:]
+    count = len(body) // record_size
+    for i in range(count):
+        record = body[i * record_size:(i + 1) * record_size]
+        writer.writerow([decode_field(record, o, t, s) for _, o, t, s in fields])
+
+    if len(body) % record_size:
+        print("warning: trailing partial record ignored", file=sys.stderr)
+    print(f"v{version}: {count} records", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Read a CamS3Library raw recording region (.cs3r).
+
+The region file is copied off the card like any other file. The newest
+valid checkpoint gives the session; records are then followed from the
+start of the stream for as long as their session, sequence and CRCs check
+out, which also recovers records written after the last checkpoint.
+
+Usage: cams3_rawlog.py record.cs3r [--list] [--extract DIR]
+"""
+
+import argparse
+import os
+import struct
+import sys
+import wave
+import zlib
+
+MAGIC = b"CS3R"
+RECORD_MAGIC = 0x72335343
+SECTOR = 512
+DATA_START = 2
+CHECKPOINT = struct.Struct("<4sHHIIIIQqqI")
+RECORD = struct.Struct("<IIIIqIBBHII")
+TYPES = {1: "frame", 2: "audio", 3: "user"}
+PIXFORMAT_JPEG = 4
+
+
+def read_checkpoint(data):
+    best = None
+    for slot in range(2):
+        raw = data[slot * SECTOR:slot * SECTOR + CHECKPOINT.size]
+        if len(raw) < CHECKPOINT.size:
+            continue
+        fields = CHECKPOINT.unpack(raw)
+        if fields[0] != MAGIC or zlib.crc32(raw[:-4]) != fields[-1]:
+            continue
+        cp = dict(zip(("magic", "version", "record_size", "session", "checkpoint", "data_sectors",
+                       "records", "head", "start_us", "time_us", "crc32"), fields))
+        if best is None or cp["checkpoint"] > best["checkpoint"]:
+            best = cp
+    if best is None:
+        raise ValueError("no valid checkpoint: not a CamS3 raw recording")
+    return best
+
+
+def records(data, cp):
+    """Yield (header dict, payload) for every valid record of the session."""
+    pos = DATA_START * SECTOR
+    end = min(len(data), pos + cp["data_sectors"] * SECTOR)
+    sequence = 0
+    while pos + RECORD.size <= end:
+        raw = data[pos:pos + RECORD.size]
+        fields = RECORD.unpack(raw)
+        rec = dict(zip(("magic", "session", "sequence", "length", "time_us", "info", "type", "format",
+                        "reserved", "payload_crc", "header_crc"), fields))
+        if (rec["magic"] != RECORD_MAGIC or rec["session"] != cp["session"] or rec["sequence"] != sequence
+                or zlib.crc32(raw[:-4]) != rec["header_crc"]):
+            return
+        payload = data[pos + RECORD.size:pos + RECORD.size + rec["length"]]
+        if len(payload) != rec["length"] or zlib.crc32(payload) != rec["payload_crc"]:
+            return
+        rec["offset"] = pos - DATA_START * SECTOR
+        yield rec, payload
+        pos += RECORD.size + rec["length"]
+        sequence += 1
+
+
+def describe(rec):
+    if rec["type"] == 1:
+        return f"{rec['info'] >> 16}x{rec['info'] & 0xFFFF} format {rec['format']}"
+    if rec["type"] == 2:
+        return f"{rec['info']} Hz {rec['format']}-bit"
+    return ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("region")
+    parser.add_argument("--list", action="store_true", help="print every record")
+    parser.add_argument("--extract", metavar="DIR", help="write frames and a WAV of the audio to DIR")
+    args = parser.parse_args()
+
+    with open(args.region, "rb") as f:
+        data = f.read()
+    cp = read_checkpoint(data)
+
+    if args.extract:
+        os.makedirs(args.extract, exist_ok=True)
+    audio = None
+    counts = {}
+    total = 0
+    first_us = last_us = None
+    last = None
+
+    for rec, payload in records(data, cp):
+        name = TYPES.get(rec["type"], f"type{rec['type']}")
+        counts[name] = counts.get(name, 0) + 1
+        total += len(payload)
+        first_us = rec["time_us"] if first_us is None else first_us
+        last_us = rec["time_us"]
+        last = rec
+        if args.list:
+            print(f"{rec['sequence']:8d} {rec['time_us'] / 1e6:12.6f} {name:6s} {rec['length']:8d} {describe(rec)}")
+        if not args.extract:
+            continue
+        if rec["type"] == 1:
+            ext = "jpg" if rec["format"] == PIXFORMAT_JPEG else "raw"
+            with open(os.path.join(args.extract, f"frame_{rec['sequence']:06d}.{ext}"), "wb") as out:
+                out.write(payload)
+        elif rec["type"] == 2:
+            if audio is None:
+                audio = wave.open(os.path.join(args.extract, "audio.wav"), "wb")
+                audio.setnchannels(1)
+                audio.setsampwidth(rec["format"] // 8)
+                audio.setframerate(rec["info"])
+            audio.writeframes(payload)
+    if audio:
+        audio.close()
+
+    found = last["sequence"] + 1 if last else 0
+    stream = last["offset"] + RECORD.size + last["length"] if last else 0
+    print(f"session {cp['session']:08x}, checkpoint {cp['checkpoint']}: {cp['records']} records durable, "
+          f"{found} found ({found - cp['records']} after the checkpoint)", file=sys.stderr)
+    print(f"{stream} of {cp['data_sectors'] * SECTOR} stream bytes used, {total} payload bytes, "
+          + ", ".join(f"{n} {k}" for k, n in sorted(counts.items())), file=sys.stderr)
+    if first_us is not None and last_us > first_us:
+        print(f"{(last_us - first_us) / 1e6:.1f} s recorded", file=sys.stderr)
+    if found < cp["records"]:
+        print("warning: fewer records than the checkpoint promises, the region is damaged", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""Query a CamS3Library time-series store (.cs3t) and print CSV.
+
+Chunks are in time order: the first chunk of the range is found by a
+binary search over the chunk headers, and only chunks overlapping the
+range are decoded. Times are in the unit the device appended them in
+(normally milliseconds).
+
+Usage: cams3_series.py telemetry.cs3t [--from MS] [--to MS] [--columns a,b] [-o out.csv] [--info]
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import zlib
+
+MAGIC = b"CS3S"
+CHUNK_MAGIC = 0x74335343
+MAX_COLUMNS = 16
+HEADER = struct.Struct("<4sHHB3x" + "15sB" * MAX_COLUMNS + "I")
+CHUNK = struct.Struct("<IIqqHBBI")
+FLOAT, INT = 0, 1
+
+
+class BitReader:
+    def __init__(self, data, start, end):
+        self.value = int.from_bytes(data[start:end], "big")
+        self.left = (end - start) * 8
+
+    def get(self, n):
+        if n == 0:
+            return 0
+        if n > self.left:  # Past the end of the stream reads zeros
+            v = (self.value << (n - self.left)) & ((1 << n) - 1) if self.left > 0 else 0
+            self.left = 0
+            return v
+        self.left -= n
+        return (self.value >> self.left) & ((1 << n) - 1)
+
+
+def read_header(data):
+    if len(data) < HEADER.size:
+        raise ValueError("not a CamS3 time-series store")
+    fields = HEADER.unpack_from(data, 0)
+    magic, version, block_size, count = fields[:4]
+    if magic != MAGIC or zlib.crc32(data[:HEADER.size - 4]) != fields[-1]:
+        raise ValueError("not a CamS3 time-series store")
+    columns = [(fields[4 + 2 * i].rstrip(b"\0").decode(), fields[5 + 2 * i]) for i in range(count)]
+    return block_size, columns
+
+
+def chunk_header(data, block_size, index):
+    pos = (index + 1) * block_size
+    if pos + CHUNK.size > len(data):
+        return None
+    h = dict(zip(("magic", "sequence", "first_ms", "last_ms", "rows", "columns", "reserved", "crc32"),
+                 CHUNK.unpack_from(data, pos)))
+    return h if h["magic"] == CHUNK_MAGIC and h["sequence"] == index else None
+
+
+def chunk_valid(data, block_size, index):
+    pos = (index + 1) * block_size
+    block = bytearray(data[pos:pos + block_size])
+    if len(block) < block_size:
+        return False
+    crc = struct.unpack_from("<I", block, CHUNK.size - 4)[0]
+    block[CHUNK.size - 4:CHUNK.size] = bytes(4)
+    return zlib.crc32(block) == crc
+
+
+def decode_chunk(data, block_size, index, columns):
+    """Yield (time, [values]) for every row of a chunk."""
+    pos = (index + 1) * block_size
+    h = chunk_header(data, block_size, index)
+    n = len(columns)
+    ends = struct.unpack_from(f"<{n + 1}H", data, pos + CHUNK.size)
+    start = CHUNK.size + (n + 1) * 2
+    streams = []
+    for end in ends:
+        streams.append(BitReader(data, pos + start, pos + end))
+        start = end
+
+    t, delta = h["first_ms"], 0
+    prev = [0] * n
+    window = [(0, 0)] * n
+    for row in range(h["rows"]):
+        if row > 0:
+            r = streams[0]
+            if r.get(1) == 0:
+                dod = 0
+            elif r.get(1) == 0:
+                dod = r.get(7) - 63
+            elif r.get(1) == 0:
+                dod = r.get(9) - 255
+            elif r.get(1) == 0:
+                dod = r.get(12) - 2047
+            else:
+                dod = r.get(64)
+                dod -= (1 << 64) if dod >> 63 else 0
+            delta += dod
+            t += delta
+
+        values = []
+        for c, (_, ctype) in enumerate(columns):
+            r = streams[c + 1]
+            if ctype == INT:
+                v, shift = 0, 0
+                while shift < 64:
+                    b = r.get(8)
+                    v |= (b & 0x7F) << shift
+                    shift += 7
+                    if not b & 0x80:
+                        break
+                prev[c] += (v >> 1) ^ -(v & 1)
+                values.append(prev[c])
+                continue
+            if row == 0:
+                bits = r.get(32)
+            elif r.get(1) == 0:
+                bits = prev[c]
+            elif r.get(1) == 0:
+                lead, trail = window[c]
+                bits = prev[c] ^ (r.get(32 - lead - trail) << trail)
+            else:
+                lead = r.get(5)
+                length = r.get(5) + 1
+                window[c] = (lead, 32 - lead - length)
+                bits = prev[c] ^ (r.get(length) << window[c][1])
+            prev[c] = bits
+            values.append(struct.unpack("<f", struct.pack("<I", bits))[0])
+        yield t, values
+
+
+def query(data, block_size, columns, from_ms, to_ms):
+    chunks = max(len(data) // block_size - 1, 0)
+    lo, hi = 0, chunks
+    while lo < hi:
+        mid = (lo + hi) // 2
+        h = chunk_header(data, block_size, mid)
+        if h is None:
+            hi = mid  # Damaged or torn header: treat as the end
+        elif h["last_ms"] < from_ms:
+            lo = mid + 1
+        else:
+            hi = mid
+    for index in range(lo, chunks):
+        h = chunk_header(data, block_size, index)
+        if h is None or not chunk_valid(data, block_size, index):
+            print(f"warning: chunk {index} is damaged, skipped", file=sys.stderr)
+            continue
+        if h["first_ms"] > to_ms:
+            return
+        for t, values in decode_chunk(data, block_size, index, columns):
+            if t > to_ms:
+                return
+            if t >= from_ms:
+                yield t, values
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("store")
+    parser.add_argument("--from", dest="from_ms", type=int, default=-(1 << 63), help="range start (inclusive)")
+    parser.add_argument("--to", dest="to_ms", type=int, default=(1 << 63) - 1, help="range end (inclusive)")
+    parser.add_argument("--columns", help="comma-separated columns to print (default: all)")
+    parser.add_argument("-o", "--output", help="output CSV (default: stdout)")
+    parser.add_argument("--info", action="store_true", help="print the schema and chunk summary")
+    args = parser.parse_args()
+
+    with open(args.store, "rb") as f:
+        data = f.read()
+    block_size, columns = read_header(data)
+
+    if args.info:
+        chunks = max(len(data) // block_size - 1, 0)
+        rows = 0
+        first = last = None
+        for i in range(chunks):
+            h = chunk_header(data, block_size, i)
+            if h:
+                rows += h["rows"]
+                first = h["first_ms"] if first is None else first
+                last = h["last_ms"]
+        print(f"{block_size}-byte blocks, {chunks} chunks, {rows} rows, time {first} .. {last}")
+        for name, ctype in columns:
+            print(f"  {name:15s} {'int' if ctype == INT else 'float'}")
+        if rows:
+            print(f"{len(data) / rows:.1f} bytes per row on the card")
+        return
+
+    names = [name for name, _ in columns]
+    pick = list(range(len(names)))
+    if args.columns:
+        wanted = args.columns.split(",")
+        missing = [w for w in wanted if w not in names]
+        if missing:
+            parser.error("unknown column(s): " + ", ".join(missing))
+        pick = [names.index(w) for w in wanted]
+
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.writer(out, lineterminator="\n")
+    writer.writerow(["time"] + [names[i] for i in pick])
+    for t, values in query(data, block_size, columns, args.from_ms, args.to_ms):
+        writer.writerow([t] + [f"{values[i]:.7g}" if columns[i][1] == FLOAT else values[i] for i in pick])
+    if args.output:
+        out.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Decompress a CamS3Library compressed log (.cs3z).
+
+Blocks are found by hopping from header to header; only the blocks that
+overlap the requested byte range are decompressed. A damaged block (torn
+write at power loss) is skipped by searching for the next block header.
+
+Usage: cams3_zlog.py diag.cs3z [-o out.txt] [--range START:END] [--blocks]
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = b"CS3Z"
+BLOCK_MAGIC = 0x7A335343
+MAGIC_BYTES = struct.pack("<I", BLOCK_MAGIC)
+HEADER = struct.Struct("<4sHHHHI")
+BLOCK = struct.Struct("<IHHQIHH")
+STORED = 0x0001
+
+
+def lz4_block_decompress(src, raw_len):
+    out = bytearray()
+    i = 0
+    while i < len(src):
+        token = src[i]
+        i += 1
+        length = token >> 4
+        if length == 15:
+            while True:
+                b = src[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        out += src[i:i + length]
+        i += length
+        if i >= len(src):
+            break
+        offset = src[i] | src[i + 1] << 8
+        i += 2
+        length = token & 15
+        if length == 15:
+            while True:
+                b = src[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        length += 4
+        if offset == 0 or offset > len(out):
+            raise ValueError("bad match offset")
+        start = len(out) - offset
+        for k in range(length):  # Matches may overlap their own output
+            out.append(out[start + k])
+    if len(out) != raw_len:
+        raise ValueError("bad block length")
+    return bytes(out)
+
+
+def blocks(data):
+    """Yield (position, header dict) for every intact block header."""
+    if len(data) < HEADER.size:
+        raise ValueError("not a CamS3 compressed log")
+    fields = HEADER.unpack_from(data, 0)
+    if fields[0] != MAGIC or zlib.crc32(data[:HEADER.size - 4]) != fields[-1] or fields[3] != BLOCK.size:
+        raise ValueError("not a CamS3 compressed log")
+    pos = HEADER.size
+    while pos + BLOCK.size <= len(data):
+        fields = BLOCK.unpack_from(data, pos)
+        block = dict(zip(("magic", "raw_len", "packed_len", "offset", "raw_crc", "flags", "header_crc"), fields))
+        end = pos + BLOCK.size + block["packed_len"]
+        # A torn block followed by more data still has an intact header; its end must meet the next block
+        if (block["magic"] == BLOCK_MAGIC
+                and zlib.crc32(data[pos:pos + BLOCK.size - 2]) & 0xFFFF == block["header_crc"]
+                and (end == len(data) or data[end:end + 4] == MAGIC_BYTES)):
+            yield pos, block
+            pos = end
+            continue
+        # Resynchronize on the next header
+        found = data.find(MAGIC_BYTES, pos + 1)
+        if found < 0:
+            return
+        print(f"warning: skipped {found - pos} damaged bytes at {pos}", file=sys.stderr)
+        pos = found
+
+
+def decode(data, pos, block):
+    payload = data[pos + BLOCK.size:pos + BLOCK.size + block["packed_len"]]
+    raw = payload if block["flags"] & STORED else lz4_block_decompress(payload, block["raw_len"])
+    if zlib.crc32(raw) != block["raw_crc"]:
+        raise ValueError(f"CRC mismatch in block at {pos}")
+    return raw
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    parser.add_argument("--range", help="uncompressed byte range START:END (either may be omitted)")
+    parser.add_argument("--blocks", action="store_true", help="list the blocks instead of decompressing")
+    args = parser.parse_args()
+
+    with open(args.log, "rb") as f:
+        data = f.read()
+
+    start, end = 0, None
+    if args.range:
+        a, _, b = args.range.partition(":")
+        start = int(a) if a else 0
+        end = int(b) if b else None
+
+    if args.blocks:
+        raw = packed = 0
+        for pos, block in blocks(data):
+            kind = "stored" if block["flags"] & STORED else "lz4"
+            print(f"{pos:10d} {block['offset']:12d} {block['raw_len']:6d} -> {block['packed_len']:6d} {kind}")
+            raw += block["raw_len"]
+            packed += BLOCK.size + block["packed_len"]
+        if packed:
+            print(f"{raw} bytes in {packed} ({raw / packed:.1f}:1)", file=sys.stderr)
+        return
+
+    out = open(args.output, "wb") if args.output else sys.stdout.buffer
+    for pos, block in blocks(data):
+        first, last = block["offset"], block["offset"] + block["raw_len"]
+        if last <= start or (end is not None and first >= end):
+            continue
+        try:
+            raw = decode(data, pos, block)
+        except ValueError as e:
+            print(f"warning: {e}", file=sys.stderr)
+            continue
+        out.write(raw[max(start - first, 0):(end - first) if end is not None else None])
+    if args.output:
+        out.close()
+
+
+if __name__ == "__main__":
+    main()
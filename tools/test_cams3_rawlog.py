@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Checkpoint recovery tests for cams3_rawlog.py.
+
+Builds region images the way CamS3_RawLog writes them (checkpoint slots
+written alternately, records packed back to back from sector 2), damages
+them as a power cut or a bad copy would, and reads them back.
+
+Usage: python3 -m unittest tools/test_cams3_rawlog.py
+"""
+
+import os
+import struct
+import sys
+import unittest
+import zlib
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import cams3_rawlog as rawlog  # noqa: E402
+
+SESSION = 0x1234ABCD
+DATA_SECTORS = 64
+
+
+class Region:
+    """Minimal model of the device writer."""
+
+    def __init__(self, session=SESSION, data_sectors=DATA_SECTORS):
+        self.session = session
+        self.data_sectors = data_sectors
+        self.image = bytearray((rawlog.DATA_START + data_sectors) * rawlog.SECTOR)
+        self.stream = bytearray()
+        self.sequence = 0
+        self.checkpoint_count = 0
+
+    def record(self, payload, kind=3, time_us=0):
+        header = struct.pack("<IIIIqIBBHI", rawlog.RECORD_MAGIC, self.session, self.sequence, len(payload),
+                             time_us, 0, kind, 0, 0, zlib.crc32(payload))
+        self.stream += header + struct.pack("<I", zlib.crc32(header)) + payload
+        self.sequence += 1
+        start = rawlog.DATA_START * rawlog.SECTOR
+        self.image[start:start + len(self.stream)] = self.stream
+
+    def checkpoint(self):
+        body = struct.pack("<4sHHIIIIQqq", rawlog.MAGIC, 1, rawlog.RECORD.size, self.session,
+                           self.checkpoint_count, self.data_sectors, self.sequence, len(self.stream), 0, 0)
+        slot = (self.checkpoint_count & 1) * rawlog.SECTOR
+        sector = body + struct.pack("<I", zlib.crc32(body))
+        self.image[slot:slot + rawlog.SECTOR] = sector.ljust(rawlog.SECTOR, b"\0")
+        self.checkpoint_count += 1
+        return slot
+
+    def read(self, data=None):
+        data = bytes(self.image if data is None else data)
+        cp = rawlog.read_checkpoint(data)
+        return cp, [rec["sequence"] for rec, _ in rawlog.records(data, cp)]
+
+
+class CheckpointRecoveryTest(unittest.TestCase):
+    def setUp(self):
+        # Two checkpoints: #0 in slot 0 covers 3 records, #1 in slot 1 covers 5, then 2 more unsynced
+        self.region = Region()
+        for i in range(3):
+            self.region.record(bytes([i]) * (100 + 200 * i))
+        self.region.checkpoint()
+        for i in range(3, 5):
+            self.region.record(bytes([i]) * 700)
+        self.newest = self.region.checkpoint()
+        for i in range(5, 7):
+            self.region.record(bytes([i]) * 50)
+
+    def test_newest_checkpoint_wins(self):
+        cp, seqs = self.region.read()
+        self.assertEqual(cp["checkpoint"], 1)
+        self.assertEqual(cp["records"], 5)
+        self.assertEqual(seqs, list(range(7)))
+
+    def test_corrupt_newest_checkpoint_falls_back(self):
+        self.region.image[self.newest + 20] ^= 0xFF
+        cp, seqs = self.region.read()
+        self.assertEqual(cp["checkpoint"], 0)
+        self.assertEqual(cp["records"], 3)
+        # Records past the surviving checkpoint are still recovered from their own CRCs
+        self.assertEqual(seqs, list(range(7)))
+
+    def test_torn_newest_checkpoint_falls_back(self):
+        # Power lost halfway through the checkpoint sector write
+        half = rawlog.CHECKPOINT.size // 2
+        self.region.image[self.newest + half:self.newest + rawlog.SECTOR] = bytes(rawlog.SECTOR - half)
+        cp, seqs = self.region.read()
+        self.assertEqual(cp["checkpoint"], 0)
+        self.assertEqual(seqs, list(range(7)))
+
+    def test_truncated_file_stops_at_last_whole_record(self):
+        # A copy cut short inside record 4: the checkpoint survives, the reader stops before the gap
+        stream = rawlog.DATA_START * rawlog.SECTOR
+        cut = stream + len(self.region.stream) - 2 * (rawlog.RECORD.size + 50) - 300
+        cp, seqs = self.region.read(self.region.image[:cut])
+        self.assertEqual(cp["checkpoint"], 1)
+        self.assertEqual(seqs, list(range(4)))
+
+    def test_truncated_into_checkpoint_slot(self):
+        # Only part of slot 0 was copied: no checkpoint is left to trust
+        with self.assertRaises(ValueError):
+            self.region.read(self.region.image[:rawlog.CHECKPOINT.size - 1])
+
+    def test_both_checkpoints_corrupt(self):
+        self.region.image[4] ^= 0xFF
+        self.region.image[self.newest + 4] ^= 0xFF
+        with self.assertRaises(ValueError):
+            self.region.read()
+
+    def test_stale_session_is_not_followed(self):
+        # A new session over an old region: the old records beyond the new head must not be read
+        fresh = Region(session=SESSION + 2)
+        fresh.image[:] = self.region.image
+        fresh.image[rawlog.SECTOR:2 * rawlog.SECTOR] = bytes(rawlog.SECTOR)  # begin() clears slot 1
+        fresh.record(b"new" * 10)
+        fresh.checkpoint()
+        cp, seqs = fresh.read()
+        self.assertEqual(cp["session"], SESSION + 2)
+        self.assertEqual(seqs, [0])
+
+    def test_corrupt_record_ends_the_stream(self):
+        # Damage to the payload of record 5, written after the last checkpoint
+        offset = rawlog.DATA_START * rawlog.SECTOR + len(self.region.stream) - (rawlog.RECORD.size + 50) - 10
+        self.region.image[offset] ^= 0xFF
+        cp, seqs = self.region.read()
+        self.assertEqual(cp["records"], 5)
+        self.assertEqual(seqs, list(range(5)))
+
+
+if __name__ == "__main__":
+    unittest.main()